@@ -23,6 +23,7 @@
 #include "ImfTiledMisc.h"
 #include "ImfTiledOutputPart.h"
 
+#include <algorithm>
 #include <chrono>
 #include <ctime>
 #include <list>
@@ -30,6 +31,16 @@
 #include <vector>
 #include <sys/stat.h>
 
+#ifdef _WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#    include <psapi.h>
+#else
+#    include <sys/resource.h>
+#endif
+
 using namespace OPENEXR_IMF_NAMESPACE;
 using IMATH_NAMESPACE::Box2i;
 
@@ -38,6 +49,7 @@ using namespace std::chrono;
 using std::cout;
 using std::endl;
 using std::list;
+using std::max;
 using std::min;
 using std::runtime_error;
 using std::string;
@@ -944,6 +956,46 @@ accumulate (vector<double>& output, const vector<double>& input)
     }
 }
 
+//
+// log where the time went while reading 'in' since its counters were reset
+//
+void
+logStages (const MultiPartInputFile& in, stageStats& stages)
+{
+    exr_perf_counters_t counters = in.perfCounters ();
+    stages.ioPerf.push_back (counters.stage_ns[EXR_TRACE_STAGE_READ] * 1e-9);
+    stages.decompressPerf.push_back (
+        counters.stage_ns[EXR_TRACE_STAGE_DECOMPRESS] * 1e-9);
+    stages.unpackPerf.push_back (
+        counters.stage_ns[EXR_TRACE_STAGE_UNPACK] * 1e-9);
+    stages.bytesRead = counters.bytes_read;
+    stages.peakBufferSize =
+        max (stages.peakBufferSize, counters.peak_buffer_bytes);
+}
+
+uint64_t
+peakMemoryUsage ()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo (
+            GetCurrentProcess (), &counters, sizeof (counters)))
+    {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage (RUSAGE_SELF, &usage)) { return 0; }
+#    ifdef __APPLE__
+    return usage.ru_maxrss;
+#    else
+    // reported in kilobytes
+    return uint64_t (usage.ru_maxrss) * 1024;
+#    endif
+#endif
+}
+
 string
 modeName (PixelMode p)
 {
@@ -1067,7 +1119,10 @@ exrmetrics (
     vector<partData> parts (part == -1 ? in.parts () : 1);
     metrics.stats.resize (parts.size ());
 
+    // don't count reading the header
+    in.resetPerfCounters ();
     initAndReadFile (in, outHeaders, part, parts, metrics, reread);
+    logStages (in, metrics.readStages);
 
     if (write)
     {
@@ -1133,7 +1188,9 @@ exrmetrics (
                 if (outFileName) { in = new MultiPartInputFile (outFileName); }
                 else { in = new MultiPartInputFile (istream); }
 
+                in->resetPerfCounters ();
                 rereadFile (*in, parts, metrics);
+                logStages (*in, metrics.rereadStages);
 
                 delete in;
             }
@@ -1193,6 +1250,8 @@ exrmetrics (
         }
     }
 
+    metrics.peakMemory = peakMemoryUsage ();
+
     if (verbose) { cerr << endl; }
     return metrics;
 }
@@ -54,12 +54,33 @@ struct partStats
     partSizeData sizeData;
 };
 
+//
+// breakdown of the time spent reading a file, from the counters of the
+// Core context. Stage times are summed over all threads, so with a
+// thread pool they measure CPU time and can add up to more than the
+// read time
+//
+struct stageStats
+{
+    std::vector<double> ioPerf;         // time fetching chunks from the file
+    std::vector<double> decompressPerf; // time decompressing chunks
+    std::vector<double> unpackPerf; // time unpacking into the frame buffer
+    uint64_t            bytesRead = 0; // bytes read by each pass
+    uint64_t            peakBufferSize =
+        0; // largest total size of the decoding buffers in any pass
+};
+
 struct fileMetrics
 {
     std::vector<partStats> stats;
     partStats              totalStats;
+    stageStats             readStages;
+    stageStats             rereadStages;
     uint64_t               inputFileSize;
     uint64_t               outputFileSize;
+    uint64_t               peakMemory =
+        0; // high water mark of the process resident size, in bytes, since
+           // the process started: cumulative across runs, not per run
 };
 
 fileMetrics exrmetrics (
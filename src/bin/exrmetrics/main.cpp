@@ -63,6 +63,10 @@ usageMessage (ostream& stream, const char* program_name, bool verbose = false)
                "  -m                          set to multi-threaded (system selected thread count)\n"
                "  -t n                        Use a pool of n worker threads for processing files.\n"
                "                              Default is single threaded (no thread pool)\n"
+               "  --threads list              comma separated list of thread counts to repeat\n"
+               "                              every test with, to measure how it scales\n"
+               "                              (e.g. 0,1,2,4,8; 'm' for system selected count)\n"
+               "                              cannot be combined with -t or -m\n"
                "\n"
                "  -l level                    set DWA or ZIP compression level\n"
                "\n"
@@ -89,6 +93,14 @@ usageMessage (ostream& stream, const char* program_name, bool verbose = false)
                " --csv                        print output in csv mode. If passes>1, show median timing\n"
                "                              default is JSON mode\n"
                " --passes num                 write and re-read file num times (default 1)\n"
+               "                              with more than one pass, JSON output includes\n"
+               "                              median, 90th and 99th percentile times\n"
+               "\n"
+               "  Timed reads and re-reads also report the time spent in each stage of\n"
+               "  decoding (io, decompress, unpack), summed over all threads, along\n"
+               "  with the bytes read and the peak size of the decoding buffers in\n"
+               "  that run. 'process peak memory' is the high water mark of the whole\n"
+               "  exrmetrics process so far, so it is cumulative, not per run\n"
                "\n"
                "  -h, --help                  print this message\n"
                "  -v                          output progress messages\n"
@@ -112,6 +124,8 @@ struct options
     std::vector<const char*> inFiles;
     int                      part    = -1;
     int                      threads = 0;
+    bool                     threadsSet = false; // -t or -m given
+    std::vector<int>         threadCounts;
     float                    level   = INFINITY;
     int                      passes  = 1;
     int                      timing  = TIME_READ | TIME_REREAD | TIME_WRITE;
@@ -129,6 +143,7 @@ struct runData
     const char* file;
     PixelMode   mode;
     Compression compression;
+    int         threads;
     fileMetrics metrics;
 };
 
@@ -141,6 +156,20 @@ median (const vector<double>& perf)
     return (d[d.size () / 2] + d[(d.size () - 1) / 2]) / 2.0;
 }
 
+// linearly interpolated value below which 'fraction' of the values lie
+double
+percentile (const vector<double>& perf, double fraction)
+{
+    if (perf.size () == 0) { return 0.; }
+    if (perf.size () == 1) { return perf[0]; }
+    vector<double> d = perf;
+    sort (d.begin (), d.end ());
+    double position = fraction * (d.size () - 1);
+    size_t below    = size_t (position);
+    if (below + 1 >= d.size ()) { return d.back (); }
+    return d[below] + (d[below + 1] - d[below]) * (position - below);
+}
+
 void
 printTiming (const vector<double>& perf, ostream& out, bool raw, bool stats)
 {
@@ -184,7 +213,8 @@ printTiming (const vector<double>& perf, ostream& out, bool raw, bool stats)
     {
         out << "\"min\": " << minimum << ", \"max\": " << maximum
             << ", \"mean\": " << sum / n << ", \"median\": " << median (perf)
-            << ", \"std dev\": ";
+            << ", \"p90\": " << percentile (perf, 0.9)
+            << ", \"p99\": " << percentile (perf, 0.99) << ", \"std dev\": ";
         out << sqrt ((x2 - x * x / n) / n);
     }
     out << "}";
@@ -238,6 +268,27 @@ printPartStats (
     }
 }
 
+void
+printStageStats (
+    ostream&          out,
+    const stageStats& data,
+    const string      indent,
+    bool              raw,
+    bool              stats)
+{
+    out << "{\n";
+    out << indent << "  \"io time\": ";
+    printTiming (data.ioPerf, out, raw, stats);
+    out << ",\n" << indent << "  \"decompress time\": ";
+    printTiming (data.decompressPerf, out, raw, stats);
+    out << ",\n" << indent << "  \"unpack time\": ";
+    printTiming (data.unpackPerf, out, raw, stats);
+    out << ",\n" << indent << "  \"bytes read\": " << data.bytesRead;
+    out << ",\n"
+        << indent << "  \"peak buffer size\": " << data.peakBufferSize;
+    out << "\n" << indent << "}";
+}
+
 void
 jsonStats (
     ostream&       out,
@@ -359,7 +410,8 @@ jsonStats (
         out << '\n';
         out << "    {\n";
         out << "      \"compression\": \"" << compName << "\",\n";
-        out << "      \"pixel mode\": \"" << modeName (run.mode) << "\"";
+        out << "      \"pixel mode\": \"" << modeName (run.mode) << "\",\n";
+        out << "      \"threads\": " << run.threads;
 
         if (outputSizeData)
         {
@@ -371,6 +423,20 @@ jsonStats (
             out << ",\n";
             printPartStats (
                 out, run.metrics.totalStats, "      ", timing, raw, stats);
+            if (timing & options::TIME_READ)
+            {
+                out << ",\n      \"read stages\": ";
+                printStageStats (
+                    out, run.metrics.readStages, "      ", raw, stats);
+            }
+            if (timing & options::TIME_REREAD)
+            {
+                out << ",\n      \"re-read stages\": ";
+                printStageStats (
+                    out, run.metrics.rereadStages, "      ", raw, stats);
+            }
+            out << ",\n";
+            out << "      \"process peak memory\": " << run.metrics.peakMemory;
         }
         if (timing && run.metrics.stats.size () > 1)
         {
@@ -417,19 +483,29 @@ csvStats (ostream& out, list<runData>& data, bool outputSizeData, int timing)
     {
         out << ",input size,pixel count,channel count,tile count,raw size";
     }
-    out << ",compression,pixel mode";
+    out << ",compression,pixel mode,threads";
     if (outputSizeData) { out << ",output size"; }
     if (timing & options::TIME_READ)
     {
         out << ",count read time";
         out << ",read time";
+        out << ",read io time,read decompress time,read unpack time";
+        out << ",read peak buffer size";
+    }
+    if (timing & options::TIME_WRITE)
+    {
+        out << ",write time";
+        out << ",write time p90";
     }
-    if (timing & options::TIME_WRITE) { out << ",write time"; }
     if (timing & options::TIME_REREAD)
     {
         out << ",count reread time";
         out << ",reread time";
+        out << ",reread time p90";
+        out << ",reread io time,reread decompress time,reread unpack time";
+        out << ",reread peak buffer size";
     }
+    if (timing) { out << ",process peak memory"; }
     cout << "\n";
     for (runData run: data)
     {
@@ -452,7 +528,8 @@ csvStats (ostream& out, list<runData>& data, bool outputSizeData, int timing)
             compName = "original";
         }
         else { getCompressionNameFromId (run.compression, compName); }
-        out << ',' << compName << ',' << modeName (run.mode);
+        out << ',' << compName << ',' << modeName (run.mode) << ','
+            << run.threads;
 
         if (outputSizeData) { out << ',' << run.metrics.outputFileSize; }
         if (timing & options::TIME_READ)
@@ -463,10 +540,15 @@ csvStats (ostream& out, list<runData>& data, bool outputSizeData, int timing)
             }
             else { out << ",---"; }
             out << ',' << median (run.metrics.totalStats.readPerf);
+            out << ',' << median (run.metrics.readStages.ioPerf) << ','
+                << median (run.metrics.readStages.decompressPerf) << ','
+                << median (run.metrics.readStages.unpackPerf) << ','
+                << run.metrics.readStages.peakBufferSize;
         }
         if (timing & options::TIME_WRITE)
         {
             out << ',' << median (run.metrics.totalStats.writePerf);
+            out << ',' << percentile (run.metrics.totalStats.writePerf, 0.9);
         }
         if (timing & options::TIME_REREAD)
         {
@@ -476,7 +558,13 @@ csvStats (ostream& out, list<runData>& data, bool outputSizeData, int timing)
             }
             else { out << ",---"; }
             out << ',' << median (run.metrics.totalStats.rereadPerf);
+            out << ',' << percentile (run.metrics.totalStats.rereadPerf, 0.9);
+            out << ',' << median (run.metrics.rereadStages.ioPerf) << ','
+                << median (run.metrics.rereadStages.decompressPerf) << ','
+                << median (run.metrics.rereadStages.unpackPerf) << ','
+                << run.metrics.rereadStages.peakBufferSize;
         }
+        if (timing) { out << ',' << run.metrics.peakMemory; }
         out << "\n";
     }
 }
@@ -492,11 +580,6 @@ main (int argc, char** argv)
     list<runData> data;
     try
     {
-        if (opts.threads < 0)
-            setGlobalThreadCount (ThreadPool::estimateThreadCountForFileIO ());
-        else
-            setGlobalThreadCount (opts.threads);
-
         for (const char* inFile: opts.inFiles)
         {
             bool hasDeep = false;
@@ -518,23 +601,34 @@ main (int argc, char** argv)
                 {
                     for (PixelMode mode: opts.pixelModes)
                     {
-                        runData d;
-                        d.file        = inFile;
-                        d.compression = compression;
-                        d.mode        = mode;
-                        d.metrics     = exrmetrics (
-                            inFile,
-                            opts.outFile,
-                            opts.part,
-                            compression,
-                            opts.level,
-                            opts.passes,
-                            opts.outFile || opts.outputSizeData ||
-                                opts.timing & options::TIME_WRITE,
-                            opts.timing & options::TIME_REREAD,
-                            mode,
-                            opts.verbose);
-                        data.push_back (d);
+                        for (int threads: opts.threadCounts)
+                        {
+                            if (threads < 0)
+                            {
+                                threads = ThreadPool::
+                                    estimateThreadCountForFileIO ();
+                            }
+                            setGlobalThreadCount (threads);
+
+                            runData d;
+                            d.file        = inFile;
+                            d.compression = compression;
+                            d.mode        = mode;
+                            d.threads     = threads;
+                            d.metrics     = exrmetrics (
+                                inFile,
+                                opts.outFile,
+                                opts.part,
+                                compression,
+                                opts.level,
+                                opts.passes,
+                                opts.outFile || opts.outputSizeData ||
+                                    opts.timing & options::TIME_WRITE,
+                                opts.timing & options::TIME_REREAD,
+                                mode,
+                                opts.verbose);
+                            data.push_back (d);
+                        }
                     }
                 }
             }
@@ -612,7 +706,8 @@ options::parse (int argc, char* argv[])
         }
         else if (!strcmp (argv[i], "-m"))
         {
-            threads = -1;
+            threads    = -1;
+            threadsSet = true;
             i += 1;
         }
         else if (!strcmp (argv[i], "-t"))
@@ -623,7 +718,8 @@ options::parse (int argc, char* argv[])
                 return 1;
             }
 
-            threads = atoi (argv[i + 1]);
+            threads    = atoi (argv[i + 1]);
+            threadsSet = true;
             if (threads < 0)
             {
                 cerr << "bad thread count " << argv[i + 1]
@@ -633,6 +729,33 @@ options::parse (int argc, char* argv[])
 
             i += 2;
         }
+        else if (!strcmp (argv[i], "--threads"))
+        {
+            if (i > argc - 2)
+            {
+                cerr << "Missing thread count list with --threads option\n";
+                return 1;
+            }
+            std::list<string> items = split (argv[i + 1], ',');
+            threadCounts.clear ();
+            for (string i: items)
+            {
+                if (i == "m") { threadCounts.push_back (-1); }
+                else
+                {
+                    char* end   = nullptr;
+                    long  count = strtol (i.c_str (), &end, 10);
+                    if (i.empty () || *end != '\0' || count < 0)
+                    {
+                        cerr << "bad thread count " << i
+                             << " specified to --threads option\n";
+                        return 1;
+                    }
+                    threadCounts.push_back (int (count));
+                }
+            }
+            i += 2;
+        }
         else if (!strcmp (argv[i], "--bench"))
         {
             compressions.clear ();
@@ -909,5 +1032,13 @@ options::parse (int argc, char* argv[])
         compressions.push_back (NUM_COMPRESSION_METHODS);
     }
 
+    if (threadCounts.size () == 0) { threadCounts.push_back (threads); }
+    else if (threadsSet)
+    {
+        cerr << "-t and -m cannot be combined with --threads: "
+                "add the count to the --threads list instead\n";
+        return 1;
+    }
+
     return 0;
 }
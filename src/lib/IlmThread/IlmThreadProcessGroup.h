@@ -24,6 +24,7 @@
 #include "Iex.h"
 
 #include <atomic>
+#include <iostream>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -0,0 +1,178 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+//-----------------------------------------------------------------------------
+//
+//	Constant chunks
+//
+//-----------------------------------------------------------------------------
+
+#include "ImfConstantChunks.h"
+
+#include "ImfChannelList.h"
+#include "ImfHeader.h"
+#include "ImfIO.h"
+#include "ImfMisc.h"
+#include "ImfOpaqueAttribute.h"
+#include "ImfPartType.h"
+#include "ImfXdr.h"
+
+#include <string.h>
+
+#include "ImfNamespace.h"
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
+
+namespace
+{
+
+const char attrName[] = "constantChunks";
+const char typeName[] = "constchunks";
+
+const OpaqueAttribute*
+findConstantChunks (const Header& header)
+{
+    Header::ConstIterator i = header.find (attrName);
+
+    if (i == header.end ()) return 0;
+
+    const OpaqueAttribute* attr =
+        dynamic_cast<const OpaqueAttribute*> (&i.attribute ());
+
+    if (!attr || strcmp (attr->typeName (), typeName)) return 0;
+
+    return attr;
+}
+
+int
+channelBytesPerPixel (const Header& header)
+{
+    int bpp = 0;
+
+    for (ChannelList::ConstIterator i = header.channels ().begin ();
+         i != header.channels ().end ();
+         ++i)
+    {
+        bpp += pixelTypeSize (i.channel ().type);
+    }
+
+    return bpp;
+}
+
+} // namespace
+
+void
+addConstantChunks (Header& header)
+{
+    if (header.hasType () && isDeepData (header.type ())) return;
+
+    if (!findConstantChunks (header))
+        header.insert (attrName, OpaqueAttribute (typeName));
+}
+
+bool
+hasConstantChunks (const Header& header)
+{
+    return findConstantChunks (header) != 0;
+}
+
+bool
+ConstantChunkTable::prepare (Header& header)
+{
+    if (!findConstantChunks (header)) return false;
+
+    if (header.hasType () && isDeepData (header.type ()))
+    {
+        header.erase (attrName);
+        return false;
+    }
+
+    int numChunks = getChunkOffsetTableSize (header);
+    int bpp       = channelBytesPerPixel (header);
+    int mapSize   = (numChunks + 7) / 8;
+
+    std::vector<char> data (
+        2 * Xdr::size<int> () + mapSize + size_t (numChunks) * bpp, 0);
+
+    char* p = data.data ();
+    Xdr::write<CharPtrIO> (p, numChunks);
+    Xdr::write<CharPtrIO> (p, bpp);
+
+    header.insert (
+        attrName,
+        OpaqueAttribute (typeName, long (data.size ()), data.data ()));
+
+    return true;
+}
+
+const char*
+ConstantChunkTable::attributeName ()
+{
+    return attrName;
+}
+
+ConstantChunkTable::ConstantChunkTable () : _numChunks (0), _bytesPerPixel (0)
+{
+    // empty
+}
+
+ConstantChunkTable::ConstantChunkTable (const Header& header)
+    : _numChunks (0), _bytesPerPixel (0)
+{
+    const OpaqueAttribute* attr = findConstantChunks (header);
+
+    if (!attr || attr->dataSize () < 2 * Xdr::size<int> ()) return;
+
+    const char* p = attr->data ();
+    Xdr::read<CharPtrIO> (p, _numChunks);
+    Xdr::read<CharPtrIO> (p, _bytesPerPixel);
+
+    _data.assign (
+        (const char*) attr->data (),
+        (const char*) attr->data () + attr->dataSize ());
+}
+
+void
+ConstantChunkTable::set (int chunk, const char value[])
+{
+    int   mapSize = (_numChunks + 7) / 8;
+    char* map     = _data.data () + 2 * Xdr::size<int> ();
+
+    map[chunk / 8] |= char (1 << (chunk % 8));
+    memcpy (
+        map + mapSize + size_t (chunk) * _bytesPerPixel,
+        value,
+        _bytesPerPixel);
+}
+
+bool
+ConstantChunkTable::isSet (int chunk) const
+{
+    if (chunk < 0 || chunk >= _numChunks) return false;
+
+    const char* map = _data.data () + 2 * Xdr::size<int> ();
+
+    return (map[chunk / 8] & (1 << (chunk % 8))) != 0;
+}
+
+bool
+ConstantChunkTable::sameSamples (
+    const char data[], const char value[], size_t numSamples, int sampleSize)
+{
+    for (size_t i = 0; i < numSamples; ++i, data += sampleSize)
+        if (memcmp (data, value, sampleSize)) return false;
+
+    return true;
+}
+
+void
+ConstantChunkTable::writeTo (
+    OPENEXR_IMF_INTERNAL_NAMESPACE::OStream& os, uint64_t position) const
+{
+    os.seekp (position);
+    os.write (_data.data (), int (_data.size ()));
+}
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_EXIT
@@ -0,0 +1,129 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifndef INCLUDED_IMF_CONSTANT_CHUNKS_H
+#define INCLUDED_IMF_CONSTANT_CHUNKS_H
+
+//-----------------------------------------------------------------------------
+//
+//	Constant chunks
+//
+//	A scan line or tiled image part whose header contains a
+//	"constantChunks" attribute does not store the pixel data of
+//	chunks (tiles or blocks of scan lines) in which every pixel has
+//	the same value, such as the empty regions of masks, ID passes
+//	or holdouts.  Instead, the attribute records which chunks were
+//	left out and the value of their pixels, and the chunks' entries
+//	in the offset table are 0.  Readers fill these chunks with their
+//	value without reading or decompressing anything.
+//
+//	Readers that predate the attribute treat the chunks that were
+//	left out as missing.
+//
+//	The attribute is filled in by OutputFile and TiledOutputFile
+//	as they write the image; call addConstantChunks() on the header
+//	before the file is created to enable it:
+//
+//	    Header header (width, height);
+//	    header.setTileDescription (TileDescription (64, 64));
+//	    addConstantChunks (header);
+//
+//	    TiledOutputFile out ("mask.exr", header);
+//
+//-----------------------------------------------------------------------------
+
+#include "ImfForward.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
+
+//
+// Enable constant chunks for the part described by a header.
+// Has no effect on deep parts.
+//
+
+IMF_EXPORT void addConstantChunks (Header& header);
+
+//
+// Check if a header has the constantChunks attribute.
+//
+
+IMF_EXPORT bool hasConstantChunks (const Header& header);
+
+//
+// The value of the constantChunks attribute, as the output files
+// build it.  The layout matches the reader in OpenEXRCore (see
+// openexr_chunkio.h): the number of chunks and the number of bytes
+// per pixel, a bit per chunk, and then one pixel value per chunk,
+// all in Xdr format.
+//
+
+class IMF_EXPORT_TYPE ConstantChunkTable
+{
+public:
+    //
+    // Size the header's constantChunks attribute, if any, to hold one
+    // entry for every chunk in the part, with no constant chunks.
+    // The header must be complete.  Returns false if the part does
+    // not use constant chunks.
+    //
+
+    IMF_EXPORT static bool prepare (Header& header);
+
+    //
+    // The name of the attribute.
+    //
+
+    IMF_EXPORT static const char* attributeName ();
+
+    //
+    // Construct an empty table, or one for a prepared header.
+    //
+
+    IMF_EXPORT ConstantChunkTable ();
+    IMF_EXPORT explicit ConstantChunkTable (const Header& header);
+
+    bool enabled () const { return !_data.empty (); }
+    int  bytesPerPixel () const { return _bytesPerPixel; }
+
+    //
+    // Mark a chunk as constant; value holds bytesPerPixel() bytes,
+    // one Xdr value per channel in channel list order.
+    //
+
+    IMF_EXPORT void set (int chunk, const char value[]);
+    IMF_EXPORT bool isSet (int chunk) const;
+
+    //
+    // Check if numSamples samples of sampleSize bytes, starting at
+    // data, all have the given value.
+    //
+
+    IMF_EXPORT static bool sameSamples (
+        const char data[],
+        const char value[],
+        size_t     numSamples,
+        int        sampleSize);
+
+    //
+    // Write the attribute value at the given stream position,
+    // as returned by Header::writeTo().
+    //
+
+    IMF_EXPORT void writeTo (
+        OPENEXR_IMF_INTERNAL_NAMESPACE::OStream& os, uint64_t position) const;
+
+private:
+    std::vector<char> _data;
+    int               _numChunks;
+    int               _bytesPerPixel;
+};
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif
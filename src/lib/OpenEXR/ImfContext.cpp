@@ -233,6 +233,27 @@ Context::partCount () const
 
 ////////////////////////////////////////
 
+int
+Context::partIndex (const char* name) const
+{
+    int          partidx = -1;
+    exr_result_t rv      = exr_get_part_index (*_ctxt, name, &partidx);
+
+    if (rv == EXR_ERR_NO_ATTR_BY_NAME) return -1;
+    if (rv != EXR_ERR_SUCCESS)
+    {
+        THROW (
+            IEX_NAMESPACE::ArgExc,
+            "Unable to look up part '" << (name ? name : "<null>")
+                                       << "' in file '" << fileName ()
+                                       << "'");
+    }
+
+    return partidx;
+}
+
+////////////////////////////////////////
+
 exr_storage_t
 Context::storage (int partidx) const
 {
@@ -845,4 +866,34 @@ Context::chunkTableValid (int partidx) const
     return exr_validate_chunk_table (*_ctxt, partidx) == EXR_ERR_SUCCESS;
 }
 
+////////////////////////////////////////
+
+exr_perf_counters_t
+Context::perfCounters () const
+{
+    exr_perf_counters_t counters;
+
+    if (EXR_ERR_SUCCESS != exr_get_perf_counters (*_ctxt, &counters))
+    {
+        THROW (
+            IEX_NAMESPACE::ArgExc,
+            "Unable to get performance counters from context");
+    }
+
+    return counters;
+}
+
+////////////////////////////////////////
+
+void
+Context::resetPerfCounters ()
+{
+    if (EXR_ERR_SUCCESS != exr_reset_perf_counters (*_ctxt))
+    {
+        THROW (
+            IEX_NAMESPACE::ArgExc,
+            "Unable to reset performance counters of context");
+    }
+}
+
 OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_EXIT
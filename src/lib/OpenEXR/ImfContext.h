@@ -60,6 +60,9 @@ public:
 
     IMF_EXPORT int partCount () const;
 
+    // index of the first part with the given name, -1 if there is none
+    IMF_EXPORT int partIndex (const char* name) const;
+
     IMF_EXPORT exr_storage_t storage (int partidx) const;
 
     // access to commonly used attributes
@@ -89,6 +92,12 @@ public:
 
     IMF_EXPORT bool chunkTableValid (int partidx) const;
 
+    // counters accumulated while reading / writing, see
+    // exr_get_perf_counters
+
+    IMF_EXPORT exr_perf_counters_t perfCounters () const;
+    IMF_EXPORT void resetPerfCounters ();
+
 private:
     std::shared_ptr<exr_context_t> _ctxt;
 }; // class Context
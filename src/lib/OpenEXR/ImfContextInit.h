@@ -105,6 +105,20 @@ public:
         return *this;
     }
 
+    ContextInitializer& setMemoryBudget (size_t bytes) noexcept
+    {
+        _initializer.memory_budget = bytes;
+        return *this;
+    }
+
+    ContextInitializer&
+    setTraceFunction (exr_trace_func_ptr_t tracefn, void* user) noexcept
+    {
+        _initializer.trace_fn        = tracefn;
+        _initializer.trace_user_data = user;
+        return *this;
+    }
+
     ContextInitializer& strictHeaderValidation (bool onoff) noexcept
     {
         setFlag (EXR_CONTEXT_FLAG_STRICT_HEADER, onoff);
@@ -44,6 +44,8 @@ class IMF_EXPORT_TYPE AcesOutputFile;
 class IMF_EXPORT_TYPE TiledInputPart;
 class IMF_EXPORT_TYPE TiledInputFile;
 class IMF_EXPORT_TYPE TileOffsets;
+class IMF_EXPORT_TYPE TileCache;
+class IMF_EXPORT_TYPE SequenceReader;
 
 // multipart file handling
 class IMF_EXPORT_TYPE GenericInputFile;
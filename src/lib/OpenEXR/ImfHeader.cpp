@@ -42,7 +42,9 @@
 #include <ImfVersion.h>
 #include <atomic>
 #include <cmath>
+#include <memory>
 #include <sstream>
+#include <unordered_map>
 #include <stdlib.h>
 #include <time.h>
 #include <openexr_base.h>
@@ -74,128 +76,6 @@ struct CompressionRecord
     int   zip_level;
     float dwa_level;
 };
-// NB: This is extra complicated than one would normally write to
-// handle scenario that seems to happen on MacOS/Windows (probably
-// linux too, but unobserved) with a static library, where a
-// (static/global) Header is being destroyed after the shutdown of
-// this translation unit happens, causing use after destroy.
-//
-// but if we just use the once_flag / call_once mechanism, windows
-// then starts crashing on exit in a different way.
-
-struct CompressionStash;
-// assignments to here happen in static singleton ctor which is
-// guaranteed construction safe.
-//
-// we could potentially solve with using an atomic shared ptr instead
-// of needing the ctor/dtor and getstash thing, but gcc 4.8 does not
-// include proper support for those.
-static std::atomic<CompressionStash*> s_stash{nullptr};
-
-struct CompressionStash
-{
-    CompressionStash () { s_stash.store (this); }
-    ~CompressionStash ()
-    {
-        // technically not safe in that if there are multiple threads
-        // running at object destruction time, another thread may have
-        // retrieved the pointer, but not yet entered the mutex, but
-        // then we run, destroying the mutex, and then they crash
-        // against a destroyed mutex. But this code only happens at
-        // static object destruction time, and only has
-        // non-deterministic behavior when compiled statically.
-        // so. this is about all we can do to add this feature without
-        // changing the abi other than say don't have static/global
-        // Header objects?
-        s_stash.store (nullptr);
-#if ILMTHREAD_THREADING_ENABLED
-        // let's explicitly grab the lock and clear the map in case
-        // there is someone waiting on a lock concurrently at static
-        // destruction time, just to be pedantic
-        _mutex.lock ();
-        _store.clear ();
-        _mutex.unlock ();
-#endif
-    }
-#if ILMTHREAD_THREADING_ENABLED
-    std::mutex _mutex;
-#endif
-    std::map<const void*, CompressionRecord> _store;
-};
-
-static CompressionStash*
-getStash ()
-{
-    static CompressionStash stash_impl;
-    return s_stash.load ();
-}
-
-static void
-clearCompressionRecord (Header* hdr)
-{
-    CompressionStash* s = getStash ();
-    if (s)
-    {
-#if ILMTHREAD_THREADING_ENABLED
-        std::lock_guard<std::mutex> lk (s->_mutex);
-#endif
-        auto i = s->_store.find (hdr);
-        if (i != s->_store.end ()) s->_store.erase (i);
-    }
-}
-
-static CompressionRecord
-retrieveCompressionRecord (const Header* hdr)
-{
-    CompressionRecord retval;
-
-    CompressionStash* s = getStash ();
-    if (s)
-    {
-#if ILMTHREAD_THREADING_ENABLED
-        std::lock_guard<std::mutex> lk (s->_mutex);
-#endif
-        auto i = s->_store.find (hdr);
-        if (i != s->_store.end ()) retval = i->second;
-    }
-    return retval;
-}
-
-static CompressionRecord&
-retrieveCompressionRecord (Header* hdr)
-{
-    CompressionStash* s = getStash ();
-    if (s)
-    {
-#if ILMTHREAD_THREADING_ENABLED
-        std::lock_guard<std::mutex> lk (s->_mutex);
-#endif
-        return s->_store[hdr];
-    }
-    // this will only happen at app shutdown, so it'd be an invalid
-    // store anyway, but just return something to avoid a crash
-    static CompressionRecord defrec;
-    return defrec;
-}
-
-static void
-copyCompressionRecord (Header* dst, const Header* src)
-{
-    CompressionStash* s = getStash ();
-    if (s)
-    {
-#if ILMTHREAD_THREADING_ENABLED
-        std::lock_guard<std::mutex> lk (s->_mutex);
-#endif
-        auto i = s->_store.find (src);
-        if (i != s->_store.end ()) { s->_store[dst] = i->second; }
-        else
-        {
-            i = s->_store.find (dst);
-            if (i != s->_store.end ()) s->_store.erase (i);
-        }
-    }
-};
 
 void
 initialize (
@@ -261,6 +141,170 @@ setDefaultDwaCompressionLevel (float level)
     exr_set_default_dwa_compression_quality (level);
 }
 
+//
+// The attributes of a header live in a reference counted Store that
+// copies of the header share until one of them is modified.  The
+// attributes themselves are reference counted too: when a header
+// gets a private copy of a shared store, the new store shares all
+// attribute objects with the old one, so references to attributes
+// that a header handed out stay valid, and no attribute is copied
+// until it is modified.
+//
+// A header that hands out a non-const reference to an attribute
+// (or an iterator) pins the attribute: the caller may write through
+// the reference later, so copies of the header that are made from
+// then on get their own copy of that attribute, and do not share
+// the store.
+//
+
+struct Header::Data
+{
+    struct Owner
+    {
+        std::shared_ptr<Attribute> attribute;
+        bool                       pinned = false;
+    };
+
+    struct Store
+    {
+        std::atomic<int>                              refCount{1};
+        bool                                          shareable = true;
+        AttributeMap                                  map;
+        std::unordered_map<const Attribute*, Owner>   owners;
+
+        void add (const Name& name, const std::shared_ptr<Attribute>& attr)
+        {
+            owners[attr.get ()].attribute = attr;
+
+            try
+            {
+                map[name] = attr.get ();
+            }
+            catch (...)
+            {
+                owners.erase (attr.get ());
+                throw;
+            }
+        }
+
+        void
+        replace (AttributeMap::iterator i, const std::shared_ptr<Attribute>& attr)
+        {
+            owners[attr.get ()].attribute = attr;
+            owners.erase (i->second);
+            i->second = attr.get ();
+        }
+
+        void erase (AttributeMap::iterator i)
+        {
+            owners.erase (i->second);
+            map.erase (i);
+        }
+
+        //
+        // Make sure this store is the only owner of the attribute at
+        // i, so that it can be modified, and optionally pin it.
+        //
+
+        Attribute& own (AttributeMap::iterator i, bool pin)
+        {
+            Owner& o = owners.at (i->second);
+
+            if (o.attribute.use_count () != 1)
+            {
+                std::shared_ptr<Attribute> attr (i->second->copy ());
+                replace (i, attr);
+            }
+            else
+            {
+                // pairs with the release in the other owners'
+                // shared_ptr destructors
+                std::atomic_thread_fence (std::memory_order_acquire);
+            }
+
+            if (pin)
+            {
+                owners.at (i->second).pinned = true;
+                shareable                   = false;
+            }
+
+            return *i->second;
+        }
+
+        //
+        // A new store with the same attributes.  Pinned attributes
+        // are copied, all others are shared.
+        //
+
+        static Store* clone (const Store& other)
+        {
+            std::unique_ptr<Store> store (new Store);
+
+            for (AttributeMap::const_iterator i = other.map.begin ();
+                 i != other.map.end ();
+                 ++i)
+            {
+                const Owner& o = other.owners.at (i->second);
+
+                if (o.pinned)
+                    store->add (
+                        i->first, std::shared_ptr<Attribute> (i->second->copy ()));
+                else
+                    store->add (i->first, o.attribute);
+            }
+
+            return store.release ();
+        }
+
+        static void release (Store* store)
+        {
+            if (store->refCount.fetch_sub (1, std::memory_order_acq_rel) == 1)
+                delete store;
+        }
+    };
+
+    Data () : store (new Store) {}
+
+    Data (const Data& other) : store (other.store)
+    {
+        if (store->shareable)
+            ++store->refCount;
+        else
+            store = Store::clone (*other.store);
+
+        readsNothing   = other.readsNothing;
+        hasCompression = other.hasCompression;
+        compression    = other.compression;
+    }
+
+    ~Data () { Store::release (store); }
+
+    Data& operator= (const Data&) = delete;
+
+    Store& mutableStore ()
+    {
+        if (store->refCount.load (std::memory_order_acquire) != 1)
+        {
+            Store* tmp = Store::clone (*store);
+            Store::release (store);
+            store = tmp;
+        }
+
+        return *store;
+    }
+
+    Store* store;
+    bool   readsNothing = false;
+
+    //
+    // zip and dwa compression levels, taken from the global defaults
+    // the first time they are modified
+    //
+
+    bool              hasCompression = false;
+    CompressionRecord compression;
+};
+
 Header::Header (
     int         width,
     int         height,
@@ -269,23 +313,35 @@ Header::Header (
     float       screenWindowWidth,
     LineOrder   lineOrder,
     Compression compression)
-    : _map (), _readsNothing (false)
+    : _data (new Data)
 {
-    sanityCheckDisplayWindow (width, height);
+    //
+    // the destructor does not run if the constructor throws
+    //
+
+    try
+    {
+        sanityCheckDisplayWindow (width, height);
 
-    staticInitialize ();
+        staticInitialize ();
 
-    Box2i displayWindow (V2i (0, 0), V2i (width - 1, height - 1));
+        Box2i displayWindow (V2i (0, 0), V2i (width - 1, height - 1));
 
-    initialize (
-        *this,
-        displayWindow,
-        displayWindow,
-        pixelAspectRatio,
-        screenWindowCenter,
-        screenWindowWidth,
-        lineOrder,
-        compression);
+        initialize (
+            *this,
+            displayWindow,
+            displayWindow,
+            pixelAspectRatio,
+            screenWindowCenter,
+            screenWindowWidth,
+            lineOrder,
+            compression);
+    }
+    catch (...)
+    {
+        delete _data;
+        throw;
+    }
 }
 
 Header::Header (
@@ -297,23 +353,31 @@ Header::Header (
     float        screenWindowWidth,
     LineOrder    lineOrder,
     Compression  compression)
-    : _map (), _readsNothing (false)
+    : _data (new Data)
 {
-    sanityCheckDisplayWindow (width, height);
+    try
+    {
+        sanityCheckDisplayWindow (width, height);
 
-    staticInitialize ();
+        staticInitialize ();
 
-    Box2i displayWindow (V2i (0, 0), V2i (width - 1, height - 1));
+        Box2i displayWindow (V2i (0, 0), V2i (width - 1, height - 1));
 
-    initialize (
-        *this,
-        displayWindow,
-        dataWindow,
-        pixelAspectRatio,
-        screenWindowCenter,
-        screenWindowWidth,
-        lineOrder,
-        compression);
+        initialize (
+            *this,
+            displayWindow,
+            dataWindow,
+            pixelAspectRatio,
+            screenWindowCenter,
+            screenWindowWidth,
+            lineOrder,
+            compression);
+    }
+    catch (...)
+    {
+        delete _data;
+        throw;
+    }
 }
 
 Header::Header (
@@ -324,46 +388,41 @@ Header::Header (
     float        screenWindowWidth,
     LineOrder    lineOrder,
     Compression  compression)
-    : _map (), _readsNothing (false)
+    : _data (new Data)
 {
-    staticInitialize ();
-
-    initialize (
-        *this,
-        displayWindow,
-        dataWindow,
-        pixelAspectRatio,
-        screenWindowCenter,
-        screenWindowWidth,
-        lineOrder,
-        compression);
-}
-
-Header::Header (const Header& other)
-    : _map (), _readsNothing (other._readsNothing)
-{
-    for (AttributeMap::const_iterator i = other._map.begin ();
-         i != other._map.end ();
-         ++i)
+    try
     {
-        insert (*i->first, *i->second);
+        staticInitialize ();
+
+        initialize (
+            *this,
+            displayWindow,
+            dataWindow,
+            pixelAspectRatio,
+            screenWindowCenter,
+            screenWindowWidth,
+            lineOrder,
+            compression);
+    }
+    catch (...)
+    {
+        delete _data;
+        throw;
     }
-    copyCompressionRecord (this, &other);
 }
 
-Header::Header (Header&& other)
-    : _map (std::move (other._map)), _readsNothing (other._readsNothing)
+Header::Header (const Header& other)
+    : _data (other._data ? new Data (*other._data) : new Data)
+{}
+
+Header::Header (Header&& other) noexcept : _data (other._data)
 {
-    copyCompressionRecord (this, &other);
+    other._data = nullptr;
 }
 
 Header::~Header ()
 {
-    for (AttributeMap::iterator i = _map.begin (); i != _map.end (); ++i)
-    {
-        delete i->second;
-    }
-    clearCompressionRecord (this);
+    delete _data;
 }
 
 Header&
@@ -371,40 +430,63 @@ Header::operator= (const Header& other)
 {
     if (this != &other)
     {
-        for (AttributeMap::iterator i = _map.begin (); i != _map.end (); ++i)
-        {
-            delete i->second;
-        }
-
-        _map.clear ();
-
-        for (AttributeMap::const_iterator i = other._map.begin ();
-             i != other._map.end ();
-             ++i)
-        {
-            insert (*i->first, *i->second);
-        }
-        copyCompressionRecord (this, &other);
-        _readsNothing = other._readsNothing;
+        Header tmp (other);
+        std::swap (_data, tmp._data);
     }
 
     return *this;
 }
 
 Header&
-Header::operator= (Header&& other)
+Header::operator= (Header&& other) noexcept
 {
-    if (this != &other)
-    {
-        std::swap (_map, other._map);
-        // don't have to move or anything as it's pod types
-        copyCompressionRecord (this, &other);
-        _readsNothing = other._readsNothing;
-    }
-
+    std::swap (_data, other._data);
     return *this;
 }
 
+const Header::AttributeMap&
+Header::attributes () const
+{
+    //
+    // a moved-from header has no data, and no attributes
+    //
+
+    static const AttributeMap empty;
+    return _data ? _data->store->map : empty;
+}
+
+Header::AttributeMap&
+Header::mutableAttributes ()
+{
+    if (!_data) _data = new Data;
+    return _data->mutableStore ().map;
+}
+
+Attribute&
+Header::mutableAttribute (AttributeMap::iterator i, bool pin)
+{
+    return _data->store->own (i, pin);
+}
+
+Header::AttributeMap&
+Header::pinnedAttributes ()
+{
+    //
+    // An iterator can reach every attribute, so all of them are pinned,
+    // and copies made while the iterator is in use do not share the map
+    // it points into.
+    //
+
+    AttributeMap& attributes = mutableAttributes ();
+
+    for (AttributeMap::iterator i = attributes.begin (); i != attributes.end ();
+         ++i)
+        mutableAttribute (i, true);
+
+    _data->store->shareable = false;
+    return attributes;
+}
+
 void
 Header::erase (const char name[])
 {
@@ -413,12 +495,9 @@ Header::erase (const char name[])
             IEX_NAMESPACE::ArgExc,
             "Image attribute name cannot be an empty string.");
 
-    AttributeMap::iterator i = _map.find (name);
-    if (i != _map.end ())
-    {
-        delete i->second;
-        _map.erase (i);
-    }
+    AttributeMap&          attributes = mutableAttributes ();
+    AttributeMap::iterator i          = attributes.find (name);
+    if (i != attributes.end ()) _data->store->erase (i);
 }
 
 void
@@ -435,7 +514,8 @@ Header::insert (const char name[], const Attribute& attribute)
             IEX_NAMESPACE::ArgExc,
             "Image attribute name cannot be an empty string.");
 
-    AttributeMap::iterator i = _map.find (name);
+    AttributeMap&          attributes = mutableAttributes ();
+    AttributeMap::iterator i          = attributes.find (name);
     if (!strcmp (name, "dwaCompressionLevel") &&
         !strcmp (attribute.typeName (), "float"))
     {
@@ -444,19 +524,9 @@ Header::insert (const char name[], const Attribute& attribute)
         dwaCompressionLevel () = dwaattr.value ();
     }
 
-    if (i == _map.end ())
+    if (i == attributes.end ())
     {
-        Attribute* tmp = attribute.copy ();
-
-        try
-        {
-            _map[name] = tmp;
-        }
-        catch (...)
-        {
-            delete tmp;
-            throw;
-        }
+        _data->store->add (name, std::shared_ptr<Attribute> (attribute.copy ()));
     }
     else
     {
@@ -473,9 +543,7 @@ Header::insert (const char name[], const Attribute& attribute)
                        "type \""
                     << i->second->typeName () << "\".");
 
-        Attribute* tmp = attribute.copy ();
-        delete i->second;
-        i->second = tmp;
+        _data->store->replace (i, std::shared_ptr<Attribute> (attribute.copy ()));
     }
 }
 
@@ -488,22 +556,23 @@ Header::insert (const string& name, const Attribute& attribute)
 Attribute&
 Header::operator[] (const char name[])
 {
-    AttributeMap::iterator i = _map.find (name);
+    AttributeMap&          attributes = mutableAttributes ();
+    AttributeMap::iterator i          = attributes.find (name);
 
-    if (i == _map.end ())
+    if (i == attributes.end ())
         THROW (
             IEX_NAMESPACE::ArgExc,
             "Cannot find image attribute \"" << name << "\".");
 
-    return *i->second;
+    return mutableAttribute (i, true);
 }
 
 const Attribute&
 Header::operator[] (const char name[]) const
 {
-    AttributeMap::const_iterator i = _map.find (name);
+    AttributeMap::const_iterator i = attributes ().find (name);
 
-    if (i == _map.end ())
+    if (i == attributes ().end ())
         THROW (
             IEX_NAMESPACE::ArgExc,
             "Cannot find image attribute \"" << name << "\".");
@@ -526,37 +595,37 @@ Header::operator[] (const string& name) const
 Header::Iterator
 Header::begin ()
 {
-    return _map.begin ();
+    return pinnedAttributes ().begin ();
 }
 
 Header::ConstIterator
 Header::begin () const
 {
-    return _map.begin ();
+    return attributes ().begin ();
 }
 
 Header::Iterator
 Header::end ()
 {
-    return _map.end ();
+    return pinnedAttributes ().end ();
 }
 
 Header::ConstIterator
 Header::end () const
 {
-    return _map.end ();
+    return attributes ().end ();
 }
 
 Header::Iterator
 Header::find (const char name[])
 {
-    return _map.find (name);
+    return pinnedAttributes ().find (name);
 }
 
 Header::ConstIterator
 Header::find (const char name[]) const
 {
-    return _map.find (name);
+    return attributes ().find (name);
 }
 
 Header::Iterator
@@ -677,31 +746,42 @@ Header::compression () const
 void
 Header::resetDefaultCompressionLevels ()
 {
-    clearCompressionRecord (this);
+    if (_data) _data->hasCompression = false;
 }
 
 int&
 Header::zipCompressionLevel ()
 {
-    return retrieveCompressionRecord (this).zip_level;
+    if (!_data) _data = new Data;
+
+    if (!_data->hasCompression)
+    {
+        _data->compression    = CompressionRecord ();
+        _data->hasCompression = true;
+    }
+
+    return _data->compression.zip_level;
 }
 
 int
 Header::zipCompressionLevel () const
 {
-    return retrieveCompressionRecord (this).zip_level;
+    return (_data && _data->hasCompression) ? _data->compression.zip_level
+                                            : CompressionRecord ().zip_level;
 }
 
 float&
 Header::dwaCompressionLevel ()
 {
-    return retrieveCompressionRecord (this).dwa_level;
+    zipCompressionLevel ();
+    return _data->compression.dwa_level;
 }
 
 float
 Header::dwaCompressionLevel () const
 {
-    return retrieveCompressionRecord (this).dwa_level;
+    return (_data && _data->hasCompression) ? _data->compression.dwa_level
+                                            : CompressionRecord ().dwa_level;
 }
 
 void
@@ -1293,12 +1373,23 @@ Header::getMaxTileSize (int& maxWidth, int& maxHeight)
 bool
 Header::readsNothing ()
 {
-    return _readsNothing;
+    return _data && _data->readsNothing;
 }
 
 uint64_t
 Header::writeTo (
     OPENEXR_IMF_INTERNAL_NAMESPACE::OStream& os, bool isTiled) const
+{
+    uint64_t attrPosition;
+    return writeTo (os, isTiled, "", attrPosition);
+}
+
+uint64_t
+Header::writeTo (
+    OPENEXR_IMF_INTERNAL_NAMESPACE::OStream& os,
+    bool                                     isTiled,
+    const char                               attrName[],
+    uint64_t&                                attrPosition) const
 {
     //
     // Write a "magic number" to identify the file as an image file.
@@ -1313,6 +1404,7 @@ Header::writeTo (
     //
 
     uint64_t previewPosition = 0;
+    attrPosition             = 0;
 
     const Attribute* preview =
         findTypedAttribute<PreviewImageAttribute> ("preview");
@@ -1343,6 +1435,8 @@ Header::writeTo (
 
         if (&i.attribute () == preview) previewPosition = os.tellp ();
 
+        if (!strcmp (i.name (), attrName)) attrPosition = os.tellp ();
+
         os.write (s.data (), int (s.length ()));
     }
 
@@ -1379,10 +1473,8 @@ Header::readFrom (OPENEXR_IMF_INTERNAL_NAMESPACE::IStream& is, int& version)
 
         if (name[0] == 0)
         {
-            if (attrCount == 0)
-                _readsNothing = true;
-            else
-                _readsNothing = false;
+            if (!_data) _data = new Data;
+            _data->readsNothing = (attrCount == 0);
             break;
         }
 
@@ -1410,9 +1502,10 @@ Header::readFrom (OPENEXR_IMF_INTERNAL_NAMESPACE::IStream& is, int& version)
                 "Invalid size field in header attribute");
         }
 
-        AttributeMap::iterator i = _map.find (name);
+        AttributeMap&          attributes = mutableAttributes ();
+        AttributeMap::iterator i          = attributes.find (name);
 
-        if (i != _map.end ())
+        if (i != attributes.end ())
         {
             //
             // The attribute already exists (for example,
@@ -1427,7 +1520,7 @@ Header::readFrom (OPENEXR_IMF_INTERNAL_NAMESPACE::IStream& is, int& version)
                     "\"" << name
                          << "\".");
 
-            i->second->readValueFrom (is, size, version);
+            mutableAttribute (i, false).readValueFrom (is, size, version);
         }
         else
         {
@@ -1439,23 +1532,13 @@ Header::readFrom (OPENEXR_IMF_INTERNAL_NAMESPACE::IStream& is, int& version)
             // store it as an OpaqueAttribute.
             //
 
-            Attribute* attr;
+            std::shared_ptr<Attribute> attr (
+                Attribute::knownType (typeName)
+                    ? Attribute::newAttribute (typeName)
+                    : new OpaqueAttribute (typeName));
 
-            if (Attribute::knownType (typeName))
-                attr = Attribute::newAttribute (typeName);
-            else
-                attr = new OpaqueAttribute (typeName);
-
-            try
-            {
-                attr->readValueFrom (is, size, version);
-                _map[name] = attr;
-            }
-            catch (...)
-            {
-                delete attr;
-                throw;
-            }
+            attr->readValueFrom (is, size, version);
+            _data->store->add (name, attr);
         }
     }
 }
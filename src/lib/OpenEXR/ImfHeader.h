@@ -92,7 +92,7 @@ public:
     IMF_EXPORT
     Header (const Header& other);
     IMF_EXPORT
-    Header (Header&& other);
+    Header (Header&& other) noexcept;
 
     //-----------
     // Destructor
@@ -108,7 +108,7 @@ public:
     IMF_EXPORT
     Header& operator= (const Header& other);
     IMF_EXPORT
-    Header& operator= (Header&& other);
+    Header& operator= (Header&& other) noexcept;
 
     //---------------------------------------------------------------
     // Add an attribute:
@@ -168,6 +168,11 @@ public:
     //				name n and type T, or 0 if no attribute
     //				with name n and type T exists.
     //
+    // References and pointers to an attribute remain valid until the
+    // attribute is erased or replaced by insert(), or the header is
+    // destroyed; copying the header, or modifying other attributes,
+    // does not invalidate them.
+    //
     //------------------------------------------------------------------
 
     IMF_EXPORT
@@ -472,13 +477,45 @@ public:
         OPENEXR_IMF_INTERNAL_NAMESPACE::OStream& os,
         bool                                     isTiled = false) const;
 
+    //------------------------------------------------------------------
+    // Like writeTo() above, but also stores the position of the value
+    // of attribute attrName in attrPosition (0 if there is no such
+    // attribute), so that an output file can later overwrite the
+    // value in place with one of the same size.
+    //------------------------------------------------------------------
+
+    IMF_EXPORT
+    uint64_t writeTo (
+        OPENEXR_IMF_INTERNAL_NAMESPACE::OStream& os,
+        bool                                     isTiled,
+        const char                               attrName[],
+        uint64_t&                                attrPosition) const;
+
     IMF_EXPORT
     void readFrom (OPENEXR_IMF_INTERNAL_NAMESPACE::IStream& is, int& version);
 
 private:
-    AttributeMap _map;
+    //
+    // The attributes live in a reference counted store that is shared
+    // between copies of a header until one of the copies is modified
+    // (copy on write); see ImfHeader.cpp.
+    //
+    // mutableAttributes() gives this header a private store.
+    // mutableAttribute() gives this header a private copy of one
+    // attribute; if pin is true, the caller is about to hand out a
+    // non-const reference to the attribute, and future copies of the
+    // header get their own copy of it.  pinnedAttributes() does the
+    // same for all attributes, before an Iterator is handed out.
+    //
+
+    struct IMF_HIDDEN Data;
 
-    bool _readsNothing;
+    const AttributeMap& attributes () const;
+    AttributeMap&       mutableAttributes ();
+    AttributeMap&       pinnedAttributes ();
+    Attribute& mutableAttribute (AttributeMap::iterator i, bool pin);
+
+    Data* _data;
 };
 
 //----------
@@ -697,16 +734,25 @@ template <class T>
 T*
 Header::findTypedAttribute (const char name[])
 {
-    AttributeMap::iterator i = _map.find (name);
-    return (i == _map.end ()) ? 0 : dynamic_cast<T*> (i->second);
+    //
+    // Look the attribute up through the const interface, so that only
+    // the attribute that is returned becomes modifiable, not the whole
+    // header (see find()).
+    //
+
+    const Header& self = *this;
+
+    if (self.findTypedAttribute<T> (name) == 0) return 0;
+
+    return &typedAttribute<T> (name);
 }
 
 template <class T>
 const T*
 Header::findTypedAttribute (const char name[]) const
 {
-    AttributeMap::const_iterator i = _map.find (name);
-    return (i == _map.end ()) ? 0 : dynamic_cast<const T*> (i->second);
+    ConstIterator i = find (name);
+    return (i == end ()) ? 0 : dynamic_cast<const T*> (&i.attribute ());
 }
 
 template <class T>
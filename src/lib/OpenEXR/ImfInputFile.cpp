@@ -32,6 +32,7 @@
 #include <half.h>
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -85,6 +86,14 @@ struct InputFile::Data
     void readPixels (
         const FrameBuffer& frameBuffer, int scanline1, int scanline2);
 
+    void readPixels (
+        const FrameBuffer*                      frameBuffer,
+        const std::vector<std::pair<int, int>>& ranges);
+
+    void readRegion (const IMATH_NAMESPACE::Box2i& box, int level);
+    void readRegion (
+        const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int level);
+
     void deleteCachedBuffer (void);
     void copyCachedBuffer (FrameBuffer::ConstIterator to,
                            FrameBuffer::ConstIterator from,
@@ -207,6 +216,18 @@ InputFile::isComplete () const
     return _ctxt.chunkTableValid (_data->getPartIdx ());
 }
 
+exr_perf_counters_t
+InputFile::perfCounters () const
+{
+    return _ctxt.perfCounters ();
+}
+
+void
+InputFile::resetPerfCounters ()
+{
+    _ctxt.resetPerfCounters ();
+}
+
 bool
 InputFile::isOptimizationEnabled () const
 {
@@ -235,6 +256,33 @@ InputFile::readPixels (
     _data->readPixels (frameBuffer, scanLine1, scanLine2);
 }
 
+void
+InputFile::readPixels (const std::vector<std::pair<int, int>>& ranges)
+{
+    _data->readPixels (nullptr, ranges);
+}
+
+void
+InputFile::readPixels (
+    const FrameBuffer&                      frameBuffer,
+    const std::vector<std::pair<int, int>>& ranges)
+{
+    _data->readPixels (&frameBuffer, ranges);
+}
+
+void
+InputFile::readRegion (const IMATH_NAMESPACE::Box2i& box, int level)
+{
+    _data->readRegion (box, level);
+}
+
+void
+InputFile::readRegion (
+    const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int level)
+{
+    _data->readRegion (boxes, level);
+}
+
 void
 InputFile::rawPixelData (
     int firstScanLine, const char*& pixelData, int& pixelDataSize)
@@ -482,6 +530,231 @@ InputFile::Data::readPixels (
     else { _sFile->readPixels (frameBuffer, scanLine1, scanLine2); }
 }
 
+void
+InputFile::Data::readPixels (
+    const FrameBuffer*                      frameBuffer,
+    const std::vector<std::pair<int, int>>& ranges)
+{
+    if (!_compositor && _storage != EXR_STORAGE_TILED)
+    {
+        if (frameBuffer)
+            _sFile->readPixels (*frameBuffer, ranges);
+        else
+        {
+#if ILMTHREAD_THREADING_ENABLED
+            std::lock_guard<std::mutex> lock (_mx);
+#endif
+            _sFile->readPixels (ranges);
+        }
+        return;
+    }
+
+    if (_compositor)
+    {
+        //
+        // Deep files: read the ranges one after another, in
+        // increasing y order.
+        //
+
+        std::vector<std::pair<int, int>> sorted (ranges);
+
+        for (auto& r: sorted)
+            if (r.second < r.first) std::swap (r.first, r.second);
+
+        std::sort (sorted.begin (), sorted.end ());
+
+#if ILMTHREAD_THREADING_ENABLED
+        std::lock_guard<std::mutex> lock (_mx);
+#endif
+
+        if (frameBuffer) _compositor->setFrameBuffer (*frameBuffer);
+
+        for (auto& r: sorted)
+            _compositor->readPixels (r.first, r.second);
+
+        return;
+    }
+
+    //
+    // Tiled files: each range is a box as wide as the data window,
+    // so that the tiles of all ranges are decoded in a single pass,
+    // and tiles shared by several ranges only once.
+    //
+
+    exr_attr_box2i_t dataWindow = _ctxt->dataWindow (getPartIdx ());
+
+    std::vector<IMATH_NAMESPACE::Box2i> boxes;
+    boxes.reserve (ranges.size ());
+
+    for (const auto& r: ranges)
+    {
+        int minY = std::min (r.first, r.second);
+        int maxY = std::max (r.first, r.second);
+
+        if (minY < dataWindow.min.y || maxY > dataWindow.max.y)
+        {
+            throw IEX_NAMESPACE::ArgExc ("Tried to read scan line outside "
+                                         "the image file's data window.");
+        }
+
+        boxes.emplace_back (
+            IMATH_NAMESPACE::V2i (dataWindow.min.x, minY),
+            IMATH_NAMESPACE::V2i (dataWindow.max.x, maxY));
+    }
+
+#if ILMTHREAD_THREADING_ENABLED
+    std::lock_guard<std::mutex> lock (_mx);
+#endif
+
+    if (frameBuffer) lockedSetFrameBuffer (*frameBuffer);
+
+    _tFile->setFrameBuffer (_cacheFrameBuffer);
+    _tFile->readRegion (boxes, 0);
+}
+
+void
+InputFile::Data::readRegion (
+    const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int level)
+{
+    if (_compositor)
+    {
+        throw IEX_NAMESPACE::ArgExc (
+            "readRegion() is not supported for deep image files.");
+    }
+
+    if (_storage == EXR_STORAGE_TILED)
+    {
+#if ILMTHREAD_THREADING_ENABLED
+        std::lock_guard<std::mutex> lock (_mx);
+#endif
+        _tFile->setFrameBuffer (_cacheFrameBuffer);
+        _tFile->readRegion (boxes, level);
+        return;
+    }
+
+    for (const IMATH_NAMESPACE::Box2i& box: boxes)
+        readRegion (box, level);
+}
+
+void
+InputFile::Data::readRegion (const IMATH_NAMESPACE::Box2i& box, int level)
+{
+    if (_compositor)
+    {
+        throw IEX_NAMESPACE::ArgExc (
+            "readRegion() is not supported for deep image files.");
+    }
+
+    if (_storage == EXR_STORAGE_TILED)
+    {
+#if ILMTHREAD_THREADING_ENABLED
+        std::lock_guard<std::mutex> lock (_mx);
+#endif
+        _tFile->setFrameBuffer (_cacheFrameBuffer);
+        _tFile->readRegion (box, level);
+        return;
+    }
+
+    if (level != 0)
+        throw IEX_NAMESPACE::ArgExc (
+            "Scan line files only have a single resolution level.");
+
+    exr_attr_box2i_t dataWindow = _ctxt->dataWindow (getPartIdx ());
+
+    if (box.isEmpty () || box.min.x < dataWindow.min.x ||
+        box.min.y < dataWindow.min.y || box.max.x > dataWindow.max.x ||
+        box.max.y > dataWindow.max.y)
+    {
+        throw IEX_NAMESPACE::ArgExc ("Tried to read a region outside "
+                                     "the image file's data window.");
+    }
+
+    //
+    // Scan line files always decode whole scan lines, so read the
+    // rows covered by box into a temporary buffer one data window
+    // wide, and copy out the requested columns.
+    //
+
+    FrameBuffer userFrameBuffer;
+    {
+#if ILMTHREAD_THREADING_ENABLED
+        std::lock_guard<std::mutex> lock (_mx);
+#endif
+        userFrameBuffer = _cacheFrameBuffer;
+    }
+
+    int64_t width  = int64_t (dataWindow.max.x) - dataWindow.min.x + 1;
+    int64_t height = int64_t (box.max.y) - box.min.y + 1;
+
+    FrameBuffer                          rowBuffer;
+    std::vector<std::unique_ptr<char[]>> rows;
+
+    for (FrameBuffer::ConstIterator k = userFrameBuffer.begin ();
+         k != userFrameBuffer.end ();
+         ++k)
+    {
+        const Slice& s = k.slice ();
+
+        if (s.xSampling != 1 || s.ySampling != 1)
+            throw IEX_NAMESPACE::ArgExc (
+                "readRegion() does not support subsampled channels.");
+
+        int64_t bytes = (s.type == HALF) ? 2 : 4;
+
+        rows.emplace_back (new char[width * height * bytes]);
+        char* base = rows.back ().get () -
+                     int64_t (dataWindow.min.x) * bytes -
+                     int64_t (box.min.y) * width * bytes;
+
+        rowBuffer.insert (
+            k.name (),
+            Slice (
+                s.type,
+                base,
+                bytes,
+                width * bytes,
+                1,
+                1,
+                s.fillValue,
+                false,
+                false));
+    }
+
+    _sFile->readPixels (rowBuffer, box.min.y, box.max.y);
+
+    size_t i = 0;
+    for (FrameBuffer::ConstIterator k = userFrameBuffer.begin ();
+         k != userFrameBuffer.end ();
+         ++k, ++i)
+    {
+        const Slice& s     = k.slice ();
+        int64_t      bytes = (s.type == HALF) ? 2 : 4;
+        size_t       n     = size_t (box.max.x - box.min.x + 1) * bytes;
+
+        for (int y = box.min.y; y <= box.max.y; ++y)
+        {
+            const char* src = rows[i].get () +
+                              (int64_t (y) - box.min.y) * width * bytes +
+                              (int64_t (box.min.x) - dataWindow.min.x) * bytes;
+
+            char* dst = s.base + int64_t (y) * s.yStride +
+                        int64_t (box.min.x) * s.xStride;
+
+            if (s.xStride == size_t (bytes))
+                memcpy (dst, src, n);
+            else
+            {
+                for (int x = box.min.x; x <= box.max.x; ++x)
+                {
+                    memcpy (dst, src, bytes);
+                    src += bytes;
+                    dst += s.xStride;
+                }
+            }
+        }
+    }
+}
+
 void
 InputFile::Data::bufferedReadPixels (int scanLine1, int scanLine2)
 {
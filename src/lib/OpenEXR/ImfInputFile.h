@@ -19,6 +19,9 @@
 
 #include "ImfContext.h"
 
+#include <utility>
+#include <vector>
+
 OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
 
 class TiledInputFile;
@@ -153,6 +156,20 @@ public:
     IMF_EXPORT
     bool isComplete () const;
 
+    //---------------------------------------------------------------
+    // Counters of the bytes read, chunks decoded per compression,
+    // time spent in each decoding stage and buffer memory used
+    // since the file was opened or the counters were last reset
+    // (see exr_perf_counters_t).  A file opened as a part of a
+    // MultiPartInputFile shares the counters of that file.
+    //---------------------------------------------------------------
+
+    IMF_EXPORT
+    exr_perf_counters_t perfCounters () const;
+
+    IMF_EXPORT
+    void resetPerfCounters ();
+
     //---------------------------------------------------------------
     // Check if SSE optimization is enabled
     //
@@ -221,6 +238,57 @@ public:
     void readPixels (
         const FrameBuffer& frameBuffer, int scanLine1, int scanLine2);
 
+    //----------------------------------------------
+    // Read several ranges of scan lines in one call:
+    //
+    // readPixels(ranges) reads, for every pair (s1, s2) in ranges,
+    // the scan lines in [min (s1, s2), max (s1, s2)], as if by
+    // readPixels(s1,s2).  The ranges may be given in any order and
+    // may overlap.  For scan line and tiled files, every chunk is
+    // decoded at most once, and the chunks of all ranges are decoded
+    // in parallel (see ScanLineInputFile::readPixels() and
+    // TiledInputFile::readRegion()).  Deep files read the ranges one
+    // after another, in increasing y order.
+    //----------------------------------------------
+
+    IMF_EXPORT
+    void readPixels (const std::vector<std::pair<int, int>>& ranges);
+
+    IMF_EXPORT
+    void readPixels (
+        const FrameBuffer&                      frameBuffer,
+        const std::vector<std::pair<int, int>>& ranges);
+
+    //----------------------------------------------
+    // Read a rectangular region of pixels:
+    //
+    // readRegion(box, level) reads only the pixels inside box
+    // and stores them in the current frame buffer.  Pixels of
+    // the frame buffer outside box are not written, so it need
+    // only cover the region itself.
+    //
+    // For tiled files, only the tiles that overlap box are
+    // decoded (concurrently if multi-threading is used), and
+    // box is given in the pixel coordinates of the given
+    // MIPMAP or ONE_LEVEL level.  For scan line files, level
+    // must be 0 and all scan lines that intersect box are
+    // decoded.  Subsampled channels and deep files are not
+    // supported.
+    //
+    // readRegion(boxes, level) reads the pixels inside each of the
+    // boxes.  For tiled files, a tile that overlaps several boxes
+    // is decoded only once, and the tiles of all boxes are decoded
+    // in parallel.  Scan line files read the boxes one after
+    // another.
+    //----------------------------------------------
+
+    IMF_EXPORT
+    void readRegion (const IMATH_NAMESPACE::Box2i& box, int level = 0);
+
+    IMF_EXPORT
+    void readRegion (
+        const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int level = 0);
+
     //----------------------------------------------
     // Read a block of raw pixel data from the file,
     // without uncompressing it (this function is
@@ -77,6 +77,33 @@ InputPart::readPixels (
     file->readPixels (frameBuffer, scanLine1, scanLine2);
 }
 
+void
+InputPart::readPixels (const std::vector<std::pair<int, int>>& ranges)
+{
+    file->readPixels (ranges);
+}
+
+void
+InputPart::readPixels (
+    const FrameBuffer&                      frameBuffer,
+    const std::vector<std::pair<int, int>>& ranges)
+{
+    file->readPixels (frameBuffer, ranges);
+}
+
+void
+InputPart::readRegion (const IMATH_NAMESPACE::Box2i& box, int level)
+{
+    file->readRegion (box, level);
+}
+
+void
+InputPart::readRegion (
+    const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int level)
+{
+    file->readRegion (boxes, level);
+}
+
 void
 InputPart::rawPixelData (
     int firstScanLine, const char*& pixelData, int& pixelDataSize)
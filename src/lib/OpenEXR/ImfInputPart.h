@@ -8,6 +8,11 @@
 
 #include "ImfForward.h"
 
+#include <ImathBox.h>
+
+#include <utility>
+#include <vector>
+
 OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
 
 //-------------------------------------------------------------------
@@ -44,6 +49,17 @@ public:
     void readPixels (
         const FrameBuffer& frameBuffer, int scanLine1, int scanLine2);
     IMF_EXPORT
+    void readPixels (const std::vector<std::pair<int, int>>& ranges);
+    IMF_EXPORT
+    void readPixels (
+        const FrameBuffer&                      frameBuffer,
+        const std::vector<std::pair<int, int>>& ranges);
+    IMF_EXPORT
+    void readRegion (const IMATH_NAMESPACE::Box2i& box, int level = 0);
+    IMF_EXPORT
+    void readRegion (
+        const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int level = 0);
+    IMF_EXPORT
     void rawPixelData (
         int firstScanLine, const char*& pixelData, int& pixelDataSize);
 
@@ -10,6 +10,8 @@
 //-----------------------------------------------------------------------------
 
 #include "ImfNamespace.h"
+#include <IlmThreadConfig.h>
+#include <IlmThreadPool.h>
 #include <Iex.h>
 #include <ImathFun.h>
 #include <ImfAttribute.h>
@@ -20,11 +22,17 @@
 #include <ImfMisc.h>
 #include <ImfPartType.h>
 #include <ImfStdIO.h>
+#include <ImfThreading.h>
 #include <ImfTileDescription.h>
 #include <ImfXdr.h>
 
+#include <algorithm>
 #include <codecvt>
+#include <exception>
 #include <locale>
+#if ILMTHREAD_THREADING_ENABLED
+#    include <mutex>
+#endif
 
 OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
 
@@ -1996,6 +2004,85 @@ getChunkOffsetTableSize (const Header& header)
         return getTiledChunkOffsetTableSize (header);
 }
 
+namespace
+{
+
+struct RowRangeFailure
+{
+    void record (std::exception_ptr e)
+    {
+#if ILMTHREAD_THREADING_ENABLED
+        std::lock_guard<std::mutex> lock (mx);
+#endif
+        if (!first) first = e;
+    }
+
+#if ILMTHREAD_THREADING_ENABLED
+    std::mutex mx;
+#endif
+    std::exception_ptr first;
+};
+
+class RowRangeTask : public ILMTHREAD_NAMESPACE::Task
+{
+public:
+    RowRangeTask (
+        ILMTHREAD_NAMESPACE::TaskGroup*       group,
+        const std::function<void (int, int)>& fn,
+        int                                   begin,
+        int                                   end,
+        RowRangeFailure&                      failure)
+        : Task (group), _fn (fn), _begin (begin), _end (end), _failure (failure)
+    {}
+
+    void execute () override
+    {
+        try
+        {
+            _fn (_begin, _end);
+        }
+        catch (...)
+        {
+            _failure.record (std::current_exception ());
+        }
+    }
+
+private:
+    const std::function<void (int, int)>& _fn;
+    int                                   _begin;
+    int                                   _end;
+    RowRangeFailure&                      _failure;
+};
+
+} // namespace
+
+void
+forEachRowRange (int numRows, const std::function<void (int, int)>& fn)
+{
+    int numChunks = std::min (numRows, std::max (1, globalThreadCount () * 4));
+
+    if (numChunks <= 1)
+    {
+        fn (0, numRows);
+        return;
+    }
+
+    RowRangeFailure failure;
+    {
+        ILMTHREAD_NAMESPACE::TaskGroup group;
+
+        for (int i = 0; i < numChunks; ++i)
+        {
+            int begin = int (int64_t (numRows) * i / numChunks);
+            int end   = int (int64_t (numRows) * (i + 1) / numChunks);
+            ILMTHREAD_NAMESPACE::ThreadPool::addGlobalTask (
+                new RowRangeTask (&group, fn, begin, end, failure));
+        }
+    }
+
+    if (failure.first) std::rethrow_exception (failure.first);
+}
+
 std::wstring
 WidenFilename (const char* filename)
 {
@@ -19,6 +19,7 @@
 #include "ImfPixelType.h"
 
 #include <cstddef>
+#include <functional>
 #include <vector>
 
 OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
@@ -434,6 +435,17 @@ bool usesLongNames (const Header& header);
 IMF_EXPORT
 int getChunkOffsetTableSize (const Header& header);
 
+//
+// Call fn (begin, end) for consecutive ranges of rows that together
+// cover [0, numRows), concurrently on the global thread pool, and
+// return when all of them are done.  If fn throws, the first exception
+// is rethrown once every range has finished.  Since the ranges run as
+// tasks on the pool, fn must not wait for other tasks on the pool.
+//
+
+IMF_EXPORT
+void forEachRowRange (int numRows, const std::function<void (int, int)>& fn);
+
 //
 // Convert a filename to a wide string.  This is useful for working with
 // filenames on Windows.
@@ -14,6 +14,7 @@
 #include "ImfInputPartData.h"
 #include "ImfInputStreamMutex.h"
 #include "ImfMisc.h"
+#include "ImfPartChunks.h"
 #include "ImfPartType.h"
 #include "ImfScanLineInputFile.h"
 #include "ImfStdIO.h"
@@ -30,8 +31,11 @@
 #include <OpenEXRConfig.h>
 
 #include <Iex.h>
+#include <IlmThreadPool.h>
 
+#include <algorithm>
 #include <any>
+#include <memory>
 #include <mutex>
 
 OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
@@ -41,14 +45,47 @@ struct MultiPartInputFile::Data
 #if ILMTHREAD_THREADING_ENABLED
     std::mutex _mx;
 #endif
+    //
+    // The C++ state of a part (its Header and InputPartData) is only
+    // built the first time the part is used, so that opening a file
+    // with many parts to read one of them does not convert the
+    // headers of all the others.
+    //
     struct Part
     {
-        InputPartData data;
+        std::unique_ptr<InputPartData> data;
         std::any file;
     };
     std::vector<Part> parts;
+
+    int  numThreads  = 0;
+    bool autoAddType = true;
+
+    // the caller must hold _mx
+    InputPartData* partData (const Context& ctxt, int partNumber);
 };
 
+InputPartData*
+MultiPartInputFile::Data::partData (const Context& ctxt, int partNumber)
+{
+    Part& part = parts[partNumber];
+
+    if (!part.data)
+    {
+        part.data.reset (new InputPartData (ctxt, partNumber, numThreads));
+
+        if (autoAddType && !part.data->header.hasType ())
+        {
+            if (isTiled (ctxt.version ()))
+                part.data->header.setType (TILEDIMAGE);
+            else
+                part.data->header.setType (SCANLINEIMAGE);
+        }
+    }
+
+    return part.data.get ();
+}
+
 ////////////////////////////////////////
 
 MultiPartInputFile::MultiPartInputFile (
@@ -59,22 +96,9 @@ MultiPartInputFile::MultiPartInputFile (
     : _ctxt (filename, ctxtinit, Context::read_mode_t{})
     , _data (std::make_shared<Data> ())
 {
-    int version = _ctxt.version ();
-    int pc = _ctxt.partCount ();
-    _data->parts.resize (pc);
-
-    for ( int p = 0; p < pc; ++p )
-    {
-        _data->parts[p].data = InputPartData (_ctxt, p, numThreads);
-
-        if (autoAddType && ! _data->parts[p].data.header.hasType ())
-        {
-            if (isTiled (version))
-                _data->parts[p].data.header.setType (TILEDIMAGE);
-            else
-                _data->parts[p].data.header.setType (SCANLINEIMAGE);
-        }
-    }
+    _data->parts.resize (_ctxt.partCount ());
+    _data->numThreads  = numThreads;
+    _data->autoAddType = autoAddType;
 }
 
 MultiPartInputFile::MultiPartInputFile (
@@ -127,6 +151,12 @@ MultiPartInputFile::header (int partNumber) const
     return getPart (partNumber)->header;
 }
 
+int
+MultiPartInputFile::partNumber (const std::string& name) const
+{
+    return _ctxt.partIndex (name.c_str ());
+}
+
 void
 MultiPartInputFile::flushPartCache ()
 {
@@ -137,12 +167,133 @@ MultiPartInputFile::flushPartCache ()
         part.file.reset();
 }
 
+void
+MultiPartInputFile::readPixels (const std::vector<PartRead>& reads)
+{
+    std::vector<ScanLineInputFile::PartLines> scanLineParts;
+    std::vector<TiledInputFile::PartRegion>   tiledParts;
+    std::vector<const PartRead*>              deepParts;
+
+    for (const PartRead& r: reads)
+    {
+        if (r.partNumber < 0 || r.partNumber >= parts ())
+        {
+            THROW (
+                IEX_NAMESPACE::ArgExc,
+                "MultiPartInputFile::readPixels called with invalid part "
+                    << r.partNumber << " on file with " << parts ()
+                    << " parts");
+        }
+
+        exr_storage_t storage = _ctxt.storage (r.partNumber);
+
+        if (storage == EXR_STORAGE_SCANLINE)
+        {
+            scanLineParts.push_back (
+                {r.partNumber, r.frameBuffer, r.scanLine1, r.scanLine2});
+        }
+        else if (storage == EXR_STORAGE_TILED)
+        {
+            //
+            // the scan lines of a tiled part are a box as wide as
+            // its data window
+            //
+
+            exr_attr_box2i_t dw   = _ctxt.dataWindow (r.partNumber);
+            int              minY = std::min (r.scanLine1, r.scanLine2);
+            int              maxY = std::max (r.scanLine1, r.scanLine2);
+
+            if (minY < dw.min.y || maxY > dw.max.y)
+            {
+                throw IEX_NAMESPACE::ArgExc ("Tried to read scan line outside "
+                                             "the image file's data window.");
+            }
+
+            tiledParts.push_back (
+                {r.partNumber,
+                 r.frameBuffer,
+                 IMATH_NAMESPACE::Box2i (
+                     IMATH_NAMESPACE::V2i (dw.min.x, minY),
+                     IMATH_NAMESPACE::V2i (dw.max.x, maxY))});
+        }
+        else
+            deepParts.push_back (&r);
+    }
+
+    //
+    // decode the chunks of all the scan line and tiled parts in file
+    // order, so that the reads move through the file instead of
+    // jumping between parts
+    //
+
+    std::unique_ptr<PartChunks> chunks[] = {
+        ScanLineInputFile::partChunks (
+            _ctxt, scanLineParts, _data->numThreads),
+        TiledInputFile::partChunks (_ctxt, tiledParts, _data->numThreads)};
+
+    struct Job
+    {
+        PartChunks* chunks;
+        size_t      index;
+        uint64_t    offset;
+    };
+
+    std::vector<Job> jobs;
+
+    for (const std::unique_ptr<PartChunks>& c: chunks)
+        for (size_t i = 0; i < c->numJobs (); ++i)
+            jobs.push_back ({c.get (), i, c->jobOffset (i)});
+
+    std::stable_sort (
+        jobs.begin (), jobs.end (), [] (const Job& a, const Job& b) {
+            return a.offset < b.offset;
+        });
+
+#if ILMTHREAD_THREADING_ENABLED
+    if (jobs.size () > 1 && _data->numThreads > 1)
+    {
+        {
+            ILMTHREAD_NAMESPACE::TaskGroup tg;
+
+            for (const Job& job: jobs)
+                job.chunks->runJob (job.index, &tg);
+        }
+
+        for (const std::unique_ptr<PartChunks>& c: chunks)
+            c->finish ();
+    }
+    else
+#endif
+    {
+        for (const Job& job: jobs)
+            job.chunks->runJob (job.index, nullptr);
+    }
+
+    for (const PartRead* r: deepParts)
+    {
+        getInputPart<InputFile> (r->partNumber)
+            ->readPixels (*r->frameBuffer, r->scanLine1, r->scanLine2);
+    }
+}
+
 bool
 MultiPartInputFile::partComplete (int partNumber) const
 {
     return _ctxt.chunkTableValid (partNumber);
 }
 
+exr_perf_counters_t
+MultiPartInputFile::perfCounters () const
+{
+    return _ctxt.perfCounters ();
+}
+
+void
+MultiPartInputFile::resetPerfCounters ()
+{
+    _ctxt.resetPerfCounters ();
+}
+
 template <class T>
 T*
 MultiPartInputFile::getInputPart (int partNumber)
@@ -165,7 +316,7 @@ MultiPartInputFile::getInputPart (int partNumber)
         // TODO: change to copy / value semantics
         // stupid make_shared and friend functions, can we remove this restriction?
         // f = std::make_shared<T> (&(_data->parts[partNumber].data));
-        f.reset (new T (&(_data->parts[partNumber].data)));
+        f.reset (new T (_data->partData (_ctxt, partNumber)));
         _data->parts[partNumber].file = f;
     }
     else
@@ -192,7 +343,11 @@ MultiPartInputFile::getPart (int n) const
             "MultiPartInputFile::getPart called with invalid part "
                 << n << " on file with " << _data->parts.size () << " parts");
     }
-    return &(_data->parts[n].data);
+
+#if ILMTHREAD_THREADING_ENABLED
+    std::lock_guard<std::mutex> lock (_data->_mx);
+#endif
+    return _data->partData (_ctxt, n);
 }
 
 OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_EXIT
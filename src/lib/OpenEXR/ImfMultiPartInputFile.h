@@ -12,6 +12,9 @@
 
 #include "ImfContext.h"
 
+#include <string>
+#include <vector>
+
 OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
 
 /// \brief
@@ -71,6 +74,54 @@ public:
     IMF_EXPORT
     const Header& header (int partNumber) const;
 
+    //---------------------------------------------------------
+    // Find a part by name.  Returns the number of the first
+    // part with the specified name, or -1 if there is no such
+    // part.  The lookup does not read or convert the headers
+    // of the other parts.
+    //---------------------------------------------------------
+
+    IMF_EXPORT
+    int partNumber (const std::string& name) const;
+
+    //---------------------------------------------------------
+    // Read pixels from several parts in one pass.
+    //
+    // Each PartRead asks for scan lines scanLine1 through
+    // scanLine2 of one part, to be stored in frameBuffer.  The
+    // chunks of all the scan line and tiled parts are decoded
+    // together on the global thread pool, in the order in which
+    // they are stored in the file, rather than one part after
+    // the other; for a tiled part, these are the tiles of level
+    // (0, 0) that hold the scan lines.  Deep parts are then read
+    // one at a time, as if by InputPart::readPixels().
+    //
+    // The frame buffers of different requests must not
+    // overlap.
+    //---------------------------------------------------------
+
+    struct PartRead
+    {
+        PartRead (
+            int                partNumber,
+            const FrameBuffer& frameBuffer,
+            int                scanLine1,
+            int                scanLine2)
+            : partNumber (partNumber)
+            , frameBuffer (&frameBuffer)
+            , scanLine1 (scanLine1)
+            , scanLine2 (scanLine2)
+        {}
+
+        int                partNumber;
+        const FrameBuffer* frameBuffer;
+        int                scanLine1;
+        int                scanLine2;
+    };
+
+    IMF_EXPORT
+    void readPixels (const std::vector<PartRead>& reads);
+
     // =----------------------------------------
     // Check whether the entire chunk offset
     // table for the part is written correctly
@@ -78,6 +129,18 @@ public:
     IMF_EXPORT
     bool partComplete (int partNumber) const;
 
+    // ----------------------------------------
+    // Counters of the bytes read, chunks
+    // decoded, time spent decoding and buffer
+    // memory used by all the parts of the file
+    // (see exr_perf_counters_t)
+    // ----------------------------------------
+    IMF_EXPORT
+    exr_perf_counters_t perfCounters () const;
+
+    IMF_EXPORT
+    void resetPerfCounters ();
+
     // ----------------------------------------
     // Flush internal part cache
     // Invalidates all 'Part' types previously
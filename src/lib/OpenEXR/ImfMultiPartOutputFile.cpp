@@ -6,6 +6,7 @@
 #include "ImfMultiPartOutputFile.h"
 #include "ImfBoxAttribute.h"
 #include "ImfChromaticitiesAttribute.h"
+#include "ImfConstantChunks.h"
 #include "ImfDeepScanLineOutputFile.h"
 #include "ImfDeepTiledOutputFile.h"
 #include "ImfFloatAttribute.h"
@@ -176,6 +177,14 @@ MultiPartOutputFile::MultiPartOutputFile (
 
         _data->do_header_sanity_checks (overrideSharedAttributes);
 
+        //
+        // Size the constantChunks attributes, if requested, before
+        // the headers are written.
+        //
+
+        for (size_t i = 0; i < _data->_headers.size (); i++)
+            ConstantChunkTable::prepare (_data->_headers[i]);
+
         //
         // Build parts and write headers and offset tables to file.
         //
@@ -229,6 +238,14 @@ MultiPartOutputFile::MultiPartOutputFile (
 
         _data->do_header_sanity_checks (overrideSharedAttributes);
 
+        //
+        // Size the constantChunks attributes, if requested, before
+        // the headers are written.
+        //
+
+        for (size_t i = 0; i < _data->_headers.size (); i++)
+            ConstantChunkTable::prepare (_data->_headers[i]);
+
         //
         // Build parts and write headers and offset tables to file.
         //
@@ -472,9 +489,17 @@ MultiPartOutputFile::Data::writeHeadersToFile (const vector<Header>& headers)
 
         // (TODO) consider deep files' preview images here.
         if (headers[i].type () == TILEDIMAGE)
-            parts[i]->previewPosition = headers[i].writeTo (*os, true);
+            parts[i]->previewPosition = headers[i].writeTo (
+                *os,
+                true,
+                ConstantChunkTable::attributeName (),
+                parts[i]->constantChunksPosition);
         else
-            parts[i]->previewPosition = headers[i].writeTo (*os, false);
+            parts[i]->previewPosition = headers[i].writeTo (
+                *os,
+                false,
+                ConstantChunkTable::attributeName (),
+                parts[i]->constantChunksPosition);
     }
 
     //
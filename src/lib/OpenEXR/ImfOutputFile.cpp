@@ -19,6 +19,7 @@
 #include "IlmThreadSemaphore.h"
 #include "ImfArray.h"
 #include "ImfCompressor.h"
+#include "ImfConstantChunks.h"
 #include "ImfFrameBuffer.h"
 #include "ImfInputPart.h"
 #include "ImfMisc.h"
@@ -36,6 +37,7 @@
 #include <assert.h>
 #include <fstream>
 #include <string>
+#include <string.h>
 #include <vector>
 
 OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
@@ -100,6 +102,8 @@ struct LineBuffer
     int         scanLineMax;
     Compressor* compressor;
     bool        partiallyFull; // has incomplete data
+    bool        constant;      // all pixels have the value below
+    Array<char> constantValue; // one Xdr value per channel
     bool        hasException;
     string      exception;
 
@@ -118,6 +122,7 @@ LineBuffer::LineBuffer (Compressor* comp)
     , dataSize (0)
     , compressor (comp)
     , partiallyFull (false)
+    , constant (false)
     , hasException (false)
     , exception ()
     , _sem (1)
@@ -157,6 +162,11 @@ struct OutputFile::Data
     uint64_t             lineOffsetsPosition; // file position for line
                                               // offset table
 
+    ConstantChunkTable constantChunks;         // line buffers left out of
+                                               // the file
+    uint64_t           constantChunksPosition; // file position for the
+                                               // table's attribute
+
     vector<LineBuffer*> lineBuffers;   // each holds one line buffer
     int                 linesInBuffer; // number of scanlines each
                                        // buffer holds
@@ -180,6 +190,7 @@ struct OutputFile::Data
 
 OutputFile::Data::Data (int numThreads)
     : lineOffsetsPosition (0)
+    , constantChunksPosition (0)
     , partNumber (-1)
     , _streamData (0)
     , _deleteStream (false)
@@ -280,6 +291,20 @@ writePixelData (
     OutputFile::Data*  partdata,
     const LineBuffer*  lineBuffer)
 {
+    //
+    // A constant line buffer is recorded in the constantChunks
+    // attribute instead of being stored in the file.
+    //
+
+    if (lineBuffer->constant)
+    {
+        partdata->constantChunks.set (
+            (partdata->currentScanLine - partdata->minY) /
+                partdata->linesInBuffer,
+            lineBuffer->constantValue);
+        return;
+    }
+
     writePixelData (
         filedata,
         partdata,
@@ -358,6 +383,65 @@ convertToXdr (
     }
 }
 
+bool
+findConstantValue (const OutputFile::Data* ofd, LineBuffer* lineBuffer)
+{
+    //
+    // Check if all pixels in a complete lineBuffer have the same
+    // value.  If they do, store that value, one Xdr sample per
+    // channel, in lineBuffer->constantValue.  Channels without
+    // samples in the lineBuffer get the value 0.
+    //
+
+    const char* readPtr = lineBuffer->buffer;
+
+    memset (lineBuffer->constantValue, 0, ofd->constantChunks.bytesPerPixel ());
+
+    for (int y = lineBuffer->minY; y <= lineBuffer->maxY; y++)
+    {
+        char* valuePtr = lineBuffer->constantValue;
+
+        for (unsigned int i = 0; i < ofd->slices.size (); ++i)
+        {
+            const OutSliceInfo& slice = ofd->slices[i];
+            int                 size  = pixelTypeSize (slice.type);
+
+            if (modp (y, slice.ySampling) == 0)
+            {
+                int dMinX = divp (ofd->minX, slice.xSampling);
+                int dMaxX = divp (ofd->maxX, slice.xSampling);
+
+                //
+                // The first sampled scan line of the channel
+                // provides the value to compare against.
+                //
+
+                if (y - lineBuffer->minY < slice.ySampling)
+                    memcpy (valuePtr, readPtr, size);
+
+                if (!ConstantChunkTable::sameSamples (
+                        readPtr, valuePtr, dMaxX - dMinX + 1, size))
+                    return false;
+
+                readPtr += size_t (dMaxX - dMinX + 1) * size;
+            }
+
+            valuePtr += size;
+        }
+    }
+
+    if (ofd->format == Compressor::NATIVE)
+    {
+        char*       toPtr   = lineBuffer->constantValue;
+        const char* fromPtr = lineBuffer->constantValue;
+
+        for (unsigned int i = 0; i < ofd->slices.size (); ++i)
+            convertInPlace (toPtr, fromPtr, ofd->slices[i].type, 1);
+    }
+
+    return true;
+}
+
 //
 // A LineBufferTask encapsulates the task of copying a set of scanlines
 // from the user's frame buffer into a LineBuffer object, compressing
@@ -411,6 +495,7 @@ LineBufferTask::LineBufferTask (
             min (_lineBuffer->minY + _ofd->linesInBuffer - 1, _ofd->maxY);
 
         _lineBuffer->partiallyFull = true;
+        _lineBuffer->constant      = false;
     }
 
     _lineBuffer->scanLineMin = max (_lineBuffer->minY, scanLineMin);
@@ -554,6 +639,21 @@ LineBufferTask::execute ()
         _lineBuffer->dataSize =
             _lineBuffer->endOfLineBufferData - _lineBuffer->buffer;
 
+        //
+        // If the file records constant line buffers, and all pixels
+        // in this one have the same value, it is not compressed or
+        // stored in the file.
+        //
+
+        _lineBuffer->constant = _ofd->constantChunks.enabled () &&
+                                findConstantValue (_ofd, _lineBuffer);
+
+        if (_lineBuffer->constant)
+        {
+            _lineBuffer->partiallyFull = false;
+            return;
+        }
+
         //
         // Compress the data
         //
@@ -632,8 +732,11 @@ OutputFile::OutputFile (
         // Write header and empty offset table to the file.
         writeMagicNumberAndVersionField (
             *_data->_streamData->os, _data->header);
-        _data->previewPosition =
-            _data->header.writeTo (*_data->_streamData->os);
+        _data->previewPosition = _data->header.writeTo (
+            *_data->_streamData->os,
+            false,
+            ConstantChunkTable::attributeName (),
+            _data->constantChunksPosition);
         _data->lineOffsetsPosition =
             writeLineOffsets (*_data->_streamData->os, _data->lineOffsets);
     }
@@ -694,8 +797,11 @@ OutputFile::OutputFile (
         // Write header and empty offset table to the file.
         writeMagicNumberAndVersionField (
             *_data->_streamData->os, _data->header);
-        _data->previewPosition =
-            _data->header.writeTo (*_data->_streamData->os);
+        _data->previewPosition = _data->header.writeTo (
+            *_data->_streamData->os,
+            false,
+            ConstantChunkTable::attributeName (),
+            _data->constantChunksPosition);
         _data->lineOffsetsPosition =
             writeLineOffsets (*_data->_streamData->os, _data->lineOffsets);
     }
@@ -743,8 +849,9 @@ OutputFile::OutputFile (const OutputPartData* part) : _data (NULL)
 
         initialize (part->header);
         _data->partNumber          = part->partNumber;
-        _data->lineOffsetsPosition = part->chunkOffsetTablePosition;
-        _data->previewPosition     = part->previewPosition;
+        _data->lineOffsetsPosition    = part->chunkOffsetTablePosition;
+        _data->previewPosition        = part->previewPosition;
+        _data->constantChunksPosition = part->constantChunksPosition;
     }
     catch (IEX_NAMESPACE::BaseExc& e)
     {
@@ -787,6 +894,14 @@ OutputFile::initialize (const Header& header)
     _data->minY             = dataWindow.min.y;
     _data->maxY             = dataWindow.max.y;
 
+    //
+    // Size the constantChunks attribute, if requested, before the
+    // header is written.
+    //
+
+    if (ConstantChunkTable::prepare (_data->header))
+        _data->constantChunks = ConstantChunkTable (_data->header);
+
     size_t maxBytesPerLine =
         bytesPerLineTable (_data->header, _data->bytesPerLine);
 
@@ -802,8 +917,14 @@ OutputFile::initialize (const Header& header)
     _data->lineBufferSize  = maxBytesPerLine * _data->linesInBuffer;
 
     for (size_t i = 0; i < _data->lineBuffers.size (); i++)
+    {
         _data->lineBuffers[i]->buffer.resizeErase (_data->lineBufferSize);
 
+        if (_data->constantChunks.enabled ())
+            _data->lineBuffers[i]->constantValue.resizeErase (
+                _data->constantChunks.bytesPerPixel ());
+    }
+
     int lineOffsetSize =
         (dataWindow.max.y - dataWindow.min.y + _data->linesInBuffer) /
         _data->linesInBuffer;
@@ -832,6 +953,14 @@ OutputFile::~OutputFile ()
                     writeLineOffsets (
                         *_data->_streamData->os, _data->lineOffsets);
 
+                    if (_data->constantChunksPosition > 0 &&
+                        _data->constantChunks.enabled ())
+                    {
+                        _data->constantChunks.writeTo (
+                            *_data->_streamData->os,
+                            _data->constantChunksPosition);
+                    }
+
                     //
                     // Restore the original position.
                     //
@@ -1306,6 +1435,23 @@ OutputFile::copyPixels (InputFile& in)
                 << "\" failed.  "
                    "The files have different channel lists.");
 
+    //
+    // Constant line buffers have no raw pixel data that could be copied.
+    //
+
+    if (hasConstantChunks (inHdr))
+        THROW (
+            IEX_NAMESPACE::ArgExc,
+            "Quick pixel copy from image "
+            "file \""
+                << in.fileName ()
+                << "\" to image "
+                   "file \""
+                << fileName ()
+                << "\" failed.  "
+                   "The input file does not store its constant "
+                   "scan lines.");
+
     //
     // Verify that no pixel data have been written to this file yet.
     //
@@ -17,6 +17,7 @@ struct OutputPartData
     Header             header;
     uint64_t           chunkOffsetTablePosition;
     uint64_t           previewPosition;
+    uint64_t           constantChunksPosition;
     int                numThreads;
     int                partNumber;
     bool               multipart;
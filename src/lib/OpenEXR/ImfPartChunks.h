@@ -0,0 +1,60 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifndef INCLUDED_IMF_PART_CHUNKS_H
+#define INCLUDED_IMF_PART_CHUNKS_H
+
+//-----------------------------------------------------------------------------
+//
+//	class PartChunks
+//
+//	The chunks that must be decoded to read pixels from one or more
+//	parts of a file, one job per chunk.  MultiPartInputFile::readPixels()
+//	collects the jobs of the scan line and the tiled parts, and runs
+//	all of them in a single pass, in the order in which their chunks
+//	are stored in the file.
+//
+//-----------------------------------------------------------------------------
+
+#include "ImfForward.h"
+
+#include "IlmThreadForward.h"
+
+#include <cstddef>
+#include <cstdint>
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
+
+class IMF_HIDDEN PartChunks
+{
+public:
+    virtual ~PartChunks () = default;
+
+    virtual size_t numJobs () const = 0;
+
+    //
+    // Offset in the file of the chunk of job i
+    //
+
+    virtual uint64_t jobOffset (size_t i) const = 0;
+
+    //
+    // Decode the chunk of job i, as a task of group if group is
+    // not null, otherwise right away, in the calling thread
+    //
+
+    virtual void runJob (size_t i, ILMTHREAD_NAMESPACE::TaskGroup* group) = 0;
+
+    //
+    // Once the task group has finished, rethrow the first failure
+    // of the jobs that ran on the thread pool
+    //
+
+    virtual void finish () = 0;
+};
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif
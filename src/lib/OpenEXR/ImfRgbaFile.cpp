@@ -14,14 +14,17 @@
 #include <ImathFun.h>
 #include <ImfChannelList.h>
 #include <ImfInputPart.h>
+#include <ImfMisc.h>
 #include <ImfMultiPartInputFile.h>
 #include <ImfOutputFile.h>
 #include <ImfRgbaFile.h>
 #include <ImfRgbaYca.h>
 #include <ImfStandardAttributes.h>
 #include <algorithm>
+#include <functional>
 #include <mutex>
 #include <string.h>
+#include <vector>
 
 #include "ImfNamespace.h"
 
@@ -34,6 +37,15 @@ using namespace RgbaYca;
 namespace
 {
 
+//
+// Luminance/chroma conversions of at least PARALLEL_LINES scan lines
+// are done in bands of up to BAND_LINES scan lines.  The rows of each
+// band are converted concurrently on the global thread pool.
+//
+
+const int PARALLEL_LINES = 64;
+const int BAND_LINES     = 512;
+
 void
 insertChannels (Header& header, RgbaChannels rgbaChannels)
 {
@@ -138,6 +150,52 @@ cachePadding (ptrdiff_t size)
     return 0;
 }
 
+//
+// Append N2 copies of the first and last pixel to the beginning and
+// end of a scan line of n pixels that starts at buf[N2]
+//
+
+void
+padScanLine (int n, Rgba buf[/*n+N-1*/])
+{
+    for (int i = 0; i < N2; ++i)
+    {
+        buf[i]          = buf[N2];
+        buf[n + N2 + i] = buf[n + N2 - 2];
+    }
+}
+
+//
+// A slice for one of the channels of an array of Rgba pixels with
+// rows of rowLength pixels, where pixel (x0, y0) is at index firstPixel
+//
+
+Slice
+rgbaSlice (
+    const half* channel,
+    ptrdiff_t   firstPixel,
+    int         x0,
+    int         y0,
+    size_t      rowLength,
+    int         sampling,
+    double      fillValue)
+{
+    ptrdiff_t xStride = sizeof (Rgba);
+    ptrdiff_t yStride = xStride * rowLength;
+
+    intptr_t base = reinterpret_cast<intptr_t> (channel) +
+                    xStride * (firstPixel - x0) - yStride * y0;
+
+    return Slice (
+        HALF,
+        reinterpret_cast<char*> (base),
+        xStride * sampling,
+        yStride * sampling,
+        sampling,
+        sampling,
+        fillValue);
+}
+
 } // namespace
 
 class RgbaOutputFile::ToYca : public std::mutex
@@ -159,13 +217,17 @@ public:
     int  currentScanLine () const;
 
 private:
-    void padTmpBuf ();
-    void rotateBuffers ();
-    void duplicateLastBuffer ();
-    void duplicateSecondToLastBuffer ();
-    void decimateChromaVertAndWriteScanLine ();
+    void        padTmpBuf ();
+    void        rotateBuffers ();
+    void        duplicateLastBuffer ();
+    void        duplicateSecondToLastBuffer ();
+    void        decimateChromaVertAndWriteScanLine ();
+    void        writeLuminanceBands (int numScanLines);
+    void        writeChromaBands ();
+    FrameBuffer bandFrameBuffer (const vector<Rgba>& rows, int y0) const;
 
     OutputFile& _outputFile;
+    FrameBuffer _ycaFrameBuffer;
     bool        _writeY;
     bool        _writeC;
     bool        _writeA;
@@ -297,6 +359,7 @@ RgbaOutputFile::ToYca::setFrameBuffer (
         }
 
         _outputFile.setFrameBuffer (fb);
+        _ycaFrameBuffer = fb;
     }
 
     _fbBase    = base;
@@ -317,8 +380,40 @@ RgbaOutputFile::ToYca::writePixels (int numScanLines)
                  << "\".");
     }
 
+    //
+    // Large numbers of scan lines are converted in bands, with the
+    // rows of each band divided among the threads in the global
+    // thread pool.  Chroma filtering looks N2 scan lines ahead, so
+    // the banded conversion with chroma is used only if the whole
+    // image is written in one call.  Writing a band temporarily
+    // replaces the output file's frame buffer.
+    //
+
+    bool luminanceOnly = _writeY && !_writeC;
+
+    if (numScanLines >= PARALLEL_LINES &&
+        (luminanceOnly ? numScanLines <= _height - _linesConverted
+                       : _linesConverted == 0 && numScanLines == _height))
+    {
+        try
+        {
+            if (luminanceOnly)
+                writeLuminanceBands (numScanLines);
+            else
+                writeChromaBands ();
+        }
+        catch (...)
+        {
+            _outputFile.setFrameBuffer (_ycaFrameBuffer);
+            throw;
+        }
+
+        _outputFile.setFrameBuffer (_ycaFrameBuffer);
+        return;
+    }
+
     intptr_t base = reinterpret_cast<intptr_t> (_fbBase);
-    if (_writeY && !_writeC)
+    if (luminanceOnly)
     {
         //
         // We are writing only luminance; filtering
@@ -452,6 +547,185 @@ RgbaOutputFile::ToYca::writePixels (int numScanLines)
     }
 }
 
+void
+RgbaOutputFile::ToYca::writeLuminanceBands (int numScanLines)
+{
+    int      yStep = (_lineOrder == INCREASING_Y) ? 1 : -1;
+    intptr_t base  = reinterpret_cast<intptr_t> (_fbBase);
+
+    for (int done = 0; done < numScanLines; done += BAND_LINES)
+    {
+        int numLines  = min (BAND_LINES, numScanLines - done);
+        int firstLine = _currentScanLine;
+        int bandMin   = min (firstLine, firstLine + yStep * (numLines - 1));
+
+        vector<Rgba> rows (size_t (_width) * numLines);
+
+        std::function<void (int, int)> toYca = [&] (int begin, int end) {
+            for (int i = begin; i < end; ++i)
+            {
+                int   y   = firstLine + yStep * i;
+                Rgba* row = &rows[size_t (_width) * (y - bandMin)];
+
+                for (int j = 0; j < _width; ++j)
+                {
+                    row[j] = *reinterpret_cast<const Rgba*> (
+                        base + sizeof (Rgba) * (_fbYStride * y +
+                                                _fbXStride * (j + _xMin)));
+                }
+
+                RGBAtoYCA (_yw, _width, _writeA, row, row);
+            }
+        };
+
+        forEachRowRange (numLines, toYca);
+
+        _outputFile.setFrameBuffer (bandFrameBuffer (rows, bandMin));
+        _outputFile.writePixels (numLines);
+
+        _linesConverted += numLines;
+        _currentScanLine += yStep * numLines;
+    }
+}
+
+void
+RgbaOutputFile::ToYca::writeChromaBands ()
+{
+    //
+    // Convert the image to luminance/chroma, and filter and subsample
+    // the chroma channels, one band of output scan lines at a time.
+    // Each band needs the horizontally decimated scan lines of the
+    // band itself plus N2 tap lines above and below it; the tap lines
+    // below a band are the first lines of the next band's window, so
+    // they are kept rather than converted again.
+    //
+    // The results are identical to those of the rotating buffers in
+    // writePixels(): scan lines before the first one are replaced by
+    // the first scan line, and scan lines after the last one by the
+    // second to last scan line.
+    //
+
+    int      yStep     = (_lineOrder == INCREASING_Y) ? 1 : -1;
+    int      firstLine = _currentScanLine;
+    intptr_t base      = reinterpret_cast<intptr_t> (_fbBase);
+    int      bandLines = min (BAND_LINES, _height);
+
+    vector<Rgba> window (size_t (_width) * (bandLines + N - 1));
+    vector<Rgba> rows (size_t (_width) * bandLines);
+    int          windowStart = 0;
+    int          keptLines   = 0;
+
+    //
+    // Window line r holds scan line windowStart + r - N2 of the image,
+    // or the line that replaces it if that is outside the image.
+    //
+
+    std::function<void (int, int)> decimateHoriz = [&] (int begin, int end) {
+        vector<Rgba> tmp (_width + N - 1);
+
+        for (int r = keptLines + begin; r < keptLines + end; ++r)
+        {
+            int i = windowStart + r - N2;
+
+            if (i < 0)
+                i = 0;
+            else if (i >= _height)
+                i = _height - 2;
+
+            int y = firstLine + yStep * i;
+
+            for (int j = 0; j < _width; ++j)
+            {
+                tmp[j + N2] = *reinterpret_cast<const Rgba*> (
+                    base + sizeof (Rgba) * (_fbYStride * y +
+                                            _fbXStride * (j + _xMin)));
+            }
+
+            RGBAtoYCA (_yw, _width, _writeA, &tmp[N2], &tmp[N2]);
+            padScanLine (_width, &tmp[0]);
+            decimateChromaHoriz (_width, &tmp[0], &window[size_t (_width) * r]);
+        }
+    };
+
+    for (int done = 0; done < _height; done += BAND_LINES)
+    {
+        int numLines    = min (BAND_LINES, _height - done);
+        int windowLines = numLines + N - 1;
+        int bandMin     = min (
+            firstLine + yStep * done,
+            firstLine + yStep * (done + numLines - 1));
+
+        windowStart = done;
+        forEachRowRange (windowLines - keptLines, decimateHoriz);
+
+        std::function<void (int, int)> decimateVert = [&] (int begin,
+                                                           int end) {
+            for (int i = done + begin; i < done + end; ++i)
+            {
+                const Rgba* taps[N];
+
+                for (int j = 0; j < N; ++j)
+                    taps[j] = &window[size_t (_width) * (i - done + j)];
+
+                int   y   = firstLine + yStep * i;
+                Rgba* out = &rows[size_t (_width) * (y - bandMin)];
+
+                //
+                // i + N2 + 1 is the value of _linesConverted when
+                // writePixels() stores this scan line.
+                //
+
+                if ((i + N2 + 1) & 1)
+                    memcpy (out, taps[N2], _width * sizeof (Rgba));
+                else
+                    decimateChromaVert (_width, taps, out);
+
+                if (_writeY && _writeC)
+                    roundYCA (_width, _roundY, _roundC, out, out);
+            }
+        };
+
+        forEachRowRange (numLines, decimateVert);
+
+        _outputFile.setFrameBuffer (bandFrameBuffer (rows, bandMin));
+        _outputFile.writePixels (numLines);
+
+        //
+        // The last N - 1 lines of the window are the first lines of
+        // the next band's window.
+        //
+
+        memmove (
+            &window[0],
+            &window[size_t (_width) * numLines],
+            size_t (_width) * (N - 1) * sizeof (Rgba));
+
+        keptLines = N - 1;
+    }
+
+    _linesConverted  = _height + N2;
+    _currentScanLine = firstLine + yStep * _height;
+}
+
+FrameBuffer
+RgbaOutputFile::ToYca::bandFrameBuffer (const vector<Rgba>& rows, int y0) const
+{
+    const Rgba& p = rows[0];
+    FrameBuffer fb;
+
+    if (_writeY) fb.insert ("Y", rgbaSlice (&p.g, 0, _xMin, y0, _width, 1, 0));
+
+    if (_writeC)
+    {
+        fb.insert ("RY", rgbaSlice (&p.r, 0, _xMin, y0, _width, 2, 0));
+        fb.insert ("BY", rgbaSlice (&p.b, 0, _xMin, y0, _width, 2, 0));
+    }
+
+    if (_writeA) fb.insert ("A", rgbaSlice (&p.a, 0, _xMin, y0, _width, 1, 0));
+
+    return fb;
+}
+
 int
 RgbaOutputFile::ToYca::currentScanLine () const
 {
@@ -461,11 +735,7 @@ RgbaOutputFile::ToYca::currentScanLine () const
 void
 RgbaOutputFile::ToYca::padTmpBuf ()
 {
-    for (int i = 0; i < N2; ++i)
-    {
-        _tmpBuf[i]               = _tmpBuf[N2];
-        _tmpBuf[_width + N2 + i] = _tmpBuf[_width + N2 - 2];
-    }
+    padScanLine (_width, _tmpBuf);
 }
 
 void
@@ -751,12 +1021,16 @@ public:
 
 private:
     void readPixels (int scanLine);
+    void readBand (int scanLine1, int scanLine2);
     void rotateBuf1 (int d);
     void rotateBuf2 (int d);
     void readYCAScanLine (int y, Rgba buf[]);
     void padTmpBuf ();
+    int  clampScanLine (int y) const;
 
-    InputPart& _inputPart;
+    InputPart&  _inputPart;
+    FrameBuffer _ycaFrameBuffer;
+    string      _channelNamePrefix;
     bool       _readC;
     int        _xMin;
     int        _yMin;
@@ -871,6 +1145,9 @@ RgbaInputFile::FromYca::setFrameBuffer (
                 1.0));                          // fillValue
 
         _inputPart.setFrameBuffer (fb);
+
+        _ycaFrameBuffer    = fb;
+        _channelNamePrefix = channelNamePrefix;
     }
 
     _fbBase    = base;
@@ -881,10 +1158,43 @@ RgbaInputFile::FromYca::setFrameBuffer (
 void
 RgbaInputFile::FromYca::readPixels (int scanLine1, int scanLine2)
 {
+    if (_fbBase == 0)
+    {
+        THROW (
+            IEX_NAMESPACE::ArgExc,
+            "No frame buffer was specified as the "
+            "pixel data destination for image file "
+            "\"" << _inputPart.fileName ()
+                 << "\".");
+    }
+
     int minY = min (scanLine1, scanLine2);
     int maxY = max (scanLine1, scanLine2);
 
-    if (_lineOrder == INCREASING_Y)
+    if (maxY - minY + 1 >= PARALLEL_LINES && _height > 1)
+    {
+        //
+        // Read the scan lines in bands.  Reading a band temporarily
+        // replaces the input part's frame buffer; the partially
+        // processed scan lines in _buf1 and _buf2 become stale.
+        //
+
+        try
+        {
+            for (int y = minY; y <= maxY; y += BAND_LINES)
+                readBand (y, min (maxY, y + BAND_LINES - 1));
+        }
+        catch (...)
+        {
+            _inputPart.setFrameBuffer (_ycaFrameBuffer);
+            _currentScanLine = _yMin - N - 2;
+            throw;
+        }
+
+        _inputPart.setFrameBuffer (_ycaFrameBuffer);
+        _currentScanLine = _yMin - N - 2;
+    }
+    else if (_lineOrder == INCREASING_Y)
     {
         for (int y = minY; y <= maxY; ++y)
             readPixels (y);
@@ -899,16 +1209,6 @@ RgbaInputFile::FromYca::readPixels (int scanLine1, int scanLine2)
 void
 RgbaInputFile::FromYca::readPixels (int scanLine)
 {
-    if (_fbBase == 0)
-    {
-        THROW (
-            IEX_NAMESPACE::ArgExc,
-            "No frame buffer was specified as the "
-            "pixel data destination for image file "
-            "\"" << _inputPart.fileName ()
-                 << "\".");
-    }
-
     //
     // In order to convert one scan line to RGB format, we need that
     // scan line plus N2+1 extra scan lines above and N2+1 scan lines
@@ -1012,6 +1312,176 @@ RgbaInputFile::FromYca::readPixels (int scanLine)
     _currentScanLine = scanLine;
 }
 
+void
+RgbaInputFile::FromYca::readBand (int scanLine1, int scanLine2)
+{
+    //
+    // Convert scan lines scanLine1 through scanLine2 to RGB format
+    // in one pass, without the rotating buffers used by
+    // readPixels(int).  The results are identical:
+    //
+    // Scan lines scanLine1-N2-1 through scanLine2+N2+1 (clamped as
+    // in readYCAScanLine()) are read in one readPixels() call, so that
+    // the input part can decompress them concurrently.  The even
+    // scan lines are then filtered horizontally, and finally each
+    // output scan line is filtered vertically, converted to RGB and
+    // desaturated.  The rows of the last two steps are divided among
+    // the threads in the global thread pool.
+    //
+
+    int lineMin = scanLine1 - N2 - 1;
+    int lineMax = scanLine2 + N2 + 1;
+
+    //
+    // The chroma channels are subsampled vertically, so the first
+    // scan line we read must be even, like _yMin.
+    //
+
+    int readMin = max (_yMin, lineMin);
+    int readMax = min (_yMax, lineMax);
+
+    if (readMin & 1) --readMin;
+
+    int    numRows   = readMax - readMin + 1;
+    size_t rowLength = _width + N - 1;
+
+    vector<Rgba> ycaRows (rowLength * numRows);
+    vector<Rgba> filteredRows (size_t (_width) * numRows);
+
+    {
+        ptrdiff_t   first = N2;
+        const Rgba& p     = ycaRows[0];
+        FrameBuffer fb;
+
+        fb.insert (
+            _channelNamePrefix + "Y",
+            rgbaSlice (&p.g, first, _xMin, readMin, rowLength, 1, 0.5));
+
+        if (_readC)
+        {
+            fb.insert (
+                _channelNamePrefix + "RY",
+                rgbaSlice (&p.r, first, _xMin, readMin, rowLength, 2, 0.0));
+
+            fb.insert (
+                _channelNamePrefix + "BY",
+                rgbaSlice (&p.b, first, _xMin, readMin, rowLength, 2, 0.0));
+        }
+
+        fb.insert (
+            _channelNamePrefix + "A",
+            rgbaSlice (&p.a, first, _xMin, readMin, rowLength, 1, 1.0));
+
+        _inputPart.setFrameBuffer (fb);
+        _inputPart.readPixels (readMin, readMax);
+    }
+
+    //
+    // ycaLines[i] points to scan line readMin+i in luminance/chroma
+    // format, with the missing chroma samples of even scan lines
+    // reconstructed.
+    //
+
+    vector<const Rgba*> ycaLines (numRows);
+
+    std::function<void (int, int)> filterHoriz = [&] (int begin, int end) {
+        for (int i = begin; i < end; ++i)
+        {
+            Rgba* row = &ycaRows[rowLength * i];
+
+            if (!_readC)
+            {
+                for (int j = 0; j < _width; ++j)
+                {
+                    row[j + N2].r = 0;
+                    row[j + N2].b = 0;
+                }
+            }
+
+            if ((readMin + i) & 1) { ycaLines[i] = row + N2; }
+            else
+            {
+                padScanLine (_width, row);
+
+                Rgba* out = &filteredRows[size_t (_width) * i];
+                reconstructChromaHoriz (_width, row, out);
+                ycaLines[i] = out;
+            }
+        }
+    };
+
+    forEachRowRange (numRows, filterHoriz);
+
+    std::function<void (int, int)> toRgb = [&] (int begin, int end) {
+        //
+        // Convert scan lines scanLine1+begin-1 through scanLine1+end
+        // to RGB; fixSaturation() needs one neighbor on either side.
+        //
+
+        int          firstLine = scanLine1 + begin - 1;
+        int          numLines  = end - begin + 2;
+        vector<Rgba> rgbRows (size_t (_width) * numLines);
+        vector<Rgba> out (_width);
+
+        for (int i = 0; i < numLines; ++i)
+        {
+            int   y   = firstLine + i;
+            Rgba* rgb = &rgbRows[size_t (_width) * i];
+
+            if ((y + 1) & 1)
+            {
+                YCAtoRGBA (
+                    _yw, _width, ycaLines[clampScanLine (y) - readMin], rgb);
+            }
+            else
+            {
+                const Rgba* taps[N];
+
+                for (int j = 0; j < N; ++j)
+                    taps[j] = ycaLines[clampScanLine (y - N2 + j) - readMin];
+
+                reconstructChromaVert (_width, taps, rgb);
+                YCAtoRGBA (_yw, _width, rgb, rgb);
+            }
+        }
+
+        intptr_t base = reinterpret_cast<intptr_t> (_fbBase);
+
+        for (int i = 1; i < numLines - 1; ++i)
+        {
+            const Rgba* rows[3] = {
+                &rgbRows[size_t (_width) * (i - 1)],
+                &rgbRows[size_t (_width) * i],
+                &rgbRows[size_t (_width) * (i + 1)]};
+
+            fixSaturation (_yw, _width, rows, &out[0]);
+
+            int scanLine = firstLine + i;
+
+            for (int j = 0; j < _width; ++j)
+            {
+                Rgba* ptr = reinterpret_cast<Rgba*> (
+                    base + sizeof (Rgba) * (_fbYStride * scanLine +
+                                            _fbXStride * (j + _xMin)));
+                *ptr = out[j];
+            }
+        }
+    };
+
+    forEachRowRange (scanLine2 - scanLine1 + 1, toRgb);
+}
+
+int
+RgbaInputFile::FromYca::clampScanLine (int y) const
+{
+    if (y < _yMin)
+        return _yMin;
+    else if (y > _yMax)
+        return _yMax - 1;
+
+    return y;
+}
+
 void
 RgbaInputFile::FromYca::rotateBuf1 (int d)
 {
@@ -1083,11 +1553,7 @@ RgbaInputFile::FromYca::readYCAScanLine (int y, Rgba* buf)
 void
 RgbaInputFile::FromYca::padTmpBuf ()
 {
-    for (int i = 0; i < N2; ++i)
-    {
-        _tmpBuf[i]               = _tmpBuf[N2];
-        _tmpBuf[_width + N2 + i] = _tmpBuf[_width + N2 - 2];
-    }
+    padScanLine (_width, _tmpBuf);
 }
 
 RgbaInputFile::RgbaInputFile (const char name[], int numThreads)
@@ -13,6 +13,29 @@
 #include <algorithm>
 #include <assert.h>
 
+//
+// The colour conversion and chroma filter loops have F16C versions
+// that handle several pixels at a time.  Without a compiler flag that
+// enables F16C they are compiled for it separately and picked at run
+// time, the same way as in OpenEXRCore's unpack.c.
+//
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    if defined(__AVX__) && defined(__F16C__)
+#        define IMF_RGBA_YCA_F16C
+#        define IMF_F16C_TARGET
+#    elif defined(__GNUC__) || defined(__clang__)
+#        define IMF_RGBA_YCA_F16C
+#        define IMF_F16C_TARGET __attribute__ ((target ("avx,f16c")))
+#    endif
+#endif
+
+#ifdef IMF_RGBA_YCA_F16C
+#    include "ImfSystemSpecific.h"
+#    include <immintrin.h>
+#    include <string.h>
+#endif
+
 using namespace IMATH_NAMESPACE;
 using namespace std;
 #include "ImfNamespace.h"
@@ -22,6 +45,477 @@ OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
 namespace RgbaYca
 {
 
+#ifdef IMF_RGBA_YCA_F16C
+
+namespace
+{
+
+//
+// The kernels below do the same float operations, in the same order,
+// as the scalar loops further down, and half <-> float conversions
+// are exact in both directions (floats are rounded to the nearest
+// half, ties to even, as half(float) does).  The results are thus
+// identical to those of the scalar code, except possibly for which
+// input NaN a NaN result carries.  Channels that the scalar code
+// copies are copied as bits.  Each kernel returns the number of
+// pixels it has handled; the scalar loop does the rest.
+//
+
+bool
+haveF16c ()
+{
+#    ifdef __F16C__
+    return true;
+#    else
+    static const bool f16c = [] {
+        CpuId cpuId;
+        return cpuId.avx && cpuId.f16c;
+    }();
+
+    return f16c;
+#    endif
+}
+
+//
+// Filter taps, as offsets from the center pixel or scan line
+//
+
+const int   decimateTaps                 = 15;
+const int   decimateOffset[decimateTaps] = {
+    -13, -11, -9, -7, -5, -3, -1, 0, 1, 3, 5, 7, 9, 11, 13};
+const float decimateCoeff[decimateTaps] = {
+    0.001064f,
+    -0.003771f,
+    0.009801f,
+    -0.021586f,
+    0.043978f,
+    -0.093067f,
+    0.313659f,
+    0.499846f,
+    0.313659f,
+    -0.093067f,
+    0.043978f,
+    -0.021586f,
+    0.009801f,
+    -0.003771f,
+    0.001064f};
+
+const int   reconstructTaps                    = 14;
+const int   reconstructOffset[reconstructTaps] = {
+    -13, -11, -9, -7, -5, -3, -1, 1, 3, 5, 7, 9, 11, 13};
+const float reconstructCoeff[reconstructTaps] = {
+    0.002128f,
+    -0.007540f,
+    0.019597f,
+    -0.043159f,
+    0.087929f,
+    -0.186077f,
+    0.627123f,
+    0.627123f,
+    -0.186077f,
+    0.087929f,
+    -0.043159f,
+    0.019597f,
+    -0.007540f,
+    0.002128f};
+
+//
+// Two pixels as eight floats, r0 g0 b0 a0 r1 g1 b1 a1
+//
+
+IMF_F16C_TARGET inline __m128i
+loadHalves (const Rgba* p0, const Rgba* p1)
+{
+    return _mm_unpacklo_epi64 (
+        _mm_loadl_epi64 ((const __m128i*) p0),
+        _mm_loadl_epi64 ((const __m128i*) p1));
+}
+
+IMF_F16C_TARGET inline __m256
+loadPixels (const Rgba* p0, const Rgba* p1)
+{
+    return _mm256_cvtph_ps (loadHalves (p0, p1));
+}
+
+//
+// Store the R and B channels of two filtered pixels, and copy
+// G and A from the pixels at the filter center, c0 and c1.
+//
+
+IMF_F16C_TARGET inline void
+storeChroma (__m256 v, const Rgba* c0, const Rgba* c1, Rgba* out0, Rgba* out1)
+{
+    __m128i h = _mm256_cvtps_ph (v, _MM_FROUND_TO_NEAREST_INT);
+    h         = _mm_blend_epi16 (loadHalves (c0, c1), h, 0x55);
+
+    _mm_storel_epi64 ((__m128i*) out0, h);
+    _mm_storel_epi64 ((__m128i*) out1, _mm_unpackhi_epi64 (h, h));
+}
+
+IMF_F16C_TARGET inline __m256
+filterHoriz (
+    int         taps,
+    const int   offset[],
+    const float coeff[],
+    const Rgba* c0,
+    const Rgba* c1)
+{
+    __m256 v = _mm256_mul_ps (
+        loadPixels (c0 + offset[0], c1 + offset[0]),
+        _mm256_set1_ps (coeff[0]));
+
+    for (int k = 1; k < taps; ++k)
+    {
+        v = _mm256_add_ps (
+            v,
+            _mm256_mul_ps (
+                loadPixels (c0 + offset[k], c1 + offset[k]),
+                _mm256_set1_ps (coeff[k])));
+    }
+
+    return v;
+}
+
+IMF_F16C_TARGET inline __m256
+filterVert (
+    int               taps,
+    const int         offset[],
+    const float       coeff[],
+    const Rgba* const ycaIn[N],
+    int               i0,
+    int               i1)
+{
+    const Rgba* const* c = ycaIn + N2;
+
+    __m256 v = _mm256_mul_ps (
+        loadPixels (c[offset[0]] + i0, c[offset[0]] + i1),
+        _mm256_set1_ps (coeff[0]));
+
+    for (int k = 1; k < taps; ++k)
+    {
+        v = _mm256_add_ps (
+            v,
+            _mm256_mul_ps (
+                loadPixels (c[offset[k]] + i0, c[offset[k]] + i1),
+                _mm256_set1_ps (coeff[k])));
+    }
+
+    return v;
+}
+
+IMF_F16C_TARGET int
+decimateChromaHoriz_f16c (int n, const Rgba ycaIn[], Rgba ycaOut[])
+{
+    int j = 0;
+
+    for (; j + 4 <= n; j += 4)
+    {
+        const Rgba* in  = ycaIn + N2 + j;
+        Rgba*       out = ycaOut + j;
+
+        __m256 v = filterHoriz (
+            decimateTaps, decimateOffset, decimateCoeff, in, in + 2);
+
+        storeChroma (v, in, in + 2, out, out + 2);
+
+        out[1].g = in[1].g;
+        out[1].a = in[1].a;
+        out[3].g = in[3].g;
+        out[3].a = in[3].a;
+    }
+
+    return j;
+}
+
+IMF_F16C_TARGET int
+decimateChromaVert_f16c (int n, const Rgba* const ycaIn[N], Rgba ycaOut[])
+{
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        const Rgba* in  = ycaIn[N2] + i;
+        Rgba*       out = ycaOut + i;
+
+        __m256 v = filterVert (
+            decimateTaps, decimateOffset, decimateCoeff, ycaIn, i, i + 2);
+
+        storeChroma (v, in, in + 2, out, out + 2);
+
+        out[1].g = in[1].g;
+        out[1].a = in[1].a;
+        out[3].g = in[3].g;
+        out[3].a = in[3].a;
+    }
+
+    return i;
+}
+
+IMF_F16C_TARGET int
+reconstructChromaHoriz_f16c (int n, const Rgba ycaIn[], Rgba ycaOut[])
+{
+    int j = 0;
+
+    for (; j + 4 <= n; j += 4)
+    {
+        const Rgba* in  = ycaIn + N2 + j;
+        Rgba*       out = ycaOut + j;
+
+        __m256 v = filterHoriz (
+            reconstructTaps,
+            reconstructOffset,
+            reconstructCoeff,
+            in + 1,
+            in + 3);
+
+        storeChroma (v, in + 1, in + 3, out + 1, out + 3);
+
+        out[0] = in[0];
+        out[2] = in[2];
+    }
+
+    return j;
+}
+
+IMF_F16C_TARGET int
+reconstructChromaVert_f16c (int n, const Rgba* const ycaIn[N], Rgba ycaOut[])
+{
+    int i = 0;
+
+    for (; i + 2 <= n; i += 2)
+    {
+        const Rgba* in = ycaIn[N2] + i;
+
+        __m256 v = filterVert (
+            reconstructTaps,
+            reconstructOffset,
+            reconstructCoeff,
+            ycaIn,
+            i,
+            i + 1);
+
+        storeChroma (v, in, in + 1, ycaOut + i, ycaOut + i + 1);
+    }
+
+    return i;
+}
+
+//
+// Eight pixels as one vector per channel.  The pixels are in the
+// order 0 2 4 6 1 3 5 7; lane k holds pixel pixelInLane (k).
+//
+
+inline int
+pixelInLane (int k)
+{
+    return k < 4 ? 2 * k : 2 * (k - 4) + 1;
+}
+
+IMF_F16C_TARGET inline void
+loadChannels (const Rgba p[8], __m256& r, __m256& g, __m256& b, __m256& a)
+{
+    __m256 v0 = _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i*) (p + 0)));
+    __m256 v1 = _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i*) (p + 2)));
+    __m256 v2 = _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i*) (p + 4)));
+    __m256 v3 = _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i*) (p + 6)));
+
+    __m256 t0 = _mm256_unpacklo_ps (v0, v1);
+    __m256 t1 = _mm256_unpackhi_ps (v0, v1);
+    __m256 t2 = _mm256_unpacklo_ps (v2, v3);
+    __m256 t3 = _mm256_unpackhi_ps (v2, v3);
+
+    r = _mm256_shuffle_ps (t0, t2, _MM_SHUFFLE (1, 0, 1, 0));
+    g = _mm256_shuffle_ps (t0, t2, _MM_SHUFFLE (3, 2, 3, 2));
+    b = _mm256_shuffle_ps (t1, t3, _MM_SHUFFLE (1, 0, 1, 0));
+    a = _mm256_shuffle_ps (t1, t3, _MM_SHUFFLE (3, 2, 3, 2));
+}
+
+IMF_F16C_TARGET inline void
+storeChannels (__m256 r, __m256 g, __m256 b, __m256 a, Rgba p[8])
+{
+    __m256 t0 = _mm256_unpacklo_ps (r, g);
+    __m256 t1 = _mm256_unpacklo_ps (b, a);
+    __m256 t2 = _mm256_unpackhi_ps (r, g);
+    __m256 t3 = _mm256_unpackhi_ps (b, a);
+
+    __m256 v0 = _mm256_shuffle_ps (t0, t1, _MM_SHUFFLE (1, 0, 1, 0));
+    __m256 v1 = _mm256_shuffle_ps (t0, t1, _MM_SHUFFLE (3, 2, 3, 2));
+    __m256 v2 = _mm256_shuffle_ps (t2, t3, _MM_SHUFFLE (1, 0, 1, 0));
+    __m256 v3 = _mm256_shuffle_ps (t2, t3, _MM_SHUFFLE (3, 2, 3, 2));
+
+    _mm_storeu_si128 (
+        (__m128i*) (p + 0), _mm256_cvtps_ph (v0, _MM_FROUND_TO_NEAREST_INT));
+    _mm_storeu_si128 (
+        (__m128i*) (p + 2), _mm256_cvtps_ph (v1, _MM_FROUND_TO_NEAREST_INT));
+    _mm_storeu_si128 (
+        (__m128i*) (p + 4), _mm256_cvtps_ph (v2, _MM_FROUND_TO_NEAREST_INT));
+    _mm_storeu_si128 (
+        (__m128i*) (p + 6), _mm256_cvtps_ph (v3, _MM_FROUND_TO_NEAREST_INT));
+}
+
+IMF_F16C_TARGET int
+RGBAtoYCA_f16c (
+    const V3f& yw, int n, bool aIsValid, const Rgba rgbaIn[], Rgba ycaOut[])
+{
+    const __m256 ywx     = _mm256_set1_ps (yw.x);
+    const __m256 ywy     = _mm256_set1_ps (yw.y);
+    const __m256 ywz     = _mm256_set1_ps (yw.z);
+    const __m256 zero    = _mm256_setzero_ps ();
+    const __m256 one     = _mm256_set1_ps (1.0f);
+    const __m256 halfMax = _mm256_set1_ps (HALF_MAX);
+    const __m256 absMask = _mm256_castsi256_ps (_mm256_set1_epi32 (0x7fffffff));
+
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        //
+        // rgbaIn and ycaOut may be the same array.
+        //
+
+        Rgba in[8];
+        memcpy (in, rgbaIn + i, sizeof (in));
+
+        __m256 r, g, b, a;
+        loadChannels (in, r, g, b, a);
+
+        //
+        // Replace infinities, NaNs and negative values with 0.
+        // Like in.r < 0, (r >= 0) is true for -0.
+        //
+
+        r = _mm256_and_ps (
+            r,
+            _mm256_and_ps (
+                _mm256_cmp_ps (r, zero, _CMP_GE_OQ),
+                _mm256_cmp_ps (r, halfMax, _CMP_LE_OQ)));
+
+        g = _mm256_and_ps (
+            g,
+            _mm256_and_ps (
+                _mm256_cmp_ps (g, zero, _CMP_GE_OQ),
+                _mm256_cmp_ps (g, halfMax, _CMP_LE_OQ)));
+
+        b = _mm256_and_ps (
+            b,
+            _mm256_and_ps (
+                _mm256_cmp_ps (b, zero, _CMP_GE_OQ),
+                _mm256_cmp_ps (b, halfMax, _CMP_LE_OQ)));
+
+        __m256 grey = _mm256_and_ps (
+            _mm256_cmp_ps (r, g, _CMP_EQ_OQ), _mm256_cmp_ps (g, b, _CMP_EQ_OQ));
+
+        //
+        // Y is rounded to half before the chroma channels are
+        // computed from it, as in the scalar code.
+        //
+
+        __m256 Y = _mm256_add_ps (
+            _mm256_add_ps (_mm256_mul_ps (r, ywx), _mm256_mul_ps (g, ywy)),
+            _mm256_mul_ps (b, ywz));
+
+        Y = _mm256_cvtph_ps (_mm256_cvtps_ph (Y, _MM_FROUND_TO_NEAREST_INT));
+
+        __m256 limit = _mm256_mul_ps (halfMax, Y);
+        __m256 dr    = _mm256_sub_ps (r, Y);
+        __m256 db    = _mm256_sub_ps (b, Y);
+
+        __m256 cr = _mm256_and_ps (
+            _mm256_div_ps (dr, Y),
+            _mm256_cmp_ps (_mm256_and_ps (dr, absMask), limit, _CMP_LT_OQ));
+
+        __m256 cb = _mm256_and_ps (
+            _mm256_div_ps (db, Y),
+            _mm256_cmp_ps (_mm256_and_ps (db, absMask), limit, _CMP_LT_OQ));
+
+        storeChannels (
+            _mm256_blendv_ps (cr, zero, grey),
+            _mm256_blendv_ps (Y, g, grey),
+            _mm256_blendv_ps (cb, zero, grey),
+            aIsValid ? a : one,
+            ycaOut + i);
+
+        if (aIsValid)
+            for (int k = 0; k < 8; ++k)
+                ycaOut[i + k].a = in[k].a;
+    }
+
+    return i;
+}
+
+IMF_F16C_TARGET int
+YCAtoRGBA_f16c (const V3f& yw, int n, const Rgba ycaIn[], Rgba rgbaOut[])
+{
+    const __m256 ywx  = _mm256_set1_ps (yw.x);
+    const __m256 ywy  = _mm256_set1_ps (yw.y);
+    const __m256 ywz  = _mm256_set1_ps (yw.z);
+    const __m256 zero = _mm256_setzero_ps ();
+    const __m256 one  = _mm256_set1_ps (1.0f);
+
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        //
+        // ycaIn and rgbaOut may be the same array.
+        //
+
+        Rgba in[8];
+        memcpy (in, ycaIn + i, sizeof (in));
+
+        __m256 cr, Y, cb, a;
+        loadChannels (in, cr, Y, cb, a);
+
+        __m256 grey = _mm256_and_ps (
+            _mm256_cmp_ps (cr, zero, _CMP_EQ_OQ),
+            _mm256_cmp_ps (cb, zero, _CMP_EQ_OQ));
+
+        __m256 r = _mm256_mul_ps (_mm256_add_ps (cr, one), Y);
+        __m256 b = _mm256_mul_ps (_mm256_add_ps (cb, one), Y);
+
+        __m256 g = _mm256_div_ps (
+            _mm256_sub_ps (
+                _mm256_sub_ps (Y, _mm256_mul_ps (r, ywx)),
+                _mm256_mul_ps (b, ywz)),
+            ywy);
+
+        storeChannels (
+            _mm256_blendv_ps (r, Y, grey),
+            _mm256_blendv_ps (g, Y, grey),
+            _mm256_blendv_ps (b, Y, grey),
+            a,
+            rgbaOut + i);
+
+        for (int k = 0; k < 8; ++k)
+            rgbaOut[i + k].a = in[k].a;
+
+        //
+        // Converting to float and back quiets signaling NaNs; the
+        // scalar code copies the luminance of grey pixels as bits.
+        //
+
+        int nanGrey = _mm256_movemask_ps (
+            _mm256_and_ps (grey, _mm256_cmp_ps (Y, Y, _CMP_UNORD_Q)));
+
+        for (int k = 0; nanGrey != 0; ++k, nanGrey >>= 1)
+        {
+            if (nanGrey & 1)
+            {
+                Rgba& out = rgbaOut[i + pixelInLane (k)];
+                out.r     = in[pixelInLane (k)].g;
+                out.g     = in[pixelInLane (k)].g;
+                out.b     = in[pixelInLane (k)].g;
+            }
+        }
+    }
+
+    return i;
+}
+
+} // namespace
+
+#endif
+
 V3f
 computeYw (const Chromaticities& cr)
 {
@@ -37,7 +531,13 @@ RGBAtoYCA (
     const Rgba rgbaIn[/*n*/],
     Rgba       ycaOut[/*n*/])
 {
-    for (int i = 0; i < n; ++i)
+    int i = 0;
+
+#ifdef IMF_RGBA_YCA_F16C
+    if (haveF16c ()) i = RGBAtoYCA_f16c (yw, n, aIsValid, rgbaIn, ycaOut);
+#endif
+
+    for (; i < n; ++i)
     {
         Rgba  in  = rgbaIn[i];
         Rgba& out = ycaOut[i];
@@ -100,10 +600,16 @@ decimateChromaHoriz (int n, const Rgba ycaIn[/*n+N-1*/], Rgba ycaOut[/*n*/])
     assert (ycaIn != ycaOut);
 #endif
 
+    int done = 0;
+
+#ifdef IMF_RGBA_YCA_F16C
+    if (haveF16c ()) done = decimateChromaHoriz_f16c (n, ycaIn, ycaOut);
+#endif
+
     int begin = N2;
     int end   = begin + n;
 
-    for (int i = begin, j = 0; i < end; ++i, ++j)
+    for (int i = begin + done, j = done; i < end; ++i, ++j)
     {
         if ((j & 1) == 0)
         {
@@ -136,7 +642,13 @@ decimateChromaHoriz (int n, const Rgba ycaIn[/*n+N-1*/], Rgba ycaOut[/*n*/])
 void
 decimateChromaVert (int n, const Rgba* const ycaIn[N], Rgba ycaOut[/*n*/])
 {
-    for (int i = 0; i < n; ++i)
+    int i = 0;
+
+#ifdef IMF_RGBA_YCA_F16C
+    if (haveF16c ()) i = decimateChromaVert_f16c (n, ycaIn, ycaOut);
+#endif
+
+    for (; i < n; ++i)
     {
         if ((i & 1) == 0)
         {
@@ -194,10 +706,16 @@ reconstructChromaHoriz (int n, const Rgba ycaIn[/*n+N-1*/], Rgba ycaOut[/*n*/])
     assert (ycaIn != ycaOut);
 #endif
 
+    int done = 0;
+
+#ifdef IMF_RGBA_YCA_F16C
+    if (haveF16c ()) done = reconstructChromaHoriz_f16c (n, ycaIn, ycaOut);
+#endif
+
     int begin = N2;
     int end   = begin + n;
 
-    for (int i = begin, j = 0; i < end; ++i, ++j)
+    for (int i = begin + done, j = done; i < end; ++i, ++j)
     {
         if (j & 1)
         {
@@ -233,7 +751,13 @@ reconstructChromaHoriz (int n, const Rgba ycaIn[/*n+N-1*/], Rgba ycaOut[/*n*/])
 void
 reconstructChromaVert (int n, const Rgba* const ycaIn[N], Rgba ycaOut[/*n*/])
 {
-    for (int i = 0; i < n; ++i)
+    int i = 0;
+
+#ifdef IMF_RGBA_YCA_F16C
+    if (haveF16c ()) i = reconstructChromaVert_f16c (n, ycaIn, ycaOut);
+#endif
+
+    for (; i < n; ++i)
     {
         ycaOut[i].r = ycaIn[0][i].r * 0.002128f + ycaIn[2][i].r * -0.007540f +
                       ycaIn[4][i].r * 0.019597f + ycaIn[6][i].r * -0.043159f +
@@ -263,7 +787,13 @@ YCAtoRGBA (
     const Rgba                  ycaIn[/*n*/],
     Rgba                        rgbaOut[/*n*/])
 {
-    for (int i = 0; i < n; ++i)
+    int i = 0;
+
+#ifdef IMF_RGBA_YCA_F16C
+    if (haveF16c ()) i = YCAtoRGBA_f16c (yw, n, ycaIn, rgbaOut);
+#endif
+
+    for (; i < n; ++i)
     {
         const Rgba& in  = ycaIn[i];
         Rgba&       out = rgbaOut[i];
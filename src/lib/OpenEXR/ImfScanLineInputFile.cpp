@@ -21,7 +21,9 @@
 
 #include "ImfFrameBuffer.h"
 #include "ImfInputPartData.h"
+#include "ImfPartChunks.h"
 
+#include <algorithm>
 #include <vector>
 
 OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
@@ -67,6 +69,9 @@ struct ScanLineProcess
     exr_chunk_info_t      cinfo;
     exr_decode_pipeline_t decoder;
 
+    // the frame buffer the unpack routines were chosen for
+    const FrameBuffer*    routinesFb = nullptr;
+
     // requirement to use process group
     ScanLineProcess* next;
 };
@@ -75,6 +80,14 @@ struct ScanLineProcess
 using ScanLineProcessGroup = ILMTHREAD_NAMESPACE::ProcessGroup<ScanLineProcess>;
 #endif
 
+// the scan lines y1 through y2 of one chunk
+struct ChunkLines
+{
+    exr_chunk_info_t cinfo;
+    int              y1;
+    int              y2;
+};
+
 } // empty namespace
 
 struct ScanLineInputFile::Data
@@ -101,6 +114,16 @@ struct ScanLineInputFile::Data
     std::vector<char> _pixel_data_scratch;
 
     void readPixels (const FrameBuffer &fb, int scanLine1, int scanLine2);
+    void readPixels (
+        const FrameBuffer &fb, const std::vector<std::pair<int, int>> &ranges);
+
+    // split ranges into the pieces of each chunk, returns the number
+    // of distinct chunks
+    size_t splitRanges (
+        const std::vector<std::pair<int, int>> &ranges,
+        std::vector<ChunkLines>                &lines);
+
+    void computeFillList (const FrameBuffer &fb, std::vector<Slice> &fill);
 
     // only keep a single stash of a scanline for things which
     // are reading one-scanline at a time. if we try to keep a
@@ -137,18 +160,19 @@ struct ScanLineInputFile::Data
             Data*                   ifd,
             ScanLineProcessGroup*   lineg,
             const FrameBuffer*      outfb,
-            const exr_chunk_info_t& cinfo,
-            int                     fby,
-            int                     endScan)
+            const ChunkLines*       lines,
+            size_t                  numLines,
+            const std::vector<Slice>* fill)
             : Task (group)
             , _outfb (outfb)
             , _ifd (ifd)
-            , _fby (fby)
-            , _last_fby (endScan)
+            , _fill (fill)
+            , _lines (lines)
+            , _num_lines (numLines)
             , _line (lineg->pop ())
             , _line_group (lineg)
         {
-            _line->cinfo = cinfo;
+            _line->cinfo = lines[0].cinfo;
         }
 
         ~LineBufferTask () override
@@ -161,10 +185,11 @@ struct ScanLineInputFile::Data
     private:
         void run_decode ();
 
-        const FrameBuffer*    _outfb;
-        Data*                 _ifd;
-        int                   _fby;
-        int                   _last_fby;
+        const FrameBuffer*        _outfb;
+        Data*                     _ifd;
+        const std::vector<Slice>* _fill;
+        const ChunkLines*         _lines;
+        size_t                _num_lines;
         ScanLineProcess*      _line;
         ScanLineProcessGroup* _line_group;
     };
@@ -243,36 +268,7 @@ ScanLineInputFile::setFrameBuffer (const FrameBuffer& frameBuffer)
 #if ILMTHREAD_THREADING_ENABLED
     std::lock_guard<std::mutex> lock (_data->_mx);
 #endif
-    _data->fill_list.clear ();
-
-    for (FrameBuffer::ConstIterator j = frameBuffer.begin ();
-         j != frameBuffer.end ();
-         ++j)
-    {
-        const exr_attr_chlist_entry_t* curc = _ctxt.findChannel (
-            _data->partNumber, j.name ());
-
-        if (!curc)
-        {
-            _data->fill_list.push_back (j.slice ());
-            continue;
-        }
-
-        if (curc->x_sampling != j.slice ().xSampling ||
-            curc->y_sampling != j.slice ().ySampling)
-            THROW (
-                IEX_NAMESPACE::ArgExc,
-                "X and/or y subsampling factors "
-                "of \""
-                    << j.name ()
-                    << "\" channel "
-                       "of input file \""
-                    << fileName ()
-                    << "\" are "
-                       "not compatible with the frame buffer's "
-                       "subsampling factors.");
-    }
-
+    _data->computeFillList (frameBuffer, _data->fill_list);
     _data->frameBuffer = frameBuffer;
 }
 
@@ -321,6 +317,19 @@ ScanLineInputFile::readPixels (int scanLine)
     readPixels (scanLine, scanLine);
 }
 
+void
+ScanLineInputFile::readPixels (const std::vector<std::pair<int, int>>& ranges)
+{
+    _data->readPixels (frameBuffer (), ranges);
+}
+
+void
+ScanLineInputFile::readPixels (
+    const FrameBuffer& frame, const std::vector<std::pair<int, int>>& ranges)
+{
+    _data->readPixels (frame, ranges);
+}
+
 ////////////////////////////////////////
 
 void
@@ -411,6 +420,49 @@ ScanLineInputFile::rawPixelDataToBuffer (
 
 void ScanLineInputFile::Data::readPixels (
     const FrameBuffer &fb, int scanLine1, int scanLine2)
+{
+    readPixels (fb, std::vector<std::pair<int, int>> (1, {scanLine1, scanLine2}));
+}
+
+////////////////////////////////////////
+
+void ScanLineInputFile::Data::computeFillList (
+    const FrameBuffer &fb, std::vector<Slice> &fill)
+{
+    fill.clear ();
+
+    for (FrameBuffer::ConstIterator j = fb.begin (); j != fb.end (); ++j)
+    {
+        const exr_attr_chlist_entry_t* curc = _ctxt->findChannel (
+            partNumber, j.name ());
+
+        if (!curc)
+        {
+            fill.push_back (j.slice ());
+            continue;
+        }
+
+        if (curc->x_sampling != j.slice ().xSampling ||
+            curc->y_sampling != j.slice ().ySampling)
+            THROW (
+                IEX_NAMESPACE::ArgExc,
+                "X and/or y subsampling factors "
+                "of \""
+                    << j.name ()
+                    << "\" channel "
+                       "of input file \""
+                    << _ctxt->fileName ()
+                    << "\" are "
+                       "not compatible with the frame buffer's "
+                       "subsampling factors.");
+    }
+}
+
+////////////////////////////////////////
+
+size_t ScanLineInputFile::Data::splitRanges (
+    const std::vector<std::pair<int, int>> &ranges,
+    std::vector<ChunkLines>                &lines)
 {
     exr_attr_box2i_t dw = _ctxt->dataWindow (partNumber);
     exr_chunk_info_t cinfo;
@@ -424,26 +476,101 @@ void ScanLineInputFile::Data::readPixels (
             "file \"" << _ctxt->fileName () << "\".");
     }
 
-    if (scanLine2 < scanLine1)
-        std::swap (scanLine1, scanLine2);
+    //
+    // sort the ranges and merge the ones that overlap or touch
+    //
+
+    std::vector<std::pair<int, int>> merged;
+    merged.reserve (ranges.size ());
 
-    if (scanLine1 < dw.min.y || scanLine2 > dw.max.y)
+    for (auto r: ranges)
     {
-        THROW (
-            IEX_NAMESPACE::ArgExc,
-            "Tried to read scan line outside "
-            "the image file's data window: "
-            << scanLine1 << " - " << scanLine2
-            << " vs datawindow "
-            << dw.min.y << " - " << dw.max.y);
+        if (r.second < r.first)
+            std::swap (r.first, r.second);
+
+        if (r.first < dw.min.y || r.second > dw.max.y)
+        {
+            THROW (
+                IEX_NAMESPACE::ArgExc,
+                "Tried to read scan line outside "
+                "the image file's data window: "
+                << r.first << " - " << r.second
+                << " vs datawindow "
+                << dw.min.y << " - " << dw.max.y);
+        }
+
+        merged.push_back (r);
     }
 
-#if ILMTHREAD_THREADING_ENABLED
-    int64_t nchunks;
-    nchunks = ((int64_t) scanLine2 - (int64_t) scanLine1);
-    nchunks /= (int64_t) scansperchunk;
-    nchunks += 1;
+    std::sort (merged.begin (), merged.end ());
+
+    size_t nmerged = 0;
+    for (size_t i = 0; i < merged.size (); ++i)
+    {
+        if (nmerged > 0 &&
+            int64_t (merged[i].first) <= int64_t (merged[nmerged - 1].second) + 1)
+        {
+            merged[nmerged - 1].second =
+                std::max (merged[nmerged - 1].second, merged[i].second);
+        }
+        else
+            merged[nmerged++] = merged[i];
+    }
+    merged.resize (nmerged);
+
+    //
+    // split the ranges at chunk boundaries; the pieces of one chunk
+    // end up next to each other, so the chunk is decoded once, and
+    // the remaining pieces are unpacked from the decoded chunk
+    //
+
+    size_t nchunks = 0;
 
+    for (auto& r: merged)
+    {
+        for (int y = r.first; y <= r.second; )
+        {
+            if (lines.empty () || y < lines.back ().cinfo.start_y ||
+                y >= lines.back ().cinfo.start_y + lines.back ().cinfo.height)
+            {
+                if (EXR_ERR_SUCCESS != exr_read_scanline_chunk_info (*_ctxt, partNumber, y, &cinfo))
+                    throw IEX_NAMESPACE::InputExc ("Unable to query scanline information");
+                ++nchunks;
+            }
+            else
+                cinfo = lines.back ().cinfo;
+
+            int last = cinfo.start_y + scansperchunk - 1;
+            lines.push_back ({cinfo, y, std::min (last, r.second)});
+            y = last + 1;
+        }
+    }
+
+    return nchunks;
+}
+
+////////////////////////////////////////
+
+void ScanLineInputFile::Data::readPixels (
+    const FrameBuffer &fb, const std::vector<std::pair<int, int>> &ranges)
+{
+    std::vector<ChunkLines> lines;
+    size_t                  nchunks = splitRanges (ranges, lines);
+
+    if (lines.empty ())
+        return;
+
+    // a frame buffer given to readPixels() directly, rather than by
+    // setFrameBuffer(), needs its own list of channels to fill
+    std::vector<Slice>        fbFill;
+    const std::vector<Slice>* fill = &fill_list;
+    if (&fb != &frameBuffer)
+    {
+        computeFillList (fb, fbFill);
+        fill = &fbFill;
+    }
+
+#if ILMTHREAD_THREADING_ENABLED
     if (nchunks > 1 && numThreads > 1)
     {
         // we need the lifetime of this to last longer than the
@@ -455,15 +582,18 @@ void ScanLineInputFile::Data::readPixels (
         {
             ILMTHREAD_NAMESPACE::TaskGroup tg;
 
-            for (int y = scanLine1; y <= scanLine2; )
+            for (size_t i = 0; i < lines.size (); )
             {
-                if (EXR_ERR_SUCCESS != exr_read_scanline_chunk_info (*_ctxt, partNumber, y, &cinfo))
-                    throw IEX_NAMESPACE::InputExc ("Unable to query scanline information");
+                size_t n = 1;
+                while (i + n < lines.size () &&
+                       lines[i + n].cinfo.idx == lines[i].cinfo.idx)
+                    ++n;
 
                 ILMTHREAD_NAMESPACE::ThreadPool::addGlobalTask (
-                    new LineBufferTask (&tg, this, &sg, &fb, cinfo, y, scanLine2) );
+                    new LineBufferTask (
+                        &tg, this, &sg, &fb, &lines[i], n, fill) );
 
-                y += scansperchunk - (y - cinfo.start_y);
+                i += n;
             }
         }
 
@@ -474,38 +604,34 @@ void ScanLineInputFile::Data::readPixels (
     {
         std::unique_ptr<ScanLineProcess> sp = checkoutScan ();
 
-        for (int y = scanLine1; y <= scanLine2; )
+        for (const ChunkLines& cl: lines)
         {
-            if (EXR_ERR_SUCCESS != exr_read_scanline_chunk_info (*_ctxt, partNumber, y, &cinfo))
-                throw IEX_NAMESPACE::InputExc ("Unable to query scanline information");
-
             // check if we have the same chunk where we can just
             // re-run the unpack (i.e. people reading 1 scan at a time
             // in a multi-scanline chunk)
-            if (!sp->first && sp->cinfo.idx == cinfo.idx &&
+            if (!sp->first && sp->cinfo.idx == cl.cinfo.idx &&
+                sp->routinesFb == &fb &&
                 sp->last_decode_err == EXR_ERR_SUCCESS)
             {
                 sp->run_unpack (
                     *_ctxt,
                     partNumber,
                     &fb,
-                    y,
-                    scanLine2,
-                    fill_list);
+                    cl.y1,
+                    cl.y2,
+                    *fill);
             }
             else
             {
-                sp->cinfo = cinfo;
+                sp->cinfo = cl.cinfo;
                 sp->run_decode (
                     *_ctxt,
                     partNumber,
                     &fb,
-                    y,
-                    scanLine2,
-                    fill_list);
+                    cl.y1,
+                    cl.y2,
+                    *fill);
             }
-
-            y += scansperchunk - (y - cinfo.start_y);
         }
 
         checkinScan (sp);
@@ -514,6 +640,140 @@ void ScanLineInputFile::Data::readPixels (
 
 ////////////////////////////////////////
 
+//
+// The chunks of several scan line parts, one job per chunk, holding
+// the pieces of the chunk to unpack
+//
+
+struct ScanLineInputFile::Chunks final : public PartChunks
+{
+    struct Job
+    {
+        Data*              data;
+        const FrameBuffer* fb;
+        const ChunkLines*  lines;
+        size_t             numLines;
+    };
+
+    Chunks (int nt) : numThreads (nt) {}
+
+    size_t numJobs () const override { return jobs.size (); }
+
+    uint64_t jobOffset (size_t i) const override
+    {
+        return jobs[i].lines[0].cinfo.data_offset;
+    }
+
+    void runJob (size_t i, ILMTHREAD_NAMESPACE::TaskGroup* group) override;
+    void finish () override;
+
+    int                                  numThreads;
+    std::vector<std::unique_ptr<Data>>   datas;
+    std::vector<std::vector<ChunkLines>> lines;
+    std::vector<Job>                     jobs;
+
+    ScanLineProcess process;
+#if ILMTHREAD_THREADING_ENABLED
+    std::unique_ptr<ScanLineProcessGroup> processGroup;
+#endif
+};
+
+std::unique_ptr<PartChunks>
+ScanLineInputFile::partChunks (
+    Context& ctxt, const std::vector<PartLines>& parts, int numThreads)
+{
+    std::unique_ptr<Chunks> chunks = std::make_unique<Chunks> (numThreads);
+
+    chunks->lines.resize (parts.size ());
+
+    for (size_t i = 0; i < parts.size (); ++i)
+    {
+        std::unique_ptr<Data> d =
+            std::make_unique<Data> (&ctxt, parts[i].partNumber, numThreads);
+
+        std::vector<ChunkLines>& lines = chunks->lines[i];
+
+        d->initialize ();
+        d->computeFillList (*parts[i].frameBuffer, d->fill_list);
+        d->splitRanges (
+            std::vector<std::pair<int, int>> (
+                1, {parts[i].scanLine1, parts[i].scanLine2}),
+            lines);
+
+        for (size_t j = 0; j < lines.size (); )
+        {
+            size_t n = 1;
+            while (j + n < lines.size () &&
+                   lines[j + n].cinfo.idx == lines[j].cinfo.idx)
+                ++n;
+
+            chunks->jobs.push_back (
+                {d.get (), parts[i].frameBuffer, &lines[j], n});
+            j += n;
+        }
+
+        chunks->datas.push_back (std::move (d));
+    }
+
+    return chunks;
+}
+
+void
+ScanLineInputFile::Chunks::runJob (
+    size_t i, ILMTHREAD_NAMESPACE::TaskGroup* group)
+{
+    const Job& job = jobs[i];
+
+#if ILMTHREAD_THREADING_ENABLED
+    if (group)
+    {
+        if (!processGroup)
+            processGroup = std::make_unique<ScanLineProcessGroup> (numThreads);
+
+        ILMTHREAD_NAMESPACE::ThreadPool::addGlobalTask (
+            new Data::LineBufferTask (
+                group,
+                job.data,
+                processGroup.get (),
+                job.fb,
+                job.lines,
+                job.numLines,
+                &job.data->fill_list));
+        return;
+    }
+#endif
+
+    process.cinfo = job.lines[0].cinfo;
+    process.run_decode (
+        *job.data->_ctxt,
+        job.data->partNumber,
+        job.fb,
+        job.lines[0].y1,
+        job.lines[0].y2,
+        job.data->fill_list);
+
+    for (size_t j = 1; j < job.numLines; ++j)
+    {
+        process.run_unpack (
+            *job.data->_ctxt,
+            job.data->partNumber,
+            job.fb,
+            job.lines[j].y1,
+            job.lines[j].y2,
+            job.data->fill_list);
+    }
+}
+
+void
+ScanLineInputFile::Chunks::finish ()
+{
+#if ILMTHREAD_THREADING_ENABLED
+    if (processGroup) processGroup->throw_on_failure ();
+#endif
+}
+
+////////////////////////////////////////
+
 #if ILMTHREAD_THREADING_ENABLED
 void ScanLineInputFile::Data::LineBufferTask::execute ()
 {
@@ -523,9 +783,20 @@ void ScanLineInputFile::Data::LineBufferTask::execute ()
             *(_ifd->_ctxt),
             _ifd->partNumber,
             _outfb,
-            _fby,
-            _last_fby,
-            _ifd->fill_list);
+            _lines[0].y1,
+            _lines[0].y2,
+            *_fill);
+
+        for (size_t i = 1; i < _num_lines; ++i)
+        {
+            _line->run_unpack (
+                *(_ifd->_ctxt),
+                _ifd->partNumber,
+                _outfb,
+                _lines[i].y1,
+                _lines[i].y2,
+                *_fill);
+        }
     }
     catch (std::exception &e)
     {
@@ -549,6 +820,15 @@ void ScanLineProcess::run_decode (
     const std::vector<Slice> &filllist)
 {
     last_decode_err = EXR_ERR_UNKNOWN;
+
+    // a process shared between the parts of a file was last used for
+    // another part, whose channels may differ, so start over
+    if (!first && (decoder.context != ctxt || decoder.part_index != pn))
+    {
+        exr_decoding_destroy (decoder.context, &decoder);
+        first = true;
+    }
+
     // stash the flag off to make sure to clean up in the event
     // of an exception by changing the flag after init...
     bool isfirst = first;
@@ -573,13 +853,18 @@ void ScanLineProcess::run_decode (
 
     update_pointers (outfb, fbY, fbLastY);
 
-    if (isfirst)
+    // the routines depend on the types and strides of the frame
+    // buffer, and a process shared by the requests of readParts may
+    // move to one with another frame buffer for the same part
+    if (isfirst || outfb != routinesFb)
     {
+        routinesFb = nullptr;
         if (EXR_ERR_SUCCESS !=
             exr_decoding_choose_default_routines (ctxt, pn, &decoder))
         {
             throw IEX_NAMESPACE::IoExc ("Unable to choose decoder routines");
         }
+        routinesFb = outfb;
     }
 
     last_decode_err = exr_decoding_run (ctxt, pn, &decoder);
@@ -18,8 +18,14 @@
 
 #include "ImfThreading.h"
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
 
+class PartChunks;
+
 class IMF_EXPORT_TYPE ScanLineInputFile
 {
 public:
@@ -152,6 +158,25 @@ public:
     void readPixels (
         const FrameBuffer& frame, int scanLine1, int scanLine2);
 
+    //----------------------------------------------
+    // Read several ranges of scan lines in one pass:
+    //
+    // readPixels(ranges) reads, for every pair (s1, s2) in ranges,
+    // the scan lines in [min (s1, s2), max (s1, s2)], as if by
+    // readPixels(s1,s2).  The ranges may be given in any order and
+    // may overlap.  Every chunk that the ranges touch is decoded
+    // only once, and, if threading is enabled, the chunks of all
+    // ranges are decoded in parallel.
+    //----------------------------------------------
+
+    IMF_EXPORT
+    void readPixels (const std::vector<std::pair<int, int>>& ranges);
+
+    IMF_EXPORT
+    void readPixels (
+        const FrameBuffer&                      frame,
+        const std::vector<std::pair<int, int>>& ranges);
+
     //----------------------------------------------
     // Read a block of raw pixel data from the file,
     // without uncompressing it (this function is
@@ -189,6 +214,24 @@ private:
 
     IMF_HIDDEN ScanLineInputFile (InputPartData* part);
 
+    //
+    // Used by MultiPartInputFile::readPixels() to decode the chunks of
+    // several parts of one file in a single pass
+    //
+
+    struct PartLines
+    {
+        int                partNumber;
+        const FrameBuffer* frameBuffer;
+        int                scanLine1;
+        int                scanLine2;
+    };
+
+    struct IMF_HIDDEN Chunks;
+
+    IMF_HIDDEN static std::unique_ptr<PartChunks> partChunks (
+        Context& ctxt, const std::vector<PartLines>& parts, int numThreads);
+
     friend class MultiPartInputFile;
     friend class InputFile;
 };
@@ -0,0 +1,809 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+//-----------------------------------------------------------------------------
+//
+//	class SequenceReader
+//
+//-----------------------------------------------------------------------------
+
+#include "ImfSequenceReader.h"
+
+#include "IlmThreadConfig.h"
+#include "IlmThreadPool.h"
+#include "ImfChannelList.h"
+#include "ImfInputPart.h"
+#include "ImfMisc.h"
+#include "ImfMultiPartInputFile.h"
+#include "ImfThreading.h"
+
+#include "Iex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#if ILMTHREAD_THREADING_ENABLED
+#    include <condition_variable>
+#    include <mutex>
+#endif
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
+
+using ILMTHREAD_NAMESPACE::Task;
+using ILMTHREAD_NAMESPACE::ThreadPool;
+
+//
+// Frame
+//
+
+SequenceReader::Frame::Frame (int index, const std::string& fileName)
+    : _index (index), _fileName (fileName), _bytes (0)
+{}
+
+SequenceReader::Frame::~Frame ()
+{}
+
+int
+SequenceReader::Frame::index () const
+{
+    return _index;
+}
+
+const std::string&
+SequenceReader::Frame::fileName () const
+{
+    return _fileName;
+}
+
+int
+SequenceReader::Frame::numParts () const
+{
+    return static_cast<int> (_partNumbers.size ());
+}
+
+size_t
+SequenceReader::Frame::partIndex (int i) const
+{
+    if (i < 0 || i >= numParts ())
+        THROW (
+            IEX_NAMESPACE::ArgExc,
+            "Frame " << _index << " has no part " << i << "; only "
+                     << numParts () << " parts were read.");
+
+    return static_cast<size_t> (i);
+}
+
+int
+SequenceReader::Frame::partNumber (int i) const
+{
+    return _partNumbers[partIndex (i)];
+}
+
+const Header&
+SequenceReader::Frame::header (int i) const
+{
+    return _headers[partIndex (i)];
+}
+
+const IMATH_NAMESPACE::Box2i&
+SequenceReader::Frame::region (int i) const
+{
+    return _regions[partIndex (i)];
+}
+
+const FrameBuffer&
+SequenceReader::Frame::frameBuffer (int i) const
+{
+    return _frameBuffers[partIndex (i)];
+}
+
+void
+SequenceReader::Frame::addPart (
+    int                             partNumber,
+    const Header&                   header,
+    const IMATH_NAMESPACE::Box2i&   region,
+    const std::vector<std::string>& channels)
+{
+    //
+    // Allocate the pixels of the channels of one part, and
+    // describe them in a frame buffer
+    //
+
+    bool        all = region == header.dataWindow ();
+    FrameBuffer fb;
+
+    std::vector<std::string> names = channels;
+    if (names.empty ())
+    {
+        const ChannelList& cl = header.channels ();
+        for (ChannelList::ConstIterator i = cl.begin (); i != cl.end (); ++i)
+            names.push_back (i.name ());
+    }
+
+    int64_t w = int64_t (region.max.x) - region.min.x + 1;
+    int64_t h = int64_t (region.max.y) - region.min.y + 1;
+
+    for (const std::string& name: names)
+    {
+        const Channel* c = header.channels ().findChannel (name);
+
+        PixelType type = c ? c->type : HALF;
+        int       xs   = c ? c->xSampling : 1;
+        int       ys   = c ? c->ySampling : 1;
+
+        if (!all && (xs != 1 || ys != 1))
+            THROW (
+                IEX_NAMESPACE::ArgExc,
+                "Cannot read a region of subsampled channel \"" << name
+                                                                << "\".");
+
+        size_t bytes   = (type == HALF) ? 2 : 4;
+        size_t xStride = bytes;
+        size_t yStride =
+            bytes * size_t (numSamples (xs, region.min.x, region.max.x));
+        size_t size =
+            yStride * size_t (numSamples (ys, region.min.y, region.max.y));
+
+        _pixels.emplace_back (new char[size]);
+        _bytes += size;
+
+        fb.insert (
+            name,
+            Slice::Make (
+                type,
+                _pixels.back ().get (),
+                region.min,
+                w,
+                h,
+                xStride,
+                yStride,
+                xs,
+                ys));
+    }
+
+    _partNumbers.push_back (partNumber);
+    _headers.push_back (header);
+    _regions.push_back (region);
+    _frameBuffers.push_back (fb);
+}
+
+size_t
+SequenceReader::Frame::bytes () const
+{
+    return _bytes;
+}
+
+//
+// SequenceReader
+//
+
+struct SequenceReader::Data
+{
+    struct Slot
+    {
+        enum State
+        {
+            QUEUED,
+            DECODING,
+            READY,
+            FAILED
+        };
+
+        State                        state     = QUEUED;
+        bool                         cancelled = false;
+        std::shared_ptr<const Frame> frame;
+        std::string                  error;
+    };
+
+    using SlotPtr = std::shared_ptr<Slot>;
+
+    class PrefetchTask : public Task
+    {
+    public:
+        PrefetchTask (Data* data, int index, const SlotPtr& slot)
+            : Task (nullptr), _data (data), _index (index), _slot (slot)
+        {}
+
+        void execute () override { _data->prefetch (_index, _slot); }
+
+    private:
+        Data*   _data;
+        int     _index;
+        SlotPtr _slot;
+    };
+
+    Data (const std::vector<std::string>& f, const ReadSpec& s, int a, size_t m)
+        : fileNames (f), spec (s), framesAhead (std::max (a, 0)), maxBytes (m)
+    {}
+
+    void prefetch (int index, const SlotPtr& slot);
+    void finish (
+        const SlotPtr&               slot,
+        std::shared_ptr<const Frame> f,
+        const std::string&           err);
+    void updateWindow (
+        int center, bool includeCenter, std::vector<PrefetchTask*>& tasks);
+    void evict (int center, const std::vector<int>& wanted);
+
+    std::vector<std::string> fileNames;
+    ReadSpec                 spec;
+    int                      framesAhead;
+    size_t                   maxBytes;
+    int                      direction = 1;
+    int                      current   = -1;
+
+    std::map<int, SlotPtr> slots;
+    size_t                 readyBytes = 0; // decoded frames in slots
+    size_t                 frameBytes = 0; // most recently decoded frame
+    int                    pending    = 0; // prefetch tasks not yet run
+
+#if ILMTHREAD_THREADING_ENABLED
+    std::mutex              mx;
+    std::condition_variable cv;
+#endif
+};
+
+#if ILMTHREAD_THREADING_ENABLED
+#    define SEQ_LOCK(d) std::unique_lock<std::mutex> lock ((d)->mx)
+#else
+#    define SEQ_LOCK(d)
+#endif
+
+void
+SequenceReader::Data::prefetch (int index, const SlotPtr& slot)
+{
+    {
+        SEQ_LOCK (this);
+
+        //
+        // Skip frames that were cancelled, or that frame() has
+        // already started decoding in the calling thread.
+        //
+
+        if (slot->cancelled || slot->state != Slot::QUEUED)
+        {
+            --pending;
+#if ILMTHREAD_THREADING_ENABLED
+            cv.notify_all ();
+#endif
+            return;
+        }
+
+        slot->state = Slot::DECODING;
+    }
+
+    std::shared_ptr<const Frame> f;
+    std::string                  err;
+
+    try
+    {
+        // parallelism comes from decoding several frames at once
+        f = readFrame (fileNames[index], index, spec, 0);
+    }
+    catch (std::exception& e)
+    {
+        err = e.what ();
+    }
+    catch (...)
+    {
+        err = "Unknown error.";
+    }
+
+    SEQ_LOCK (this);
+    --pending;
+    finish (slot, f, err);
+}
+
+void
+SequenceReader::Data::finish (
+    const SlotPtr& slot, std::shared_ptr<const Frame> f, const std::string& err)
+{
+    //
+    // Called with the lock held
+    //
+
+    if (f)
+    {
+        slot->frame = f;
+        slot->state = Slot::READY;
+        frameBytes  = f->bytes ();
+
+        if (!slot->cancelled) readyBytes += f->bytes ();
+    }
+    else
+    {
+        slot->error = err;
+        slot->state = Slot::FAILED;
+    }
+
+#if ILMTHREAD_THREADING_ENABLED
+    cv.notify_all ();
+#endif
+}
+
+void
+SequenceReader::Data::evict (int center, const std::vector<int>& wanted)
+{
+    //
+    // Drop the decoded frames outside the read-ahead window. Then, if
+    // the frames inside it are over the budget, drop those furthest
+    // from center until the budget is met, keeping the center frame.
+    //
+
+    std::vector<int> victims;
+    for (auto s = slots.begin (); s != slots.end ();)
+    {
+        if (s->second->state != Slot::READY &&
+            s->second->state != Slot::FAILED)
+        {
+            ++s;
+            continue;
+        }
+
+        if (std::find (wanted.begin (), wanted.end (), s->first) !=
+            wanted.end ())
+        {
+            if (s->first != center) victims.push_back (s->first);
+            ++s;
+            continue;
+        }
+
+        if (s->second->frame) readyBytes -= s->second->frame->bytes ();
+        s->second->cancelled = true;
+        s = slots.erase (s);
+    }
+
+    std::sort (victims.begin (), victims.end (), [center] (int a, int b) {
+        return std::abs (a - center) > std::abs (b - center);
+    });
+
+    for (int v: victims)
+    {
+        if (maxBytes == 0 || readyBytes <= maxBytes) break;
+
+        SlotPtr& s = slots[v];
+        if (s->frame) readyBytes -= s->frame->bytes ();
+        s->cancelled = true;
+        slots.erase (v);
+    }
+}
+
+void
+SequenceReader::Data::updateWindow (
+    int center, bool includeCenter, std::vector<PrefetchTask*>& tasks)
+{
+    //
+    // Called with the lock held.  Cancel queued frames outside the
+    // read-ahead window and queue the missing frames inside it.
+    //
+
+    int              numFrames = static_cast<int> (fileNames.size ());
+    std::vector<int> wanted;
+
+    for (int k = 0; k <= framesAhead; ++k)
+    {
+        int i = center + k * direction;
+        if (i < 0 || i >= numFrames) break;
+        wanted.push_back (i);
+    }
+
+    int inFlight = 0;
+    for (auto s = slots.begin (); s != slots.end ();)
+    {
+        bool isWanted = std::find (wanted.begin (), wanted.end (), s->first) !=
+                        wanted.end ();
+
+        if (!isWanted && s->second->state == Slot::QUEUED)
+        {
+            s->second->cancelled = true;
+            s = slots.erase (s);
+            continue;
+        }
+
+        if (s->second->state == Slot::QUEUED ||
+            s->second->state == Slot::DECODING)
+            ++inFlight;
+
+        ++s;
+    }
+
+    evict (center, wanted);
+
+#if ILMTHREAD_THREADING_ENABLED
+    if (globalThreadCount () < 1) return;
+
+    for (int i: wanted)
+    {
+        if (i == center && !includeCenter) continue;
+        if (slots.find (i) != slots.end ()) continue;
+
+        if (maxBytes != 0 &&
+            readyBytes + size_t (inFlight + 1) * frameBytes > maxBytes)
+            break;
+
+        SlotPtr slot = std::make_shared<Slot> ();
+        slots[i]     = slot;
+        ++pending;
+        ++inFlight;
+        tasks.push_back (new PrefetchTask (this, i, slot));
+    }
+#else
+    (void) includeCenter;
+    (void) tasks;
+#endif
+}
+
+namespace
+{
+
+template <class Tasks>
+void
+startTasks (Tasks& tasks)
+{
+    for (auto* t: tasks)
+        ThreadPool::addGlobalTask (t);
+    tasks.clear ();
+}
+
+} // namespace
+
+SequenceReader::SequenceReader (
+    const std::vector<std::string>& fileNames,
+    const ReadSpec&                 spec,
+    int                             framesAhead,
+    size_t                          maxBytes)
+    : _data (new Data (fileNames, spec, framesAhead, maxBytes))
+{}
+
+SequenceReader::~SequenceReader ()
+{
+    SEQ_LOCK (_data);
+
+    for (auto& s: _data->slots)
+        s.second->cancelled = true;
+    _data->slots.clear ();
+
+#if ILMTHREAD_THREADING_ENABLED
+    _data->cv.wait (lock, [this] { return _data->pending == 0; });
+#endif
+}
+
+std::vector<std::string>
+SequenceReader::expandPattern (const std::string& pattern, int first, int last)
+{
+    size_t prefixEnd   = std::string::npos;
+    size_t suffixBegin = std::string::npos;
+    int    width       = 0;
+
+    for (size_t i = 0; i < pattern.size (); ++i)
+    {
+        if (pattern[i] == '#')
+        {
+            size_t j = i;
+            while (j < pattern.size () && pattern[j] == '#')
+                ++j;
+
+            prefixEnd   = i;
+            suffixBegin = j;
+            width       = static_cast<int> (j - i);
+            break;
+        }
+
+        if (pattern[i] == '%')
+        {
+            size_t j = i + 1;
+            while (j < pattern.size () && isdigit (pattern[j]))
+                ++j;
+
+            if (j < pattern.size () && pattern[j] == 'd')
+            {
+                prefixEnd   = i;
+                suffixBegin = j + 1;
+                width       = atoi (pattern.substr (i + 1, j - i - 1).c_str ());
+                break;
+            }
+        }
+    }
+
+    if (prefixEnd == std::string::npos)
+    {
+        THROW (
+            IEX_NAMESPACE::ArgExc,
+            "Image sequence pattern \""
+                << pattern
+                << "\" does not contain a frame number placeholder "
+                   "(\"%d\", \"%04d\" or \"####\").");
+    }
+
+    std::vector<std::string> names;
+    int                      step = (last >= first) ? 1 : -1;
+
+    for (int f = first;; f += step)
+    {
+        char num[32];
+        snprintf (num, sizeof (num), "%0*d", width, f);
+
+        names.push_back (
+            pattern.substr (0, prefixEnd) + num + pattern.substr (suffixBegin));
+
+        if (f == last) break;
+    }
+
+    return names;
+}
+
+int
+SequenceReader::numFrames () const
+{
+    return static_cast<int> (_data->fileNames.size ());
+}
+
+const std::string&
+SequenceReader::fileName (int index) const
+{
+    if (index < 0 || index >= numFrames ())
+        THROW (
+            IEX_NAMESPACE::ArgExc,
+            "Frame index " << index << " is out of range.");
+
+    return _data->fileNames[index];
+}
+
+const SequenceReader::ReadSpec&
+SequenceReader::readSpec () const
+{
+    return _data->spec;
+}
+
+void
+SequenceReader::setFramesAhead (int framesAhead)
+{
+    SEQ_LOCK (_data);
+    _data->framesAhead = std::max (framesAhead, 0);
+}
+
+int
+SequenceReader::framesAhead () const
+{
+    SEQ_LOCK (_data);
+    return _data->framesAhead;
+}
+
+void
+SequenceReader::setMaxBytes (size_t maxBytes)
+{
+    SEQ_LOCK (_data);
+    _data->maxBytes = maxBytes;
+}
+
+size_t
+SequenceReader::maxBytes () const
+{
+    SEQ_LOCK (_data);
+    return _data->maxBytes;
+}
+
+void
+SequenceReader::setDirection (int direction)
+{
+    std::vector<Data::PrefetchTask*> tasks;
+
+    {
+        SEQ_LOCK (_data);
+
+        direction = (direction < 0) ? -1 : 1;
+        if (direction == _data->direction) return;
+
+        _data->direction = direction;
+        if (_data->current >= 0)
+            _data->updateWindow (_data->current, false, tasks);
+    }
+
+    startTasks (tasks);
+}
+
+int
+SequenceReader::direction () const
+{
+    SEQ_LOCK (_data);
+    return _data->direction;
+}
+
+void
+SequenceReader::seek (int index)
+{
+    if (index < 0 || index >= numFrames ())
+        THROW (
+            IEX_NAMESPACE::ArgExc,
+            "Frame index " << index << " is out of range.");
+
+    std::vector<Data::PrefetchTask*> tasks;
+
+    {
+        SEQ_LOCK (_data);
+        _data->current = index;
+        _data->updateWindow (index, true, tasks);
+    }
+
+    startTasks (tasks);
+}
+
+bool
+SequenceReader::isReady (int index) const
+{
+    SEQ_LOCK (_data);
+
+    auto s = _data->slots.find (index);
+    return s != _data->slots.end () && s->second->state == Data::Slot::READY;
+}
+
+std::shared_ptr<const SequenceReader::Frame>
+SequenceReader::frame (int index)
+{
+    if (index < 0 || index >= numFrames ())
+        THROW (
+            IEX_NAMESPACE::ArgExc,
+            "Frame index " << index << " is out of range.");
+
+    std::vector<Data::PrefetchTask*> tasks;
+    Data::SlotPtr                    slot;
+    bool                             decodeHere = false;
+
+    {
+        SEQ_LOCK (_data);
+
+        if (_data->current >= 0 && index != _data->current)
+            _data->direction = (index > _data->current) ? 1 : -1;
+
+        _data->current = index;
+
+        auto s = _data->slots.find (index);
+        if (s == _data->slots.end ())
+        {
+            slot                = std::make_shared<Data::Slot> ();
+            _data->slots[index] = slot;
+        }
+        else
+            slot = s->second;
+
+        //
+        // Rather than wait behind other prefetches, decode the
+        // requested frame in this thread if no task has started
+        // on it yet.
+        //
+
+        if (slot->state == Data::Slot::QUEUED)
+        {
+            slot->state = Data::Slot::DECODING;
+            decodeHere  = true;
+        }
+
+        _data->updateWindow (index, false, tasks);
+    }
+
+    startTasks (tasks);
+
+    if (decodeHere)
+    {
+        std::shared_ptr<const Frame> f;
+        std::string                  err;
+
+        try
+        {
+            f = readFrame (
+                _data->fileNames[index],
+                index,
+                _data->spec,
+                globalThreadCount ());
+        }
+        catch (std::exception& e)
+        {
+            err = e.what ();
+        }
+        catch (...)
+        {
+            err = "Unknown error.";
+        }
+
+        SEQ_LOCK (_data);
+        _data->finish (slot, f, err);
+    }
+
+    SEQ_LOCK (_data);
+
+#if ILMTHREAD_THREADING_ENABLED
+    _data->cv.wait (lock, [&slot] {
+        return slot->state == Data::Slot::READY ||
+               slot->state == Data::Slot::FAILED;
+    });
+#endif
+
+    if (slot->state != Data::Slot::READY)
+    {
+        //
+        // Forget the failure, so that the frame is read again
+        // the next time it is requested.
+        //
+
+        auto s = _data->slots.find (index);
+        if (s != _data->slots.end () && s->second == slot)
+            _data->slots.erase (s);
+
+        THROW (
+            IEX_NAMESPACE::InputExc,
+            "Cannot read frame " << index << " (\"" << _data->fileNames[index]
+                                 << "\"): " << slot->error);
+    }
+
+    return slot->frame;
+}
+
+std::shared_ptr<SequenceReader::Frame>
+SequenceReader::readFrame (
+    const std::string& fileName,
+    int                index,
+    const ReadSpec&    spec,
+    int                numThreads)
+{
+    std::shared_ptr<Frame> frame = std::make_shared<Frame> (index, fileName);
+
+    MultiPartInputFile file (fileName.c_str (), numThreads);
+
+    std::vector<int> partNumbers = spec.parts;
+    if (partNumbers.empty ()) partNumbers.push_back (spec.part);
+
+    bool all = spec.region.isEmpty ();
+
+    for (int p: partNumbers)
+    {
+        if (p < 0 || p >= file.parts ())
+            THROW (
+                IEX_NAMESPACE::ArgExc,
+                "Part " << p << " does not exist in image file \""
+                        << fileName << "\".");
+
+        const Header& hdr = file.header (p);
+
+        frame->addPart (
+            p, hdr, all ? hdr.dataWindow () : spec.region, spec.channels);
+    }
+
+    if (all)
+    {
+        //
+        // Decode the chunks of all the parts in one pass over the file
+        //
+
+        std::vector<MultiPartInputFile::PartRead> reads;
+
+        for (size_t i = 0; i < partNumbers.size (); ++i)
+        {
+            const IMATH_NAMESPACE::Box2i& dw = frame->_regions[i];
+
+            reads.push_back (MultiPartInputFile::PartRead (
+                partNumbers[i], frame->_frameBuffers[i], dw.min.y, dw.max.y));
+        }
+
+        file.readPixels (reads);
+    }
+    else
+    {
+        for (size_t i = 0; i < partNumbers.size (); ++i)
+        {
+            InputPart part (file, partNumbers[i]);
+            part.setFrameBuffer (frame->_frameBuffers[i]);
+            part.readRegion (frame->_regions[i]);
+        }
+    }
+
+    return frame;
+}
+
+#undef SEQ_LOCK
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_EXIT
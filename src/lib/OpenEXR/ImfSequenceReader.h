@@ -0,0 +1,276 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifndef INCLUDED_IMF_SEQUENCE_READER_H
+#define INCLUDED_IMF_SEQUENCE_READER_H
+
+//-----------------------------------------------------------------------------
+//
+//	class SequenceReader
+//
+//	Reads the frames of an image sequence for playback.  While the
+//	application displays one frame, the frames that follow it in the
+//	current play direction are opened and decoded ahead of time on
+//	the global thread pool (see setGlobalThreadCount()), so that
+//	file open, header parsing and decoding latencies overlap.
+//
+//	Every frame is read according to the same ReadSpec: one or more
+//	parts, a set of channels, and optionally a region of interest.
+//	Each prefetched frame is decoded by a single pool thread; several
+//	frames are decoded concurrently.
+//
+//	The number of frames read ahead and the memory used by decoded
+//	frames are both bounded.  When the play direction changes,
+//	prefetches that have not started yet are cancelled.
+//
+//-----------------------------------------------------------------------------
+
+#include "ImfForward.h"
+
+#include "ImfFrameBuffer.h"
+#include "ImfHeader.h"
+
+#include <ImathBox.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
+
+class IMF_EXPORT_TYPE SequenceReader
+{
+public:
+    //------------------------------------------------------------
+    // What to read from every frame:
+    //
+    // part       the part number
+    // parts      if not empty, the numbers of the parts to read,
+    //            instead of part.  Without a region, the chunks of
+    //            all these parts are decoded in a single pass over
+    //            the file (see MultiPartInputFile::readPixels());
+    //            with a region, the parts are read one after
+    //            another.
+    // channels   names of the channels to read; if empty, all
+    //            channels of each part are read.  Channels that are
+    //            missing from a part are filled with zeros.
+    // region     region of interest, in pixel space; if empty, the
+    //            whole data window of each part is read.  The region
+    //            must lie within the data window of every part of
+    //            every frame, and the channels must not be subsampled.
+    //------------------------------------------------------------
+
+    struct ReadSpec
+    {
+        ReadSpec () : part (0) {}
+
+        int                      part;
+        std::vector<int>         parts;
+        std::vector<std::string> channels;
+        IMATH_NAMESPACE::Box2i   region;
+    };
+
+    //------------------------------------------------------------
+    // One decoded frame.  A Frame owns its pixels, and stays valid
+    // for as long as the caller holds a reference to it.
+    //------------------------------------------------------------
+
+    class IMF_EXPORT_TYPE Frame
+    {
+    public:
+        IMF_EXPORT
+        Frame (int index, const std::string& fileName);
+
+        IMF_EXPORT
+        ~Frame ();
+
+        Frame (const Frame&)            = delete;
+        Frame& operator= (const Frame&) = delete;
+
+        IMF_EXPORT
+        int index () const;
+
+        IMF_EXPORT
+        const std::string& fileName () const;
+
+        //
+        // The parts that were read, in the order in which the
+        // ReadSpec lists them.  header(), region() and frameBuffer()
+        // return those of part i of this list, by default the first.
+        //
+
+        IMF_EXPORT
+        int numParts () const;
+
+        IMF_EXPORT
+        int partNumber (int i = 0) const;
+
+        IMF_EXPORT
+        const Header& header (int i = 0) const;
+
+        //
+        // The pixels that were read, in the coordinates of the
+        // file's pixel space
+        //
+
+        IMF_EXPORT
+        const IMATH_NAMESPACE::Box2i& region (int i = 0) const;
+
+        IMF_EXPORT
+        const FrameBuffer& frameBuffer (int i = 0) const;
+
+        IMF_EXPORT
+        size_t bytes () const;
+
+    private:
+        friend class SequenceReader;
+
+        IMF_HIDDEN size_t partIndex (int i) const;
+
+        IMF_HIDDEN void addPart (
+            int                             partNumber,
+            const Header&                   header,
+            const IMATH_NAMESPACE::Box2i&   region,
+            const std::vector<std::string>& channels);
+
+        int                                  _index;
+        std::string                          _fileName;
+        std::vector<int>                     _partNumbers;
+        std::vector<Header>                  _headers;
+        std::vector<IMATH_NAMESPACE::Box2i>  _regions;
+        std::vector<FrameBuffer>             _frameBuffers;
+        std::vector<std::unique_ptr<char[]>> _pixels;
+        size_t                               _bytes;
+    };
+
+    //------------------------------------------------------------
+    // Constructor
+    //
+    // fileNames     the frames of the sequence, in play order
+    // spec          what to read from each frame
+    // framesAhead   the number of frames to decode ahead of the
+    //               last requested frame
+    // maxBytes      memory budget for decoded frames, 0 means
+    //               unlimited.  The requested frame is always
+    //               decoded, even if it exceeds the budget.
+    //
+    // Only the last requested frame and the frames ahead of it are
+    // kept; frames which fall behind are released.
+    //
+    // The destructor cancels pending prefetches and waits for the
+    // ones in progress to finish.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    SequenceReader (
+        const std::vector<std::string>& fileNames,
+        const ReadSpec&                 spec        = ReadSpec (),
+        int                             framesAhead = 4,
+        size_t                          maxBytes    = 0);
+
+    IMF_EXPORT
+    virtual ~SequenceReader ();
+
+    SequenceReader (const SequenceReader&)            = delete;
+    SequenceReader& operator= (const SequenceReader&) = delete;
+    SequenceReader (SequenceReader&&)                 = delete;
+    SequenceReader& operator= (SequenceReader&&)      = delete;
+
+    //------------------------------------------------------------
+    // Expand a file name pattern into a frame list.  The first
+    // printf-style integer conversion ("%d", "%04d") or run of '#'
+    // characters (one digit per '#') in pattern is replaced by the
+    // frame numbers first through last, inclusive.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    static std::vector<std::string>
+    expandPattern (const std::string& pattern, int first, int last);
+
+    IMF_EXPORT
+    int numFrames () const;
+
+    IMF_EXPORT
+    const std::string& fileName (int index) const;
+
+    IMF_EXPORT
+    const ReadSpec& readSpec () const;
+
+    //------------------------------------------------------------
+    // Read-ahead settings
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    void setFramesAhead (int framesAhead);
+
+    IMF_EXPORT
+    int framesAhead () const;
+
+    IMF_EXPORT
+    void setMaxBytes (size_t maxBytes);
+
+    IMF_EXPORT
+    size_t maxBytes () const;
+
+    //------------------------------------------------------------
+    // Play direction, +1 for forward and -1 for backward playback.
+    // The direction also changes automatically when frame() is
+    // called with an index before (or after) the previous one.
+    // Changing the direction cancels pending prefetches in the
+    // old direction.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    void setDirection (int direction);
+
+    IMF_EXPORT
+    int direction () const;
+
+    //------------------------------------------------------------
+    // Frame access
+    //
+    // frame(i) returns frame i, waiting for it to be decoded if
+    // necessary, and starts prefetching the frames that follow it
+    // in the play direction.  If frame i cannot be read, an
+    // IEX_NAMESPACE::InputExc describing the error is thrown.
+    //
+    // seek(i) only starts reading frame i and the frames that
+    // follow it, and returns immediately.
+    //
+    // isReady(i) returns true if frame i has been decoded and
+    // can be returned by frame(i) without waiting.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    std::shared_ptr<const Frame> frame (int index);
+
+    IMF_EXPORT
+    void seek (int index);
+
+    IMF_EXPORT
+    bool isReady (int index) const;
+
+    //------------------------------------------------------------
+    // Read one frame synchronously, without the prefetching
+    // machinery, decoding with numThreads threads.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    static std::shared_ptr<Frame> readFrame (
+        const std::string& fileName,
+        int                index,
+        const ReadSpec&    spec,
+        int                numThreads);
+
+private:
+    struct IMF_HIDDEN Data;
+
+    std::unique_ptr<Data> _data;
+};
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_IMF_SEQUENCE_READER_H
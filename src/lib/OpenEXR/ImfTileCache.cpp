@@ -0,0 +1,250 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+//-----------------------------------------------------------------------------
+//
+//	class TileCache
+//
+//-----------------------------------------------------------------------------
+
+#include "ImfTileCache.h"
+
+#include "IlmThreadConfig.h"
+
+#if ILMTHREAD_THREADING_ENABLED
+#    include <mutex>
+#endif
+
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
+
+namespace
+{
+
+struct KeyHash
+{
+    size_t operator() (const TileCache::Key& k) const
+    {
+        size_t h = std::hash<uint64_t> () (k.reader);
+        auto   mix = [&h] (size_t v) {
+            h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        };
+        for (uint64_t v: k.fileId)
+            mix (std::hash<uint64_t> () (v));
+        mix (std::hash<std::string> () (k.channels));
+        mix (static_cast<size_t> (k.part));
+        mix (static_cast<size_t> (k.dx));
+        mix (static_cast<size_t> (k.dy));
+        mix (static_cast<size_t> (k.lx));
+        mix (static_cast<size_t> (k.ly));
+        return h;
+    }
+};
+
+} // namespace
+
+struct TileCache::Shard
+{
+    using Entry   = std::pair<Key, TileData>;
+    using LruList = std::list<Entry>;
+
+    // evicts the least recently used tile, returns its size
+    size_t evictOne ()
+    {
+        Entry& victim = lru.back ();
+        size_t size   = victim.second->size ();
+        bytesUsed -= size;
+        index.erase (victim.first);
+        lru.pop_back ();
+        ++evictions;
+        return size;
+    }
+
+#if ILMTHREAD_THREADING_ENABLED
+    std::mutex mx;
+#endif
+    LruList                                             lru;
+    std::unordered_map<Key, LruList::iterator, KeyHash> index;
+    size_t                                              bytesUsed = 0;
+    uint64_t                                            hits      = 0;
+    uint64_t                                            misses    = 0;
+    uint64_t                                            inserts   = 0;
+    uint64_t                                            evictions = 0;
+};
+
+#if ILMTHREAD_THREADING_ENABLED
+#    define SHARD_LOCK(s) std::lock_guard<std::mutex> lock ((s).mx)
+#else
+#    define SHARD_LOCK(s)
+#endif
+
+TileCache::TileCache (size_t maxBytes, int numShards)
+    : _maxBytes (maxBytes), _bytesUsed (0)
+{
+    if (numShards < 1) numShards = 1;
+
+    _shards.reserve (numShards);
+    for (int i = 0; i < numShards; ++i)
+        _shards.emplace_back (new Shard);
+}
+
+TileCache::~TileCache ()
+{
+}
+
+size_t
+TileCache::maxBytes () const
+{
+    return _maxBytes;
+}
+
+void
+TileCache::setMaxBytes (size_t maxBytes)
+{
+    _maxBytes = maxBytes;
+    trim (0, false);
+}
+
+void
+TileCache::clear ()
+{
+    for (auto& s: _shards)
+    {
+        SHARD_LOCK (*s);
+        _bytesUsed -= s->bytesUsed;
+        s->index.clear ();
+        s->lru.clear ();
+        s->bytesUsed = 0;
+    }
+}
+
+void
+TileCache::clear (const std::string& fileName)
+{
+    for (auto& s: _shards)
+    {
+        SHARD_LOCK (*s);
+        for (auto i = s->lru.begin (); i != s->lru.end ();)
+        {
+            if (i->first.file == fileName)
+            {
+                s->bytesUsed -= i->second->size ();
+                _bytesUsed -= i->second->size ();
+                s->index.erase (i->first);
+                i = s->lru.erase (i);
+            }
+            else
+                ++i;
+        }
+    }
+}
+
+TileCache::Statistics
+TileCache::statistics () const
+{
+    Statistics st;
+
+    st.maxBytes = _maxBytes;
+    for (auto& s: _shards)
+    {
+        SHARD_LOCK (*s);
+        st.hits += s->hits;
+        st.misses += s->misses;
+        st.insertions += s->inserts;
+        st.evictions += s->evictions;
+        st.bytesUsed += s->bytesUsed;
+        st.numTiles += s->lru.size ();
+    }
+    return st;
+}
+
+void
+TileCache::resetStatistics ()
+{
+    for (auto& s: _shards)
+    {
+        SHARD_LOCK (*s);
+        s->hits      = 0;
+        s->misses    = 0;
+        s->inserts   = 0;
+        s->evictions = 0;
+    }
+}
+
+TileCache::Shard&
+TileCache::shardFor (const Key& key) const
+{
+    return *(_shards[KeyHash () (key) % _shards.size ()]);
+}
+
+void
+TileCache::trim (size_t first, bool keepNewest)
+{
+    // one shard is locked at a time, so concurrent inserts and
+    // lookups never wait on each other in a cycle; the shard that
+    // was just added to keeps its most recent tile
+    for (size_t i = 0; i < _shards.size () && _bytesUsed > _maxBytes; ++i)
+    {
+        Shard& s    = *(_shards[(first + i) % _shards.size ()]);
+        size_t keep = (i == 0 && keepNewest) ? 1 : 0;
+        SHARD_LOCK (s);
+        while (_bytesUsed > _maxBytes && s.lru.size () > keep)
+            _bytesUsed -= s.evictOne ();
+    }
+}
+
+TileCache::TileData
+TileCache::find (const Key& key)
+{
+    Shard& s = shardFor (key);
+    SHARD_LOCK (s);
+
+    auto i = s.index.find (key);
+    if (i == s.index.end ())
+    {
+        ++s.misses;
+        return TileData ();
+    }
+
+    ++s.hits;
+    s.lru.splice (s.lru.begin (), s.lru, i->second);
+    return i->second->second;
+}
+
+void
+TileCache::insert (const Key& key, const TileData& data)
+{
+    if (!data || data->size () > _maxBytes) return;
+
+    size_t shard = KeyHash () (key) % _shards.size ();
+    Shard& s     = *(_shards[shard]);
+    {
+        SHARD_LOCK (s);
+
+        auto i = s.index.find (key);
+        if (i != s.index.end ())
+        {
+            // another thread decoded the same tile concurrently,
+            // keep the existing copy
+            s.lru.splice (s.lru.begin (), s.lru, i->second);
+            return;
+        }
+
+        s.lru.emplace_front (key, data);
+        s.index[key] = s.lru.begin ();
+        s.bytesUsed += data->size ();
+        _bytesUsed += data->size ();
+        ++s.inserts;
+    }
+
+    trim (shard, true);
+}
+
+#undef SHARD_LOCK
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_EXIT
@@ -0,0 +1,189 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifndef INCLUDED_IMF_TILE_CACHE_H
+#define INCLUDED_IMF_TILE_CACHE_H
+
+//-----------------------------------------------------------------------------
+//
+//	class TileCache
+//
+//	A memory-budgeted, least-recently-used cache of decoded tiles.
+//	A single cache may be shared by any number of TiledInputFile and
+//	TiledInputPart objects (see TiledInputFile::setTileCache()).
+//
+//	Tiles are keyed by the identity of the file they were read from
+//	(device, file number, modification time and size), part number,
+//	tile and level coordinates, and the set of channels (names and
+//	pixel types) that were requested by the frame buffer at the
+//	time the tile was decoded.  Separately opened readers of the
+//	same file therefore share their tiles, while a file that is
+//	rewritten in place gets a new identity.  Streams that have no
+//	identity (custom IStream objects) are keyed per reader instead,
+//	and only share the cache's memory budget.
+//
+//	The cache is split into a number of independently locked
+//	shards, so that concurrent lookups from many threads rarely
+//	contend with each other.  The memory budget applies to the
+//	cache as a whole; when it is exceeded, tiles are evicted least
+//	recently used first within each shard.
+//
+//-----------------------------------------------------------------------------
+
+#include "ImfForward.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
+
+class IMF_EXPORT_TYPE TileCache
+{
+public:
+    //------------------------------------------------------------
+    // Statistics, as returned by statistics ().  The counters
+    // accumulate until resetStatistics () is called.
+    //------------------------------------------------------------
+
+    struct Statistics
+    {
+        uint64_t hits       = 0;
+        uint64_t misses     = 0;
+        uint64_t insertions = 0;
+        uint64_t evictions  = 0;
+        size_t   bytesUsed  = 0;
+        size_t   maxBytes   = 0;
+        size_t   numTiles   = 0;
+    };
+
+    //------------------------------------------------------------
+    // Key identifying one decoded tile.  fileId is the identity
+    // of the file (see exr_get_file_identity()); for streams that
+    // have none it is zero, and reader is a process unique id of
+    // the reader that decoded the tile.  The file name is only
+    // kept for clear (fileName), and is not compared.  The
+    // channels member is an opaque description of the channel
+    // names and pixel types the tile was decoded into.
+    //------------------------------------------------------------
+
+    struct Key
+    {
+        uint64_t    fileId[4] = {0, 0, 0, 0};
+        uint64_t    reader    = 0;
+        std::string file;
+        std::string channels;
+        int         part = 0;
+        int         dx   = 0;
+        int         dy   = 0;
+        int         lx   = 0;
+        int         ly   = 0;
+
+        bool operator== (const Key& other) const
+        {
+            return fileId[0] == other.fileId[0] &&
+                   fileId[1] == other.fileId[1] &&
+                   fileId[2] == other.fileId[2] &&
+                   fileId[3] == other.fileId[3] && reader == other.reader &&
+                   part == other.part && dx == other.dx && dy == other.dy &&
+                   lx == other.lx && ly == other.ly &&
+                   channels == other.channels;
+        }
+    };
+
+    //------------------------------------------------------------
+    // The decoded pixels of one tile.  Tile data is immutable once
+    // it has been inserted, and stays valid for as long as a caller
+    // holds a reference, even if it is evicted in the meantime.
+    //------------------------------------------------------------
+
+    using TileData = std::shared_ptr<const std::vector<char>>;
+
+    //------------------------------------------------------------
+    // Constructor: maxBytes is the memory budget for the decoded
+    // pixel data.  numShards is the number of independently locked
+    // partitions; it is clamped to at least 1.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    explicit TileCache (size_t maxBytes, int numShards = 16);
+
+    IMF_EXPORT
+    ~TileCache ();
+
+    TileCache (const TileCache&)            = delete;
+    TileCache& operator= (const TileCache&) = delete;
+    TileCache (TileCache&&)                 = delete;
+    TileCache& operator= (TileCache&&)      = delete;
+
+    //------------------------------------------------------------
+    // Memory budget.  Lowering the budget evicts tiles immediately.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    size_t maxBytes () const;
+
+    IMF_EXPORT
+    void setMaxBytes (size_t maxBytes);
+
+    //------------------------------------------------------------
+    // Remove all tiles from the cache, or only those that belong
+    // to the file with the given name.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    void clear ();
+
+    IMF_EXPORT
+    void clear (const std::string& fileName);
+
+    //------------------------------------------------------------
+    // Hit / miss statistics
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    Statistics statistics () const;
+
+    IMF_EXPORT
+    void resetStatistics ();
+
+    //------------------------------------------------------------
+    // Low level access, used by TiledInputFile.
+    //
+    // find() returns a null pointer (and counts a miss) if the
+    // tile is not in the cache, otherwise it marks the tile as
+    // most recently used and returns its data.
+    //
+    // insert() adds a tile, evicting least recently used tiles
+    // as needed, starting with the shard the tile is added to.
+    // Tiles larger than the whole budget are not cached.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    TileData find (const Key& key);
+
+    IMF_EXPORT
+    void insert (const Key& key, const TileData& data);
+
+private:
+    struct IMF_HIDDEN Shard;
+
+    IMF_HIDDEN
+    Shard& shardFor (const Key& key) const;
+
+    IMF_HIDDEN
+    void trim (size_t first, bool keepNewest);
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::atomic<size_t>                 _maxBytes;
+    std::atomic<size_t>                 _bytesUsed;
+};
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_IMF_TILE_CACHE_H
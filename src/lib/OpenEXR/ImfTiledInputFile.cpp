@@ -21,12 +21,16 @@
 
 #include "ImfFrameBuffer.h"
 #include "ImfInputPartData.h"
+#include "ImfPartChunks.h"
+#include "ImfTileCache.h"
 
 // TODO: remove once TiledOutput is converted
 #include "ImfTileOffsets.h"
 #include "ImfTiledMisc.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <vector>
 
 OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
@@ -47,6 +51,31 @@ struct TileProcess
         const FrameBuffer *outfb,
         const std::vector<Slice> &filllist);
 
+    void run_buffered (
+        exr_const_context_t ctxt,
+        int pn,
+        const FrameBuffer *outfb,
+        const std::vector<Slice> &filllist,
+        TileCache *cache,
+        const TileCache::Key *cacheKey,
+        const std::vector<IMATH_NAMESPACE::Box2i> *clips);
+
+    bool init_decoder (exr_const_context_t ctxt, int pn);
+
+    void decode_to_buffer (
+        exr_const_context_t ctxt,
+        int pn,
+        const FrameBuffer *outfb,
+        std::vector<char> &buf);
+
+    void copy_from_buffer (
+        exr_const_context_t ctxt,
+        int pn,
+        const FrameBuffer *outfb,
+        const std::vector<char> &data,
+        int t_absX, int t_absY,
+        const IMATH_NAMESPACE::Box2i *clip);
+
     void update_pointers (
         const FrameBuffer *outfb,
         int fb_absX, int fb_absY,
@@ -56,12 +85,21 @@ struct TileProcess
         const FrameBuffer *outfb,
         int fb_absX, int fb_absY,
         int t_absX, int t_absY,
-        const std::vector<Slice> &filllist);
+        const std::vector<Slice> &filllist,
+        const IMATH_NAMESPACE::Box2i *clip = nullptr);
 
     bool                  first = true;
     exr_chunk_info_t      cinfo;
     exr_decode_pipeline_t decoder;
 
+    // the decoder's unpack routines were chosen for the layout of
+    // decode_to_buffer() rather than for the frame buffer
+    bool                  routinesBuffered = false;
+
+    // decoded tile storage when tiles can not be decoded directly
+    // into the frame buffer
+    std::vector<char>     scratch;
+
     TileProcess*          next;
 };
 
@@ -82,7 +120,20 @@ struct TiledInputFile::Data
     : _ctxt (ctxt)
     , partNumber (pN)
     , numThreads (nT)
-    {}
+    {
+        // cached tiles are shared by all readers of the same file;
+        // streams without a file identity can not be told apart
+        // reliably (by name, say), so their tiles are cached per
+        // reader, with a process unique id
+        int hasIdentity = 0;
+        if (EXR_ERR_SUCCESS !=
+                exr_get_file_identity (*ctxt, &hasIdentity, cacheFileId) ||
+            !hasIdentity)
+        {
+            static std::atomic<uint64_t> reader (0);
+            cacheReader = ++reader;
+        }
+    }
 
     void initialize ()
     {
@@ -106,7 +157,26 @@ struct TiledInputFile::Data
             throw IEX_NAMESPACE::ArgExc ("Unable to query number of tile levels");
     }
 
-    void readTiles (int dx1, int dx2, int dy1, int dy2, int lx, int ly);
+    void setFrameBuffer (const FrameBuffer& fb);
+
+    void readChunkInfo (
+        int tx, int ty, int lx, int ly, exr_chunk_info_t& cinfo) const;
+
+    void readTiles (
+        int dx1, int dx2, int dy1, int dy2, int lx, int ly,
+        const std::vector<IMATH_NAMESPACE::Box2i>* clips = nullptr);
+
+    void readTiles (
+        const std::vector<std::pair<int, int>>&     tiles,
+        int                                         lx,
+        int                                         ly,
+        const std::vector<IMATH_NAMESPACE::Box2i>* clips);
+
+    void decodeTile (
+        TileProcess&                               tp,
+        TileCache*                                 cache,
+        const TileCache::Key*                      cacheKey,
+        const std::vector<IMATH_NAMESPACE::Box2i>* clips);
 
     Context* _ctxt;
     int partNumber;
@@ -128,6 +198,11 @@ struct TiledInputFile::Data
     FrameBuffer frameBuffer;
     std::vector<Slice> fill_list;
 
+    std::shared_ptr<TileCache> tileCache;
+    std::string cacheChannels;
+    uint64_t cacheFileId[4] = {0, 0, 0, 0};
+    uint64_t cacheReader    = 0;
+
     std::vector<std::string> _failures;
 
 #if ILMTHREAD_THREADING_ENABLED
@@ -141,12 +216,18 @@ struct TiledInputFile::Data
             Data*                   ifd,
             TileProcessGroup*       tileg,
             const FrameBuffer*      outfb,
-            const exr_chunk_info_t& cinfo)
+            const exr_chunk_info_t& cinfo,
+            TileCache*              cache,
+            const TileCache::Key*   cacheKey,
+            const std::vector<IMATH_NAMESPACE::Box2i>* clips)
             : Task (group)
             , _outfb (outfb)
             , _ifd (ifd)
             , _tile (tileg->pop ())
             , _tile_group (tileg)
+            , _cache (cache)
+            , _cache_key (cacheKey)
+            , _clips (clips)
         {
             _tile->cinfo = cinfo;
         }
@@ -166,6 +247,10 @@ struct TiledInputFile::Data
 
         TileProcess*       _tile;
         TileProcessGroup*  _tile_group;
+
+        TileCache*                                 _cache;
+        const TileCache::Key*                      _cache_key;
+        const std::vector<IMATH_NAMESPACE::Box2i>* _clips;
     };
 #endif
 };
@@ -241,21 +326,31 @@ TiledInputFile::setFrameBuffer (const FrameBuffer& frameBuffer)
 #if ILMTHREAD_THREADING_ENABLED
     std::lock_guard<std::mutex> lock (_data->_mx);
 #endif
-    _data->fill_list.clear ();
+    _data->setFrameBuffer (frameBuffer);
+}
 
-    for (FrameBuffer::ConstIterator j = frameBuffer.begin ();
-         j != frameBuffer.end ();
-         ++j)
+void
+TiledInputFile::Data::setFrameBuffer (const FrameBuffer& fb)
+{
+    fill_list.clear ();
+    cacheChannels.clear ();
+
+    for (FrameBuffer::ConstIterator j = fb.begin (); j != fb.end (); ++j)
     {
-        const exr_attr_chlist_entry_t* curc = _ctxt.findChannel (
-            _data->partNumber, j.name ());
+        const exr_attr_chlist_entry_t* curc =
+            _ctxt->findChannel (partNumber, j.name ());
 
         if (!curc)
         {
-            _data->fill_list.push_back (j.slice ());
+            fill_list.push_back (j.slice ());
             continue;
         }
 
+        cacheChannels += j.name ();
+        cacheChannels += ':';
+        cacheChannels += char ('0' + int (j.slice ().type));
+        cacheChannels += ';';
+
         if (curc->x_sampling != j.slice ().xSampling ||
             curc->y_sampling != j.slice ().ySampling)
             THROW (
@@ -265,13 +360,13 @@ TiledInputFile::setFrameBuffer (const FrameBuffer& frameBuffer)
                     << j.name ()
                     << "\" channel "
                        "of input file \""
-                    << fileName ()
+                    << _ctxt->fileName ()
                     << "\" are "
                        "not compatible with the frame buffer's "
                        "subsampling factors.");
     }
 
-    _data->frameBuffer = frameBuffer;
+    frameBuffer = fb;
 }
 
 const FrameBuffer&
@@ -283,6 +378,24 @@ TiledInputFile::frameBuffer () const
     return _data->frameBuffer;
 }
 
+void
+TiledInputFile::setTileCache (const std::shared_ptr<TileCache>& cache)
+{
+#if ILMTHREAD_THREADING_ENABLED
+    std::lock_guard<std::mutex> lock (_data->_mx);
+#endif
+    _data->tileCache = cache;
+}
+
+std::shared_ptr<TileCache>
+TiledInputFile::tileCache () const
+{
+#if ILMTHREAD_THREADING_ENABLED
+    std::lock_guard<std::mutex> lock (_data->_mx);
+#endif
+    return _data->tileCache;
+}
+
 bool
 TiledInputFile::isComplete () const
 {
@@ -341,6 +454,103 @@ TiledInputFile::readTile (int dx, int dy, int l)
     readTile (dx, dy, l, l);
 }
 
+void
+TiledInputFile::readRegion (const IMATH_NAMESPACE::Box2i& box, int lx, int ly)
+{
+    readRegion (std::vector<IMATH_NAMESPACE::Box2i> (1, box), lx, ly);
+}
+
+void
+TiledInputFile::readRegion (
+    const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int lx, int ly)
+{
+    //
+    // Read the pixels inside the boxes from the tiles that cover them
+    //
+
+    try
+    {
+        if (!isValidLevel (lx, ly))
+            THROW (
+                IEX_NAMESPACE::ArgExc,
+                "Level coordinate "
+                "(" << lx
+                    << ", " << ly
+                    << ") "
+                       "is invalid.");
+
+        IMATH_NAMESPACE::Box2i dw = dataWindowForLevel (lx, ly);
+
+        int tx = static_cast<int> (tileXSize ());
+        int ty = static_cast<int> (tileYSize ());
+
+        std::vector<std::pair<int, int>> tiles;
+
+        for (const IMATH_NAMESPACE::Box2i& box: boxes)
+        {
+            if (box.isEmpty () || box.min.x < dw.min.x ||
+                box.min.y < dw.min.y || box.max.x > dw.max.x ||
+                box.max.y > dw.max.y)
+            {
+                THROW (
+                    IEX_NAMESPACE::ArgExc,
+                    "Region (" << box.min.x << ", " << box.min.y << ") - ("
+                               << box.max.x << ", " << box.max.y
+                               << ") is not inside the data window of level ("
+                               << lx << ", " << ly << ").");
+            }
+
+            int dx1 = (box.min.x - dw.min.x) / tx;
+            int dx2 = (box.max.x - dw.min.x) / tx;
+            int dy1 = (box.min.y - dw.min.y) / ty;
+            int dy2 = (box.max.y - dw.min.y) / ty;
+
+            for (int dy = dy1; dy <= dy2; ++dy)
+                for (int dx = dx1; dx <= dx2; ++dx)
+                    tiles.emplace_back (dx, dy);
+        }
+
+        //
+        // Tiles shared by several boxes are decoded only once, and
+        // the tiles are read in file order (row by row).
+        //
+
+        std::sort (
+            tiles.begin (),
+            tiles.end (),
+            [] (const std::pair<int, int>& a, const std::pair<int, int>& b) {
+                return a.second < b.second ||
+                       (a.second == b.second && a.first < b.first);
+            });
+
+        tiles.erase (std::unique (tiles.begin (), tiles.end ()), tiles.end ());
+
+        if (!tiles.empty ()) _data->readTiles (tiles, lx, ly, &boxes);
+    }
+    catch (IEX_NAMESPACE::BaseExc& e)
+    {
+        REPLACE_EXC (
+            e,
+            "Error reading pixel data from image "
+            "file \""
+                << fileName () << "\". " << e.what ());
+        throw;
+    }
+}
+
+void
+TiledInputFile::readRegion (const IMATH_NAMESPACE::Box2i& box, int l)
+{
+    readRegion (box, l, l);
+}
+
+void
+TiledInputFile::readRegion (
+    const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int l)
+{
+    readRegion (boxes, l, l);
+}
+
 void
 TiledInputFile::rawTileData (
     int&         dx,
@@ -758,12 +968,68 @@ TiledInputFile::tileOrder (int dx[], int dy[], int lx[], int ly[]) const
     }
 }
 
-void TiledInputFile::Data::readTiles (int dx1, int dx2, int dy1, int dy2, int lx, int ly)
+void TiledInputFile::Data::readChunkInfo (
+    int tx, int ty, int lx, int ly, exr_chunk_info_t& cinfo) const
+{
+    exr_result_t rv =
+        exr_read_tile_chunk_info (*_ctxt, partNumber, tx, ty, lx, ly, &cinfo);
+    if (EXR_ERR_INCOMPLETE_CHUNK_TABLE == rv)
+    {
+        THROW (
+            IEX_NAMESPACE::InputExc,
+            "Tile (" << tx << ", " << ty << ", " << lx << ", " << ly
+            << ") is missing.");
+    }
+    else if (EXR_ERR_SUCCESS != rv)
+        throw IEX_NAMESPACE::InputExc ("Unable to query tile information");
+}
+
+void TiledInputFile::Data::readTiles (
+    int dx1, int dx2, int dy1, int dy2, int lx, int ly,
+    const std::vector<IMATH_NAMESPACE::Box2i>* clips)
 {
-    int nTiles = dx2 - dx1 + 1;
-    nTiles *= dy2 - dy1 + 1;
+    std::vector<std::pair<int, int>> tiles;
+    tiles.reserve (size_t (dx2 - dx1 + 1) * size_t (dy2 - dy1 + 1));
+
+    for (int ty = dy1; ty <= dy2; ++ty)
+        for (int tx = dx1; tx <= dx2; ++tx)
+            tiles.emplace_back (tx, ty);
+
+    readTiles (tiles, lx, ly, clips);
+}
+
+void TiledInputFile::Data::readTiles (
+    const std::vector<std::pair<int, int>>&     tiles,
+    int                                         lx,
+    int                                         ly,
+    const std::vector<IMATH_NAMESPACE::Box2i>* clips)
+{
+    size_t nTiles = tiles.size ();
 
     exr_chunk_info_t      cinfo;
+
+    // hold on to the cache for the duration of the read, in case
+    // setTileCache() replaces it concurrently; the copy is taken
+    // under the same lock as the assignment
+    std::shared_ptr<TileCache> cache;
+    {
+#if ILMTHREAD_THREADING_ENABLED
+        std::lock_guard<std::mutex> lock (_mx);
+#endif
+        cache = tileCache;
+    }
+
+    TileCache::Key cacheKey;
+    if (cache)
+    {
+        std::copy (cacheFileId, cacheFileId + 4, cacheKey.fileId);
+        cacheKey.reader   = cacheReader;
+        cacheKey.file     = _ctxt->fileName ();
+        cacheKey.channels = cacheChannels;
+        cacheKey.part     = partNumber;
+    }
+    const TileCache::Key* keyp = cache ? &cacheKey : nullptr;
+
 #if ILMTHREAD_THREADING_ENABLED
     if (nTiles > 1 && numThreads > 1)
     {
@@ -776,25 +1042,14 @@ void TiledInputFile::Data::readTiles (int dx1, int dx2, int dy1, int dy2, int lx
         {
             ILMTHREAD_NAMESPACE::TaskGroup tg;
 
-            for (int ty = dy1; ty <= dy2; ++ty)
+            for (const auto& t: tiles)
             {
-                for (int tx = dx1; tx <= dx2; ++tx)
-                {
-                    exr_result_t rv = exr_read_tile_chunk_info (
-                        *_ctxt, partNumber, tx, ty, lx, ly, &cinfo);
-                    if (EXR_ERR_INCOMPLETE_CHUNK_TABLE == rv)
-                    {
-                        THROW (
-                            IEX_NAMESPACE::InputExc,
-                            "Tile (" << tx << ", " << ty << ", " << lx << ", " << ly
-                            << ") is missing.");
-                    }
-                    else if (EXR_ERR_SUCCESS != rv)
-                        throw IEX_NAMESPACE::InputExc ("Unable to query tile information");
+                readChunkInfo (t.first, t.second, lx, ly, cinfo);
 
-                    ILMTHREAD_NAMESPACE::ThreadPool::addGlobalTask (
-                        new TileBufferTask (&tg, this, &tpg, &frameBuffer, cinfo) );
-                }
+                ILMTHREAD_NAMESPACE::ThreadPool::addGlobalTask (
+                    new TileBufferTask (
+                        &tg, this, &tpg, &frameBuffer, cinfo,
+                        cache.get (), keyp, clips) );
             }
         }
 
@@ -805,33 +1060,43 @@ void TiledInputFile::Data::readTiles (int dx1, int dx2, int dy1, int dy2, int lx
     {
         TileProcess tp;
 
-        for (int ty = dy1; ty <= dy2; ++ty)
+        for (const auto& t: tiles)
         {
-            for (int tx = dx1; tx <= dx2; ++tx)
-            {
-                exr_result_t rv = exr_read_tile_chunk_info (
-                    *_ctxt, partNumber, tx, ty, lx, ly, &cinfo);
-                if (EXR_ERR_INCOMPLETE_CHUNK_TABLE == rv)
-                {
-                    THROW (
-                        IEX_NAMESPACE::InputExc,
-                        "Tile (" << tx << ", " << ty << ", " << lx << ", " << ly
-                        << ") is missing.");
-                }
-                else if (EXR_ERR_SUCCESS != rv)
-                    throw IEX_NAMESPACE::InputExc ("Unable to query tile information");
-
-                tp.cinfo = cinfo;
-                tp.run_decode (
-                    *_ctxt,
-                    partNumber,
-                    &frameBuffer,
-                    fill_list);
-            }
+            readChunkInfo (t.first, t.second, lx, ly, cinfo);
+
+            tp.cinfo = cinfo;
+            decodeTile (tp, cache.get (), keyp, clips);
         }
     }
 }
 
+void TiledInputFile::Data::decodeTile (
+    TileProcess&                               tp,
+    TileCache*                                 cache,
+    const TileCache::Key*                      cacheKey,
+    const std::vector<IMATH_NAMESPACE::Box2i>* clips)
+{
+    if (cacheKey || clips)
+    {
+        tp.run_buffered (
+            *_ctxt,
+            partNumber,
+            &frameBuffer,
+            fill_list,
+            cache,
+            cacheKey,
+            clips);
+    }
+    else
+    {
+        tp.run_decode (
+            *_ctxt,
+            partNumber,
+            &frameBuffer,
+            fill_list);
+    }
+}
+
 ////////////////////////////////////////
 
 #if ILMTHREAD_THREADING_ENABLED
@@ -839,11 +1104,7 @@ void TiledInputFile::Data::TileBufferTask::execute ()
 {
     try
     {
-        _tile->run_decode (
-            *(_ifd->_ctxt),
-            _ifd->partNumber,
-            _outfb,
-            _ifd->fill_list);
+        _ifd->decodeTile (*_tile, _cache, _cache_key, _clips);
     }
     catch (std::exception &e)
     {
@@ -858,6 +1119,130 @@ void TiledInputFile::Data::TileBufferTask::execute ()
 
 ////////////////////////////////////////
 
+//
+// The tiles of several tiled parts, one job per tile
+//
+
+struct TiledInputFile::Chunks final : public PartChunks
+{
+    struct Job
+    {
+        Data*                                      data;
+        exr_chunk_info_t                           cinfo;
+        const std::vector<IMATH_NAMESPACE::Box2i>* clips;
+    };
+
+    Chunks (int nt) : numThreads (nt) {}
+
+    size_t numJobs () const override { return jobs.size (); }
+
+    uint64_t jobOffset (size_t i) const override
+    {
+        return jobs[i].cinfo.data_offset;
+    }
+
+    void runJob (size_t i, ILMTHREAD_NAMESPACE::TaskGroup* group) override;
+    void finish () override;
+
+    int                                              numThreads;
+    std::vector<std::unique_ptr<Data>>               datas;
+    std::vector<std::vector<IMATH_NAMESPACE::Box2i>> clips;
+    std::vector<Job>                                 jobs;
+
+    TileProcess process;
+#if ILMTHREAD_THREADING_ENABLED
+    std::unique_ptr<TileProcessGroup> processGroup;
+#endif
+};
+
+std::unique_ptr<PartChunks>
+TiledInputFile::partChunks (
+    Context& ctxt, const std::vector<PartRegion>& parts, int numThreads)
+{
+    std::unique_ptr<Chunks> chunks = std::make_unique<Chunks> (numThreads);
+
+    chunks->clips.resize (parts.size ());
+
+    for (size_t i = 0; i < parts.size (); ++i)
+    {
+        std::unique_ptr<Data> d =
+            std::make_unique<Data> (&ctxt, parts[i].partNumber, numThreads);
+
+        d->initialize ();
+        d->setFrameBuffer (*parts[i].frameBuffer);
+
+        const IMATH_NAMESPACE::Box2i& box = parts[i].box;
+        exr_attr_box2i_t dw = ctxt.dataWindow (parts[i].partNumber);
+
+        int tx = static_cast<int> (d->tile_x_size);
+        int ty = static_cast<int> (d->tile_y_size);
+
+        int dx1 = (box.min.x - dw.min.x) / tx;
+        int dx2 = (box.max.x - dw.min.x) / tx;
+        int dy1 = (box.min.y - dw.min.y) / ty;
+        int dy2 = (box.max.y - dw.min.y) / ty;
+
+        chunks->clips[i].push_back (box);
+
+        for (int dy = dy1; dy <= dy2; ++dy)
+        {
+            for (int dx = dx1; dx <= dx2; ++dx)
+            {
+                Chunks::Job job;
+                job.data  = d.get ();
+                job.clips = &chunks->clips[i];
+                d->readChunkInfo (dx, dy, 0, 0, job.cinfo);
+
+                chunks->jobs.push_back (job);
+            }
+        }
+
+        chunks->datas.push_back (std::move (d));
+    }
+
+    return chunks;
+}
+
+void
+TiledInputFile::Chunks::runJob (
+    size_t i, ILMTHREAD_NAMESPACE::TaskGroup* group)
+{
+    const Job& job = jobs[i];
+
+#if ILMTHREAD_THREADING_ENABLED
+    if (group)
+    {
+        if (!processGroup)
+            processGroup = std::make_unique<TileProcessGroup> (numThreads);
+
+        ILMTHREAD_NAMESPACE::ThreadPool::addGlobalTask (
+            new Data::TileBufferTask (
+                group,
+                job.data,
+                processGroup.get (),
+                &job.data->frameBuffer,
+                job.cinfo,
+                nullptr,
+                nullptr,
+                job.clips));
+        return;
+    }
+#endif
+
+    process.cinfo = job.cinfo;
+    job.data->decodeTile (process, nullptr, nullptr, job.clips);
+}
+
+void
+TiledInputFile::Chunks::finish ()
+{
+#if ILMTHREAD_THREADING_ENABLED
+    if (processGroup) processGroup->throw_on_failure ();
+#endif
+}
+
+////////////////////////////////////////
+
 void TileProcess::run_decode (
     exr_const_context_t ctxt,
     int pn,
@@ -867,6 +1252,49 @@ void TileProcess::run_decode (
     int absX, absY, tileX, tileY;
     exr_attr_box2i_t dw;
 
+    bool isfirst = init_decoder (ctxt, pn);
+
+    if (EXR_ERR_SUCCESS != exr_get_data_window (ctxt, pn, &dw))
+        throw IEX_NAMESPACE::ArgExc ("Unable to query the data window.");
+
+    if (EXR_ERR_SUCCESS != exr_get_tile_sizes (
+            ctxt, pn, cinfo.level_x, cinfo.level_y, &tileX, &tileY))
+        throw IEX_NAMESPACE::ArgExc ("Unable to query the data window.");
+
+    absX = dw.min.x + tileX * cinfo.start_x;
+    absY = dw.min.y + tileY * cinfo.start_y;
+
+    update_pointers (outfb, dw.min.x, dw.min.y, absX, absY);
+
+    if (isfirst || routinesBuffered)
+    {
+        if (EXR_ERR_SUCCESS !=
+            exr_decoding_choose_default_routines (ctxt, pn, &decoder))
+        {
+            throw IEX_NAMESPACE::IoExc ("Unable to choose decoder routines");
+        }
+
+        routinesBuffered = false;
+    }
+
+    if (EXR_ERR_SUCCESS != exr_decoding_run (ctxt, pn, &decoder))
+        throw IEX_NAMESPACE::IoExc ("Unable to run decoder");
+
+    run_fill (outfb, dw.min.x, dw.min.y, absX, absY, filllist);
+}
+
+////////////////////////////////////////
+
+bool TileProcess::init_decoder (exr_const_context_t ctxt, int pn)
+{
+    // a process shared between the parts of a file was last used for
+    // another part, whose channels may differ, so start over
+    if (!first && (decoder.context != ctxt || decoder.part_index != pn))
+    {
+        exr_decoding_destroy (decoder.context, &decoder);
+        first = true;
+    }
+
     // stash the flag off to make sure to clean up in the event
     // of an exception by changing the flag after init...
     bool isfirst = first;
@@ -888,6 +1316,60 @@ void TileProcess::run_decode (
             throw IEX_NAMESPACE::IoExc ("Unable to update decode pipeline");
         }
     }
+    return isfirst;
+}
+
+////////////////////////////////////////
+
+namespace
+{
+
+//
+// Compute the part of a tile, in pixels relative to the tile origin,
+// that lies inside the clip box.  The end coordinates are exclusive.
+// Returns false if the tile and the clip box do not overlap.
+//
+
+bool
+clipTile (
+    const exr_chunk_info_t&       cinfo,
+    int                           t_absX,
+    int                           t_absY,
+    const IMATH_NAMESPACE::Box2i* clip,
+    int&                          x0,
+    int&                          x1,
+    int&                          y0,
+    int&                          y1)
+{
+    x0 = 0;
+    y0 = 0;
+    x1 = cinfo.width;
+    y1 = cinfo.height;
+
+    if (clip)
+    {
+        x0 = std::max (x0, clip->min.x - t_absX);
+        y0 = std::max (y0, clip->min.y - t_absY);
+        x1 = std::min (x1, clip->max.x - t_absX + 1);
+        y1 = std::min (y1, clip->max.y - t_absY + 1);
+    }
+
+    return x0 < x1 && y0 < y1;
+}
+
+} // namespace
+
+void TileProcess::run_buffered (
+    exr_const_context_t ctxt,
+    int pn,
+    const FrameBuffer *outfb,
+    const std::vector<Slice> &filllist,
+    TileCache *cache,
+    const TileCache::Key *cacheKey,
+    const std::vector<IMATH_NAMESPACE::Box2i> *clips)
+{
+    int absX, absY, tileX, tileY;
+    exr_attr_box2i_t dw;
 
     if (EXR_ERR_SUCCESS != exr_get_data_window (ctxt, pn, &dw))
         throw IEX_NAMESPACE::ArgExc ("Unable to query the data window.");
@@ -899,21 +1381,212 @@ void TileProcess::run_decode (
     absX = dw.min.x + tileX * cinfo.start_x;
     absY = dw.min.y + tileY * cinfo.start_y;
 
-    update_pointers (outfb, dw.min.x, dw.min.y, absX, absY);
+    if (cache && cacheKey)
+    {
+        TileCache::Key key = *cacheKey;
+
+        key.dx = cinfo.start_x;
+        key.dy = cinfo.start_y;
+        key.lx = cinfo.level_x;
+        key.ly = cinfo.level_y;
 
-    if (isfirst)
+        TileCache::TileData data = cache->find (key);
+        if (!data)
+        {
+            std::shared_ptr<std::vector<char>> buf =
+                std::make_shared<std::vector<char>> ();
+
+            decode_to_buffer (ctxt, pn, outfb, *buf);
+
+            data = buf;
+            cache->insert (key, data);
+        }
+
+        if (!clips)
+        {
+            copy_from_buffer (ctxt, pn, outfb, *data, absX, absY, nullptr);
+            run_fill (outfb, dw.min.x, dw.min.y, absX, absY, filllist);
+            return;
+        }
+
+        for (const IMATH_NAMESPACE::Box2i& clip: *clips)
+            copy_from_buffer (ctxt, pn, outfb, *data, absX, absY, &clip);
+    }
+    else
+    {
+        for (const IMATH_NAMESPACE::Box2i& clip: *clips)
+        {
+            int x0, x1, y0, y1;
+
+            if (clipTile (cinfo, absX, absY, &clip, x0, x1, y0, y1) &&
+                x0 == 0 && y0 == 0 && x1 == cinfo.width && y1 == cinfo.height)
+            {
+                // a tile that lies entirely inside one of the regions
+                // can be decoded straight into the frame buffer
+                run_decode (ctxt, pn, outfb, filllist);
+                return;
+            }
+        }
+
+        // otherwise decode the tile once, and copy out the part
+        // that lies inside each region
+        decode_to_buffer (ctxt, pn, outfb, scratch);
+
+        for (const IMATH_NAMESPACE::Box2i& clip: *clips)
+            copy_from_buffer (ctxt, pn, outfb, scratch, absX, absY, &clip);
+    }
+
+    for (const IMATH_NAMESPACE::Box2i& clip: *clips)
+        run_fill (outfb, dw.min.x, dw.min.y, absX, absY, filllist, &clip);
+}
+
+////////////////////////////////////////
+
+void TileProcess::decode_to_buffer (
+    exr_const_context_t ctxt,
+    int pn,
+    const FrameBuffer *outfb,
+    std::vector<char> &buf)
+{
+    bool isfirst = init_decoder (ctxt, pn);
+
+    // the buffered form of a tile is one tightly packed plane per
+    // requested channel, in channel list order
+    size_t total = 0;
+    for (int c = 0; c < decoder.channel_count; ++c)
+    {
+        const exr_coding_channel_info_t& curchan = decoder.channels[c];
+        const Slice* fbslice = outfb->findSlice (curchan.channel_name);
+
+        if (curchan.height == 0 || !fbslice) continue;
+
+        if (fbslice->xSampling != 1 || fbslice->ySampling != 1)
+            throw IEX_NAMESPACE::ArgExc ("Tiled data should not have subsampling.");
+
+        total += size_t (curchan.width) * size_t (curchan.height) *
+                 ((fbslice->type == HALF) ? 2 : 4);
+    }
+
+    buf.resize (total);
+    uint8_t* ptr = reinterpret_cast<uint8_t*> (buf.data ());
+
+    decoder.user_line_begin_skip = 0;
+    decoder.user_line_end_ignore = 0;
+
+    for (int c = 0; c < decoder.channel_count; ++c)
+    {
+        exr_coding_channel_info_t& curchan = decoder.channels[c];
+        const Slice* fbslice = outfb->findSlice (curchan.channel_name);
+
+        if (curchan.height == 0 || !fbslice)
+        {
+            curchan.decode_to_ptr     = NULL;
+            curchan.user_pixel_stride = 0;
+            curchan.user_line_stride  = 0;
+            continue;
+        }
+
+        int8_t bpe = (fbslice->type == HALF) ? 2 : 4;
+
+        curchan.user_bytes_per_element = bpe;
+        curchan.user_data_type         = (exr_pixel_type_t)fbslice->type;
+        curchan.user_pixel_stride      = bpe;
+        curchan.user_line_stride       = curchan.width * bpe;
+        curchan.decode_to_ptr          = ptr;
+
+        ptr += size_t (curchan.width) * size_t (curchan.height) * bpe;
+    }
+
+    if (total == 0)
+    {
+        if (isfirst)
+        {
+            // nothing was decoded, so no routines were chosen yet
+            exr_decoding_destroy (ctxt, &decoder);
+            first = true;
+        }
+        return;
+    }
+
+    if (isfirst || !routinesBuffered)
     {
         if (EXR_ERR_SUCCESS !=
             exr_decoding_choose_default_routines (ctxt, pn, &decoder))
         {
             throw IEX_NAMESPACE::IoExc ("Unable to choose decoder routines");
         }
+
+        routinesBuffered = true;
     }
 
     if (EXR_ERR_SUCCESS != exr_decoding_run (ctxt, pn, &decoder))
         throw IEX_NAMESPACE::IoExc ("Unable to run decoder");
+}
 
-    run_fill (outfb, dw.min.x, dw.min.y, absX, absY, filllist);
+////////////////////////////////////////
+
+void TileProcess::copy_from_buffer (
+    exr_const_context_t ctxt,
+    int pn,
+    const FrameBuffer *outfb,
+    const std::vector<char> &data,
+    int t_absX, int t_absY,
+    const IMATH_NAMESPACE::Box2i *clip)
+{
+    const exr_attr_chlist_t* chlist = nullptr;
+    int x0, x1, y0, y1;
+
+    if (!clipTile (cinfo, t_absX, t_absY, clip, x0, x1, y0, y1))
+        return;
+
+    if (EXR_ERR_SUCCESS != exr_get_channels (ctxt, pn, &chlist))
+        throw IEX_NAMESPACE::ArgExc ("Unable to query the channel list.");
+
+    const char* src    = data.data ();
+    const char* srcend = src + data.size ();
+    size_t      w      = static_cast<size_t> (cinfo.width);
+
+    for (int c = 0; c < chlist->num_channels; ++c)
+    {
+        const Slice* fbslice = outfb->findSlice (chlist->entries[c].name.str);
+        if (!fbslice) continue;
+
+        size_t bpe       = (fbslice->type == HALF) ? 2 : 4;
+        size_t linebytes = w * bpe;
+        size_t copybytes = size_t (x1 - x0) * bpe;
+
+        if (src + linebytes * size_t (cinfo.height) > srcend)
+            throw IEX_NAMESPACE::LogicExc ("Buffered tile is smaller than expected.");
+
+        int xOffset = fbslice->xTileCoords ? 0 : t_absX;
+        int yOffset = fbslice->yTileCoords ? 0 : t_absY;
+
+        char* ptr = fbslice->base;
+        ptr += (int64_t (xOffset) + x0) * int64_t (fbslice->xStride);
+        ptr += (int64_t (yOffset) + y0) * int64_t (fbslice->yStride);
+
+        const char* srcline = src + size_t (y0) * linebytes + size_t (x0) * bpe;
+
+        for (int y = y0; y < y1; ++y)
+        {
+            if (fbslice->xStride == bpe)
+                memcpy (ptr, srcline, copybytes);
+            else
+            {
+                char* outptr = ptr;
+                for (int x = x0; x < x1; ++x)
+                {
+                    memcpy (outptr, srcline + size_t (x - x0) * bpe, bpe);
+                    outptr += fbslice->xStride;
+                }
+            }
+
+            srcline += linebytes;
+            ptr += fbslice->yStride;
+        }
+
+        src += linebytes * size_t (cinfo.height);
+    }
 }
 
 ////////////////////////////////////////
@@ -962,8 +1635,14 @@ void TileProcess::update_pointers (const FrameBuffer *outfb, int fb_absX, int fb
 
 void TileProcess::run_fill (
     const FrameBuffer *outfb, int fb_absX, int fb_absY, int t_absX, int t_absY,
-    const std::vector<Slice> &filllist)
+    const std::vector<Slice> &filllist,
+    const IMATH_NAMESPACE::Box2i *clip)
 {
+    int x0, x1, y0, y1;
+
+    if (!clipTile (cinfo, t_absX, t_absY, clip, x0, x1, y0, y1))
+        return;
+
     for (auto& s: filllist)
     {
         uint8_t* ptr;
@@ -975,16 +1654,16 @@ void TileProcess::run_fill (
         int yOffset = s.yTileCoords ? 0 : t_absY;
 
         ptr  = reinterpret_cast<uint8_t*> (s.base);
-        ptr += int64_t (xOffset) * int64_t (s.xStride);
-        ptr += int64_t (yOffset) * int64_t (s.yStride);
+        ptr += (int64_t (xOffset) + x0) * int64_t (s.xStride);
+        ptr += (int64_t (yOffset) + y0) * int64_t (s.yStride);
 
         // TODO: update ImfMisc, lift fill type / value
-        for ( int start = 0; start < cinfo.height; ++start )
+        for ( int start = y0; start < y1; ++start )
         {
             if (start % s.ySampling) continue;
 
             uint8_t* outptr = ptr;
-            for ( int sx = 0; sx < cinfo.width; ++sx )
+            for ( int sx = x0; sx < x1; ++sx )
             {
                 if (sx % s.xSampling) continue;
 
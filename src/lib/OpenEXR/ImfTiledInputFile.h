@@ -21,8 +21,13 @@
 #include "ImfTileDescription.h"
 #include <ImathBox.h>
 
+#include <memory>
+#include <vector>
+
 OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
 
+class PartChunks;
+
 class IMF_EXPORT_TYPE TiledInputFile
 {
 public:
@@ -325,6 +330,69 @@ public:
     IMF_EXPORT
     void readTiles (int dx1, int dx2, int dy1, int dy2, int l = 0);
 
+    //------------------------------------------------------------
+    // Read a rectangular region of pixels:
+    //
+    // readRegion(box, lx, ly) reads all tiles of level (lx, ly)
+    // that overlap box, concurrently if multi-threading is used,
+    // and stores only the pixels inside box in the current frame
+    // buffer.  box is given in the pixel coordinates of the level,
+    // and must lie within dataWindowForLevel(lx, ly).
+    //
+    // Unlike readTiles(), pixels outside box are never written, so
+    // the frame buffer need only cover the region itself; for
+    // example, a slice whose base pointer is offset by -box.min.
+    //
+    // readRegion(boxes, lx, ly) reads the pixels inside each of
+    // the boxes, as if by readRegion(box, lx, ly) for every box.
+    // A tile that overlaps several boxes is decoded only once, and
+    // the tiles of all boxes are decoded concurrently, in a single
+    // pass over the file.
+    //
+    // readRegion(box, level) and readRegion(boxes, level) are
+    // convenience functions used for ONE_LEVEL and MIPMAP_LEVELS
+    // files.  They call readRegion(box, level, level) and
+    // readRegion(boxes, level, level).
+    //
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    void readRegion (const IMATH_NAMESPACE::Box2i& box, int lx, int ly);
+
+    IMF_EXPORT
+    void readRegion (const IMATH_NAMESPACE::Box2i& box, int l = 0);
+
+    IMF_EXPORT
+    void readRegion (
+        const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int lx, int ly);
+
+    IMF_EXPORT
+    void readRegion (
+        const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int l = 0);
+
+    //------------------------------------------------------------
+    // Decoded tile cache:
+    //
+    // setTileCache(cache) makes readTile() and readTiles() look up
+    // tiles in the given cache before decoding them, and insert
+    // freshly decoded tiles into it.  The same cache may be shared
+    // between any number of files and parts, which then share its
+    // memory budget.  Files and parts that were opened by name
+    // reuse each other's tiles if they read the same, unmodified
+    // file; files read from an IStream only reuse their own tiles.
+    // Passing a null pointer disables caching, which is the default.
+    //
+    // Tiles are cached in the pixel types requested by the current
+    // frame buffer, so a frame buffer that selects different
+    // channels or types does not reuse the tiles of another.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    void setTileCache (const std::shared_ptr<TileCache>& cache);
+
+    IMF_EXPORT
+    std::shared_ptr<TileCache> tileCache () const;
+
     //--------------------------------------------------
     // Read a tile of raw pixel data from the file,
     // without uncompressing it (this function is
@@ -364,6 +432,24 @@ private:
     IMF_HIDDEN
     void  tileOrder (int dx[], int dy[], int lx[], int ly[]) const;
 
+    //
+    // Used by MultiPartInputFile::readPixels() to decode the tiles of
+    // several parts of one file in a single pass; box is given in the
+    // pixel coordinates of level (0, 0)
+    //
+
+    struct PartRegion
+    {
+        int                    partNumber;
+        const FrameBuffer*     frameBuffer;
+        IMATH_NAMESPACE::Box2i box;
+    };
+
+    struct IMF_HIDDEN Chunks;
+
+    IMF_HIDDEN static std::unique_ptr<PartChunks> partChunks (
+        Context& ctxt, const std::vector<PartRegion>& parts, int numThreads);
+
     friend class TiledOutputFile;
 };
 
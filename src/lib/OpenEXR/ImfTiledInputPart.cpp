@@ -172,6 +172,44 @@ TiledInputPart::readTiles (int dx1, int dx2, int dy1, int dy2, int l)
     file->readTiles (dx1, dx2, dy1, dy2, l);
 }
 
+void
+TiledInputPart::readRegion (const IMATH_NAMESPACE::Box2i& box, int lx, int ly)
+{
+    file->readRegion (box, lx, ly);
+}
+
+void
+TiledInputPart::readRegion (const IMATH_NAMESPACE::Box2i& box, int l)
+{
+    file->readRegion (box, l);
+}
+
+void
+TiledInputPart::readRegion (
+    const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int lx, int ly)
+{
+    file->readRegion (boxes, lx, ly);
+}
+
+void
+TiledInputPart::readRegion (
+    const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int l)
+{
+    file->readRegion (boxes, l);
+}
+
+void
+TiledInputPart::setTileCache (const std::shared_ptr<TileCache>& cache)
+{
+    file->setTileCache (cache);
+}
+
+std::shared_ptr<TileCache>
+TiledInputPart::tileCache () const
+{
+    return file->tileCache ();
+}
+
 void
 TiledInputPart::rawTileData (
     int&         dx,
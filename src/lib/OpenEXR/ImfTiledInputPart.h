@@ -11,6 +11,9 @@
 #include "ImfTileDescription.h"
 #include <ImathBox.h>
 
+#include <memory>
+#include <vector>
+
 OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
 
 //-----------------------------------------------------------------------------
@@ -79,6 +82,20 @@ public:
     IMF_EXPORT
     void readTiles (int dx1, int dx2, int dy1, int dy2, int l = 0);
     IMF_EXPORT
+    void readRegion (const IMATH_NAMESPACE::Box2i& box, int lx, int ly);
+    IMF_EXPORT
+    void readRegion (const IMATH_NAMESPACE::Box2i& box, int l = 0);
+    IMF_EXPORT
+    void readRegion (
+        const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int lx, int ly);
+    IMF_EXPORT
+    void readRegion (
+        const std::vector<IMATH_NAMESPACE::Box2i>& boxes, int l = 0);
+    IMF_EXPORT
+    void setTileCache (const std::shared_ptr<TileCache>& cache);
+    IMF_EXPORT
+    std::shared_ptr<TileCache> tileCache () const;
+    IMF_EXPORT
     void rawTileData (
         int&         dx,
         int&         dy,
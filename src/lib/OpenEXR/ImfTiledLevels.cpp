@@ -0,0 +1,690 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+//-----------------------------------------------------------------------------
+//
+//	Generation of the lower resolution levels of tiled files.
+//
+//	Each reduction shrinks one axis by a factor of two.  For every
+//	output column (or row) a short table of source indices and
+//	weights is built once per level, with the wrap mode already
+//	applied, so the inner loops do not need any edge handling.
+//	Vertical reductions combine whole rows with scalar weights,
+//	which compilers turn into vector code.
+//
+//	The results are bit for bit those of the serial code that
+//	exrmaketiled used before: the same double precision arithmetic
+//	in the same order, rounded to the pixel type after each pass.
+//
+//-----------------------------------------------------------------------------
+
+#include "ImfTiledLevels.h"
+
+#include "ImfChannelList.h"
+#include "ImfFrameBuffer.h"
+#include "ImfHeader.h"
+#include "ImfMisc.h"
+#include "ImfThreading.h"
+#include "ImfTiledOutputFile.h"
+#include "ImfTiledOutputPart.h"
+
+#include "Iex.h"
+#include <ImathBox.h>
+#include <ImathFun.h>
+#include <half.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
+
+namespace
+{
+
+//
+// One channel of one level.  For level 0 the pixels belong to the
+// caller's frame buffer; for all other levels they are owned, and
+// tightly packed with the same pixel type as level 0.
+//
+
+struct Plane
+{
+    std::string       name;
+    PixelType         type    = FLOAT;
+    const char*       base    = nullptr; // pixel (0, 0) of the level
+    size_t            xStride = 0;
+    size_t            yStride = 0;
+    bool              filter  = true;
+    std::vector<char> storage;
+};
+
+struct Level
+{
+    int                width  = 0;
+    int                height = 0;
+    std::vector<Plane> planes;
+};
+
+//
+// One output pixel of a filtered reduction is
+//
+//     weight[0] * (s[0] * v(i0[0]) + t[0] * v(i1[0])) +
+//     weight[1] * (s[1] * v(i0[1]) + t[1] * v(i1[1])) + ...
+//
+// evaluated in double precision and in this order, where v(-1)
+// is zero.  This is the arithmetic exrmaketiled has always used,
+// so that files it writes do not change.
+//
+
+struct Tap
+{
+    int    n = 0;
+    int    i0[4];
+    int    i1[4];
+    double s[4];
+    double t[4];
+    double weight[4];
+};
+
+struct Taps
+{
+    std::vector<Tap> filtered;
+    std::vector<int> point;
+};
+
+int
+mirror (int x, int w)
+{
+    int d = IMATH_NAMESPACE::divp (x, w);
+    int m = IMATH_NAMESPACE::modp (x, w);
+    return (d & 1) ? w - 1 - m : m;
+}
+
+int
+wrapIndex (int i, int n, LevelWrap wrap)
+{
+    if (i >= 0 && i < n) return i;
+
+    switch (wrap)
+    {
+        case WRAP_CLAMP: return IMATH_NAMESPACE::clamp (i, 0, n - 1);
+        case WRAP_PERIODIC: return IMATH_NAMESPACE::modp (i, n);
+        case WRAP_MIRROR: return mirror (i, n);
+        case WRAP_BLACK:
+        default: return -1;
+    }
+}
+
+Taps
+makeTaps (int n0, int n1, LevelFilter filter, LevelWrap wrap, bool odd)
+{
+    Taps taps;
+
+    //
+    // Point sampling skips every other pixel.  In order to keep
+    // the image from sliding if it is resampled repeatedly, skip
+    // the last pixel on even passes and the first pixel on odd
+    // passes.
+    //
+
+    int offset = odd ? ((n0 - 1) - 2 * (n1 - 1)) : 0;
+
+    taps.point.resize (n1);
+    for (int x = 0; x < n1; ++x)
+        taps.point[x] = std::min (2 * x + offset, n0 - 1);
+
+    if (filter == POINT_FILTER) return taps;
+
+    //
+    // Low-pass filter and resample.  For output pixels 0 and n1 - 1,
+    // the filter is centered on source pixels 0.5 and n0 - 1.5.
+    // Filter taps that fall between two source pixels are linearly
+    // interpolated.
+    //
+
+    static const double bsplineOffsets[] = {-1, 0, 1, 2};
+    static const double bsplineWeights[] = {0.125, 0.375, 0.375, 0.125};
+    static const double boxOffsets[]     = {0, 1};
+    static const double boxWeights[]     = {0.5, 0.5};
+
+    const double* offsets = bsplineOffsets;
+    const double* weights = bsplineWeights;
+    int           numTaps = 4;
+
+    if (filter == BOX_FILTER)
+    {
+        offsets = boxOffsets;
+        weights = boxWeights;
+        numTaps = 2;
+    }
+
+    double f = (n1 > 1) ? double (n0 - 2) / (n1 - 1) : 1;
+
+    taps.filtered.resize (n1);
+    for (int x = 0; x < n1; ++x)
+    {
+        Tap& tap = taps.filtered[x];
+        tap.n    = numTaps;
+
+        for (int k = 0; k < numTaps; ++k)
+        {
+            double p  = x * f + offsets[k];
+            int    xs = IMATH_NAMESPACE::floor (p);
+            int    xt = xs + 1;
+
+            tap.s[k]      = xt - p;
+            tap.t[k]      = 1 - tap.s[k];
+            tap.i0[k]     = wrapIndex (xs, n0, wrap);
+            tap.i1[k]     = wrapIndex (xt, n0, wrap);
+            tap.weight[k] = weights[k];
+        }
+    }
+
+    return taps;
+}
+
+//
+// Conversion of a filtered value to the pixel type, as a cast
+// in the original exrmaketiled code would do it.
+//
+
+template <class T>
+inline T
+toPixel (double v)
+{
+    return static_cast<T> (v);
+}
+
+template <>
+inline half
+toPixel<half> (double v)
+{
+    return half (float (v));
+}
+
+template <class T>
+inline double
+value (const T* row, int i)
+{
+    return (i < 0) ? 0.0 : double (row[i]);
+}
+
+//
+// Return row y of a plane, gathering it into tmp if the
+// plane's pixels are not tightly packed.
+//
+
+template <class T>
+const T*
+rowPointer (const Plane& p, int y, int w, T* tmp)
+{
+    const char* row = p.base + int64_t (y) * int64_t (p.yStride);
+
+    if (p.xStride == sizeof (T)) return reinterpret_cast<const T*> (row);
+
+    for (int x = 0; x < w; ++x)
+        tmp[x] = *reinterpret_cast<const T*> (
+            row + int64_t (x) * int64_t (p.xStride));
+
+    return tmp;
+}
+
+template <class T>
+T*
+outputRow (Plane& p, int y)
+{
+    return reinterpret_cast<T*> (
+        const_cast<char*> (p.base) + int64_t (y) * int64_t (p.yStride));
+}
+
+template <class T>
+void
+reduceRowsX (
+    const Plane& src,
+    Plane&       dst,
+    int          w0,
+    int          w1,
+    const Taps&  taps,
+    int          y0,
+    int          y1)
+{
+    std::vector<T> tmp (w0);
+
+    for (int y = y0; y < y1; ++y)
+    {
+        const T* in  = rowPointer<T> (src, y, w0, tmp.data ());
+        T*       out = outputRow<T> (dst, y);
+
+        if (!src.filter || taps.filtered.empty ())
+        {
+            for (int x = 0; x < w1; ++x)
+                out[x] = in[taps.point[x]];
+            continue;
+        }
+
+        for (int x = 0; x < w1; ++x)
+        {
+            const Tap& t = taps.filtered[x];
+            double     v = t.weight[0] * (t.s[0] * value (in, t.i0[0]) +
+                                      t.t[0] * value (in, t.i1[0]));
+
+            for (int k = 1; k < t.n; ++k)
+                v += t.weight[k] * (t.s[k] * value (in, t.i0[k]) +
+                                    t.t[k] * value (in, t.i1[k]));
+
+            out[x] = toPixel<T> (v);
+        }
+    }
+}
+
+template <class T>
+void
+reduceRowsY (
+    const Plane& src,
+    Plane&       dst,
+    int          w,
+    const Taps&  taps,
+    int          y0,
+    int          y1)
+{
+    std::vector<T>      tmp0 (w);
+    std::vector<T>      tmp1 (w);
+    std::vector<T>      zero (w, T (0));
+    std::vector<double> acc (w);
+
+    auto row = [&] (int i, std::vector<T>& tmp) -> const T* {
+        return (i < 0) ? zero.data () : rowPointer<T> (src, i, w, tmp.data ());
+    };
+
+    for (int y = y0; y < y1; ++y)
+    {
+        T* out = outputRow<T> (dst, y);
+
+        if (!src.filter || taps.filtered.empty ())
+        {
+            const T* in = row (taps.point[y], tmp0);
+            std::copy (in, in + w, out);
+            continue;
+        }
+
+        const Tap& t = taps.filtered[y];
+
+        for (int k = 0; k < t.n; ++k)
+        {
+            const T* in0 = row (t.i0[k], tmp0);
+            const T* in1 = row (t.i1[k], tmp1);
+            double   wk  = t.weight[k];
+            double   sk  = t.s[k];
+            double   tk  = t.t[k];
+
+            if (k == 0)
+            {
+                for (int x = 0; x < w; ++x)
+                    acc[x] =
+                        wk * (sk * double (in0[x]) + tk * double (in1[x]));
+            }
+            else
+            {
+                for (int x = 0; x < w; ++x)
+                    acc[x] +=
+                        wk * (sk * double (in0[x]) + tk * double (in1[x]));
+            }
+        }
+
+        for (int x = 0; x < w; ++x)
+            out[x] = toPixel<T> (acc[x]);
+    }
+}
+
+Level
+allocateLevel (const Level& src, int width, int height)
+{
+    Level dst;
+    dst.width  = width;
+    dst.height = height;
+    dst.planes.resize (src.planes.size ());
+
+    for (size_t i = 0; i < src.planes.size (); ++i)
+    {
+        const Plane& s = src.planes[i];
+        Plane&       d = dst.planes[i];
+
+        d.name    = s.name;
+        d.filter  = s.filter;
+        d.type    = s.type;
+        d.xStride = (s.type == HALF) ? sizeof (half) : 4;
+        d.yStride = size_t (width) * d.xStride;
+        d.storage.resize (d.yStride * size_t (height));
+        d.base = d.storage.data ();
+    }
+
+    return dst;
+}
+
+//
+// Reduce the width or height of a level.  Unless concurrent is false,
+// the rows of the level are split among the threads of the global
+// thread pool.
+//
+
+Level
+reduceX (
+    const Level&                  src,
+    int                           width,
+    const LevelGenerationOptions& options,
+    bool                          odd,
+    bool                          concurrent = true)
+{
+    Level dst  = allocateLevel (src, width, src.height);
+    Taps  taps =
+        makeTaps (src.width, width, options.filter, options.wrapX, odd);
+
+    std::function<void (int, int)> fn = [&] (int y0, int y1) {
+        for (size_t i = 0; i < src.planes.size (); ++i)
+        {
+            const Plane& s = src.planes[i];
+            Plane&       d = dst.planes[i];
+
+            switch (s.type)
+            {
+                case HALF:
+                    reduceRowsX<half> (s, d, src.width, width, taps, y0, y1);
+                    break;
+                case FLOAT:
+                    reduceRowsX<float> (s, d, src.width, width, taps, y0, y1);
+                    break;
+                default:
+                    reduceRowsX<unsigned int> (
+                        s, d, src.width, width, taps, y0, y1);
+                    break;
+            }
+        }
+    };
+
+    if (concurrent)
+        forEachRowRange (src.height, fn);
+    else
+        fn (0, src.height);
+
+    return dst;
+}
+
+Level
+reduceY (
+    const Level&                  src,
+    int                           height,
+    const LevelGenerationOptions& options,
+    bool                          odd,
+    bool                          concurrent = true)
+{
+    Level dst = allocateLevel (src, src.width, height);
+    Taps  taps =
+        makeTaps (src.height, height, options.filter, options.wrapY, odd);
+
+    std::function<void (int, int)> fn = [&] (int y0, int y1) {
+        for (size_t i = 0; i < src.planes.size (); ++i)
+        {
+            const Plane& s = src.planes[i];
+            Plane&       d = dst.planes[i];
+
+            switch (s.type)
+            {
+                case HALF:
+                    reduceRowsY<half> (s, d, src.width, taps, y0, y1);
+                    break;
+                case FLOAT:
+                    reduceRowsY<float> (s, d, src.width, taps, y0, y1);
+                    break;
+                default:
+                    reduceRowsY<unsigned int> (s, d, src.width, taps, y0, y1);
+                    break;
+            }
+        }
+    };
+
+    if (concurrent)
+        forEachRowRange (height, fn);
+    else
+        fn (0, height);
+
+    return dst;
+}
+
+template <class Out>
+void
+storeLevel (Out& out, const Level& level, int lx, int ly)
+{
+    IMATH_NAMESPACE::Box2i dw = out.dataWindowForLevel (lx, ly);
+    FrameBuffer            fb;
+
+    for (const Plane& p: level.planes)
+    {
+        fb.insert (
+            p.name,
+            Slice::Make (
+                p.type, p.base, dw.min, level.width, level.height, p.xStride));
+    }
+
+    out.setFrameBuffer (fb);
+    out.writeTiles (
+        0, out.numXTiles (lx) - 1, 0, out.numYTiles (ly) - 1, lx, ly);
+}
+
+template <class Out>
+void
+writeLevelsImpl (
+    Out&                          out,
+    const FrameBuffer&            frameBuffer,
+    const LevelGenerationOptions& options)
+{
+    if (options.filter < 0 || options.filter >= NUM_LEVEL_FILTERS ||
+        options.wrapX < 0 || options.wrapX >= NUM_LEVEL_WRAPS ||
+        options.wrapY < 0 || options.wrapY >= NUM_LEVEL_WRAPS)
+    {
+        throw IEX_NAMESPACE::ArgExc ("Invalid level generation options.");
+    }
+
+    //
+    // Describe level 0 in terms of the caller's frame buffer.
+    //
+
+    const ChannelList&     channels = out.header ().channels ();
+    IMATH_NAMESPACE::Box2i dw       = out.dataWindowForLevel (0, 0);
+    Level                  level0;
+
+    level0.width  = dw.max.x - dw.min.x + 1;
+    level0.height = dw.max.y - dw.min.y + 1;
+
+    for (FrameBuffer::ConstIterator i = frameBuffer.begin ();
+         i != frameBuffer.end ();
+         ++i)
+    {
+        const Slice& s = i.slice ();
+
+        if (!channels.findChannel (i.name ())) continue;
+
+        if (s.xSampling != 1 || s.ySampling != 1 || s.xTileCoords ||
+            s.yTileCoords)
+        {
+            THROW (
+                IEX_NAMESPACE::ArgExc,
+                "Cannot generate resolution levels for channel \""
+                    << i.name ()
+                    << "\": slices must not be subsampled or use tile "
+                       "coordinates.");
+        }
+
+        Plane p;
+        p.name    = i.name ();
+        p.type    = s.type;
+        p.xStride = s.xStride;
+        p.yStride = s.yStride;
+        p.base    = s.base + int64_t (dw.min.x) * int64_t (s.xStride) +
+                 int64_t (dw.min.y) * int64_t (s.yStride);
+        p.filter  = options.pointSampledChannels.find (p.name) ==
+                   options.pointSampledChannels.end ();
+
+        if (p.type != UINT && p.type != HALF && p.type != FLOAT)
+            throw IEX_NAMESPACE::ArgExc ("Invalid pixel type.");
+
+        level0.planes.push_back (p);
+    }
+
+    if (options.progress) options.progress (0, 0);
+
+    out.setFrameBuffer (frameBuffer);
+    out.writeTiles (0, out.numXTiles (0) - 1, 0, out.numYTiles (0) - 1, 0, 0);
+
+    if (out.levelMode () == MIPMAP_LEVELS)
+    {
+        Level cur;
+
+        for (int l = 1; l < out.numLevels (); ++l)
+        {
+            const Level& src = (l == 1) ? level0 : cur;
+
+            Level tmp  = reduceX (src, out.levelWidth (l), options, l & 1);
+            Level next = reduceY (tmp, out.levelHeight (l), options, l & 1);
+
+            tmp = Level ();
+            if (options.progress) options.progress (l, l);
+            storeLevel (out, next, l, l);
+            cur = std::move (next);
+        }
+    }
+    else if (out.levelMode () == RIPMAP_LEVELS)
+    {
+        //
+        // Unlike mipmap levels, ripmap reductions take the parity
+        // of the level they start from, as exrmaketiled did.
+        //
+        // Each row of levels, (1, ly) to (numXLevels - 1, ly), is
+        // reduced from level (0, ly), one level from the next, but
+        // the rows are independent of each other.  While level
+        // (0, ly) has enough scan lines to keep the global thread
+        // pool busy, the rows are reduced one after the other, with
+        // the scan lines of each level split among the threads.  The
+        // remaining, smaller rows are reduced concurrently, a row
+        // per thread, and then written in the same order as before.
+        //
+
+        int numXLevels = out.numXLevels ();
+        int numYLevels = out.numYLevels ();
+        int minHeight  = globalThreadCount () * 4;
+
+        std::vector<int> levelWidth (numXLevels);
+        for (int lx = 0; lx < numXLevels; ++lx)
+            levelWidth[lx] = out.levelWidth (lx);
+
+        Level column;
+        int   ly = 0;
+
+        for (; ly < numYLevels; ++ly)
+        {
+            if (ly > 0)
+            {
+                if (out.levelHeight (ly) < minHeight) break;
+
+                const Level& src = (ly == 1) ? level0 : column;
+
+                Level next = reduceY (
+                    src, out.levelHeight (ly), options, (ly - 1) & 1);
+
+                if (options.progress) options.progress (0, ly);
+                storeLevel (out, next, 0, ly);
+                column = std::move (next);
+            }
+
+            Level cur;
+
+            for (int lx = 1; lx < numXLevels; ++lx)
+            {
+                const Level& src =
+                    (lx > 1) ? cur : ((ly == 0) ? level0 : column);
+
+                Level next =
+                    reduceX (src, levelWidth[lx], options, (lx - 1) & 1);
+
+                if (options.progress) options.progress (lx, ly);
+                storeLevel (out, next, lx, ly);
+                cur = std::move (next);
+            }
+        }
+
+        if (ly < numYLevels)
+        {
+            //
+            // rows[i][lx] is level (lx, ly + i).
+            //
+
+            std::vector<std::vector<Level>> rows (numYLevels - ly);
+
+            for (size_t i = 0; i < rows.size (); ++i)
+            {
+                int          y   = ly + int (i);
+                const Level& src = (y == 1) ? level0
+                                   : (i == 0) ? column
+                                              : rows[i - 1][0];
+
+                rows[i].resize (numXLevels);
+                rows[i][0] = reduceY (
+                    src, out.levelHeight (y), options, (y - 1) & 1);
+            }
+
+            column = Level ();
+
+            forEachRowRange (int (rows.size ()), [&] (int i0, int i1) {
+                for (int i = i0; i < i1; ++i)
+                {
+                    for (int lx = 1; lx < numXLevels; ++lx)
+                    {
+                        rows[i][lx] = reduceX (
+                            rows[i][lx - 1],
+                            levelWidth[lx],
+                            options,
+                            (lx - 1) & 1,
+                            false);
+                    }
+                }
+            });
+
+            for (size_t i = 0; i < rows.size (); ++i)
+            {
+                for (int lx = 0; lx < numXLevels; ++lx)
+                {
+                    if (options.progress) options.progress (lx, ly + int (i));
+                    storeLevel (out, rows[i][lx], lx, ly + int (i));
+                }
+
+                rows[i].clear ();
+            }
+        }
+    }
+
+    out.setFrameBuffer (frameBuffer);
+}
+
+} // namespace
+
+void
+writeLevels (
+    TiledOutputFile&              out,
+    const FrameBuffer&            frameBuffer,
+    const LevelGenerationOptions& options)
+{
+    writeLevelsImpl (out, frameBuffer, options);
+}
+
+void
+writeLevels (
+    TiledOutputPart&              out,
+    const FrameBuffer&            frameBuffer,
+    const LevelGenerationOptions& options)
+{
+    writeLevelsImpl (out, frameBuffer, options);
+}
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_EXIT
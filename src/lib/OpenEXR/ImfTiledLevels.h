@@ -0,0 +1,106 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifndef INCLUDED_IMF_TILED_LEVELS_H
+#define INCLUDED_IMF_TILED_LEVELS_H
+
+//-----------------------------------------------------------------------------
+//
+//	Generation of the lower resolution levels of MIPMAP and RIPMAP
+//	tiled files.
+//
+//	writeLevels(out, frameBuffer) stores the full resolution image
+//	described by frameBuffer as level (0, 0) of out, then repeatedly
+//	shrinks it by a factor of two and stores every other level of
+//	the file.  The levels are computed one after another, so apart
+//	from the caller's full resolution pixels no more than two levels
+//	(plus one half-reduced intermediate) are held in memory at any
+//	time.  The rows of each level are computed concurrently on the
+//	global thread pool (see setGlobalThreadCount()).
+//
+//	Pixels are filtered in double precision and rounded to the pixel
+//	type of the frame buffer after every horizontal and vertical
+//	pass, exactly as exrmaketiled has always done, so its output
+//	does not depend on whether it uses writeLevels().  Unsigned int
+//	channels are filtered like all others; channels that hold
+//	identifiers should be listed in pointSampledChannels.
+//
+//	For ONE_LEVEL files, writeLevels() only stores level 0.
+//
+//-----------------------------------------------------------------------------
+
+#include "ImfForward.h"
+
+#include <functional>
+#include <set>
+#include <string>
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
+
+enum IMF_EXPORT_ENUM LevelFilter
+{
+    POINT_FILTER   = 0, // keep every other pixel, no low-pass filtering
+    BOX_FILTER     = 1, // average of two neighboring pixels
+    BSPLINE_FILTER = 2, // four-tap 1/8, 3/8, 3/8, 1/8 filter
+
+    NUM_LEVEL_FILTERS // number of different level filters
+};
+
+enum IMF_EXPORT_ENUM LevelWrap
+{
+    WRAP_BLACK    = 0, // pixels outside the image are black
+    WRAP_CLAMP    = 1, // repeat the edge pixels
+    WRAP_PERIODIC = 2, // the image repeats
+    WRAP_MIRROR   = 3, // the image is mirrored at its edges
+
+    NUM_LEVEL_WRAPS // number of different wrap modes
+};
+
+struct IMF_EXPORT_TYPE LevelGenerationOptions
+{
+    LevelFilter filter = BSPLINE_FILTER;
+    LevelWrap   wrapX  = WRAP_CLAMP;
+    LevelWrap   wrapY  = WRAP_CLAMP;
+
+    //
+    // Names of channels that are resampled with POINT_FILTER
+    // regardless of filter, for example depth or object ids.
+    //
+
+    std::set<std::string> pointSampledChannels;
+
+    //
+    // If set, called with the coordinates of every level, level
+    // (0, 0) included, just before the level is stored.
+    //
+
+    std::function<void (int lx, int ly)> progress;
+};
+
+//
+// Store level 0 from frameBuffer, and generate and store all other
+// levels of out.  Every slice of frameBuffer must cover the data
+// window of the file, and must not be subsampled or use tile
+// coordinates.  Channels of the file that are not in frameBuffer
+// are written as zeros, as with writeTiles().
+//
+// On return, frameBuffer is the current frame buffer of out.
+//
+
+IMF_EXPORT
+void writeLevels (
+    TiledOutputFile&              out,
+    const FrameBuffer&            frameBuffer,
+    const LevelGenerationOptions& options = LevelGenerationOptions ());
+
+IMF_EXPORT
+void writeLevels (
+    TiledOutputPart&              out,
+    const FrameBuffer&            frameBuffer,
+    const LevelGenerationOptions& options = LevelGenerationOptions ());
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif
@@ -18,6 +18,7 @@
 #include <ImfArray.h>
 #include <ImfChannelList.h>
 #include <ImfCompressor.h>
+#include <ImfConstantChunks.h>
 #include <ImfFrameBuffer.h>
 #include <ImfHeader.h>
 #include <ImfInputFile.h>
@@ -37,6 +38,7 @@
 #include <ImfXdr.h>
 #include <algorithm>
 #include <assert.h>
+#include <stdio.h>
 #include <fstream>
 #include <map>
 #include <string>
@@ -128,16 +130,23 @@ struct TileCoord
 
 struct BufferedTile
 {
-    char* pixelData;
-    int   pixelDataSize;
+    char*    pixelData;
+    int      pixelDataSize;
+    uint64_t spillOffset; // position in the spill file if pixelData is 0
 
     BufferedTile (const char* data, int size)
-        : pixelData (0), pixelDataSize (size)
+        : pixelData (0), pixelDataSize (size), spillOffset (0)
     {
         pixelData = new char[pixelDataSize];
         memcpy (pixelData, data, pixelDataSize);
     }
 
+    BufferedTile (uint64_t offset, int size)
+        : pixelData (0), pixelDataSize (size), spillOffset (offset)
+    {
+        // empty
+    }
+
     ~BufferedTile () { delete[] pixelData; }
 
     BufferedTile (const BufferedTile& other)            = delete;
@@ -155,6 +164,8 @@ struct TileBuffer
     int         dataSize;
     Compressor* compressor;
     TileCoord   tileCoord;
+    bool        constant;      // all pixels have the value below
+    Array<char> constantValue; // one Xdr value per channel
     bool        hasException;
     string      exception;
 
@@ -172,6 +183,7 @@ TileBuffer::TileBuffer (Compressor* comp)
     : dataPtr (0)
     , dataSize (0)
     , compressor (comp)
+    , constant (false)
     , hasException (false)
     , exception ()
     , _sem (1)
@@ -222,6 +234,15 @@ struct TiledOutputFile::Data
     TileMap   tileMap;
     TileCoord nextTileToWrite;
 
+    size_t      maxBufferedTileBytes; // 0 buffers everything in memory
+    size_t      bufferedTileBytes;    // bytes of buffered tiles in memory
+    FILE*       spillFile;            // holds the tiles over the limit
+    uint64_t    spillFileSize;
+    Array<char> spillBuffer; // a spilled tile read back for writing
+
+    ConstantChunkTable constantChunks;         // tiles left out of the file
+    uint64_t           constantChunksPosition; // position of its attribute
+
     int partNumber; // the output part number
 
     Data (int numThreads);
@@ -245,6 +266,11 @@ TiledOutputFile::Data::Data (int numThreads)
     , numXTiles (0)
     , numYTiles (0)
     , tileOffsetsPosition (0)
+    , maxBufferedTileBytes (0)
+    , bufferedTileBytes (0)
+    , spillFile (0)
+    , spillFileSize (0)
+    , constantChunksPosition (0)
     , partNumber (-1)
 {
     //
@@ -267,6 +293,8 @@ TiledOutputFile::Data::~Data ()
     for (TileMap::iterator i = tileMap.begin (); i != tileMap.end (); ++i)
         delete i->second;
 
+    if (spillFile) fclose (spillFile);
+
     for (size_t i = 0; i < tileBuffers.size (); i++)
         delete tileBuffers[i];
 }
@@ -438,6 +466,107 @@ writeTileData (
     if (ofd->multipart) { streamData->currentPosition += Xdr::size<int> (); }
 }
 
+int
+tileChunkIndex (const TiledOutputFile::Data* ofd, const TileCoord& tile)
+{
+    //
+    // Index of a tile in the file's offset table, or -1 if the
+    // coordinates are outside the image.
+    //
+
+    if (tile.lx < 0 || tile.lx >= ofd->numXLevels || tile.ly < 0 ||
+        tile.ly >= ofd->numYLevels || tile.dx < 0 ||
+        tile.dx >= ofd->numXTiles[tile.lx] || tile.dy < 0 ||
+        tile.dy >= ofd->numYTiles[tile.ly])
+        return -1;
+
+    int index = 0;
+
+    if (ofd->tileDesc.mode == RIPMAP_LEVELS)
+    {
+        for (int ly = 0; ly < tile.ly; ++ly)
+            for (int lx = 0; lx < ofd->numXLevels; ++lx)
+                index += ofd->numXTiles[lx] * ofd->numYTiles[ly];
+
+        for (int lx = 0; lx < tile.lx; ++lx)
+            index += ofd->numXTiles[lx] * ofd->numYTiles[tile.ly];
+    }
+    else
+    {
+        for (int l = 0; l < tile.lx; ++l)
+            index += ofd->numXTiles[l] * ofd->numYTiles[l];
+    }
+
+    return index + tile.dy * ofd->numXTiles[tile.lx] + tile.dx;
+}
+
+inline bool
+isConstantTile (const TiledOutputFile::Data* ofd, const TileCoord& tile)
+{
+    return ofd->constantChunks.enabled () &&
+           ofd->constantChunks.isSet (tileChunkIndex (ofd, tile));
+}
+
+bool
+seekSpillFile (FILE* f, uint64_t pos)
+{
+#ifdef _WIN32
+    return _fseeki64 (f, (__int64) pos, SEEK_SET) == 0;
+#else
+    return fseeko (f, (off_t) pos, SEEK_SET) == 0;
+#endif
+}
+
+BufferedTile*
+spillTile (
+    TiledOutputFile::Data* ofd, const char pixelData[], int pixelDataSize)
+{
+    //
+    // Append the compressed tile to an anonymous temporary file,
+    // which the system removes when it is closed.
+    //
+
+    if (!ofd->spillFile)
+    {
+        ofd->spillFile = tmpfile ();
+
+        if (!ofd->spillFile)
+            IEX_NAMESPACE::throwErrnoExc (
+                "Cannot create a temporary file for out-of-order tiles (%T).");
+    }
+
+    if (!seekSpillFile (ofd->spillFile, ofd->spillFileSize) ||
+        fwrite (pixelData, 1, pixelDataSize, ofd->spillFile) !=
+            size_t (pixelDataSize))
+    {
+        IEX_NAMESPACE::throwErrnoExc (
+            "Cannot write out-of-order tile to temporary file (%T).");
+    }
+
+    BufferedTile* tile = new BufferedTile (ofd->spillFileSize, pixelDataSize);
+    ofd->spillFileSize += pixelDataSize;
+    return tile;
+}
+
+const char*
+bufferedTileData (TiledOutputFile::Data* ofd, const BufferedTile* tile)
+{
+    if (tile->pixelData) return tile->pixelData;
+
+    if (ofd->spillBuffer.size () < tile->pixelDataSize)
+        ofd->spillBuffer.resizeErase (tile->pixelDataSize);
+
+    if (!seekSpillFile (ofd->spillFile, tile->spillOffset) ||
+        fread (ofd->spillBuffer, 1, tile->pixelDataSize, ofd->spillFile) !=
+            size_t (tile->pixelDataSize))
+    {
+        IEX_NAMESPACE::throwErrnoExc (
+            "Cannot read out-of-order tile from temporary file (%T).");
+    }
+
+    return ofd->spillBuffer;
+}
+
 void
 bufferedTileWrite (
     OutputStreamMutex*     streamData,
@@ -447,13 +576,19 @@ bufferedTileWrite (
     int                    lx,
     int                    ly,
     const char             pixelData[],
-    int                    pixelDataSize)
+    int                    pixelDataSize,
+    const char             constantValue[])
 {
+    TileCoord currentTile = TileCoord (dx, dy, lx, ly);
+
+    int chunk =
+        ofd->constantChunks.enabled () ? tileChunkIndex (ofd, currentTile) : -1;
+
     //
     // Check if a tile with coordinates (dx,dy,lx,ly) has already been written.
     //
 
-    if (ofd->tileOffsets (dx, dy, lx, ly))
+    if (ofd->tileOffsets (dx, dy, lx, ly) || ofd->constantChunks.isSet (chunk))
     {
         THROW (
             IEX_NAMESPACE::ArgExc,
@@ -466,12 +601,17 @@ bufferedTileWrite (
 
     //
     // If tiles can be written in random order, then don't buffer anything.
+    // A constant tile is not stored in the file, only recorded in the
+    // constantChunks attribute.
     //
 
     if (ofd->lineOrder == RANDOM_Y)
     {
-        writeTileData (
-            streamData, ofd, dx, dy, lx, ly, pixelData, pixelDataSize);
+        if (constantValue)
+            ofd->constantChunks.set (chunk, constantValue);
+        else
+            writeTileData (
+                streamData, ofd, dx, dy, lx, ly, pixelData, pixelDataSize);
         return;
     }
 
@@ -480,8 +620,6 @@ bufferedTileWrite (
     // tile with coordinates (dx,dy,lx,ly) has already been buffered.
     //
 
-    TileCoord currentTile = TileCoord (dx, dy, lx, ly);
-
     if (ofd->tileMap.find (currentTile) != ofd->tileMap.end ())
     {
         THROW (
@@ -500,13 +638,27 @@ bufferedTileWrite (
     //
     // Otherwise, buffer the tile so it can be written to file later.
     //
+    // A constant tile is never buffered: its value is recorded right
+    // away, and the tiles after it are written once all tiles before
+    // it have been.
+    //
+
+    if (constantValue) ofd->constantChunks.set (chunk, constantValue);
 
     if (ofd->nextTileToWrite == currentTile)
     {
-        writeTileData (
-            streamData, ofd, dx, dy, lx, ly, pixelData, pixelDataSize);
+        if (!constantValue)
+            writeTileData (
+                streamData, ofd, dx, dy, lx, ly, pixelData, pixelDataSize);
         ofd->nextTileToWrite = ofd->nextTileCoord (ofd->nextTileToWrite);
 
+        //
+        // Skip over the constant tiles that have already been recorded.
+        //
+
+        while (isConstantTile (ofd, ofd->nextTileToWrite))
+            ofd->nextTileToWrite = ofd->nextTileCoord (ofd->nextTileToWrite);
+
         TileMap::iterator i = ofd->tileMap.find (ofd->nextTileToWrite);
 
         //
@@ -527,9 +679,11 @@ bufferedTileWrite (
                 i->first.dy,
                 i->first.lx,
                 i->first.ly,
-                i->second->pixelData,
+                bufferedTileData (ofd, i->second),
                 i->second->pixelDataSize);
 
+            if (i->second->pixelData)
+                ofd->bufferedTileBytes -= i->second->pixelDataSize;
             delete i->second;
             ofd->tileMap.erase (i);
 
@@ -538,18 +692,34 @@ bufferedTileWrite (
             //
 
             ofd->nextTileToWrite = ofd->nextTileCoord (ofd->nextTileToWrite);
-            i                    = ofd->tileMap.find (ofd->nextTileToWrite);
+
+            while (isConstantTile (ofd, ofd->nextTileToWrite))
+                ofd->nextTileToWrite =
+                    ofd->nextTileCoord (ofd->nextTileToWrite);
+
+            i = ofd->tileMap.find (ofd->nextTileToWrite);
         }
     }
-    else
+    else if (!constantValue)
     {
         //
         // Create a new BufferedTile, copy the pixelData into it, and
-        // insert it into the tileMap.
+        // insert it into the tileMap.  Once the buffered tiles reach
+        // the memory limit, further tiles go to the spill file.
         //
 
-        ofd->tileMap[currentTile] =
-            new BufferedTile ((const char*) pixelData, pixelDataSize);
+        if (ofd->maxBufferedTileBytes > 0 &&
+            ofd->bufferedTileBytes + pixelDataSize > ofd->maxBufferedTileBytes)
+        {
+            ofd->tileMap[currentTile] =
+                spillTile (ofd, pixelData, pixelDataSize);
+        }
+        else
+        {
+            ofd->tileMap[currentTile] =
+                new BufferedTile ((const char*) pixelData, pixelDataSize);
+            ofd->bufferedTileBytes += pixelDataSize;
+        }
     }
 }
 
@@ -611,6 +781,52 @@ convertToXdr (
 #endif
 }
 
+bool
+findConstantValue (
+    const TiledOutputFile::Data* ofd,
+    const char                   tileBuffer[],
+    int                          numScanLines,
+    int                          numPixelsPerScanLine,
+    char                         value[])
+{
+    //
+    // Check if all pixels in a tile have the same value.  If they
+    // do, store that value, one Xdr sample per channel, in value[].
+    //
+
+    const char* readPtr = tileBuffer;
+
+    for (int y = 0; y < numScanLines; ++y)
+    {
+        char* valuePtr = value;
+
+        for (unsigned int i = 0; i < ofd->slices.size (); ++i)
+        {
+            int size = pixelTypeSize (ofd->slices[i].type);
+
+            if (y == 0) memcpy (valuePtr, readPtr, size);
+
+            if (!ConstantChunkTable::sameSamples (
+                    readPtr, valuePtr, numPixelsPerScanLine, size))
+                return false;
+
+            readPtr += size_t (numPixelsPerScanLine) * size;
+            valuePtr += size;
+        }
+    }
+
+    if (ofd->format == Compressor::NATIVE)
+    {
+        char*       toPtr   = value;
+        const char* fromPtr = value;
+
+        for (unsigned int i = 0; i < ofd->slices.size (); ++i)
+            convertInPlace (toPtr, fromPtr, ofd->slices[i].type, 1);
+    }
+
+    return true;
+}
+
 //
 // A TileBufferTask encapsulates the task of copying a tile from
 // the user's framebuffer into a LineBuffer and compressing the data
@@ -654,6 +870,7 @@ TileBufferTask::TileBufferTask (
 
     _tileBuffer->wait ();
     _tileBuffer->tileCoord = TileCoord (dx, dy, lx, ly);
+    _tileBuffer->constant  = false;
 }
 
 TileBufferTask::~TileBufferTask ()
@@ -759,6 +976,22 @@ TileBufferTask::execute ()
             }
         }
 
+        //
+        // If the file records constant tiles, and all pixels in this
+        // tile have the same value, the tile is not compressed or
+        // stored in the file.
+        //
+
+        _tileBuffer->constant = _ofd->constantChunks.enabled () &&
+                                findConstantValue (
+                                    _ofd,
+                                    _tileBuffer->buffer,
+                                    numScanLines,
+                                    numPixelsPerScanLine,
+                                    _tileBuffer->constantValue);
+
+        if (_tileBuffer->constant) return;
+
         //
         // Compress the contents of the tileBuffer,
         // and store the compressed data in the output file.
@@ -838,7 +1071,11 @@ TiledOutputFile::TiledOutputFile (
 
         // Write header and empty offset table to the file.
         writeMagicNumberAndVersionField (*_streamData->os, _data->header);
-        _data->previewPosition = _data->header.writeTo (*_streamData->os, true);
+        _data->previewPosition = _data->header.writeTo (
+            *_streamData->os,
+            true,
+            ConstantChunkTable::attributeName (),
+            _data->constantChunksPosition);
         _data->tileOffsetsPosition =
             _data->tileOffsets.writeTo (*_streamData->os);
     }
@@ -885,7 +1122,11 @@ TiledOutputFile::TiledOutputFile (
 
         // Write header and empty offset table to the file.
         writeMagicNumberAndVersionField (*_streamData->os, _data->header);
-        _data->previewPosition = _data->header.writeTo (*_streamData->os, true);
+        _data->previewPosition = _data->header.writeTo (
+            *_streamData->os,
+            true,
+            ConstantChunkTable::attributeName (),
+            _data->constantChunksPosition);
         _data->tileOffsetsPosition =
             _data->tileOffsets.writeTo (*_streamData->os);
     }
@@ -923,8 +1164,9 @@ TiledOutputFile::TiledOutputFile (const OutputPartData* part)
         _data->multipart = part->multipart;
         initialize (part->header);
         _data->partNumber          = part->partNumber;
-        _data->tileOffsetsPosition = part->chunkOffsetTablePosition;
-        _data->previewPosition     = part->previewPosition;
+        _data->tileOffsetsPosition    = part->chunkOffsetTablePosition;
+        _data->previewPosition        = part->previewPosition;
+        _data->constantChunksPosition = part->constantChunksPosition;
     }
     catch (IEX_NAMESPACE::BaseExc& e)
     {
@@ -996,6 +1238,14 @@ TiledOutputFile::initialize (const Header& header)
                                  ? TileCoord (0, 0, 0, 0)
                                  : TileCoord (0, _data->numYTiles[0] - 1, 0, 0);
 
+    //
+    // Size the constantChunks attribute, if requested, before the
+    // header is written.
+    //
+
+    if (ConstantChunkTable::prepare (_data->header))
+        _data->constantChunks = ConstantChunkTable (_data->header);
+
     _data->maxBytesPerTileLine =
         calculateBytesPerPixel (_data->header) * _data->tileDesc.xSize;
 
@@ -1023,6 +1273,10 @@ TiledOutputFile::initialize (const Header& header)
             _data->header));
 
         _data->tileBuffers[i]->buffer.resizeErase (_data->tileBufferSize);
+
+        if (_data->constantChunks.enabled ())
+            _data->tileBuffers[i]->constantValue.resizeErase (
+                _data->constantChunks.bytesPerPixel ());
     }
 
     _data->format = defaultFormat (_data->tileBuffers[0]->compressor);
@@ -1052,6 +1306,13 @@ TiledOutputFile::~TiledOutputFile ()
                     _streamData->os->seekp (_data->tileOffsetsPosition);
                     _data->tileOffsets.writeTo (*_streamData->os);
 
+                    if (_data->constantChunksPosition > 0 &&
+                        _data->constantChunks.enabled ())
+                    {
+                        _data->constantChunks.writeTo (
+                            *_streamData->os, _data->constantChunksPosition);
+                    }
+
                     //
                     // Restore the original position.
                     //
@@ -1299,7 +1560,10 @@ TiledOutputFile::writeTiles (int dx1, int dx2, int dy1, int dy2, int lx, int ly)
                     lx,
                     ly,
                     writeBuffer->dataPtr,
-                    writeBuffer->dataSize);
+                    writeBuffer->dataSize,
+                    writeBuffer->constant
+                        ? (const char*) writeBuffer->constantValue
+                        : 0);
 
                 //
                 // Release the lock on nextWriteBuffer
@@ -1411,6 +1675,30 @@ TiledOutputFile::writeTile (int dx, int dy, int l)
     writeTile (dx, dy, l, l);
 }
 
+void
+TiledOutputFile::setMaxBufferedTileBytes (size_t bytes)
+{
+#if ILMTHREAD_THREADING_ENABLED
+    std::lock_guard<std::mutex> lock (*_streamData);
+#endif
+    _data->maxBufferedTileBytes = bytes;
+}
+
+size_t
+TiledOutputFile::maxBufferedTileBytes () const
+{
+    return _data->maxBufferedTileBytes;
+}
+
+size_t
+TiledOutputFile::bufferedTileBytes () const
+{
+#if ILMTHREAD_THREADING_ENABLED
+    std::lock_guard<std::mutex> lock (*_streamData);
+#endif
+    return _data->bufferedTileBytes;
+}
+
 void
 TiledOutputFile::copyPixels (TiledInputFile& in)
 {
@@ -1499,6 +1787,23 @@ TiledOutputFile::copyPixels (TiledInputFile& in)
                    "failed.  The files have different channel "
                    "lists.");
 
+    //
+    // Constant tiles have no raw pixel data that could be copied.
+    //
+
+    if (hasConstantChunks (inHdr))
+        THROW (
+            IEX_NAMESPACE::ArgExc,
+            "Quick pixel copy from image "
+            "file \""
+                << in.fileName ()
+                << "\" to image "
+                   "file \""
+                << fileName ()
+                << "\" "
+                   "failed.  The input file does not store its "
+                   "constant tiles.");
+
     //
     // Verify that no pixel data have been written to this file yet.
     //
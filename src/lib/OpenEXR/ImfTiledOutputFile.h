@@ -368,6 +368,30 @@ public:
     IMF_EXPORT
     void writeTiles (int dx1, int dx2, int dy1, int dy2, int l = 0);
 
+    //------------------------------------------------------------
+    // Bounding the memory used by out-of-order tiles:
+    //
+    // Unless the line order is RANDOM_Y, tiles written before the
+    // tiles that precede them in the file are held back until they
+    // can be stored in order.  setMaxBufferedTileBytes(n) keeps at
+    // most n bytes of those compressed tiles in memory; tiles beyond
+    // the limit go to a temporary file and are copied into the
+    // output file when their turn comes.  The default of 0 keeps
+    // all held back tiles in memory.
+    //
+    // bufferedTileBytes() returns the number of bytes of held back
+    // tiles currently kept in memory.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    void setMaxBufferedTileBytes (size_t bytes);
+
+    IMF_EXPORT
+    size_t maxBufferedTileBytes () const;
+
+    IMF_EXPORT
+    size_t bufferedTileBytes () const;
+
     //------------------------------------------------------------------
     // Shortcut to copy all pixels from a TiledInputFile into this file,
     // without uncompressing and then recompressing the pixel data.
@@ -160,6 +160,24 @@ TiledOutputPart::writeTiles (int dx1, int dx2, int dy1, int dy2, int l)
     file->writeTiles (dx1, dx2, dy1, dy2, l);
 }
 
+void
+TiledOutputPart::setMaxBufferedTileBytes (size_t bytes)
+{
+    file->setMaxBufferedTileBytes (bytes);
+}
+
+size_t
+TiledOutputPart::maxBufferedTileBytes () const
+{
+    return file->maxBufferedTileBytes ();
+}
+
+size_t
+TiledOutputPart::bufferedTileBytes () const
+{
+    return file->bufferedTileBytes ();
+}
+
 void
 TiledOutputPart::copyPixels (TiledInputFile& in)
 {
@@ -75,6 +75,12 @@ public:
     IMF_EXPORT
     void writeTiles (int dx1, int dx2, int dy1, int dy2, int l = 0);
     IMF_EXPORT
+    void setMaxBufferedTileBytes (size_t bytes);
+    IMF_EXPORT
+    size_t maxBufferedTileBytes () const;
+    IMF_EXPORT
+    size_t bufferedTileBytes () const;
+    IMF_EXPORT
     void copyPixels (TiledInputFile& in);
     IMF_EXPORT
     void copyPixels (InputFile& in);
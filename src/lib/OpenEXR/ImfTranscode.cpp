@@ -0,0 +1,641 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+//-----------------------------------------------------------------------------
+//
+//	transcodeFile
+//
+//-----------------------------------------------------------------------------
+
+#include "ImfTranscode.h"
+
+#include "Iex.h"
+
+#include "IlmThreadPool.h"
+#if ILMTHREAD_THREADING_ENABLED
+#    include "IlmThreadProcessGroup.h"
+#    include "IlmThreadSemaphore.h"
+#endif
+
+#include "ImfContext.h"
+#include "ImfThreading.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
+
+namespace {
+
+void
+check (exr_result_t rv, const char* what)
+{
+    if (rv != EXR_ERR_SUCCESS)
+    {
+        THROW (
+            IEX_NAMESPACE::IoExc,
+            what << ": " << exr_get_error_code_as_string (rv));
+    }
+}
+
+// one chunk of the new file, compressed and ready to be written
+struct OutChunk
+{
+    exr_chunk_info_t  cinfo;
+    std::vector<char> bytes;
+};
+
+//
+// A unit of work: the chunks of the input file that hold the pixels
+// of one or more whole chunks of the new file.  For tiled parts this
+// is always one tile; for scan line parts, the chunks of the input
+// and of the new file may cover a different number of scan lines.
+//
+
+struct Unit
+{
+    int                           part;
+    std::vector<exr_chunk_info_t> in;
+    std::vector<OutChunk>         out;
+    std::string                   error;
+#if ILMTHREAD_THREADING_ENABLED
+    ILMTHREAD_NAMESPACE::Semaphore done;
+#endif
+};
+
+// where a unit starts, a scan line or a tile
+struct UnitStart
+{
+    int part;
+    int y;
+    int tx, ty, lx, ly;
+};
+
+struct PartLayout
+{
+    bool tiled;
+    int  maxY;
+    int  inLines;
+    int  outLines;
+};
+
+struct TranscodeProcess
+{
+    ~TranscodeProcess ()
+    {
+        if (!firstDecode) exr_decoding_destroy (decoder.context, &decoder);
+        if (!firstEncode) releaseEncoder ();
+    }
+
+    void run (exr_const_context_t in, exr_context_t out, Unit& unit);
+
+    void decode (
+        exr_const_context_t in, int pn, const exr_chunk_info_t& cinfo);
+
+    size_t encode (
+        exr_context_t out, int pn, OutChunk& chunk, uint8_t* src, size_t avail);
+
+    void releaseEncoder ();
+
+    bool                  firstDecode = true;
+    bool                  firstEncode = true;
+    exr_decode_pipeline_t decoder;
+    exr_encode_pipeline_t encoder;
+
+    // raw pixels of a unit spanning several chunks of the input
+    std::vector<uint8_t> raw;
+
+    // requirement to use process group
+    TranscodeProcess* next;
+};
+
+void
+TranscodeProcess::run (exr_const_context_t in, exr_context_t out, Unit& unit)
+{
+    uint8_t* src;
+    size_t   size;
+
+    if (unit.in.size () == 1)
+    {
+        decode (in, unit.part, unit.in[0]);
+        src  = static_cast<uint8_t*> (decoder.unpacked_buffer);
+        size = decoder.chunk.unpacked_size;
+    }
+    else
+    {
+        raw.clear ();
+        for (const exr_chunk_info_t& cinfo: unit.in)
+        {
+            decode (in, unit.part, cinfo);
+
+            const uint8_t* b = static_cast<uint8_t*> (decoder.unpacked_buffer);
+            raw.insert (raw.end (), b, b + decoder.chunk.unpacked_size);
+        }
+        src  = raw.data ();
+        size = raw.size ();
+    }
+
+    //
+    // the raw layout of a chunk is its scan lines one after another,
+    // so the chunks of the new file are consecutive pieces of the
+    // raw pixels of the unit
+    //
+
+    for (OutChunk& chunk: unit.out)
+    {
+        size_t n = encode (out, unit.part, chunk, src, size);
+        src += n;
+        size -= n;
+    }
+
+    if (size != 0)
+        throw IEX_NAMESPACE::IoExc (
+            "Size mismatch between the chunks of the input and output files");
+}
+
+void
+TranscodeProcess::decode (
+    exr_const_context_t in, int pn, const exr_chunk_info_t& cinfo)
+{
+    if (!firstDecode && (decoder.context != in || decoder.part_index != pn))
+    {
+        exr_decoding_destroy (decoder.context, &decoder);
+        firstDecode = true;
+    }
+
+    if (firstDecode)
+    {
+        check (
+            exr_decoding_initialize (in, pn, &cinfo, &decoder),
+            "Unable to initialize decode pipeline");
+        firstDecode = false;
+
+        check (
+            exr_decoding_choose_default_routines (in, pn, &decoder),
+            "Unable to choose decoder routines");
+
+        // only decompress, keeping the on-disk pixel layout
+        decoder.unpack_and_convert_fn = nullptr;
+    }
+    else
+    {
+        check (
+            exr_decoding_update (in, pn, &cinfo, &decoder),
+            "Unable to update decode pipeline");
+    }
+
+    check (exr_decoding_run (in, pn, &decoder), "Unable to decompress chunk");
+}
+
+size_t
+TranscodeProcess::encode (
+    exr_context_t out, int pn, OutChunk& chunk, uint8_t* src, size_t avail)
+{
+    if (!firstEncode && (encoder.context != out || encoder.part_index != pn))
+        releaseEncoder ();
+
+    if (firstEncode)
+    {
+        check (
+            exr_encoding_initialize (out, pn, &chunk.cinfo, &encoder),
+            "Unable to initialize encode pipeline");
+        firstEncode = false;
+
+        check (
+            exr_encoding_choose_default_routines (out, pn, &encoder),
+            "Unable to choose encoder routines");
+
+        // the data is already packed, and the caller writes the
+        // chunks in order once they are compressed
+        encoder.convert_and_pack_fn  = nullptr;
+        encoder.yield_until_ready_fn = nullptr;
+        encoder.write_fn             = nullptr;
+    }
+    else
+    {
+        check (
+            exr_encoding_update (out, pn, &chunk.cinfo, &encoder),
+            "Unable to update encode pipeline");
+    }
+
+    uint64_t packed = 0;
+    for (int c = 0; c < encoder.channel_count; ++c)
+    {
+        const exr_coding_channel_info_t& ch = encoder.channels[c];
+        packed += static_cast<uint64_t> (ch.height) *
+                  static_cast<uint64_t> (ch.width) *
+                  static_cast<uint64_t> (ch.bytes_per_element);
+    }
+
+    if (packed > avail)
+        throw IEX_NAMESPACE::IoExc (
+            "Size mismatch between the chunks of the input and output files");
+
+    chunk.bytes.clear ();
+    if (packed == 0) return 0;
+
+    // borrowed, an allocation size of 0 keeps the pipeline from
+    // freeing it
+    encoder.packed_buffer     = src;
+    encoder.packed_bytes      = packed;
+    encoder.packed_alloc_size = 0;
+
+    exr_result_t rv = exr_encoding_run (out, pn, &encoder);
+    if (rv == EXR_ERR_SUCCESS)
+    {
+        const char* c = static_cast<const char*> (encoder.compressed_buffer);
+        chunk.bytes.assign (c, c + encoder.compressed_bytes);
+    }
+
+    if (encoder.compressed_buffer == encoder.packed_buffer)
+    {
+        encoder.compressed_buffer     = nullptr;
+        encoder.compressed_alloc_size = 0;
+    }
+    encoder.packed_buffer = nullptr;
+
+    check (rv, "Unable to compress chunk");
+    return static_cast<size_t> (packed);
+}
+
+void
+TranscodeProcess::releaseEncoder ()
+{
+    encoder.packed_buffer     = nullptr;
+    encoder.packed_alloc_size = 0;
+    exr_encoding_destroy (encoder.context, &encoder);
+    firstEncode = true;
+}
+
+void
+fillUnit (
+    exr_const_context_t in,
+    exr_context_t       out,
+    const PartLayout&   layout,
+    const UnitStart&    start,
+    Unit&               unit)
+{
+    unit.part = start.part;
+
+    if (layout.tiled)
+    {
+        exr_chunk_info_t cinfo;
+
+        check (
+            exr_read_tile_chunk_info (
+                in, start.part, start.tx, start.ty, start.lx, start.ly, &cinfo),
+            "Unable to query tile");
+        unit.in.push_back (cinfo);
+
+        unit.out.resize (1);
+        check (
+            exr_write_tile_chunk_info (
+                out,
+                start.part,
+                start.tx,
+                start.ty,
+                start.lx,
+                start.ly,
+                &unit.out[0].cinfo),
+            "Unable to query tile");
+        return;
+    }
+
+    int lastY = std::min (
+        layout.maxY,
+        start.y + std::max (layout.inLines, layout.outLines) - 1);
+
+    for (int y = start.y; y <= lastY; y += layout.inLines)
+    {
+        exr_chunk_info_t cinfo;
+
+        check (
+            exr_read_scanline_chunk_info (in, start.part, y, &cinfo),
+            "Unable to query scan line chunk");
+        unit.in.push_back (cinfo);
+    }
+
+    for (int y = start.y; y <= lastY; y += layout.outLines)
+    {
+        unit.out.emplace_back ();
+        check (
+            exr_write_scanline_chunk_info (
+                out, start.part, y, &unit.out.back ().cinfo),
+            "Unable to query scan line chunk");
+    }
+}
+
+void
+writeUnit (exr_context_t out, Unit& unit)
+{
+    if (!unit.error.empty ()) throw IEX_NAMESPACE::IoExc (unit.error);
+
+    for (OutChunk& chunk: unit.out)
+    {
+        const exr_chunk_info_t& c = chunk.cinfo;
+
+        if (c.type == EXR_STORAGE_TILED)
+        {
+            check (
+                exr_write_tile_chunk (
+                    out,
+                    unit.part,
+                    c.start_x,
+                    c.start_y,
+                    c.level_x,
+                    c.level_y,
+                    chunk.bytes.data (),
+                    chunk.bytes.size ()),
+                "Unable to write tile");
+        }
+        else
+        {
+            check (
+                exr_write_scanline_chunk (
+                    out,
+                    unit.part,
+                    c.start_y,
+                    chunk.bytes.data (),
+                    chunk.bytes.size ()),
+                "Unable to write scan line chunk");
+        }
+
+        std::vector<char> ().swap (chunk.bytes);
+    }
+}
+
+//
+// The units of a part, in the order in which the chunks must be
+// written: by increasing scan line, or for tiles by level, then by
+// row and column of tiles.
+//
+
+void
+planPart (
+    exr_const_context_t     in,
+    int                     pn,
+    const PartLayout&       layout,
+    std::vector<UnitStart>& starts)
+{
+    if (!layout.tiled)
+    {
+        exr_attr_box2i_t dw;
+        check (exr_get_data_window (in, pn, &dw), "Unable to query part");
+
+        int unitLines = std::max (layout.inLines, layout.outLines);
+        for (int y = dw.min.y; y <= dw.max.y; y += unitLines)
+            starts.push_back ({pn, y, 0, 0, 0, 0});
+        return;
+    }
+
+    int32_t               levelsX, levelsY;
+    exr_tile_level_mode_t mode;
+
+    check (
+        exr_get_tile_levels (in, pn, &levelsX, &levelsY),
+        "Unable to query tile levels");
+    check (
+        exr_get_tile_descriptor (in, pn, nullptr, nullptr, &mode, nullptr),
+        "Unable to query tile description");
+
+    for (int ly = 0; ly < levelsY; ++ly)
+    {
+        for (int lx = 0; lx < levelsX; ++lx)
+        {
+            if (mode != EXR_TILE_RIPMAP_LEVELS && lx != ly) continue;
+
+            int32_t countX, countY;
+            check (
+                exr_get_tile_counts (in, pn, lx, ly, &countX, &countY),
+                "Unable to query tile counts");
+
+            for (int ty = 0; ty < countY; ++ty)
+                for (int tx = 0; tx < countX; ++tx)
+                    starts.push_back ({pn, 0, tx, ty, lx, ly});
+        }
+    }
+}
+
+#if ILMTHREAD_THREADING_ENABLED
+using TranscodeProcessGroup =
+    ILMTHREAD_NAMESPACE::ProcessGroup<TranscodeProcess>;
+
+class TranscodeTask final : public ILMTHREAD_NAMESPACE::Task
+{
+public:
+    TranscodeTask (
+        ILMTHREAD_NAMESPACE::TaskGroup* group,
+        TranscodeProcessGroup*          pg,
+        exr_const_context_t             in,
+        exr_context_t                   out,
+        Unit*                           unit)
+        : Task (group)
+        , _pg (pg)
+        , _process (pg->pop ())
+        , _in (in)
+        , _out (out)
+        , _unit (unit)
+    {}
+
+    ~TranscodeTask () override { _pg->push (_process); }
+
+    void execute () override
+    {
+        try
+        {
+            _process->run (_in, _out, *_unit);
+        }
+        catch (std::exception& e)
+        {
+            _unit->error = e.what ();
+        }
+        catch (...)
+        {
+            _unit->error = "Unknown exception";
+        }
+
+        _unit->done.post ();
+    }
+
+private:
+    TranscodeProcessGroup* _pg;
+    TranscodeProcess*      _process;
+    exr_const_context_t    _in;
+    exr_context_t          _out;
+    Unit*                  _unit;
+};
+#endif
+
+} // namespace
+
+TranscodeSettings::TranscodeSettings ()
+    : compression (ZIP_COMPRESSION)
+    , zipCompressionLevel (-1)
+    , dwaCompressionLevel (-1.f)
+    , numThreads (globalThreadCount ())
+    , window (0)
+{}
+
+void
+transcodeFile (
+    const char               inFileName[],
+    const char               outFileName[],
+    const TranscodeSettings& settings)
+{
+    if (settings.compression < NO_COMPRESSION ||
+        settings.compression >= NUM_COMPRESSION_METHODS)
+        throw IEX_NAMESPACE::ArgExc ("Invalid compression for transcoding");
+
+    Context in (
+        inFileName,
+        ContextInitializer ()
+        .silentHeaderParse (true)
+        .strictHeaderValidation (false),
+        Context::read_mode_t{});
+
+    for (int p = 0; p < in.partCount (); ++p)
+    {
+        exr_storage_t s = in.storage (p);
+        if (s != EXR_STORAGE_SCANLINE && s != EXR_STORAGE_TILED)
+        {
+            THROW (
+                IEX_NAMESPACE::ArgExc,
+                "Cannot transcode \"" << inFileName << "\": part " << p
+                                      << " is not a flat image");
+        }
+    }
+
+    //
+    // the new file has the same parts and attributes as the input,
+    // except for the compression
+    //
+
+    Context out (outFileName, ContextInitializer (), Context::write_mode_t{});
+
+    for (int p = 0; p < in.partCount (); ++p)
+    {
+        const char* name = nullptr;
+        int         idx;
+
+        if (EXR_ERR_SUCCESS != exr_get_name (in, p, &name)) name = nullptr;
+
+        check (
+            exr_add_part (out, name, in.storage (p), &idx),
+            "Unable to add part");
+        check (
+            exr_set_compression (
+                out, idx, static_cast<exr_compression_t> (settings.compression)),
+            "Unable to set compression");
+        check (
+            exr_copy_unset_attributes (out, idx, in, p),
+            "Unable to copy attributes");
+
+        if (settings.zipCompressionLevel >= 0)
+        {
+            check (
+                exr_set_zip_compression_level (
+                    out, idx, settings.zipCompressionLevel),
+                "Unable to set zip compression level");
+        }
+        if (settings.dwaCompressionLevel >= 0.f)
+        {
+            check (
+                exr_set_dwa_compression_level (
+                    out, idx, settings.dwaCompressionLevel),
+                "Unable to set dwa compression level");
+        }
+    }
+
+    check (exr_write_header (out), "Unable to write header");
+
+    std::vector<PartLayout> layouts (in.partCount ());
+    std::vector<UnitStart>  starts;
+
+    for (int p = 0; p < in.partCount (); ++p)
+    {
+        PartLayout& l = layouts[p];
+
+        l.tiled    = in.storage (p) == EXR_STORAGE_TILED;
+        l.maxY     = in.dataWindow (p).max.y;
+        l.inLines  = 1;
+        l.outLines = 1;
+
+        if (!l.tiled)
+        {
+            check (
+                exr_get_scanlines_per_chunk (in, p, &l.inLines),
+                "Unable to query scan lines per chunk");
+            check (
+                exr_get_scanlines_per_chunk (out, p, &l.outLines),
+                "Unable to query scan lines per chunk");
+        }
+
+        planPart (in, p, l, starts);
+    }
+
+#if ILMTHREAD_THREADING_ENABLED
+    if (settings.numThreads > 0 && starts.size () > 1)
+    {
+        size_t window = settings.window > 0
+                            ? static_cast<size_t> (settings.window)
+                            : static_cast<size_t> (4 * settings.numThreads);
+
+        //
+        // units are transcoded in any order, but written in order:
+        // the oldest unit is written as soon as it is done, and no
+        // more than the window of units is held at once
+        //
+
+        std::deque<std::unique_ptr<Unit>> pending;
+        TranscodeProcessGroup             pg (settings.numThreads);
+        ILMTHREAD_NAMESPACE::TaskGroup    tg;
+        size_t                            next = 0;
+
+        for (;;)
+        {
+            while (!pending.empty () && pending.front ()->done.tryWait ())
+            {
+                writeUnit (out, *pending.front ());
+                pending.pop_front ();
+            }
+
+            if (next < starts.size () && pending.size () < window)
+            {
+                const UnitStart& s = starts[next++];
+
+                pending.push_back (std::make_unique<Unit> ());
+                fillUnit (in, out, layouts[s.part], s, *pending.back ());
+
+                ILMTHREAD_NAMESPACE::ThreadPool::addGlobalTask (
+                    new TranscodeTask (&tg, &pg, in, out, pending.back ().get ()));
+                continue;
+            }
+
+            if (pending.empty ()) break;
+
+            pending.front ()->done.wait ();
+            writeUnit (out, *pending.front ());
+            pending.pop_front ();
+        }
+        return;
+    }
+#endif
+
+    TranscodeProcess tp;
+
+    for (const UnitStart& s: starts)
+    {
+        Unit unit;
+
+        fillUnit (in, out, layouts[s.part], s, unit);
+        tp.run (in, out, unit);
+        writeUnit (out, unit);
+    }
+}
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_EXIT
@@ -0,0 +1,75 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifndef INCLUDED_IMF_TRANSCODE_H
+#define INCLUDED_IMF_TRANSCODE_H
+
+//-----------------------------------------------------------------------------
+//
+//	transcodeFile
+//
+//	Copies an image file, changing the compression of all its parts.
+//	The pixels are not converted: each chunk is decompressed to its
+//	raw on-disk layout and compressed again, so transcoding is
+//	lossless unless the new compression is lossy.
+//
+//	Chunks are transcoded independently on the global thread pool
+//	(see setGlobalThreadCount()), and written to the new file in
+//	chunk order as they complete.  Only a window of chunks is kept
+//	in memory at any time, regardless of the size of the image.
+//
+//	Deep parts are not supported.
+//
+//-----------------------------------------------------------------------------
+
+#include "ImfExport.h"
+#include "ImfNamespace.h"
+
+#include "ImfCompression.h"
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_ENTER
+
+struct IMF_EXPORT_TYPE TranscodeSettings
+{
+    //------------------------------------------------------------
+    // compression           the compression of the new file
+    // zipCompressionLevel   zip level for ZIP and ZIPS compression,
+    //                       less than 0 for the library default
+    // dwaCompressionLevel   quality for DWAA and DWAB compression,
+    //                       less than 0 for the library default
+    // numThreads            threads used for transcoding; with 0,
+    //                       all work is done in the calling thread
+    // window                the maximum number of work units held
+    //                       in memory; a unit is one tile, or the
+    //                       scan lines of one chunk of the input or
+    //                       output, whichever is taller.  0 picks a
+    //                       window of a few units per thread.
+    //------------------------------------------------------------
+
+    IMF_EXPORT
+    TranscodeSettings ();
+
+    Compression compression;
+    int         zipCompressionLevel;
+    float       dwaCompressionLevel;
+    int         numThreads;
+    int         window;
+};
+
+//
+// Transcode inFileName to outFileName.  Throws an IEX_NAMESPACE::ArgExc
+// if the input file has deep parts, or an IEX_NAMESPACE::IoExc if a
+// chunk cannot be read or written.
+//
+
+IMF_EXPORT
+void transcodeFile (
+    const char               inFileName[],
+    const char               outFileName[],
+    const TranscodeSettings& settings = TranscodeSettings ());
+
+OPENEXR_IMF_INTERNAL_NAMESPACE_HEADER_EXIT
+
+#endif // INCLUDED_IMF_TRANSCODE_H
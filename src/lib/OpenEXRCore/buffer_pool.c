@@ -0,0 +1,358 @@
+/*
+** SPDX-License-Identifier: BSD-3-Clause
+** Copyright Contributors to the OpenEXR Project.
+*/
+
+#include "openexr_config.h"
+#include "internal_memory.h"
+
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+#        include <windows.h>
+#        include <synchapi.h>
+#    else
+#        include <pthread.h>
+#    endif
+#endif
+
+#if defined(__linux__)
+#    include <sys/mman.h>
+#endif
+
+#include <string.h>
+
+/**************************************/
+
+/* size classes are 256 bytes, then four classes per power of two up
+ * to 1 GiB: 320, 384, 448, 512, 640, ... Anything larger is never
+ * cached */
+#define POOL_MIN_SHIFT 8
+#define POOL_MAX_SHIFT 30
+#define POOL_CLASSES_PER_SHIFT 4
+#define POOL_NUM_CLASSES                                                       \
+    (1 + (POOL_MAX_SHIFT - POOL_MIN_SHIFT) * POOL_CLASSES_PER_SHIFT)
+
+/* all pooled buffers start on a cache line, the pointer actually
+ * returned by the allocator is stored in the word before */
+#define POOL_ALIGN 64
+#define POOL_HEADER (POOL_ALIGN + sizeof (void*))
+
+/* transparent huge page size on x86-64 and most aarch64 kernels */
+#define POOL_HUGE_PAGE ((size_t) 2 * 1024 * 1024)
+
+struct _exr_buffer_pool
+{
+    exr_memory_allocation_func_t alloc_fn;
+    exr_memory_free_func_t       free_fn;
+
+    size_t max_cached;
+    size_t cached;
+    int    refcount;
+    int    huge_pages;
+
+    /* free buffers of each class, linked through their first word */
+    void* free_lists[POOL_NUM_CLASSES];
+
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#    else
+    pthread_mutex_t mutex;
+#    endif
+#endif
+};
+
+/**************************************/
+
+static inline void
+pool_lock (exr_buffer_pool_t pool)
+{
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    EnterCriticalSection (&pool->mutex);
+#    else
+    pthread_mutex_lock (&pool->mutex);
+#    endif
+#else
+    (void) pool;
+#endif
+}
+
+static inline void
+pool_unlock (exr_buffer_pool_t pool)
+{
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    LeaveCriticalSection (&pool->mutex);
+#    else
+    pthread_mutex_unlock (&pool->mutex);
+#    endif
+#else
+    (void) pool;
+#endif
+}
+
+/**************************************/
+
+static int
+size_class (size_t bytes, size_t* classsz)
+{
+    size_t v, step, q;
+    int    k;
+
+    if (bytes <= ((size_t) 1 << POOL_MIN_SHIFT))
+    {
+        *classsz = (size_t) 1 << POOL_MIN_SHIFT;
+        return 0;
+    }
+    if (bytes > ((size_t) 1 << POOL_MAX_SHIFT)) return -1;
+
+    /* bytes is in (2^k, 2^(k+1)], split in four steps of 2^(k-2) */
+    v = bytes - 1;
+    k = POOL_MIN_SHIFT;
+    while (v >> (k + 1))
+        ++k;
+
+    step     = (size_t) 1 << (k - 2);
+    q        = v / step + 1;
+    *classsz = q * step;
+    return 1 + (k - POOL_MIN_SHIFT) * POOL_CLASSES_PER_SHIFT + (int) (q - 5);
+}
+
+/**************************************/
+
+static void*
+pool_sys_alloc (exr_buffer_pool_t pool, size_t bytes, int huge_pages)
+{
+    uint8_t*  orig;
+    uint8_t*  ret;
+    uintptr_t off;
+
+    if (bytes > SIZE_MAX - POOL_HEADER) return NULL;
+
+    orig = (uint8_t*) pool->alloc_fn (bytes + POOL_HEADER);
+    if (!orig) return NULL;
+
+    off = ((uintptr_t) orig) + sizeof (void*);
+    off = (POOL_ALIGN - (off & (POOL_ALIGN - 1))) & (POOL_ALIGN - 1);
+    ret = orig + sizeof (void*) + off;
+    ((void**) ret)[-1] = orig;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    /* only the huge pages entirely inside the buffer can be backed
+     * by one, failure just leaves regular pages */
+    if (huge_pages && bytes >= POOL_HUGE_PAGE)
+    {
+        uintptr_t b = ((uintptr_t) ret + POOL_HUGE_PAGE - 1) &
+                      ~(POOL_HUGE_PAGE - 1);
+        uintptr_t e = ((uintptr_t) ret + bytes) & ~(POOL_HUGE_PAGE - 1);
+        if (e > b) madvise ((void*) b, e - b, MADV_HUGEPAGE);
+    }
+#else
+    (void) huge_pages;
+#endif
+    return ret;
+}
+
+static inline void
+pool_sys_free (exr_buffer_pool_t pool, void* ptr)
+{
+    pool->free_fn (((void**) ptr)[-1]);
+}
+
+/**************************************/
+
+static void
+pool_trim (exr_buffer_pool_t pool)
+{
+    void* lists[POOL_NUM_CLASSES];
+
+    pool_lock (pool);
+    memcpy (lists, pool->free_lists, sizeof (lists));
+    memset (pool->free_lists, 0, sizeof (pool->free_lists));
+    pool->cached = 0;
+    pool_unlock (pool);
+
+    for (int c = 0; c < POOL_NUM_CLASSES; ++c)
+    {
+        void* cur = lists[c];
+        while (cur)
+        {
+            void* next = *((void**) cur);
+            pool_sys_free (pool, cur);
+            cur = next;
+        }
+    }
+}
+
+/**************************************/
+
+exr_result_t
+exr_buffer_pool_create (
+    exr_buffer_pool_t*           pool,
+    size_t                       max_cached_bytes,
+    exr_memory_allocation_func_t alloc_fn,
+    exr_memory_free_func_t       free_fn)
+{
+    exr_buffer_pool_t ret;
+
+    if (!pool) return EXR_ERR_INVALID_ARGUMENT;
+    *pool = NULL;
+
+    if (!alloc_fn || !free_fn)
+    {
+        alloc_fn = &internal_exr_alloc;
+        free_fn  = &internal_exr_free;
+    }
+
+    ret = (exr_buffer_pool_t) alloc_fn (sizeof (struct _exr_buffer_pool));
+    if (!ret) return EXR_ERR_OUT_OF_MEMORY;
+
+    memset (ret, 0, sizeof (struct _exr_buffer_pool));
+    ret->alloc_fn   = alloc_fn;
+    ret->free_fn    = free_fn;
+    ret->max_cached = max_cached_bytes;
+    ret->refcount   = 1;
+
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    InitializeCriticalSection (&(ret->mutex));
+#    else
+    if (pthread_mutex_init (&(ret->mutex), NULL) != 0)
+    {
+        free_fn (ret);
+        return EXR_ERR_OUT_OF_MEMORY;
+    }
+#    endif
+#endif
+
+    *pool = ret;
+    return EXR_ERR_SUCCESS;
+}
+
+/**************************************/
+
+void
+exr_buffer_pool_release (exr_buffer_pool_t pool)
+{
+    int refs;
+
+    if (!pool) return;
+
+    pool_lock (pool);
+    refs = --(pool->refcount);
+    pool_unlock (pool);
+
+    if (refs > 0) return;
+
+    pool_trim (pool);
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    DeleteCriticalSection (&(pool->mutex));
+#    else
+    pthread_mutex_destroy (&(pool->mutex));
+#    endif
+#endif
+    pool->free_fn (pool);
+}
+
+/**************************************/
+
+void
+exr_buffer_pool_trim (exr_buffer_pool_t pool)
+{
+    if (pool) pool_trim (pool);
+}
+
+/**************************************/
+
+exr_result_t
+exr_buffer_pool_set_huge_pages (exr_buffer_pool_t pool, int enable)
+{
+    if (!pool) return EXR_ERR_INVALID_ARGUMENT;
+
+    pool_lock (pool);
+    pool->huge_pages = enable ? 1 : 0;
+    pool_unlock (pool);
+    return EXR_ERR_SUCCESS;
+}
+
+/**************************************/
+
+exr_result_t
+exr_buffer_pool_get_cached_size (exr_buffer_pool_t pool, size_t* bytes)
+{
+    if (!pool || !bytes) return EXR_ERR_INVALID_ARGUMENT;
+
+    pool_lock (pool);
+    *bytes = pool->cached;
+    pool_unlock (pool);
+    return EXR_ERR_SUCCESS;
+}
+
+/**************************************/
+
+void
+internal_exr_pool_retain (exr_buffer_pool_t pool)
+{
+    pool_lock (pool);
+    ++(pool->refcount);
+    pool_unlock (pool);
+}
+
+/**************************************/
+
+void*
+internal_exr_pool_alloc (exr_buffer_pool_t pool, size_t bytes, size_t* allocsz)
+{
+    void*  ret = NULL;
+    size_t classsz;
+    int    huge_pages;
+    int    c = size_class (bytes, &classsz);
+
+    if (c < 0) classsz = bytes;
+
+    pool_lock (pool);
+    huge_pages = pool->huge_pages;
+    if (c >= 0)
+    {
+        ret = pool->free_lists[c];
+        if (ret)
+        {
+            pool->free_lists[c] = *((void**) ret);
+            pool->cached -= classsz;
+        }
+    }
+    pool_unlock (pool);
+
+    if (!ret) ret = pool_sys_alloc (pool, classsz, huge_pages);
+    if (ret) *allocsz = classsz;
+    return ret;
+}
+
+/**************************************/
+
+void
+internal_exr_pool_free (exr_buffer_pool_t pool, void* ptr, size_t allocsz)
+{
+    size_t classsz;
+    int    c;
+
+    if (!ptr) return;
+
+    c = size_class (allocsz, &classsz);
+    if (c >= 0 && classsz == allocsz)
+    {
+        pool_lock (pool);
+        if (pool->cached + classsz <= pool->max_cached)
+        {
+            *((void**) ptr)     = pool->free_lists[c];
+            pool->free_lists[c] = ptr;
+            pool->cached += classsz;
+            ptr = NULL;
+        }
+        pool_unlock (pool);
+    }
+
+    if (ptr) pool_sys_free (pool, ptr);
+}
@@ -5,6 +5,7 @@
 
 #include "openexr_chunkio.h"
 
+#include "internal_attr.h"
 #include "internal_coding.h"
 #include "internal_structs.h"
 #include "internal_util.h"
@@ -24,6 +25,63 @@ exr_result_t extract_chunk_table (
 
 /**************************************/
 
+const uint8_t*
+internal_exr_constant_chunk (
+    exr_const_context_t ctxt, exr_const_priv_part_t part, int cidx)
+{
+    exr_attribute_t*         attr = NULL;
+    const exr_attr_chlist_t* chanlist;
+    const uint8_t*           data;
+    uint32_t                 count, bpp;
+    int32_t                  expbpp = 0;
+    uint64_t                 mapbytes, expsize;
+
+    if (part->storage_mode != EXR_STORAGE_SCANLINE &&
+        part->storage_mode != EXR_STORAGE_TILED)
+        return NULL;
+
+    if (cidx < 0 || cidx >= part->chunk_count || !part->channels) return NULL;
+
+    if (EXR_ERR_SUCCESS != exr_attr_list_find_by_name (
+                               ctxt,
+                               EXR_CONST_CAST (
+                                   exr_attribute_list_t*, &(part->attributes)),
+                               EXR_CONSTANT_CHUNKS_ATTR_NAME,
+                               &attr))
+        return NULL;
+
+    if (attr->type != EXR_ATTR_OPAQUE || !attr->opaque ||
+        !attr->opaque->packed_data ||
+        0 != strcmp (attr->type_name, EXR_CONSTANT_CHUNKS_TYPE_NAME))
+        return NULL;
+
+    chanlist = part->channels->chlist;
+    for (int c = 0; c < chanlist->num_channels; ++c)
+        expbpp += (chanlist->entries[c].pixel_type == EXR_PIXEL_HALF) ? 2 : 4;
+
+    /* an attribute that does not match the part is ignored, the
+     * chunks then read as missing */
+    data = (const uint8_t*) attr->opaque->packed_data;
+    if (attr->opaque->size < 8) return NULL;
+    memcpy (&count, data, sizeof (uint32_t));
+    memcpy (&bpp, data + 4, sizeof (uint32_t));
+    count = one_to_native32 (count);
+    bpp   = one_to_native32 (bpp);
+    if (count != (uint32_t) part->chunk_count || bpp != (uint32_t) expbpp)
+        return NULL;
+
+    mapbytes = ((uint64_t) count + 7) / 8;
+    expsize  = 8 + mapbytes + (uint64_t) count * (uint64_t) bpp;
+    if ((uint64_t) attr->opaque->size != expsize) return NULL;
+
+    data += 8;
+    if ((data[cidx / 8] & (1 << (cidx % 8))) == 0) return NULL;
+
+    return data + mapbytes + (uint64_t) cidx * (uint64_t) bpp;
+}
+
+/**************************************/
+
 static exr_result_t
 validate_and_compute_tile_chunk_off (
     exr_const_context_t   ctxt,
@@ -584,7 +642,10 @@ extract_chunk_table (
             for (int ci = 0; ci < part->chunk_count; ++ci)
             {
                 uint64_t cchunk = one_to_native64 (ctable[ci]);
-                if (cchunk < chunkoff || cchunk >= maxoff) complete = 0;
+                if ((cchunk < chunkoff || cchunk >= maxoff) &&
+                    !(cchunk == 0 &&
+                      internal_exr_constant_chunk (ctxt, part, ci)))
+                    complete = 0;
                 ctable[ci] = cchunk;
             }
 
@@ -933,7 +994,20 @@ exr_read_scanline_chunk_info (
 
     /* known behavior for partial files */
     if (dataoff == 0)
+    {
+        if (part->storage_mode == EXR_STORAGE_SCANLINE &&
+            internal_exr_constant_chunk (ctxt, part, cidx))
+        {
+            cinfo->data_offset              = 0;
+            cinfo->packed_size              = 0;
+            cinfo->unpacked_size            = compute_chunk_unpack_size (
+                dw.min.x, miny, cinfo->width, cinfo->height, lpc, part);
+            cinfo->sample_count_data_offset = 0;
+            cinfo->sample_count_table_size  = 0;
+            return EXR_ERR_SUCCESS;
+        }
         return EXR_ERR_INCOMPLETE_CHUNK_TABLE;
+    }
 
     if (dataoff < chunkmin || (fsize > 0 && dataoff > (uint64_t) fsize))
     {
@@ -1230,7 +1304,19 @@ exr_read_tile_chunk_info (
 
     /* known behavior for partial files */
     if (dataoff == 0)
+    {
+        if (part->storage_mode == EXR_STORAGE_TILED &&
+            internal_exr_constant_chunk (ctxt, part, cidx))
+        {
+            cinfo->data_offset              = 0;
+            cinfo->packed_size              = 0;
+            cinfo->unpacked_size            = unpacksize;
+            cinfo->sample_count_data_offset = 0;
+            cinfo->sample_count_table_size  = 0;
+            return EXR_ERR_SUCCESS;
+        }
         return EXR_ERR_INCOMPLETE_CHUNK_TABLE;
+    }
 
     if (dataoff < chunkmin || (fsize > 0 && dataoff > (uint64_t) fsize))
     {
@@ -1824,6 +1910,9 @@ write_scan_chunk (
                 &chunkoff);
             /* just in case we look at it again? */
             priv_to_native64 (ctable, part->chunk_count);
+
+            if (rv == EXR_ERR_SUCCESS && part->chunk_stats_offset > 0)
+                rv = internal_exr_write_chunk_stats (ctxt, part);
         }
         else { ctxt->last_output_chunk = cidx; }
     }
@@ -2244,6 +2333,9 @@ write_tile_chunk (
                 &chunkoff);
             /* just in case we look at it again? */
             priv_to_native64 (ctable, part->chunk_count);
+
+            if (rv == EXR_ERR_SUCCESS && part->chunk_stats_offset > 0)
+                rv = internal_exr_write_chunk_stats (ctxt, part);
         }
         else { ctxt->last_output_chunk = cidx; }
     }
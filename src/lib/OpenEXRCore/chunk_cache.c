@@ -0,0 +1,415 @@
+/*
+** SPDX-License-Identifier: BSD-3-Clause
+** Copyright Contributors to the OpenEXR Project.
+*/
+
+#include "internal_chunk_cache.h"
+
+#include "internal_memory.h"
+
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+#        include <windows.h>
+#        include <synchapi.h>
+#    else
+#        include <pthread.h>
+#    endif
+#endif
+
+#include <string.h>
+
+/**************************************/
+
+typedef struct _cache_entry
+{
+    struct _cache_entry* hash_next;
+    struct _cache_entry* lru_prev;
+    struct _cache_entry* lru_next;
+
+    uint64_t hash;
+    uint64_t file_id[4];
+    uint64_t data_offset;
+    uint64_t packed_size;
+    uint64_t unpacked_size;
+    int32_t  part_index;
+    int32_t  chunk_index;
+
+    /* unpacked_size bytes of decompressed data follow */
+} cache_entry_t;
+
+#define ENTRY_DATA(e) ((uint8_t*) ((e) + 1))
+#define ENTRY_COST(e) (sizeof (cache_entry_t) + (size_t) (e)->unpacked_size)
+
+/* the whole cache is under one lock, hits are a hash lookup and a
+ * memcpy so there is little to gain from finer locking */
+static struct
+{
+    size_t limit;
+    size_t used;
+
+    cache_entry_t** buckets;
+    size_t          bucket_count;
+    size_t          entry_count;
+
+    /* most recently used at the head */
+    cache_entry_t* lru_head;
+    cache_entry_t* lru_tail;
+} s_cache;
+
+/* a copy of s_cache.limit that is read without the lock, so that
+ * decoding does not touch the lock at all while the cache is off */
+static atomic_uint_least64_t s_cache_limit;
+
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+static SRWLOCK s_cache_lock = SRWLOCK_INIT;
+#    else
+static pthread_mutex_t s_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#    endif
+#endif
+
+static inline void
+cache_lock (void)
+{
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    AcquireSRWLockExclusive (&s_cache_lock);
+#    else
+    pthread_mutex_lock (&s_cache_lock);
+#    endif
+#endif
+}
+
+static inline void
+cache_unlock (void)
+{
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    ReleaseSRWLockExclusive (&s_cache_lock);
+#    else
+    pthread_mutex_unlock (&s_cache_lock);
+#    endif
+#endif
+}
+
+/**************************************/
+
+static uint64_t
+hash_key (
+    const uint64_t* file_id, int part_index, const exr_chunk_info_t* cinfo)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    uint64_t v[7];
+
+    v[0] = file_id[0];
+    v[1] = file_id[1];
+    v[2] = file_id[2];
+    v[3] = file_id[3];
+    v[4] = ((uint64_t) (uint32_t) part_index << 32) | (uint32_t) cinfo->idx;
+    v[5] = cinfo->data_offset;
+    v[6] = cinfo->packed_size;
+
+    for (int i = 0; i < 7; ++i)
+    {
+        h ^= v[i];
+        h *= 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+static int
+entry_matches (
+    const cache_entry_t*    e,
+    uint64_t                hash,
+    const uint64_t*         file_id,
+    int                     part_index,
+    const exr_chunk_info_t* cinfo)
+{
+    return e->hash == hash && e->part_index == part_index &&
+           e->chunk_index == cinfo->idx &&
+           e->data_offset == cinfo->data_offset &&
+           e->packed_size == cinfo->packed_size &&
+           e->unpacked_size == cinfo->unpacked_size &&
+           memcmp (e->file_id, file_id, sizeof (e->file_id)) == 0;
+}
+
+/**************************************/
+
+static void
+lru_unlink (cache_entry_t* e)
+{
+    if (e->lru_prev)
+        e->lru_prev->lru_next = e->lru_next;
+    else
+        s_cache.lru_head = e->lru_next;
+    if (e->lru_next)
+        e->lru_next->lru_prev = e->lru_prev;
+    else
+        s_cache.lru_tail = e->lru_prev;
+    e->lru_prev = NULL;
+    e->lru_next = NULL;
+}
+
+static void
+lru_push_front (cache_entry_t* e)
+{
+    e->lru_prev = NULL;
+    e->lru_next = s_cache.lru_head;
+    if (s_cache.lru_head)
+        s_cache.lru_head->lru_prev = e;
+    else
+        s_cache.lru_tail = e;
+    s_cache.lru_head = e;
+}
+
+/* unlinks the entry, the caller frees it outside the lock */
+static void
+remove_entry (cache_entry_t* e)
+{
+    cache_entry_t** slot =
+        &(s_cache.buckets[e->hash & (s_cache.bucket_count - 1)]);
+
+    while (*slot != e)
+        slot = &((*slot)->hash_next);
+    *slot = e->hash_next;
+
+    lru_unlink (e);
+    s_cache.used -= ENTRY_COST (e);
+    --s_cache.entry_count;
+}
+
+/* evicts until the cache fits in limit, returns the evicted entries
+ * linked through hash_next */
+static cache_entry_t*
+evict_to (size_t limit)
+{
+    cache_entry_t* evicted = NULL;
+
+    while (s_cache.used > limit && s_cache.lru_tail)
+    {
+        cache_entry_t* e = s_cache.lru_tail;
+        remove_entry (e);
+        e->hash_next = evicted;
+        evicted      = e;
+    }
+    return evicted;
+}
+
+static void
+free_entries (cache_entry_t* e)
+{
+    while (e)
+    {
+        cache_entry_t* next = e->hash_next;
+        internal_exr_free (e);
+        e = next;
+    }
+}
+
+/* keeps about one entry per bucket, failure to grow only makes the
+ * chains longer */
+static void
+grow_buckets (void)
+{
+    size_t          newcount = s_cache.bucket_count ? s_cache.bucket_count * 2
+                                                    : 256;
+    cache_entry_t** newb;
+
+    newb = internal_exr_alloc (newcount * sizeof (cache_entry_t*));
+    if (!newb) return;
+    memset (newb, 0, newcount * sizeof (cache_entry_t*));
+
+    for (size_t b = 0; b < s_cache.bucket_count; ++b)
+    {
+        cache_entry_t* e = s_cache.buckets[b];
+        while (e)
+        {
+            cache_entry_t* next = e->hash_next;
+            size_t         nb   = e->hash & (newcount - 1);
+            e->hash_next        = newb[nb];
+            newb[nb]            = e;
+            e                   = next;
+        }
+    }
+
+    internal_exr_free (s_cache.buckets);
+    s_cache.buckets      = newb;
+    s_cache.bucket_count = newcount;
+}
+
+/**************************************/
+
+int
+internal_exr_chunk_cache_enabled (void)
+{
+#if defined(EXR_HAS_STD_ATOMICS)
+    return atomic_load_explicit (&s_cache_limit, memory_order_relaxed) != 0;
+#else
+    return InterlockedOr64 ((LONG64 volatile*) &s_cache_limit, 0) != 0;
+#endif
+}
+
+/**************************************/
+
+int
+internal_exr_chunk_cache_fetch (
+    exr_const_context_t ctxt, int part_index, exr_decode_pipeline_t* decode)
+{
+    const exr_chunk_info_t* cinfo = &(decode->chunk);
+    uint64_t                hash;
+    cache_entry_t*          e;
+    int                     found = 0;
+
+    hash = hash_key (ctxt->file_id, part_index, cinfo);
+
+    cache_lock ();
+    if (s_cache.limit == 0)
+        found = -1;
+    else if (s_cache.entry_count > 0)
+    {
+        e = s_cache.buckets[hash & (s_cache.bucket_count - 1)];
+        while (e && !entry_matches (e, hash, ctxt->file_id, part_index, cinfo))
+            e = e->hash_next;
+
+        if (e)
+        {
+            /* copied under the lock, the entry may be evicted as soon
+             * as it is released */
+            memcpy (
+                decode->unpacked_buffer,
+                ENTRY_DATA (e),
+                (size_t) cinfo->unpacked_size);
+            if (e != s_cache.lru_head)
+            {
+                lru_unlink (e);
+                lru_push_front (e);
+            }
+            found = 1;
+        }
+    }
+    cache_unlock ();
+
+    return found;
+}
+
+/**************************************/
+
+void
+internal_exr_chunk_cache_store (
+    exr_const_context_t          ctxt,
+    int                          part_index,
+    const exr_decode_pipeline_t* decode)
+{
+    const exr_chunk_info_t* cinfo = &(decode->chunk);
+    size_t                  cost;
+    cache_entry_t*          e;
+    cache_entry_t*          cur;
+    cache_entry_t*          evicted;
+
+    cost = sizeof (cache_entry_t) + (size_t) cinfo->unpacked_size;
+
+    /* copied before taking the lock, so checked against the limit
+     * once it is held */
+    e = internal_exr_alloc (cost);
+    if (!e) return;
+
+    memset (e, 0, sizeof (cache_entry_t));
+    e->hash          = hash_key (ctxt->file_id, part_index, cinfo);
+    e->data_offset   = cinfo->data_offset;
+    e->packed_size   = cinfo->packed_size;
+    e->unpacked_size = cinfo->unpacked_size;
+    e->part_index    = part_index;
+    e->chunk_index   = cinfo->idx;
+    memcpy (e->file_id, ctxt->file_id, sizeof (e->file_id));
+    memcpy (
+        ENTRY_DATA (e), decode->unpacked_buffer, (size_t) cinfo->unpacked_size);
+
+    cache_lock ();
+    if (cost > s_cache.limit)
+    {
+        cache_unlock ();
+        internal_exr_free (e);
+        return;
+    }
+
+    /* another reader may have decoded the same chunk meanwhile */
+    cur = NULL;
+    if (s_cache.entry_count > 0)
+    {
+        cur = s_cache.buckets[e->hash & (s_cache.bucket_count - 1)];
+        while (cur &&
+               !entry_matches (cur, e->hash, e->file_id, part_index, cinfo))
+            cur = cur->hash_next;
+    }
+    if (cur)
+    {
+        cache_unlock ();
+        internal_exr_free (e);
+        return;
+    }
+
+    evicted = evict_to (s_cache.limit - cost);
+
+    if (s_cache.entry_count >= s_cache.bucket_count) grow_buckets ();
+    if (s_cache.bucket_count > 0)
+    {
+        size_t b           = e->hash & (s_cache.bucket_count - 1);
+        e->hash_next       = s_cache.buckets[b];
+        s_cache.buckets[b] = e;
+        s_cache.used += cost;
+        ++s_cache.entry_count;
+        lru_push_front (e);
+        e = NULL;
+    }
+    cache_unlock ();
+
+    free_entries (evicted);
+    if (e) internal_exr_free (e);
+}
+
+/**************************************/
+
+void
+exr_set_chunk_cache_size (size_t bytes)
+{
+    cache_entry_t* evicted;
+
+    cache_lock ();
+    s_cache.limit = bytes;
+#if defined(EXR_HAS_STD_ATOMICS)
+    atomic_store_explicit (
+        &s_cache_limit, (uint64_t) bytes, memory_order_relaxed);
+#else
+    InterlockedExchange64 ((LONG64 volatile*) &s_cache_limit, (LONG64) bytes);
+#endif
+    evicted = evict_to (bytes);
+    cache_unlock ();
+
+    free_entries (evicted);
+}
+
+/**************************************/
+
+void
+exr_get_chunk_cache_size (size_t* bytes, size_t* used)
+{
+    cache_lock ();
+    if (bytes) *bytes = s_cache.limit;
+    if (used) *used = s_cache.used;
+    cache_unlock ();
+}
+
+/**************************************/
+
+void
+exr_clear_chunk_cache (void)
+{
+    cache_entry_t* evicted;
+
+    cache_lock ();
+    evicted = evict_to (0);
+    cache_unlock ();
+
+    free_entries (evicted);
+}
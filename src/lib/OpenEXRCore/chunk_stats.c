@@ -0,0 +1,337 @@
+/*
+** SPDX-License-Identifier: BSD-3-Clause
+** Copyright Contributors to the OpenEXR Project.
+*/
+
+#include "openexr_chunkio.h"
+
+#include "internal_attr.h"
+#include "internal_coding.h"
+#include "internal_structs.h"
+#include "internal_xdr.h"
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+/**************************************/
+
+static inline float
+stat_load_float (const uint8_t* p)
+{
+    uint32_t bits = unaligned_load32 (p);
+    float    v;
+    memcpy (&v, &bits, sizeof (float));
+    return v;
+}
+
+static inline void
+stat_store_float (uint8_t* p, float v)
+{
+    uint32_t bits;
+    memcpy (&bits, &v, sizeof (float));
+    unaligned_store32 (p, bits);
+}
+
+/* the value of a part's chunk statistics attribute when it matches
+ * the part, NULL otherwise */
+static uint8_t*
+find_chunk_stats (
+    exr_const_context_t ctxt, exr_const_priv_part_t part, int32_t* nchans)
+{
+    exr_attribute_t* attr = NULL;
+    const uint8_t*   data;
+    uint32_t         count, nc;
+    uint64_t         expsize;
+
+    if (part->storage_mode != EXR_STORAGE_SCANLINE &&
+        part->storage_mode != EXR_STORAGE_TILED)
+        return NULL;
+
+    if (!part->channels) return NULL;
+
+    if (EXR_ERR_SUCCESS != exr_attr_list_find_by_name (
+                               ctxt,
+                               EXR_CONST_CAST (
+                                   exr_attribute_list_t*, &(part->attributes)),
+                               EXR_CHUNK_STATS_ATTR_NAME,
+                               &attr))
+        return NULL;
+
+    if (attr->type != EXR_ATTR_OPAQUE || !attr->opaque ||
+        !attr->opaque->packed_data || attr->opaque->size < 8 ||
+        0 != strcmp (attr->type_name, EXR_CHUNK_STATS_TYPE_NAME))
+        return NULL;
+
+    data  = (const uint8_t*) attr->opaque->packed_data;
+    count = unaligned_load32 (data);
+    nc    = unaligned_load32 (data + 4);
+    if (count != (uint32_t) part->chunk_count ||
+        nc != (uint32_t) part->channels->chlist->num_channels)
+        return NULL;
+
+    expsize = 8 + (uint64_t) count + (uint64_t) count * (uint64_t) nc * 8;
+    if ((uint64_t) attr->opaque->size != expsize) return NULL;
+
+    *nchans = (int32_t) nc;
+    return (uint8_t*) attr->opaque->packed_data;
+}
+
+/**************************************/
+
+exr_result_t
+exr_add_chunk_stats (exr_context_t ctxt, int part_index)
+{
+    uint8_t empty[8] = {0};
+    EXR_LOCK_AND_DEFINE_PART (part_index);
+
+    if (part->storage_mode != EXR_STORAGE_SCANLINE &&
+        part->storage_mode != EXR_STORAGE_TILED)
+        return EXR_UNLOCK_AND_RETURN (ctxt->report_error (
+            ctxt,
+            EXR_ERR_INVALID_ARGUMENT,
+            "Chunk statistics are only recorded for scanline and tiled parts"));
+    internal_exr_unlock (ctxt);
+
+    /* sized once the chunk count is known, when the header is written */
+    return exr_attr_set_user (
+        ctxt,
+        part_index,
+        EXR_CHUNK_STATS_ATTR_NAME,
+        EXR_CHUNK_STATS_TYPE_NAME,
+        (int32_t) sizeof (empty),
+        empty);
+}
+
+/**************************************/
+
+exr_result_t
+exr_get_chunk_stats (
+    exr_const_context_t ctxt,
+    int                 part_index,
+    int                 chunk_index,
+    int                 channel_index,
+    double*             minval,
+    double*             maxval)
+{
+    const uint8_t* stats;
+    const uint8_t* cs;
+    int32_t        nchans = 0;
+    EXR_LOCK_WRITE_AND_DEFINE_PART (part_index);
+
+    if (!minval || !maxval)
+        return EXR_UNLOCK_WRITE_AND_RETURN (
+            ctxt->standard_error (ctxt, EXR_ERR_INVALID_ARGUMENT));
+
+    stats = find_chunk_stats (ctxt, part, &nchans);
+    if (!stats) return EXR_UNLOCK_WRITE_AND_RETURN (EXR_ERR_NO_ATTR_BY_NAME);
+
+    if (chunk_index < 0 || chunk_index >= part->chunk_count)
+        return EXR_UNLOCK_WRITE_AND_RETURN (ctxt->print_error (
+            ctxt,
+            EXR_ERR_ARGUMENT_OUT_OF_RANGE,
+            "Invalid chunk index (%d) for part with %d chunks",
+            chunk_index,
+            part->chunk_count));
+
+    if (channel_index < 0 || channel_index >= nchans)
+        return EXR_UNLOCK_WRITE_AND_RETURN (ctxt->print_error (
+            ctxt,
+            EXR_ERR_ARGUMENT_OUT_OF_RANGE,
+            "Invalid channel index (%d) for part with %d channels",
+            channel_index,
+            nchans));
+
+    if (stats[8 + chunk_index] == 0)
+        return EXR_UNLOCK_WRITE_AND_RETURN (EXR_ERR_NO_ATTR_BY_NAME);
+
+    cs = stats + 8 + part->chunk_count +
+         ((uint64_t) chunk_index * (uint64_t) nchans +
+          (uint64_t) channel_index) *
+             8;
+
+    if (part->channels->chlist->entries[channel_index].pixel_type ==
+        EXR_PIXEL_UINT)
+    {
+        *minval = (double) unaligned_load32 (cs);
+        *maxval = (double) unaligned_load32 (cs + 4);
+    }
+    else
+    {
+        *minval = (double) stat_load_float (cs);
+        *maxval = (double) stat_load_float (cs + 4);
+    }
+    return EXR_UNLOCK_WRITE_AND_RETURN (EXR_ERR_SUCCESS);
+}
+
+/**************************************/
+
+exr_result_t
+internal_exr_prepare_chunk_stats (exr_context_t ctxt, exr_priv_part_t part)
+{
+    exr_attribute_t* attr = NULL;
+    uint8_t*         data;
+    uint64_t         size;
+    int32_t          nchans;
+    exr_result_t     rv;
+
+    if (EXR_ERR_SUCCESS != exr_attr_list_find_by_name (
+                               ctxt,
+                               &(part->attributes),
+                               EXR_CHUNK_STATS_ATTR_NAME,
+                               &attr))
+        return EXR_ERR_SUCCESS;
+
+    if (attr->type != EXR_ATTR_OPAQUE ||
+        0 != strcmp (attr->type_name, EXR_CHUNK_STATS_TYPE_NAME) ||
+        (part->storage_mode != EXR_STORAGE_SCANLINE &&
+         part->storage_mode != EXR_STORAGE_TILED))
+        return EXR_ERR_SUCCESS;
+
+    nchans = part->channels->chlist->num_channels;
+    size   = 8 + (uint64_t) part->chunk_count +
+           (uint64_t) part->chunk_count * (uint64_t) nchans * 8;
+    if (size > (uint64_t) INT32_MAX)
+        return ctxt->print_error (
+            ctxt,
+            EXR_ERR_ATTR_SIZE_MISMATCH,
+            "Part %d has too many chunks (%d) and channels (%d) for chunk statistics",
+            part->part_index,
+            part->chunk_count,
+            nchans);
+
+    data = ctxt->alloc_fn ((size_t) size);
+    if (!data) return ctxt->standard_error (ctxt, EXR_ERR_OUT_OF_MEMORY);
+
+    memset (data, 0, (size_t) size);
+    unaligned_store32 (data, (uint32_t) part->chunk_count);
+    unaligned_store32 (data + 4, (uint32_t) nchans);
+
+    rv = exr_attr_opaquedata_set_packed (
+        ctxt, attr->opaque, data, (int32_t) size);
+    ctxt->free_fn (data);
+    return rv;
+}
+
+/**************************************/
+
+exr_result_t
+internal_exr_write_chunk_stats (exr_context_t ctxt, exr_const_priv_part_t part)
+{
+    const uint8_t* stats;
+    int32_t        nchans = 0;
+    uint64_t       offset = part->chunk_stats_offset;
+
+    stats = find_chunk_stats (ctxt, part, &nchans);
+    if (!stats || offset == 0) return EXR_ERR_SUCCESS;
+
+    return ctxt->do_write (
+        ctxt,
+        stats,
+        8 + (uint64_t) part->chunk_count +
+            (uint64_t) part->chunk_count * (uint64_t) nchans * 8,
+        &offset);
+}
+
+/**************************************/
+
+void
+internal_exr_compute_chunk_stats (
+    exr_encode_pipeline_t* encode, exr_const_priv_part_t part)
+{
+    const uint8_t* src = encode->packed_buffer;
+    uint8_t*       stats;
+    uint8_t*       cstats;
+    int32_t        nchans = 0;
+    int            cidx   = encode->chunk.idx;
+
+    stats = find_chunk_stats (encode->context, part, &nchans);
+    if (!stats || !src || nchans != encode->channel_count || cidx < 0 ||
+        cidx >= part->chunk_count)
+        return;
+
+    /* each chunk only touches its own flag and values, so chunks
+     * encoded concurrently do not interfere */
+    cstats = stats + 8 + part->chunk_count +
+             (uint64_t) cidx * (uint64_t) nchans * 8;
+
+    for (int c = 0; c < nchans; ++c)
+    {
+        uint8_t* cs = cstats + (uint64_t) c * 8;
+
+        if (encode->channels[c].data_type == EXR_PIXEL_UINT)
+        {
+            unaligned_store32 (cs, UINT32_MAX);
+            unaligned_store32 (cs + 4, 0);
+        }
+        else
+        {
+            stat_store_float (cs, INFINITY);
+            stat_store_float (cs + 4, -INFINITY);
+        }
+    }
+
+    /* walk the packed buffer the way default_pack fills it */
+    for (int y = 0; y < encode->chunk.height; ++y)
+    {
+        int cury = y + encode->chunk.start_y;
+
+        for (int c = 0; c < nchans; ++c)
+        {
+            const exr_coding_channel_info_t* encc = (encode->channels + c);
+            uint8_t* cs = cstats + (uint64_t) c * 8;
+            int      w  = encc->width;
+
+            if (encc->height == 0) continue;
+            if (encc->y_samples > 1 && (cury % encc->y_samples) != 0)
+                continue;
+
+            switch (encc->data_type)
+            {
+                case EXR_PIXEL_HALF: {
+                    float mn = stat_load_float (cs);
+                    float mx = stat_load_float (cs + 4);
+                    for (int x = 0; x < w; ++x, src += 2)
+                    {
+                        float v = half_to_float (unaligned_load16 (src));
+                        if (v < mn) mn = v;
+                        if (v > mx) mx = v;
+                    }
+                    stat_store_float (cs, mn);
+                    stat_store_float (cs + 4, mx);
+                    break;
+                }
+                case EXR_PIXEL_FLOAT: {
+                    float mn = stat_load_float (cs);
+                    float mx = stat_load_float (cs + 4);
+                    for (int x = 0; x < w; ++x, src += 4)
+                    {
+                        float v = stat_load_float (src);
+                        if (v < mn) mn = v;
+                        if (v > mx) mx = v;
+                    }
+                    stat_store_float (cs, mn);
+                    stat_store_float (cs + 4, mx);
+                    break;
+                }
+                case EXR_PIXEL_UINT: {
+                    uint32_t mn = unaligned_load32 (cs);
+                    uint32_t mx = unaligned_load32 (cs + 4);
+                    for (int x = 0; x < w; ++x, src += 4)
+                    {
+                        uint32_t v = unaligned_load32 (src);
+                        if (v < mn) mn = v;
+                        if (v > mx) mx = v;
+                    }
+                    unaligned_store32 (cs, mn);
+                    unaligned_store32 (cs + 4, mx);
+                    break;
+                }
+                case EXR_PIXEL_LAST_TYPE:
+                default: return;
+            }
+        }
+    }
+
+    stats[8 + cidx] = 1;
+}
@@ -4,6 +4,7 @@
 */
 
 #include "internal_coding.h"
+#include "internal_memory.h"
 #include "internal_util.h"
 
 #include <string.h>
@@ -114,6 +115,19 @@ internal_coding_update_channel_info (
 
 /**************************************/
 
+static void
+count_buffer_alloc (exr_const_context_t ctxt, size_t bytes)
+{
+    uint64_t cur;
+
+    internal_exr_perf_add (ctxt, EXR_PERF_IDX (buffer_allocs), 1);
+    cur = internal_exr_perf_add (
+        ctxt, EXR_PERF_IDX (buffer_bytes), (uint64_t) bytes);
+    internal_exr_perf_max (ctxt, EXR_PERF_IDX (peak_buffer_bytes), cur);
+}
+
+/**************************************/
+
 exr_result_t
 internal_encode_free_buffer (
     exr_encode_pipeline_t*               encode,
@@ -134,7 +148,12 @@ internal_encode_free_buffer (
                 exr_const_context_t ctxt = encode->context;
                 EXR_CHECK_CONTEXT_AND_PART (encode->part_index);
 
-                ctxt->free_fn (curbuf);
+                if (ctxt->buffer_pool)
+                    internal_exr_pool_free (ctxt->buffer_pool, curbuf, cursz);
+                else
+                    ctxt->free_fn (curbuf);
+                internal_exr_perf_sub (
+                    ctxt, EXR_PERF_IDX (buffer_bytes), (uint64_t) cursz);
             }
         }
         *buf = NULL;
@@ -175,7 +194,14 @@ internal_encode_alloc_buffer (
             exr_const_context_t ctxt = encode->context;
             EXR_CHECK_CONTEXT_AND_PART (encode->part_index);
 
-            curbuf = ctxt->alloc_fn (newsz);
+            /* pooled buffers are rounded up to their size class, the
+             * whole class is usable and is what gets freed */
+            if (ctxt->buffer_pool)
+                curbuf =
+                    internal_exr_pool_alloc (ctxt->buffer_pool, newsz, &newsz);
+            else
+                curbuf = ctxt->alloc_fn (newsz);
+            if (curbuf) count_buffer_alloc (ctxt, newsz);
         }
 
         if (curbuf == NULL)
@@ -216,7 +242,12 @@ internal_decode_free_buffer (
                 exr_const_context_t ctxt = decode->context;
                 EXR_CHECK_CONTEXT_AND_PART (decode->part_index);
 
-                ctxt->free_fn (curbuf);
+                if (ctxt->buffer_pool)
+                    internal_exr_pool_free (ctxt->buffer_pool, curbuf, cursz);
+                else
+                    ctxt->free_fn (curbuf);
+                internal_exr_perf_sub (
+                    ctxt, EXR_PERF_IDX (buffer_bytes), (uint64_t) cursz);
             }
         }
         *buf = NULL;
@@ -253,7 +284,14 @@ internal_decode_alloc_buffer (
             exr_const_context_t ctxt = decode->context;
             EXR_CHECK_CONTEXT_AND_PART (decode->part_index);
 
-            curbuf = ctxt->alloc_fn (newsz);
+            /* pooled buffers are rounded up to their size class, the
+             * whole class is usable and is what gets freed */
+            if (ctxt->buffer_pool)
+                curbuf =
+                    internal_exr_pool_alloc (ctxt->buffer_pool, newsz, &newsz);
+            else
+                curbuf = ctxt->alloc_fn (newsz);
+            if (curbuf) count_buffer_alloc (ctxt, newsz);
         }
 
         if (curbuf == NULL)
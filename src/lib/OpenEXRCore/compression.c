@@ -237,6 +237,29 @@ int exr_compression_lines_per_chunk (exr_compression_t comptype)
 
 /**************************************/
 
+const char*
+internal_exr_compression_name (exr_compression_t comptype)
+{
+    switch (comptype)
+    {
+        case EXR_COMPRESSION_NONE: return "none";
+        case EXR_COMPRESSION_RLE: return "rle";
+        case EXR_COMPRESSION_ZIPS: return "zips";
+        case EXR_COMPRESSION_ZIP: return "zip";
+        case EXR_COMPRESSION_PIZ: return "piz";
+        case EXR_COMPRESSION_PXR24: return "pxr24";
+        case EXR_COMPRESSION_B44: return "b44";
+        case EXR_COMPRESSION_B44A: return "b44a";
+        case EXR_COMPRESSION_DWAA: return "dwaa";
+        case EXR_COMPRESSION_DWAB: return "dwab";
+        case EXR_COMPRESSION_LAST_TYPE:
+        default: break;
+    }
+    return NULL;
+}
+
+/**************************************/
+
 exr_result_t
 exr_compress_chunk (exr_encode_pipeline_t* encode)
 {
@@ -56,6 +56,10 @@ dispatch_read (
     if (nread) *nread = rval;
     if (rval > 0) *offsetp += (uint64_t) rval;
 
+    internal_exr_perf_add (ctxt, EXR_PERF_IDX (read_calls), 1);
+    if (rval > 0)
+        internal_exr_perf_add (ctxt, EXR_PERF_IDX (bytes_read), (uint64_t) rval);
+
     if (rval == (int64_t) sz || (rmode == EXR_ALLOW_SHORT_READ && rval >= 0))
         rv = EXR_ERR_SUCCESS;
     else
@@ -88,6 +92,11 @@ dispatch_write (
 
     if (rval > 0) *offsetp += (uint64_t) rval;
 
+    internal_exr_perf_add (ctxt, EXR_PERF_IDX (write_calls), 1);
+    if (rval > 0)
+        internal_exr_perf_add (
+            ctxt, EXR_PERF_IDX (bytes_written), (uint64_t) rval);
+
     return (rval == (int64_t) sz) ? EXR_ERR_SUCCESS : EXR_ERR_WRITE_IO;
 }
 
@@ -134,6 +143,13 @@ fill_context_data (const exr_context_initializer_t* ctxtdata)
         {
             inits.flags = ctxtdata->flags;
         }
+        if (ctxtdata->size >= sizeof (struct _exr_context_initializer_v4))
+        {
+            inits.buffer_pool     = ctxtdata->buffer_pool;
+            inits.memory_budget   = ctxtdata->memory_budget;
+            inits.trace_fn        = ctxtdata->trace_fn;
+            inits.trace_user_data = ctxtdata->trace_user_data;
+        }
     }
 
     internal_exr_update_default_handlers (&inits);
@@ -209,9 +225,15 @@ exr_finish (exr_context_t* pctxt)
             ctxt->mode == EXR_CONTEXT_WRITING_DATA)
             failed = 1;
 
+        if (ctxt->mode == EXR_CONTEXT_UPDATE_HEADER)
+            rv = internal_exr_update_header (ctxt);
+
         if (ctxt->mode != EXR_CONTEXT_READ &&
             ctxt->mode != EXR_CONTEXT_TEMPORARY)
-            rv = finalize_write (ctxt, failed);
+        {
+            exr_result_t frv = finalize_write (ctxt, failed);
+            if (rv == EXR_ERR_SUCCESS) rv = frv;
+        }
 
         if (ctxt->destroy_fn) ctxt->destroy_fn (ctxt, ctxt->user_data, failed);
 
@@ -362,11 +384,74 @@ exr_start_inplace_header_update (
     const char*                      filename,
     const exr_context_initializer_t* ctxtdata)
 {
-    /* TODO: not yet implemented */
-    (void) ctxt;
-    (void) filename;
-    (void) ctxtdata;
-    return EXR_ERR_INVALID_ARGUMENT;
+    exr_result_t              rv    = EXR_ERR_UNKNOWN;
+    exr_context_t             ret   = NULL;
+    exr_context_initializer_t inits = fill_context_data (ctxtdata);
+
+    if (!ctxt)
+    {
+        inits.error_handler_fn (
+            NULL,
+            EXR_ERR_INVALID_ARGUMENT,
+            "Invalid context handle passed to start_inplace_header_update function");
+        return EXR_ERR_INVALID_ARGUMENT;
+    }
+
+    if (filename)
+    {
+        rv = internal_exr_alloc_context (
+            &ret,
+            &inits,
+            EXR_CONTEXT_UPDATE_HEADER,
+            sizeof (struct _internal_exr_filehandle));
+        if (rv == EXR_ERR_SUCCESS)
+        {
+            ret->do_read  = &dispatch_read;
+            ret->do_write = &dispatch_write;
+
+            rv = exr_attr_string_create (
+                (exr_context_t) ret, &(ret->filename), filename);
+            if (rv == EXR_ERR_SUCCESS)
+            {
+                if (!inits.read_fn && !inits.write_fn)
+                {
+                    inits.size_fn = &default_query_size_func;
+                    rv            = default_init_update_file (ret);
+                }
+                else if (!inits.read_fn || !inits.write_fn)
+                {
+                    rv = ret->report_error (
+                        ret,
+                        EXR_ERR_INVALID_ARGUMENT,
+                        "Updating a header in place needs both a read and a write function");
+                }
+
+                if (rv == EXR_ERR_SUCCESS)
+                    rv = process_query_size (ret, &inits);
+                if (rv == EXR_ERR_SUCCESS) rv = internal_exr_parse_header (ret);
+            }
+
+            if (rv != EXR_ERR_SUCCESS)
+            {
+                /* nothing to write back */
+                ret->mode = EXR_CONTEXT_READ;
+                exr_finish ((exr_context_t*) &ret);
+            }
+        }
+        else
+            rv = EXR_ERR_OUT_OF_MEMORY;
+    }
+    else
+    {
+        inits.error_handler_fn (
+            NULL,
+            EXR_ERR_INVALID_ARGUMENT,
+            "Invalid filename passed to start_inplace_header_update function");
+        rv = EXR_ERR_INVALID_ARGUMENT;
+    }
+
+    *ctxt = (exr_context_t) ret;
+    return rv;
 }
 
 /**************************************/
@@ -420,6 +505,25 @@ exr_get_file_name (exr_const_context_t ctxt, const char** name)
 
 /**************************************/
 
+exr_result_t
+exr_get_file_identity (
+    exr_const_context_t ctxt, int* has_identity, uint64_t identity[4])
+{
+    if (!ctxt) return EXR_ERR_MISSING_CONTEXT_ARG;
+
+    if (!has_identity || !identity)
+        return ctxt->standard_error (ctxt, EXR_ERR_INVALID_ARGUMENT);
+
+    /* set when the file is opened, no locking needed */
+    *has_identity = ctxt->has_file_id ? 1 : 0;
+    for (int i = 0; i < 4; ++i)
+        identity[i] = ctxt->has_file_id ? ctxt->file_id[i] : 0;
+
+    return EXR_ERR_SUCCESS;
+}
+
+/**************************************/
+
 exr_result_t
 exr_get_file_version_and_flags (exr_const_context_t ctxt, uint32_t* ver)
 {
@@ -465,6 +569,23 @@ exr_get_user_data (exr_const_context_t ctxt, void** userdata)
 
 /**************************************/
 
+exr_result_t
+exr_get_memory_budget (
+    exr_const_context_t ctxt, size_t* budget, size_t* reserved)
+{
+    if (!ctxt) return EXR_ERR_MISSING_CONTEXT_ARG;
+    if (!budget && !reserved)
+        return ctxt->standard_error (ctxt, EXR_ERR_INVALID_ARGUMENT);
+
+    internal_exr_lock (ctxt);
+    if (budget) *budget = ctxt->memory_budget;
+    if (reserved) *reserved = ctxt->memory_reserved;
+    internal_exr_unlock (ctxt);
+    return EXR_ERR_SUCCESS;
+}
+
+/**************************************/
+
 exr_result_t
 exr_register_attr_type_handler (
     exr_context_t ctxt,
@@ -632,6 +753,29 @@ exr_set_longname_support (exr_context_t ctxt, int onoff)
 
 /**************************************/
 
+exr_result_t
+exr_set_header_padding (exr_context_t ctxt, int32_t bytes)
+{
+    if (!ctxt) return EXR_ERR_MISSING_CONTEXT_ARG;
+    internal_exr_lock (ctxt);
+
+    if (ctxt->mode != EXR_CONTEXT_WRITE)
+        return EXR_UNLOCK_AND_RETURN (
+            ctxt->standard_error (ctxt, EXR_ERR_NOT_OPEN_WRITE));
+
+    if (bytes < 0)
+        return EXR_UNLOCK_AND_RETURN (ctxt->print_error (
+            ctxt,
+            EXR_ERR_INVALID_ARGUMENT,
+            "Invalid header padding (%d)",
+            bytes));
+
+    ctxt->header_padding = bytes;
+    return EXR_UNLOCK_AND_RETURN (EXR_ERR_SUCCESS);
+}
+
+/**************************************/
+
 exr_result_t
 exr_write_header (exr_context_t ctxt)
 {
@@ -701,9 +845,14 @@ exr_write_header (exr_context_t ctxt)
             if (rv != EXR_ERR_SUCCESS) break;
         }
 
+        rv = internal_exr_prepare_chunk_stats (ctxt, curp);
+        if (rv != EXR_ERR_SUCCESS) break;
+
         rv = internal_exr_validate_write_part (ctxt, curp);
     }
 
+    if (rv == EXR_ERR_SUCCESS) rv = internal_exr_add_header_padding (ctxt);
+
     ctxt->output_file_offset = 0;
 
     if (rv == EXR_ERR_SUCCESS) rv = internal_exr_write_header (ctxt);
@@ -5,6 +5,7 @@
 
 #include "openexr_debug.h"
 
+#include "internal_compress.h"
 #include "internal_constants.h"
 #include "internal_structs.h"
 #include "openexr_attr.h"
@@ -74,19 +75,9 @@ print_attr (const exr_attribute_t* a, int verbose)
                 (double) a->chromaticities->white_y);
             break;
         case EXR_ATTR_COMPRESSION: {
-            static char* compressionnames[] = {
-                "none",
-                "rle",
-                "zips",
-                "zip",
-                "piz",
-                "pxr24",
-                "b44",
-                "b44a",
-                "dwaa",
-                "dwab"};
-            printf (
-                "'%s'", (a->uc < 10 ? compressionnames[a->uc] : "<UNKNOWN>"));
+            const char* name =
+                internal_exr_compression_name ((exr_compression_t) a->uc);
+            printf ("'%s'", name ? name : "<UNKNOWN>");
             if (verbose) printf (" (0x%02X)", a->uc);
             break;
         }
@@ -359,3 +350,37 @@ exr_print_context_info (exr_const_context_t ctxt, int verbose)
     if (ctxt->mode == EXR_CONTEXT_WRITE) internal_exr_unlock (ctxt);
     return EXR_ERR_SUCCESS;
 }
+
+/**************************************/
+
+exr_result_t
+exr_get_perf_counters (exr_const_context_t ctxt, exr_perf_counters_t* counters)
+{
+    uint64_t* out;
+
+    if (!ctxt) return EXR_ERR_MISSING_CONTEXT_ARG;
+    if (!counters) return ctxt->standard_error (ctxt, EXR_ERR_INVALID_ARGUMENT);
+
+    out = (uint64_t*) counters;
+    for (size_t i = 0; i < EXR_PERF_COUNTER_COUNT; ++i)
+        out[i] = internal_exr_perf_load (ctxt, i);
+    return EXR_ERR_SUCCESS;
+}
+
+/**************************************/
+
+exr_result_t
+exr_reset_perf_counters (exr_const_context_t ctxt)
+{
+    size_t live = EXR_PERF_IDX (buffer_bytes);
+
+    if (!ctxt) return EXR_ERR_MISSING_CONTEXT_ARG;
+
+    for (size_t i = 0; i < EXR_PERF_COUNTER_COUNT; ++i)
+        if (i != live) internal_exr_perf_store (ctxt, i, 0);
+    internal_exr_perf_max (
+        ctxt,
+        EXR_PERF_IDX (peak_buffer_bytes),
+        internal_exr_perf_load (ctxt, live));
+    return EXR_ERR_SUCCESS;
+}
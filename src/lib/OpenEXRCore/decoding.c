@@ -7,6 +7,7 @@
 
 #include "openexr_compression.h"
 
+#include "internal_chunk_cache.h"
 #include "internal_coding.h"
 #include "internal_decompress.h"
 #include "internal_structs.h"
@@ -538,12 +539,164 @@ exr_decoding_update (
 
 /**************************************/
 
-exr_result_t
-exr_decoding_run (
+/* fills a chunk recorded in the constant chunk attribute, straight
+ * into the channels when the uncompressed direct read was chosen,
+ * otherwise into the unpacked buffer for the usual unpack step */
+static exr_result_t
+fill_constant_chunk (exr_decode_pipeline_t* decode, const uint8_t* value)
+{
+    exr_result_t rv;
+    int          direct = (decode->read_fn == &read_uncompressed_direct);
+    uint8_t*     out    = NULL;
+    uint8_t*     end    = NULL;
+    uint8_t*     cdata;
+    size_t       voff;
+    uint16_t     v16;
+    uint32_t     v32;
+
+    if (!direct)
+    {
+        rv = internal_decode_alloc_buffer (
+            decode,
+            EXR_TRANSCODE_BUFFER_UNPACKED,
+            &(decode->unpacked_buffer),
+            &(decode->unpacked_alloc_size),
+            decode->chunk.unpacked_size);
+        if (rv != EXR_ERR_SUCCESS) return rv;
+        out = decode->unpacked_buffer;
+        end = out + decode->chunk.unpacked_size;
+    }
+
+    for (int y = 0; y < decode->chunk.height; ++y)
+    {
+        int cury = decode->chunk.start_y + y;
+
+        voff = 0;
+        for (int c = 0; c < decode->channel_count; ++c)
+        {
+            exr_coding_channel_info_t* decc = (decode->channels + c);
+            int                        w    = decc->width;
+            int16_t                    bpe  = decc->bytes_per_element;
+
+            if (bpe == 2)
+                memcpy (&v16, value + voff, sizeof (uint16_t));
+            else
+                memcpy (&v32, value + voff, sizeof (uint32_t));
+            voff += (size_t) bpe;
+
+            if (decc->y_samples > 1 && (cury % decc->y_samples) != 0)
+                continue;
+
+            if (direct)
+            {
+                if (decc->height == 0 || !decc->decode_to_ptr) continue;
+
+                cdata = decc->decode_to_ptr;
+                if (decc->y_samples > 1)
+                    cdata += (uint64_t) (y / decc->y_samples) *
+                             (uint64_t) decc->user_line_stride;
+                else
+                    cdata += (uint64_t) y * (uint64_t) decc->user_line_stride;
+
+                /* the direct read leaves native values */
+                v16 = one_to_native16 (v16);
+                v32 = one_to_native32 (v32);
+            }
+            else
+            {
+                cdata = out;
+                out += (size_t) w * (size_t) bpe;
+                if (out > end) return EXR_ERR_CORRUPT_CHUNK;
+            }
+
+            for (int x = 0; x < w; ++x)
+            {
+                if (bpe == 2)
+                    memcpy (cdata + x * 2, &v16, 2);
+                else
+                    memcpy (cdata + x * 4, &v32, 4);
+            }
+        }
+    }
+
+    return EXR_ERR_SUCCESS;
+}
+
+/**************************************/
+
+/* the read and decompress steps, skipped when the chunk cache
+ * already has the decompressed data */
+static exr_result_t
+read_and_decompress (
     exr_const_context_t ctxt, int part_index, exr_decode_pipeline_t* decode)
 {
     exr_result_t rv;
+    uint64_t     stage_start;
+
+    stage_start = internal_exr_stage_begin (
+        ctxt,
+        part_index,
+        &(decode->chunk),
+        EXR_TRACE_STAGE_READ,
+        decode->chunk.packed_size,
+        decode->chunk.packed_size);
+    rv = decode->read_fn (decode);
+    internal_exr_stage_end (
+        ctxt,
+        part_index,
+        &(decode->chunk),
+        EXR_TRACE_STAGE_READ,
+        stage_start,
+        decode->chunk.packed_size,
+        decode->chunk.packed_size);
+    if (rv != EXR_ERR_SUCCESS)
+        return ctxt->report_error (
+            ctxt, rv, "Unable to read pixel data block from context");
+
+    if (rv == EXR_ERR_SUCCESS) rv = update_pack_unpack_ptrs (decode);
+    if (rv != EXR_ERR_SUCCESS)
+        return ctxt->report_error (
+            ctxt,
+            rv,
+            "Decode pipeline unable to update pack / unpack pointers");
+
+    if (rv == EXR_ERR_SUCCESS && decode->decompress_fn)
+    {
+        stage_start = internal_exr_stage_begin (
+            ctxt,
+            part_index,
+            &(decode->chunk),
+            EXR_TRACE_STAGE_DECOMPRESS,
+            decode->chunk.packed_size,
+            decode->chunk.unpacked_size);
+        rv = decode->decompress_fn (decode);
+        internal_exr_stage_end (
+            ctxt,
+            part_index,
+            &(decode->chunk),
+            EXR_TRACE_STAGE_DECOMPRESS,
+            stage_start,
+            decode->chunk.packed_size,
+            decode->chunk.unpacked_size);
+    }
+    if (rv != EXR_ERR_SUCCESS)
+        return ctxt->report_error (
+            ctxt, rv, "Decode pipeline unable to decompress data");
+
+    return rv;
+}
+
+/**************************************/
+
+static exr_result_t
+decoding_run (
+    exr_const_context_t ctxt, int part_index, exr_decode_pipeline_t* decode)
+{
+    exr_result_t          rv;
     exr_const_priv_part_t part;
+    uint64_t              stage_start;
+    int                   cached;
+    const uint8_t*        constval;
 
     if (!ctxt) return EXR_ERR_MISSING_CONTEXT_ARG;
     if (part_index < 0 || part_index >= ctxt->num_parts)
@@ -564,23 +717,57 @@ exr_decoding_run (
             ctxt,
             EXR_ERR_INVALID_ARGUMENT,
             "Decode pipeline has no read_fn declared");
-    rv = decode->read_fn (decode);
-    if (rv != EXR_ERR_SUCCESS)
-        return ctxt->report_error (
-            ctxt, rv, "Unable to read pixel data block from context");
 
-    if (rv == EXR_ERR_SUCCESS) rv = update_pack_unpack_ptrs (decode);
-    if (rv != EXR_ERR_SUCCESS)
-        return ctxt->report_error (
-            ctxt,
-            rv,
-            "Decode pipeline unable to update pack / unpack pointers");
+    constval = NULL;
+    if (decode->chunk.data_offset == 0 && decode->chunk.packed_size == 0 &&
+        decode->chunk.unpacked_size > 0)
+        constval =
+            internal_exr_constant_chunk (ctxt, part, decode->chunk.idx);
+
+    cached = -1;
+    if (!constval && internal_exr_chunk_cache_enabled () &&
+        ctxt->has_file_id && !ctxt->disable_chunk_cache &&
+        decode->read_fn == &default_read_chunk &&
+        decode->decompress_fn == &exr_uncompress_chunk &&
+        (part->storage_mode == EXR_STORAGE_SCANLINE ||
+         part->storage_mode == EXR_STORAGE_TILED) &&
+        decode->chunk.unpacked_size > 0 &&
+        decode->chunk.packed_size != decode->chunk.unpacked_size)
+    {
+        rv = internal_decode_alloc_buffer (
+            decode,
+            EXR_TRANSCODE_BUFFER_UNPACKED,
+            &(decode->unpacked_buffer),
+            &(decode->unpacked_alloc_size),
+            decode->chunk.unpacked_size);
+        if (rv != EXR_ERR_SUCCESS)
+            return ctxt->report_error (
+                ctxt, rv, "Decode pipeline unable to allocate unpack buffer");
 
-    if (rv == EXR_ERR_SUCCESS && decode->decompress_fn)
-        rv = decode->decompress_fn (decode);
-    if (rv != EXR_ERR_SUCCESS)
-        return ctxt->report_error (
-            ctxt, rv, "Decode pipeline unable to decompress data");
+        cached = internal_exr_chunk_cache_fetch (ctxt, part_index, decode);
+        if (cached > 0)
+            internal_exr_perf_add (ctxt, EXR_PERF_IDX (chunk_cache_hits), 1);
+        else if (cached == 0)
+            internal_exr_perf_add (ctxt, EXR_PERF_IDX (chunk_cache_misses), 1);
+    }
+
+    if (constval)
+    {
+        rv = fill_constant_chunk (decode, constval);
+        if (rv != EXR_ERR_SUCCESS)
+            return ctxt->report_error (
+                ctxt, rv, "Decode pipeline unable to fill constant chunk");
+    }
+    else if (cached <= 0)
+    {
+        rv = read_and_decompress (ctxt, part_index, decode);
+        if (rv != EXR_ERR_SUCCESS) return rv;
+
+        if (cached == 0)
+            internal_exr_chunk_cache_store (ctxt, part_index, decode);
+    }
+    else
+        rv = EXR_ERR_SUCCESS;
 
     if (rv == EXR_ERR_SUCCESS &&
         (part->storage_mode == EXR_STORAGE_DEEP_SCANLINE ||
@@ -661,7 +848,24 @@ exr_decoding_run (
     if (decode->chunk.unpacked_size > 0)
     {
         if (rv == EXR_ERR_SUCCESS && decode->unpack_and_convert_fn)
+        {
+            stage_start = internal_exr_stage_begin (
+                ctxt,
+                part_index,
+                &(decode->chunk),
+                EXR_TRACE_STAGE_UNPACK,
+                decode->chunk.unpacked_size,
+                decode->chunk.unpacked_size);
             rv = decode->unpack_and_convert_fn (decode);
+            internal_exr_stage_end (
+                ctxt,
+                part_index,
+                &(decode->chunk),
+                EXR_TRACE_STAGE_UNPACK,
+                stage_start,
+                decode->chunk.unpacked_size,
+                decode->chunk.unpacked_size);
+        }
         if (rv != EXR_ERR_SUCCESS)
             return ctxt->report_error (
                 ctxt, rv, "Decode pipeline unable to unpack and convert data");
@@ -672,6 +876,48 @@ exr_decoding_run (
 
 /**************************************/
 
+exr_result_t
+exr_decoding_run (
+    exr_const_context_t ctxt, int part_index, exr_decode_pipeline_t* decode)
+{
+    exr_result_t rv;
+    size_t       reserved = 0;
+
+    /* the packed and unpacked buffers are what a chunk needs at most,
+     * the codecs' scratch space is about the size of either */
+    if (ctxt && decode && ctxt->memory_budget > 0)
+    {
+        reserved = (size_t) (decode->chunk.packed_size +
+                             decode->chunk.unpacked_size +
+                             decode->chunk.sample_count_table_size);
+        if (reserved > 0) internal_exr_reserve_memory (ctxt, reserved);
+    }
+
+    rv = decoding_run (ctxt, part_index, decode);
+
+    if (reserved > 0) internal_exr_release_memory (ctxt, reserved);
+
+    if (rv == EXR_ERR_SUCCESS)
+    {
+        internal_exr_perf_add (
+            ctxt,
+            EXR_PERF_IDX (chunks_decoded) +
+                (size_t) ctxt->parts[part_index]->comp_type,
+            1);
+        internal_exr_perf_add (
+            ctxt,
+            EXR_PERF_IDX (compressed_bytes_decoded),
+            decode->chunk.packed_size);
+        internal_exr_perf_add (
+            ctxt,
+            EXR_PERF_IDX (uncompressed_bytes_decoded),
+            decode->chunk.unpacked_size);
+    }
+    return rv;
+}
+
+/**************************************/
+
 exr_result_t
 exr_decoding_destroy (exr_const_context_t ctxt, exr_decode_pipeline_t* decode)
 {
@@ -209,12 +209,13 @@ exr_encoding_update (
 
 /**************************************/
 
-exr_result_t
-exr_encoding_run (
+static exr_result_t
+encoding_run (
     exr_const_context_t ctxt, int part_index, exr_encode_pipeline_t* encode)
 {
     exr_result_t rv           = EXR_ERR_SUCCESS;
     uint64_t     packed_bytes = 0;
+    uint64_t     stage_start;
     EXR_LOCK_WRITE_AND_DEFINE_PART (part_index);
 
     if (!encode)
@@ -252,6 +253,16 @@ exr_encoding_run (
                 ctxt,
                 EXR_ERR_INVALID_ARGUMENT,
                 "Unexpected 0-width chunk to encode"));
+
+        /* pre-packed data, nothing to read from the channel pointers */
+        if (!encode->convert_and_pack_fn)
+        {
+            packed_bytes +=
+                ((uint64_t) (encc->height) * (uint64_t) (encc->width) *
+                 (uint64_t) (encc->bytes_per_element));
+            continue;
+        }
+
         if (!encc->encode_from_ptr)
             return EXR_UNLOCK_WRITE_AND_RETURN (ctxt->print_error (
                 ctxt,
@@ -290,9 +301,9 @@ exr_encoding_run (
              (uint64_t) (encc->bytes_per_element));
     }
 
-    encode->packed_bytes = 0;
     if (encode->convert_and_pack_fn)
     {
+        encode->packed_bytes = 0;
         if (packed_bytes > 0)
         {
             rv = internal_encode_alloc_buffer (
@@ -303,11 +314,31 @@ exr_encoding_run (
                 packed_bytes);
 
             if (rv == EXR_ERR_SUCCESS)
+            {
+                stage_start = internal_exr_stage_begin (
+                    ctxt,
+                    part_index,
+                    &(encode->chunk),
+                    EXR_TRACE_STAGE_PACK,
+                    packed_bytes,
+                    packed_bytes);
                 rv = encode->convert_and_pack_fn (encode);
+                internal_exr_stage_end (
+                    ctxt,
+                    part_index,
+                    &(encode->chunk),
+                    EXR_TRACE_STAGE_PACK,
+                    stage_start,
+                    packed_bytes,
+                    encode->packed_bytes);
+            }
         }
     }
-    else if (!encode->packed_buffer || packed_bytes != encode->compressed_bytes)
+    else if (!encode->packed_buffer || packed_bytes != encode->packed_bytes)
     {
+        /* data already packed by the caller (i.e. when transcoding
+         * the raw bytes of a chunk read from another file) must be
+         * exactly the size of the chunk */
         return EXR_UNLOCK_WRITE_AND_RETURN (ctxt->report_error (
             ctxt,
             EXR_ERR_INVALID_ARGUMENT,
@@ -315,6 +346,9 @@ exr_encoding_run (
     }
     if (ctxt->mode == EXR_CONTEXT_WRITE) internal_exr_unlock (ctxt);
 
+    if (rv == EXR_ERR_SUCCESS && part->chunk_stats_offset > 0)
+        internal_exr_compute_chunk_stats (encode, part);
+
     if ((part->storage_mode == EXR_STORAGE_DEEP_SCANLINE ||
          part->storage_mode == EXR_STORAGE_DEEP_TILED) &&
         encode->sample_count_table != NULL)
@@ -328,7 +362,22 @@ exr_encoding_run (
     {
         if (encode->compress_fn && encode->packed_bytes > 0)
         {
+            stage_start = internal_exr_stage_begin (
+                ctxt,
+                part_index,
+                &(encode->chunk),
+                EXR_TRACE_STAGE_COMPRESS,
+                encode->packed_bytes,
+                encode->packed_bytes);
             rv = encode->compress_fn (encode);
+            internal_exr_stage_end (
+                ctxt,
+                part_index,
+                &(encode->chunk),
+                EXR_TRACE_STAGE_COMPRESS,
+                stage_start,
+                encode->packed_bytes,
+                encode->compressed_bytes);
         }
         else
         {
@@ -360,7 +409,24 @@ exr_encoding_run (
         rv = encode->yield_until_ready_fn (encode);
 
     if (rv == EXR_ERR_SUCCESS && encode->write_fn)
+    {
+        stage_start = internal_exr_stage_begin (
+            ctxt,
+            part_index,
+            &(encode->chunk),
+            EXR_TRACE_STAGE_WRITE,
+            encode->compressed_bytes,
+            encode->compressed_bytes);
         rv = encode->write_fn (encode);
+        internal_exr_stage_end (
+            ctxt,
+            part_index,
+            &(encode->chunk),
+            EXR_TRACE_STAGE_WRITE,
+            stage_start,
+            encode->compressed_bytes,
+            encode->compressed_bytes);
+    }
 
     if ((part->storage_mode == EXR_STORAGE_DEEP_SCANLINE ||
          part->storage_mode == EXR_STORAGE_DEEP_TILED) &&
@@ -376,6 +442,48 @@ exr_encoding_run (
 
 /**************************************/
 
+exr_result_t
+exr_encoding_run (
+    exr_const_context_t ctxt, int part_index, exr_encode_pipeline_t* encode)
+{
+    exr_result_t rv;
+    size_t       reserved = 0;
+
+    /* the packed buffer and a compressed buffer of about the same
+     * size, deep data is only known by its packed size */
+    if (ctxt && encode && ctxt->memory_budget > 0)
+    {
+        uint64_t sz = encode->chunk.unpacked_size;
+        if (encode->packed_bytes > sz) sz = encode->packed_bytes;
+        reserved = (size_t) (2 * sz);
+        if (reserved > 0) internal_exr_reserve_memory (ctxt, reserved);
+    }
+
+    rv = encoding_run (ctxt, part_index, encode);
+
+    if (reserved > 0) internal_exr_release_memory (ctxt, reserved);
+
+    if (rv == EXR_ERR_SUCCESS)
+    {
+        internal_exr_perf_add (
+            ctxt,
+            EXR_PERF_IDX (chunks_encoded) +
+                (size_t) ctxt->parts[part_index]->comp_type,
+            1);
+        internal_exr_perf_add (
+            ctxt,
+            EXR_PERF_IDX (compressed_bytes_encoded),
+            encode->compressed_bytes);
+        internal_exr_perf_add (
+            ctxt,
+            EXR_PERF_IDX (uncompressed_bytes_encoded),
+            encode->packed_bytes);
+    }
+    return rv;
+}
+
+/**************************************/
+
 exr_result_t
 exr_encoding_destroy (exr_const_context_t ctxt, exr_encode_pipeline_t* encode)
 {
@@ -0,0 +1,29 @@
+/*
+** SPDX-License-Identifier: BSD-3-Clause
+** Copyright Contributors to the OpenEXR Project.
+*/
+
+#ifndef OPENEXR_PRIVATE_CHUNK_CACHE_H
+#define OPENEXR_PRIVATE_CHUNK_CACHE_H
+
+#include "internal_structs.h"
+#include "openexr_decode.h"
+
+/* whether a cache size has been set; a relaxed read that does not
+ * take the cache lock, so it may briefly lag exr_set_chunk_cache_size */
+int internal_exr_chunk_cache_enabled (void);
+
+/* copies the decompressed data of the chunk of the pipeline into its
+ * unpacked buffer (of at least unpacked_size bytes) if the cache has
+ * it. Returns 1 when found, 0 when not and -1 when the cache is
+ * disabled */
+int internal_exr_chunk_cache_fetch (
+    exr_const_context_t ctxt, int part_index, exr_decode_pipeline_t* decode);
+
+/* adds the freshly decompressed unpacked buffer of the pipeline */
+void internal_exr_chunk_cache_store (
+    exr_const_context_t          ctxt,
+    int                          part_index,
+    const exr_decode_pipeline_t* decode);
+
+#endif /* OPENEXR_PRIVATE_CHUNK_CACHE_H */
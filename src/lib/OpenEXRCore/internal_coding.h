@@ -107,6 +107,58 @@ exr_result_t internal_decode_alloc_buffer (
     size_t*                              cursz,
     size_t                               newsz);
 
+/* record the statistics of the freshly packed chunk in the part's
+ * chunk statistics attribute */
+void internal_exr_compute_chunk_stats (
+    exr_encode_pipeline_t* encode, exr_const_priv_part_t part);
+
+uint64_t internal_exr_clock_ns (void);
+
+void internal_exr_emit_trace (
+    exr_const_context_t     ctxt,
+    int                     part_index,
+    const exr_chunk_info_t* cinfo,
+    exr_trace_stage_t       stage,
+    int                     is_end,
+    uint64_t                time_ns,
+    uint64_t                in_bytes,
+    uint64_t                out_bytes);
+
+/* start of a pipeline stage, returns the time to pass to the end */
+static inline uint64_t
+internal_exr_stage_begin (
+    exr_const_context_t     ctxt,
+    int                     part_index,
+    const exr_chunk_info_t* cinfo,
+    exr_trace_stage_t       stage,
+    uint64_t                in_bytes,
+    uint64_t                out_bytes)
+{
+    uint64_t now = internal_exr_clock_ns ();
+    if (ctxt->trace_fn)
+        internal_exr_emit_trace (
+            ctxt, part_index, cinfo, stage, 0, now, in_bytes, out_bytes);
+    return now;
+}
+
+static inline void
+internal_exr_stage_end (
+    exr_const_context_t     ctxt,
+    int                     part_index,
+    const exr_chunk_info_t* cinfo,
+    exr_trace_stage_t       stage,
+    uint64_t                start_ns,
+    uint64_t                in_bytes,
+    uint64_t                out_bytes)
+{
+    uint64_t now = internal_exr_clock_ns ();
+    internal_exr_perf_add (
+        ctxt, EXR_PERF_IDX (stage_ns) + (size_t) stage, now - start_ns);
+    if (ctxt->trace_fn)
+        internal_exr_emit_trace (
+            ctxt, part_index, cinfo, stage, 1, now, in_bytes, out_bytes);
+}
+
 /**************************************/
 
 static inline float
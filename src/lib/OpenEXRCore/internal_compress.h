@@ -8,6 +8,10 @@
 
 #include "openexr_encode.h"
 
+/** Short lower case name of a compression type, as used by exrheader
+ * and the trace writer, or NULL for an invalid type. */
+const char* internal_exr_compression_name (exr_compression_t comptype);
+
 uint64_t internal_rle_compress (
     void* out, uint64_t outbytes, const void* src, uint64_t srcbytes);
 
@@ -28,6 +28,10 @@ int32_t internal_exr_compute_chunk_offset_size (exr_priv_part_t curpart);
 
 exr_result_t internal_exr_calc_header_version_flags (exr_const_context_t ctxt, uint32_t *flags);
 exr_result_t internal_exr_write_header (exr_context_t ctxt);
+/* add the requested header padding to the last part before writing */
+exr_result_t internal_exr_add_header_padding (exr_context_t ctxt);
+/* rewrite the header of a file opened for update over the old one */
+exr_result_t internal_exr_update_header (exr_context_t ctxt);
 
 /* in openexr_validate.c, functions to validate the header during read / pre-write */
 exr_result_t
@@ -7,6 +7,7 @@
 #define OPENEXR_PRIVATE_MEMORY_H
 
 #include "openexr_base.h"
+#include "openexr_context.h"
 
 #if defined(__GNUC__) || defined(__clang__)
 __attribute__ ((malloc))
@@ -23,4 +24,15 @@ internal_exr_alloc_aligned (
 
 void internal_exr_free (void* ptr);
 
+/* buffer pool used for transcoding buffers, see buffer_pool.c */
+void internal_exr_pool_retain (exr_buffer_pool_t pool);
+
+/* allocates at least bytes, storing the usable size in allocsz */
+void* internal_exr_pool_alloc (
+    exr_buffer_pool_t pool, size_t bytes, size_t* allocsz);
+
+/* allocsz must be the size returned by the matching allocation */
+void
+internal_exr_pool_free (exr_buffer_pool_t pool, void* ptr, size_t allocsz);
+
 #endif /* OPENEXR_PRIVATE_MEMORY_H */
@@ -324,6 +324,35 @@ default_write_func (
 
 /**************************************/
 
+/* identifies the file for the chunk cache, a file replaced or
+ * rewritten in place gets a new identity */
+static void
+default_file_identity (exr_context_t file, int fd)
+{
+    struct stat sbuf;
+    uint64_t    mtime;
+
+    if (fstat (fd, &sbuf) != 0) return;
+
+#if defined(__APPLE__)
+    mtime = (uint64_t) sbuf.st_mtimespec.tv_sec * (uint64_t) 1000000000 +
+            (uint64_t) sbuf.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+    mtime = (uint64_t) sbuf.st_mtim.tv_sec * (uint64_t) 1000000000 +
+            (uint64_t) sbuf.st_mtim.tv_nsec;
+#else
+    mtime = (uint64_t) sbuf.st_mtime * (uint64_t) 1000000000;
+#endif
+
+    file->file_id[0]  = (uint64_t) sbuf.st_dev;
+    file->file_id[1]  = (uint64_t) sbuf.st_ino;
+    file->file_id[2]  = mtime;
+    file->file_id[3]  = (uint64_t) sbuf.st_size;
+    file->has_file_id = 1;
+}
+
+/**************************************/
+
 static exr_result_t
 default_init_read_file (exr_context_t file)
 {
@@ -355,6 +384,7 @@ default_init_read_file (exr_context_t file)
             strerror (errno));
 
     fh->fd = fd;
+    default_file_identity (file, fd);
     return EXR_ERR_SUCCESS;
 }
 
@@ -401,6 +431,44 @@ default_init_write_file (exr_context_t file)
 
 /**************************************/
 
+static exr_result_t
+default_init_update_file (exr_context_t file)
+{
+    int                              fd;
+    struct _internal_exr_filehandle* fh = file->user_data;
+
+    fh->fd = -1;
+#if !CAN_USE_PREAD
+#    ifdef ILMTHREAD_THREADING_ENABLED
+    fd = pthread_mutex_init (&(fh->mutex), NULL);
+    if (fd != 0)
+        return file->print_error (
+            file,
+            EXR_ERR_OUT_OF_MEMORY,
+            "Unable to initialize file mutex: %s",
+            strerror (fd));
+#    endif
+#endif
+
+    file->destroy_fn = &default_shutdown;
+    file->read_fn    = &default_read_func;
+    file->write_fn   = &default_write_func;
+
+    fd = open (file->filename.str, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        return file->print_error (
+            file,
+            EXR_ERR_FILE_ACCESS,
+            "Unable to open file for update: %s",
+            strerror (errno));
+
+    fh->fd = fd;
+    default_file_identity (file, fd);
+    return EXR_ERR_SUCCESS;
+}
+
+/**************************************/
+
 static int64_t
 default_query_size_func (exr_const_context_t ctxt, void* userdata)
 {
@@ -184,6 +184,95 @@ internal_exr_destroy_parts (exr_context_t ctxt)
     if (ctxt->num_parts > 1) dofree (ctxt->parts);
     ctxt->parts     = NULL;
     ctxt->num_parts = 0;
+
+    if (ctxt->part_name_index) dofree (ctxt->part_name_index);
+    ctxt->part_name_index      = NULL;
+    ctxt->part_name_index_size = 0;
+}
+
+/**************************************/
+
+static const char*
+part_name (exr_const_priv_part_t part)
+{
+    if (!part->name || part->name->type != EXR_ATTR_STRING) return NULL;
+    return part->name->string->str;
+}
+
+static uint32_t
+hash_part_name (const char* name)
+{
+    /* FNV-1a */
+    uint32_t h = 2166136261u;
+    while (*name)
+    {
+        h ^= (uint8_t) *name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void
+internal_exr_build_part_name_index (exr_context_t ctxt)
+{
+    int  size = 2;
+    int* index;
+
+    if (ctxt->part_name_index || ctxt->num_parts < 2) return;
+
+    while (size < ctxt->num_parts * 2)
+        size *= 2;
+
+    /* the index only speeds up lookups, so carry on without it if
+     * there is not enough memory */
+    index = ctxt->alloc_fn (sizeof (int) * (size_t) size);
+    if (!index) return;
+
+    for (int i = 0; i < size; ++i)
+        index[i] = -1;
+
+    for (int p = 0; p < ctxt->num_parts; ++p)
+    {
+        const char* name = part_name (ctxt->parts[p]);
+        uint32_t    slot;
+
+        if (!name) continue;
+
+        slot = hash_part_name (name) & (uint32_t) (size - 1);
+        while (index[slot] >= 0)
+            slot = (slot + 1) & (uint32_t) (size - 1);
+        index[slot] = p;
+    }
+
+    ctxt->part_name_index      = index;
+    ctxt->part_name_index_size = size;
+}
+
+int
+internal_exr_find_part_by_name (exr_const_context_t ctxt, const char* name)
+{
+    if (ctxt->part_name_index)
+    {
+        uint32_t mask = (uint32_t) (ctxt->part_name_index_size - 1);
+        uint32_t slot = hash_part_name (name) & mask;
+        int      p;
+
+        /* parts were inserted in order, so with duplicate names the
+         * first probe hit is the lowest index, like the scan below */
+        while ((p = ctxt->part_name_index[slot]) >= 0)
+        {
+            if (!strcmp (part_name (ctxt->parts[p]), name)) return p;
+            slot = (slot + 1) & mask;
+        }
+        return -1;
+    }
+
+    for (int p = 0; p < ctxt->num_parts; ++p)
+    {
+        const char* pname = part_name (ctxt->parts[p]);
+        if (pname && !strcmp (pname, name)) return p;
+    }
+    return -1;
 }
 
 /**************************************/
@@ -396,6 +485,8 @@ internal_exr_alloc_context (
              EXR_CONTEXT_FLAG_DISABLE_CHUNK_RECONSTRUCTION);
         ret->legacy_header =
             (initializers->flags & EXR_CONTEXT_FLAG_WRITE_LEGACY_HEADER);
+        if (initializers->flags & EXR_CONTEXT_FLAG_DISABLE_CHUNK_CACHE)
+            ret->disable_chunk_cache = 1;
 
         ret->file_size       = -1;
         ret->max_name_length = EXR_SHORTNAME_MAXLEN;
@@ -404,9 +495,14 @@ internal_exr_alloc_context (
         ret->read_fn    = initializers->read_fn;
         ret->write_fn   = initializers->write_fn;
 
+        ret->memory_budget = initializers->memory_budget;
+        ret->trace_fn        = initializers->trace_fn;
+        ret->trace_user_data = initializers->trace_user_data;
+
 #ifdef ILMTHREAD_THREADING_ENABLED
 #    ifdef _WIN32
         InitializeCriticalSection (&(ret->mutex));
+        InitializeConditionVariable (&(ret->memory_cond));
 #    else
         rv = pthread_mutex_init (&(ret->mutex), NULL);
         if (rv != 0)
@@ -416,9 +512,38 @@ internal_exr_alloc_context (
             *out = NULL;
             return EXR_ERR_OUT_OF_MEMORY;
         }
+        rv = pthread_cond_init (&(ret->memory_cond), NULL);
+        if (rv != 0)
+        {
+            pthread_mutex_destroy (&(ret->mutex));
+            (initializers->free_fn) (memptr);
+            *out = NULL;
+            return EXR_ERR_OUT_OF_MEMORY;
+        }
 #    endif
 #endif
 
+        if (initializers->buffer_pool)
+        {
+            ret->buffer_pool = initializers->buffer_pool;
+            internal_exr_pool_retain (ret->buffer_pool);
+        }
+        else if (
+            initializers->flags & (EXR_CONTEXT_FLAG_PRIVATE_BUFFER_POOL |
+                                   EXR_CONTEXT_FLAG_HUGE_PAGE_BUFFERS))
+        {
+            /* not fatal, the pool is left NULL and buffers are then
+             * allocated for every chunk */
+            exr_buffer_pool_create (
+                &(ret->buffer_pool),
+                EXR_DEFAULT_BUFFER_POOL_CACHE_SIZE,
+                initializers->alloc_fn,
+                initializers->free_fn);
+            if (ret->buffer_pool &&
+                (initializers->flags & EXR_CONTEXT_FLAG_HUGE_PAGE_BUFFERS))
+                exr_buffer_pool_set_huge_pages (ret->buffer_pool, 1);
+        }
+
         *out = ret;
         rv   = EXR_ERR_SUCCESS;
 
@@ -433,6 +558,7 @@ internal_exr_alloc_context (
                 /* this should never happen since we reserve space for
                  * one in the struct, but maybe we changed
                  * something */
+                exr_buffer_pool_release (ret->buffer_pool);
                 (initializers->free_fn) (memptr);
                 *out = NULL;
             }
@@ -461,10 +587,12 @@ internal_exr_destroy_context (exr_context_t ctxt)
     exr_attr_string_destroy (ctxt, &(ctxt->tmp_filename));
     exr_attr_list_destroy (ctxt, &(ctxt->custom_handlers));
     internal_exr_destroy_parts (ctxt);
+    exr_buffer_pool_release (ctxt->buffer_pool);
 #ifdef ILMTHREAD_THREADING_ENABLED
 #    ifdef _WIN32
     DeleteCriticalSection (&(ctxt->mutex));
 #    else
+    pthread_cond_destroy (&(ctxt->memory_cond));
     pthread_mutex_destroy (&(ctxt->mutex));
 #    endif
 #endif
@@ -474,6 +602,51 @@ internal_exr_destroy_context (exr_context_t ctxt)
 
 /**************************************/
 
+void
+internal_exr_reserve_memory (exr_const_context_t ctxt, size_t bytes)
+{
+    exr_context_t nonc = EXR_CONST_CAST (exr_context_t, ctxt);
+
+    if (ctxt->memory_budget == 0) return;
+
+    internal_exr_lock (ctxt);
+#ifdef ILMTHREAD_THREADING_ENABLED
+    /* a chunk larger than the whole budget still runs, alone */
+    while (nonc->memory_reserved > 0 &&
+           nonc->memory_reserved + bytes > nonc->memory_budget)
+    {
+#    ifdef _WIN32
+        SleepConditionVariableCS (&nonc->memory_cond, &nonc->mutex, INFINITE);
+#    else
+        pthread_cond_wait (&nonc->memory_cond, &nonc->mutex);
+#    endif
+    }
+#endif
+    nonc->memory_reserved += bytes;
+    internal_exr_unlock (ctxt);
+}
+
+void
+internal_exr_release_memory (exr_const_context_t ctxt, size_t bytes)
+{
+    exr_context_t nonc = EXR_CONST_CAST (exr_context_t, ctxt);
+
+    if (ctxt->memory_budget == 0) return;
+
+    internal_exr_lock (ctxt);
+    nonc->memory_reserved -= bytes;
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    WakeAllConditionVariable (&nonc->memory_cond);
+#    else
+    pthread_cond_broadcast (&nonc->memory_cond);
+#    endif
+#endif
+    internal_exr_unlock (ctxt);
+}
+
+/**************************************/
+
 void
 internal_exr_update_default_handlers (exr_context_initializer_t* inits)
 {
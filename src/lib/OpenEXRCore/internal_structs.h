@@ -8,6 +8,7 @@
 
 #include "openexr_config.h"
 #include "internal_attr.h"
+#include "openexr_debug.h"
 
 #ifdef ILMTHREAD_THREADING_ENABLED
 #    ifdef _WIN32
@@ -37,6 +38,7 @@
 #ifdef __cplusplus
 #    include <atomic>
 using atomic_uintptr_t = std::atomic_uintptr_t;
+using atomic_uint_least64_t = std::atomic_uint_least64_t;
 #else
 /* msvc, from version 19.31, evaluate __has_include(<stdatomic.h>) to true but
  * doesn't actually support it yet. Ignoring msvc for now, once we know minimal
@@ -56,6 +58,7 @@ using atomic_uintptr_t = std::atomic_uintptr_t;
 #        include <stdint.h>
 #        include <windows.h>
 typedef uintptr_t volatile atomic_uintptr_t;
+typedef uint64_t volatile atomic_uint_least64_t;
 
 static inline uintptr_t
 atomic_load (
@@ -140,6 +143,10 @@ struct _priv_exr_part_t
     int32_t          chunk_count;
     uint64_t         chunk_table_offset;
     atomic_uintptr_t chunk_table;
+
+    /* file offset of the chunk statistics attribute value when
+     * writing, 0 if the part does not record statistics */
+    uint64_t chunk_stats_offset;
 };
 
 typedef struct _priv_exr_part_t*       exr_priv_part_t;
@@ -161,6 +168,11 @@ enum _INTERNAL_EXR_CONTEXT_MODE
     EXR_CONTEXT_WRITE_FINISHED
 };
 
+#define EXR_PERF_COUNTER_COUNT                                                 \
+    (sizeof (exr_perf_counters_t) / sizeof (uint64_t))
+#define EXR_PERF_IDX(field)                                                    \
+    (offsetof (exr_perf_counters_t, field) / sizeof (uint64_t))
+
 struct _priv_exr_context_t
 {
     uint8_t mode;
@@ -200,6 +212,9 @@ struct _priv_exr_context_t
     exr_memory_allocation_func_t alloc_fn;
     exr_memory_free_func_t       free_fn;
 
+    /* transcoding buffers come from here, NULL if disabled */
+    exr_buffer_pool_t buffer_pool;
+
     int max_image_w;
     int max_image_h;
     int max_tile_w;
@@ -215,6 +230,10 @@ struct _priv_exr_context_t
     int64_t             file_size;
     exr_read_func_ptr_t read_fn;
 
+    /* device, inode / file index, modification time and size of a
+     * file opened by name, see has_file_id */
+    uint64_t file_id[4];
+
     exr_write_func_ptr_t write_fn;
     /* used when writing under a mutex, is there a better way? */
     uint64_t output_file_offset;
@@ -230,6 +249,12 @@ struct _priv_exr_context_t
     exr_priv_part_t  init_part;
     exr_priv_part_t* parts;
 
+    /* open addressing hash of part names to part indices, built once
+     * the header of a multi-part file has been read, -1 is an empty
+     * slot. NULL when not built, lookups then scan the parts */
+    int* part_name_index;
+    int  part_name_index_size;
+
     exr_attribute_list_t custom_handlers;
 
     /* mostly needed for writing, but used during read to ensure
@@ -241,14 +266,140 @@ struct _priv_exr_context_t
     pthread_mutex_t mutex;
 #    endif
 #endif
+
+    /* memory estimated for the chunks being decoded or encoded, runs
+     * wait (under the mutex above) while it is over the budget. A
+     * budget of 0 is unlimited */
+    size_t memory_budget;
+    size_t memory_reserved;
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    CONDITION_VARIABLE memory_cond;
+#    else
+    pthread_cond_t memory_cond;
+#    endif
+#endif
+
+    exr_trace_func_ptr_t trace_fn;
+    void*                trace_user_data;
+
+    /* exr_perf_counters_t, field by field */
+    atomic_uint_least64_t perf_counters[EXR_PERF_COUNTER_COUNT];
+
     uint8_t disable_chunk_reconstruct;
     uint8_t legacy_header;
-    uint8_t _pad[2];
+    uint8_t disable_chunk_cache;
+    uint8_t has_file_id;
     uint32_t orig_version_and_flags;
+
+    /* bytes of header space reserved for later in-place updates */
+    int32_t header_padding;
 };
 
 #define EXR_CONST_CAST(t, v) ((t) (uintptr_t) v)
 
+static inline atomic_uint_least64_t*
+internal_exr_perf_counter (exr_const_context_t c, size_t idx)
+{
+    return EXR_CONST_CAST (atomic_uint_least64_t*, &(c->perf_counters[idx]));
+}
+
+static inline uint64_t
+internal_exr_perf_load (exr_const_context_t c, size_t idx)
+{
+#if defined(__cplusplus)
+    return internal_exr_perf_counter (c, idx)->load (
+        std::memory_order_relaxed);
+#elif defined(EXR_HAS_STD_ATOMICS)
+    return atomic_load_explicit (
+        internal_exr_perf_counter (c, idx), memory_order_relaxed);
+#else
+    return (uint64_t) InterlockedOr64 (
+        (LONG64 volatile*) internal_exr_perf_counter (c, idx), 0);
+#endif
+}
+
+static inline void
+internal_exr_perf_store (exr_const_context_t c, size_t idx, uint64_t v)
+{
+#if defined(__cplusplus)
+    internal_exr_perf_counter (c, idx)->store (v, std::memory_order_relaxed);
+#elif defined(EXR_HAS_STD_ATOMICS)
+    atomic_store_explicit (
+        internal_exr_perf_counter (c, idx), v, memory_order_relaxed);
+#else
+    InterlockedExchange64 (
+        (LONG64 volatile*) internal_exr_perf_counter (c, idx), (LONG64) v);
+#endif
+}
+
+/* returns the new value */
+static inline uint64_t
+internal_exr_perf_add (exr_const_context_t c, size_t idx, uint64_t v)
+{
+#if defined(__cplusplus)
+    return internal_exr_perf_counter (c, idx)->fetch_add (
+               v, std::memory_order_relaxed) +
+           v;
+#elif defined(EXR_HAS_STD_ATOMICS)
+    return atomic_fetch_add_explicit (
+               internal_exr_perf_counter (c, idx), v, memory_order_relaxed) +
+           v;
+#else
+    return (uint64_t) InterlockedExchangeAdd64 (
+               (LONG64 volatile*) internal_exr_perf_counter (c, idx),
+               (LONG64) v) +
+           v;
+#endif
+}
+
+static inline int
+internal_exr_perf_cas (
+    exr_const_context_t c, size_t idx, uint64_t* expected, uint64_t desired)
+{
+#if defined(__cplusplus)
+    atomic_uint_least64_t* a = internal_exr_perf_counter (c, idx);
+    uint_least64_t         e = *expected;
+    bool ok = a->compare_exchange_weak (e, desired, std::memory_order_relaxed);
+    *expected = e;
+    return ok ? 1 : 0;
+#elif defined(EXR_HAS_STD_ATOMICS)
+    return atomic_compare_exchange_weak_explicit (
+        internal_exr_perf_counter (c, idx),
+        expected,
+        desired,
+        memory_order_relaxed,
+        memory_order_relaxed);
+#else
+    uint64_t prev = (uint64_t) InterlockedCompareExchange64 (
+        (LONG64 volatile*) internal_exr_perf_counter (c, idx),
+        (LONG64) desired,
+        (LONG64) *expected);
+    if (prev == *expected) return 1;
+    *expected = prev;
+    return 0;
+#endif
+}
+
+/* raise the counter to v if it is lower */
+static inline void
+internal_exr_perf_max (exr_const_context_t c, size_t idx, uint64_t v)
+{
+    uint64_t cur = internal_exr_perf_load (c, idx);
+    while (cur < v && !internal_exr_perf_cas (c, idx, &cur, v))
+        ;
+}
+
+/* lower the counter by v, stopping at 0 should the caller hand the
+ * library a buffer it did not allocate */
+static inline void
+internal_exr_perf_sub (exr_const_context_t c, size_t idx, uint64_t v)
+{
+    uint64_t cur = internal_exr_perf_load (c, idx);
+    while (!internal_exr_perf_cas (c, idx, &cur, cur > v ? cur - v : 0))
+        ;
+}
+
 static inline void
 internal_exr_lock (exr_const_context_t c)
 {
@@ -281,6 +432,14 @@ internal_exr_unlock (exr_const_context_t c)
                                                : ((void) 0)),                  \
      v)
 
+/* whether attributes may be added or change size: while a header is
+ * defined, and when updating one in place, where the new header must
+ * still fit the space of the old one once it is written back */
+#define EXR_CAN_RESIZE_HEADER(ctxt)                                            \
+    ((ctxt)->mode == EXR_CONTEXT_WRITE ||                                      \
+     (ctxt)->mode == EXR_CONTEXT_TEMPORARY ||                                  \
+     (ctxt)->mode == EXR_CONTEXT_UPDATE_HEADER)
+
 #define EXR_LOCK_AND_DEFINE_PART(pi)                                           \
     exr_priv_part_t part;                                                      \
     if (!ctxt) return EXR_ERR_MISSING_CONTEXT_ARG;                             \
@@ -350,4 +509,24 @@ exr_result_t internal_exr_alloc_context (
     size_t                           extra_data);
 void internal_exr_destroy_context (exr_context_t ctxt);
 
+/* reserve / return bytes of the context memory budget for a chunk
+ * run, waiting for other runs to finish while over budget */
+void internal_exr_reserve_memory (exr_const_context_t ctxt, size_t bytes);
+void internal_exr_release_memory (exr_const_context_t ctxt, size_t bytes);
+
+void internal_exr_build_part_name_index (exr_context_t ctxt);
+int  internal_exr_find_part_by_name (exr_const_context_t ctxt, const char* name);
+
+/* the per-channel values of a constant chunk stored in the part's
+ * constant chunk attribute, or NULL if the chunk is not constant */
+const uint8_t* internal_exr_constant_chunk (
+    exr_const_context_t ctxt, exr_const_priv_part_t part, int cidx);
+
+/* size the chunk statistics attribute of a part about to be written,
+ * and write its value once all chunks of the part are written */
+exr_result_t internal_exr_prepare_chunk_stats (
+    exr_context_t ctxt, exr_priv_part_t part);
+exr_result_t internal_exr_write_chunk_stats (
+    exr_context_t ctxt, exr_const_priv_part_t part);
+
 #endif /* OPENEXR_PRIVATE_STRUCTS_H */
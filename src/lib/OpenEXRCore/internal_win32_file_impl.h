@@ -287,6 +287,27 @@ default_write_func (
 
 /**************************************/
 
+/* identifies the file for the chunk cache, a file replaced or
+ * rewritten in place gets a new identity */
+static void
+default_file_identity (exr_context_t file, HANDLE fd)
+{
+    BY_HANDLE_FILE_INFORMATION info;
+
+    if (!GetFileInformationByHandle (fd, &info)) return;
+
+    file->file_id[0] = (uint64_t) info.dwVolumeSerialNumber;
+    file->file_id[1] = ((uint64_t) info.nFileIndexHigh << 32) |
+                       (uint64_t) info.nFileIndexLow;
+    file->file_id[2] = ((uint64_t) info.ftLastWriteTime.dwHighDateTime << 32) |
+                       (uint64_t) info.ftLastWriteTime.dwLowDateTime;
+    file->file_id[3] = ((uint64_t) info.nFileSizeHigh << 32) |
+                       (uint64_t) info.nFileSizeLow;
+    file->has_file_id = 1;
+}
+
+/**************************************/
+
 static exr_result_t
 default_init_read_file (exr_context_t file)
 {
@@ -329,6 +350,7 @@ default_init_read_file (exr_context_t file)
             file, EXR_ERR_OUT_OF_MEMORY, "Unable to allocate unicode filename");
 
     fh->fd = fd;
+    default_file_identity (file, fd);
 
     return EXR_ERR_SUCCESS;
 }
@@ -385,6 +407,56 @@ default_init_write_file (exr_context_t file)
 
 /**************************************/
 
+static exr_result_t
+default_init_update_file (exr_context_t file)
+{
+    wchar_t*                         wcFn = NULL;
+    HANDLE                           fd;
+    struct _internal_exr_filehandle* fh = file->user_data;
+
+    fh->fd           = INVALID_HANDLE_VALUE;
+    file->destroy_fn = &default_shutdown;
+    file->read_fn    = &default_read_func;
+    file->write_fn   = &default_write_func;
+
+    wcFn = widen_filename (file, file->filename.str);
+    if (wcFn)
+    {
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+        fd = CreateFile2 (
+            wcFn,
+            GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            OPEN_EXISTING,
+            NULL);
+#else
+        fd = CreateFileW (
+            wcFn,
+            GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            NULL);
+#endif
+        file->free_fn (wcFn);
+
+        if (fd == INVALID_HANDLE_VALUE)
+            return print_error (
+                file, EXR_ERR_FILE_ACCESS, "Unable to open file for update");
+    }
+    else
+        return print_error (
+            file, EXR_ERR_OUT_OF_MEMORY, "Unable to allocate unicode filename");
+
+    fh->fd = fd;
+    default_file_identity (file, fd);
+
+    return EXR_ERR_SUCCESS;
+}
+
+/**************************************/
+
 static int64_t
 default_query_size_func (exr_const_context_t ctxt, void* userdata)
 {
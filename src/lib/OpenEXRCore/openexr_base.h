@@ -194,6 +194,41 @@ EXR_EXPORT void exr_set_default_memory_routines (
 
 /** @} */
 
+/**
+ * @defgroup ChunkCache Process-wide cache of decompressed chunks
+ * @{
+ */
+
+/** @brief Set the size of the cache of decompressed chunks shared by
+ * all the contexts of the process.
+ *
+ * Contexts reading a file opened by name (not through custom read
+ * functions) look chunks up by file identity, part and chunk before
+ * reading and decompressing them, so several readers of the same
+ * file only decompress each chunk once. Deep and uncompressed chunks
+ * are not cached.
+ *
+ * The default of 0 disables the cache. Lowering the size evicts the
+ * least recently used chunks to fit.
+ *
+ * This function does not fail.
+ */
+EXR_EXPORT void exr_set_chunk_cache_size (size_t bytes);
+
+/** @brief Retrieve the size of the chunk cache and the bytes used.
+ *
+ * This function does not fail.
+ */
+EXR_EXPORT void exr_get_chunk_cache_size (size_t* bytes, size_t* used);
+
+/** @brief Empty the chunk cache, leaving its size unchanged.
+ *
+ * This function does not fail.
+ */
+EXR_EXPORT void exr_clear_chunk_cache (void);
+
+/** @} */
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -53,6 +53,32 @@ typedef struct
     uint64_t sample_count_table_size;
 } exr_chunk_info_t;
 
+/** @brief Name of the part attribute listing constant chunks.
+ *
+ * Writers may leave out chunks whose pixels all have the same value
+ * in every channel, recording them in an attribute of this name and
+ * of type \ref EXR_CONSTANT_CHUNKS_TYPE_NAME instead. The attribute
+ * holds, little-endian:
+ *
+ * - int32 chunk count of the part
+ * - int32 bytes per pixel, the sum of 2 or 4 over all channels
+ * - (count + 7) / 8 bytes of bitmap, bit (i % 8) of byte (i / 8) set
+ *   when chunk i is constant
+ * - count * bytes per pixel values, for each chunk the value of each
+ *   channel in channel list order, as it would be stored in the chunk
+ *
+ * A constant chunk has no data in the file and a 0 entry in the chunk
+ * table. Its chunk info reports a data_offset and packed_size of 0
+ * with the usual unpacked_size, and the decode pipeline fills the
+ * chunk without any I/O or decompression. Only scanline and tiled
+ * parts may have constant chunks. Readers unaware of the attribute
+ * see these chunks as missing.
+ */
+#define EXR_CONSTANT_CHUNKS_ATTR_NAME "constantChunks"
+
+/** @brief Type name of the \ref EXR_CONSTANT_CHUNKS_ATTR_NAME attribute. */
+#define EXR_CONSTANT_CHUNKS_TYPE_NAME "constchunks"
+
 /**************************************/
 
 /** initialize chunk info with the default values from the specified part
@@ -188,6 +214,69 @@ exr_result_t exr_write_deep_tile_chunk (
     const void*   sample_data,
     uint64_t      sample_data_size);
 
+/** @brief Name of the part attribute holding per-chunk statistics.
+ *
+ * A writer may record the minimum and maximum value of every channel
+ * in every chunk in an attribute of this name and of type \ref
+ * EXR_CHUNK_STATS_TYPE_NAME, so readers can tell whether a chunk is
+ * worth decoding (i.e. an alpha of 0 everywhere) from the header
+ * alone. The attribute holds, little-endian:
+ *
+ * - int32 chunk count of the part
+ * - int32 channel count of the part
+ * - count bytes, byte i non-zero when statistics were recorded for
+ *   chunk i
+ * - count * channels pairs of 4 byte values, for each chunk the
+ *   minimum and maximum of each channel in channel list order, as a
+ *   float for half and float channels and a uint32 for uint channels
+ *
+ * Only scanline and tiled parts have statistics.
+ */
+#define EXR_CHUNK_STATS_ATTR_NAME "chunkStats"
+
+/** @brief Type name of the \ref EXR_CHUNK_STATS_ATTR_NAME attribute. */
+#define EXR_CHUNK_STATS_TYPE_NAME "chunkstats"
+
+/** @brief Request per-chunk statistics for a part being written.
+ *
+ * Adds the \ref EXR_CHUNK_STATS_ATTR_NAME attribute to the part. It is
+ * sized when the header is written, filled in as the encode pipeline
+ * packs each chunk, and written out once the last chunk of the part
+ * has been written. Chunks written without going through
+ * \ref exr_encoding_run have no statistics.
+ *
+ * Statistics are only produced by the Core encoder. The C++ writers
+ * (OutputFile, TiledOutputFile and their part variants) compress
+ * chunks themselves rather than through an encode pipeline, so files
+ * they write never carry this attribute, even though they do skip
+ * constant chunks.
+ *
+ * Returns \ref EXR_ERR_INVALID_ARGUMENT for deep parts.
+ */
+EXR_EXPORT
+exr_result_t exr_add_chunk_stats (exr_context_t ctxt, int part_index);
+
+/** @brief Retrieve the range of values of a channel in a chunk.
+ *
+ * Returns the minimum and maximum value of the channel, by index in
+ * the channel list, within the chunk at chunk_index (the idx of the
+ * chunk info), as recorded in the part's \ref EXR_CHUNK_STATS_ATTR_NAME
+ * attribute. A reader can use this to skip decoding chunks entirely.
+ * The minimum is greater than the maximum when the chunk holds no
+ * samples of the channel, or for float channels only NaN values.
+ *
+ * Returns \ref EXR_ERR_NO_ATTR_BY_NAME when the part has no valid
+ * statistics or none were recorded for this chunk.
+ */
+EXR_EXPORT
+exr_result_t exr_get_chunk_stats (
+    exr_const_context_t ctxt,
+    int                 part_index,
+    int                 chunk_index,
+    int                 channel_index,
+    double*             minval,
+    double*             maxval);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -169,6 +169,125 @@ typedef int64_t (*exr_write_func_ptr_t) (
     uint64_t                    offset,
     exr_stream_error_func_ptr_t error_cb);
 
+/** @brief Opaque handle to a pool of transcoding buffers.
+ *
+ * Decoding and encoding pipelines allocate their packed, unpacked,
+ * compressed and scratch buffers for each chunk. A buffer pool keeps
+ * those buffers when a pipeline is done with them, sorted in size
+ * classes (four per power of two, starting at 256 bytes), so the
+ * next pipeline asking for a similar size reuses them instead of
+ * going back to the allocator.
+ *
+ * Contexts do not use a pool unless asked to, since every pool keeps
+ * memory cached, and an application may have hundreds of files open.
+ * A pool created with exr_buffer_pool_create() may be shared by any
+ * number of contexts, including contexts used from different threads,
+ * by passing it in the context initializer; its limit then bounds the
+ * memory cached for all of them. Alternatively, a context can be
+ * given a private pool with `EXR_CONTEXT_FLAG_PRIVATE_BUFFER_POOL`.
+ */
+typedef struct _exr_buffer_pool* exr_buffer_pool_t;
+
+/** @brief Maximum number of bytes a context's private buffer pool
+ * keeps cached (see `EXR_CONTEXT_FLAG_PRIVATE_BUFFER_POOL`).
+ */
+#define EXR_DEFAULT_BUFFER_POOL_CACHE_SIZE (16 * 1024 * 1024)
+
+/** @brief Create a buffer pool which can be shared between contexts.
+ *
+ * At most max_cached_bytes bytes of free buffers are kept; buffers
+ * released beyond that limit are returned to the allocator
+ * immediately. Buffers larger than the largest size class (1 GiB)
+ * are never cached.
+ *
+ * If either alloc_fn or free_fn is 0, the default routines (see
+ * exr_set_default_memory_routines()) are used for both.
+ *
+ * The pool holds one reference for the caller, and one more for each
+ * context using it. It is destroyed once all of them have been
+ * released.
+ */
+EXR_EXPORT exr_result_t exr_buffer_pool_create (
+    exr_buffer_pool_t*           pool,
+    size_t                       max_cached_bytes,
+    exr_memory_allocation_func_t alloc_fn,
+    exr_memory_free_func_t       free_fn);
+
+/** @brief Release the caller's reference to a buffer pool.
+ *
+ * Contexts still using the pool keep it alive until they are
+ * finished.
+ */
+EXR_EXPORT void exr_buffer_pool_release (exr_buffer_pool_t pool);
+
+/** @brief Return all cached buffers of a pool to the allocator.
+ *
+ * Buffers currently held by pipelines are not affected.
+ */
+EXR_EXPORT void exr_buffer_pool_trim (exr_buffer_pool_t pool);
+
+/** @brief Back the large buffers of a pool with huge pages.
+ *
+ * All pooled buffers are aligned to 64 bytes. With huge pages
+ * enabled, buffers of 2 MiB or more are additionally advised to use
+ * transparent huge pages where the platform supports it (Linux
+ * `madvise (MADV_HUGEPAGE)`), which reduces TLB misses when decoding
+ * big tiles or chunks. Only newly allocated buffers are affected.
+ *
+ * Huge page buffers are only worth it if they are reused, so the
+ * cache limit of the pool should leave room for the largest chunks.
+ */
+EXR_EXPORT exr_result_t
+exr_buffer_pool_set_huge_pages (exr_buffer_pool_t pool, int enable);
+
+/** @brief Query the number of bytes cached by a buffer pool. */
+EXR_EXPORT exr_result_t
+exr_buffer_pool_get_cached_size (exr_buffer_pool_t pool, size_t* bytes);
+
+/** @brief Stages of the decode and encode pipelines reported to a
+ * trace callback.
+ */
+typedef enum exr_trace_stage
+{
+    EXR_TRACE_STAGE_READ = 0,   /**< read_fn of a decode pipeline */
+    EXR_TRACE_STAGE_DECOMPRESS, /**< decompress_fn */
+    EXR_TRACE_STAGE_UNPACK,     /**< unpack_and_convert_fn */
+    EXR_TRACE_STAGE_PACK,       /**< convert_and_pack_fn */
+    EXR_TRACE_STAGE_COMPRESS,   /**< compress_fn */
+    EXR_TRACE_STAGE_WRITE,      /**< write_fn of an encode pipeline */
+    EXR_TRACE_STAGE_LAST_TYPE
+} exr_trace_stage_t;
+
+/** @brief Event passed to a trace callback when a pipeline stage
+ * starts or ends for a chunk.
+ *
+ * Byte counts are only known once a stage has run, so a start event
+ * carries the expected sizes and the matching end event the actual
+ * ones.
+ */
+typedef struct
+{
+    exr_trace_stage_t stage;
+    int32_t           is_end;      /**< 0 at the start, 1 at the end */
+    int32_t           part_index;
+    int32_t           chunk_index; /**< chunk index within the part */
+    int32_t           compression; /**< exr_compression_t of the part */
+    uint64_t          time_ns;     /**< monotonic clock, nanoseconds */
+    uint64_t          in_bytes;    /**< bytes consumed by the stage */
+    uint64_t          out_bytes;   /**< bytes produced by the stage */
+} exr_trace_event_t;
+
+/** @brief Trace callback
+ *
+ * Called from whichever thread runs the pipeline, so it must be
+ * thread safe, and should be quick since it is called twice per
+ * stage per chunk. It must not modify the context.
+ */
+typedef void (*exr_trace_func_ptr_t) (
+    exr_const_context_t      ctxt,
+    void*                    userdata,
+    const exr_trace_event_t* event);
+
 /** @brief Struct used to pass function pointers into the context
  * initialization routines.
  *
@@ -190,7 +309,7 @@ typedef int64_t (*exr_write_func_ptr_t) (
  * \endcode
  *
  */
-typedef struct _exr_context_initializer_v3
+typedef struct _exr_context_initializer_v4
 {
     /** @brief Size member to tag initializer for version stability.
      *
@@ -324,6 +443,33 @@ typedef struct _exr_context_initializer_v3
     int flags;
 
     uint8_t pad[4];
+
+    /** Initialize a buffer pool, created with exr_buffer_pool_create(),
+     * to be used for the transcoding buffers of this context instead
+     * of a private one. The context holds a reference to the pool
+     * until it is finished.
+     */
+    exr_buffer_pool_t buffer_pool;
+
+    /** Initialize a budget, in bytes, for the chunks decoded or
+     * encoded at the same time with this context. Before a pipeline
+     * runs, it reserves an estimate of the memory its chunk needs;
+     * while the reservations of other runs would push it over the
+     * budget, it waits for them to finish instead of allocating. This
+     * limits how many chunks are in flight when many threads share a
+     * context. A chunk larger than the whole budget still runs, on
+     * its own. 0 means no limit.
+     */
+    size_t memory_budget;
+
+    /** Initialize a callback receiving start and end events for each
+     * stage of the decode and encode pipelines run with this context.
+     * See exr_trace_write_chrome_event() for a ready made one.
+     */
+    exr_trace_func_ptr_t trace_fn;
+
+    /** Passed to trace_fn. */
+    void* trace_user_data;
 } exr_context_initializer_t;
 
 /** @brief context flag which will enforce strict header validation
@@ -350,10 +496,36 @@ typedef struct _exr_context_initializer_v3
 /** @brief Writes an old-style, sorted header with minimal information */
 #define EXR_CONTEXT_FLAG_WRITE_LEGACY_HEADER (1 << 3)
 
+/** @brief Gives the context a private buffer pool
+ *
+ * The pool keeps up to \c EXR_DEFAULT_BUFFER_POOL_CACHE_SIZE of
+ * transcoding buffers cached until the context is finished. Without
+ * it, or a shared pool provided in the initializer, transcoding
+ * buffers are allocated and freed for every chunk.
+ */
+#define EXR_CONTEXT_FLAG_PRIVATE_BUFFER_POOL (1 << 4)
+
+/** @brief Enables huge pages for the private buffer pool of the context
+ *
+ * Implies `EXR_CONTEXT_FLAG_PRIVATE_BUFFER_POOL`. See
+ * exr_buffer_pool_set_huge_pages(). The private pool only caches
+ * up to \c EXR_DEFAULT_BUFFER_POOL_CACHE_SIZE, chunks larger than that
+ * are better served by a shared pool with a bigger limit, which keeps
+ * its own huge page setting.
+ */
+#define EXR_CONTEXT_FLAG_HUGE_PAGE_BUFFERS (1 << 5)
+
+/** @brief Keeps the context out of the process-wide chunk cache
+ *
+ * See exr_set_chunk_cache_size(). This is only valid for reading
+ * contexts.
+ */
+#define EXR_CONTEXT_FLAG_DISABLE_CHUNK_CACHE (1 << 6)
+
 /* clang-format off */
 /** @brief Simple macro to initialize the context initializer with default values. */
 #define EXR_DEFAULT_CONTEXT_INITIALIZER                                        \
-    { sizeof (exr_context_initializer_t), 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -2, -1.f, 0, { 0, 0, 0, 0 } }
+    { sizeof (exr_context_initializer_t), 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -2, -1.f, 0, { 0, 0, 0, 0 }, 0, 0, 0, 0 }
 /* clang-format on */
 
 /** @} */ /* context function pointer declarations */
@@ -472,9 +644,21 @@ EXR_EXPORT exr_result_t exr_start_write (
 
 /** @brief Create a new context for updating an exr file in place.
  *
- * This is a custom mode that allows one to modify the value of a
- * metadata entry, although not to change the size of the header, or
- * any of the image data.
+ * This is a custom mode that allows one to modify the value of
+ * metadata entries, or add new ones, without touching any of the
+ * image data. The channels and parts can not be changed.
+ *
+ * The header is written back over the old one by exr_finish(), which
+ * returns \ref EXR_ERR_MODIFY_SIZE_CHANGE and leaves the file as it
+ * was if the new header does not take exactly the same space. A file
+ * written with reserved padding (see exr_set_header_padding()) gives
+ * up as much of that padding as the header grows by, so the header
+ * may grow up to the size of the padding.
+ *
+ * The new header is written over the old one at offset 0 in a single
+ * pass, not atomically: if the process or machine stops part way
+ * through, the file is left with a corrupt header. Work on a copy if
+ * that matters.
  *
  * If you have custom I/O requirements, see the initializer context
  * documentation \ref exr_context_initializer_t. The @p ctxtdata parameter
@@ -513,6 +697,19 @@ EXR_EXPORT exr_result_t exr_start_temporary_context (
 EXR_EXPORT exr_result_t
 exr_get_file_name (exr_const_context_t ctxt, const char** name);
 
+/** @brief Retrieve an identity of the file the context reads, as seen
+ * when it was opened: the device (volume), file number (inode),
+ * modification time and size.
+ *
+ * Two contexts that read the same, unmodified file have the same
+ * identity, even if they opened it under different names, so it is
+ * suitable as a cache key. Only files opened by name through the
+ * default file routines have an identity; for custom streams,
+ * @p has_identity is set to 0 and @p identity is zeroed.
+ */
+EXR_EXPORT exr_result_t exr_get_file_identity (
+    exr_const_context_t ctxt, int* has_identity, uint64_t identity[4]);
+
 /** @brief Retrieve the file version and flags the context is for as
  * parsed during the start routine.
  */
@@ -526,6 +723,14 @@ exr_get_file_version_and_flags (exr_const_context_t ctxt, uint32_t* ver);
 EXR_EXPORT exr_result_t
 exr_get_user_data (exr_const_context_t ctxt, void** userdata);
 
+/** @brief Query the memory budget the context was constructed with,
+ * and the bytes currently reserved by running pipelines.
+ *
+ * Either pointer may be NULL.
+ */
+EXR_EXPORT exr_result_t exr_get_memory_budget (
+    exr_const_context_t ctxt, size_t* budget, size_t* reserved);
+
 /** Any opaque attribute data entry of the specified type is tagged
  * with these functions enabling downstream users to unpack (or pack)
  * the data.
@@ -563,6 +768,23 @@ EXR_EXPORT exr_result_t exr_register_attr_type_handler (
 EXR_EXPORT exr_result_t
 exr_set_longname_support (exr_context_t ctxt, int onoff);
 
+/** @brief Name of the attribute holding reserved header space. */
+#define EXR_HEADER_PADDING_ATTR_NAME "headerPadding"
+
+/** @brief Type name of the \ref EXR_HEADER_PADDING_ATTR_NAME attribute. */
+#define EXR_HEADER_PADDING_TYPE_NAME "padding"
+
+/** @brief Reserve space in the header for metadata added later.
+ *
+ * When the header is written, an attribute holding the given number
+ * of zero bytes is added to the last part. A later
+ * exr_start_inplace_header_update() can then add or grow metadata
+ * by up to that many bytes without rewriting the image data. Readers
+ * see the padding as an ordinary opaque attribute.
+ */
+EXR_EXPORT exr_result_t
+exr_set_header_padding (exr_context_t ctxt, int32_t bytes);
+
 /** @brief Write the header data.
  *
  * Opening a new output file has a small initialization state problem
@@ -6,6 +6,7 @@
 #ifndef OPENEXR_DEBUG_H
 #define OPENEXR_DEBUG_H
 
+#include "openexr_attr.h"
 #include "openexr_context.h"
 
 #ifdef __cplusplus
@@ -20,6 +21,86 @@ extern "C" {
 EXR_EXPORT exr_result_t
 exr_print_context_info (exr_const_context_t c, int verbose);
 
+/** @brief Counters accumulated by a context since it was created or
+ * last reset.
+ *
+ * These are always on, and cheap enough to leave so: each is a
+ * relaxed atomic add per read / write call, pipeline stage or
+ * transcoding buffer allocation.
+ */
+typedef struct
+{
+    uint64_t bytes_read;    /**< bytes returned by the read function */
+    uint64_t read_calls;    /**< calls to the read function */
+    uint64_t bytes_written; /**< bytes accepted by the write function */
+    uint64_t write_calls;   /**< calls to the write function */
+
+    /** chunks successfully run through a decode pipeline, by the
+     * compression of their part */
+    uint64_t chunks_decoded[EXR_COMPRESSION_LAST_TYPE];
+    /** chunks successfully run through an encode pipeline */
+    uint64_t chunks_encoded[EXR_COMPRESSION_LAST_TYPE];
+
+    uint64_t compressed_bytes_decoded;   /**< packed size of those chunks */
+    uint64_t uncompressed_bytes_decoded; /**< unpacked size */
+    uint64_t compressed_bytes_encoded;
+    uint64_t uncompressed_bytes_encoded;
+
+    /** time spent in each pipeline stage, summed over all threads */
+    uint64_t stage_ns[EXR_TRACE_STAGE_LAST_TYPE];
+
+    uint64_t buffer_allocs; /**< transcoding buffers allocated */
+    uint64_t buffer_bytes;  /**< size of those currently allocated */
+    uint64_t peak_buffer_bytes;
+
+    /** chunks found in / missing from the process-wide chunk cache */
+    uint64_t chunk_cache_hits;
+    uint64_t chunk_cache_misses;
+} exr_perf_counters_t;
+
+/** Retrieve a snapshot of the counters of a context.
+ *
+ * Counters are updated independently while other threads run
+ * pipelines, so a snapshot taken then is not exactly consistent
+ * across fields.
+ */
+EXR_EXPORT exr_result_t exr_get_perf_counters (
+    exr_const_context_t ctxt, exr_perf_counters_t* counters);
+
+/** Reset the counters of a context to zero.
+ *
+ * buffer_bytes is left alone since the buffers are still allocated,
+ * and peak_buffer_bytes restarts from it.
+ */
+EXR_EXPORT exr_result_t exr_reset_perf_counters (exr_const_context_t ctxt);
+
+/** Opaque handle to a trace writer producing a Chrome trace event
+ * file (viewable in chrome://tracing or Perfetto).
+ */
+typedef struct _exr_trace_writer* exr_trace_writer_t;
+
+/** Create a trace writer and open @p filename for writing.
+ *
+ * Pass @ref exr_trace_write_chrome_event as the trace_fn of a
+ * context initializer and the writer as its trace_user_data. The
+ * same writer may be shared by several contexts.
+ */
+EXR_EXPORT exr_result_t
+exr_trace_writer_create (exr_trace_writer_t* writer, const char* filename);
+
+/** Trace callback appending @p event to the writer passed as
+ * @p userdata, as a begin or end event named after the stage.
+ */
+EXR_EXPORT void exr_trace_write_chrome_event (
+    exr_const_context_t ctxt, void* userdata, const exr_trace_event_t* event);
+
+/** Close the file and destroy the writer.
+ *
+ * Must only be called once no context using the writer is running
+ * a pipeline.
+ */
+EXR_EXPORT exr_result_t exr_trace_writer_finish (exr_trace_writer_t writer);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -231,6 +231,10 @@ typedef struct _exr_encode_pipeline
      * If the user has a custom method for the
      * compression on this part, this can be changed after
      * initialization.
+     *
+     * If set to `NULL`, the caller provides data that is already
+     * packed in @ref packed_buffer, with @ref packed_bytes set to
+     * the packed size of the chunk after exr_encoding_update().
      */
     exr_result_t (*convert_and_pack_fn) (struct _exr_encode_pipeline* pipeline);
 
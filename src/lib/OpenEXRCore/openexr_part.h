@@ -48,6 +48,18 @@ EXR_EXPORT exr_result_t exr_get_count (exr_const_context_t ctxt, int* count);
 EXR_EXPORT exr_result_t
 exr_get_name (exr_const_context_t ctxt, int part_index, const char** out);
 
+/** @brief Find the index of the part with the specified name.
+ *
+ * Once the header of a multi-part file has been read, the lookup uses
+ * a hash of the part names rather than a scan over all the parts. If
+ * several parts share the name, the lowest index is returned.
+ *
+ * Returns `EXR_ERR_NO_ATTR_BY_NAME`, without reporting an error, if no
+ * part has that name.
+ */
+EXR_EXPORT exr_result_t exr_get_part_index (
+    exr_const_context_t ctxt, const char* name, int* part_index);
+
 /** @brief Query the storage type for the specified part. */
 EXR_EXPORT exr_result_t
 exr_get_storage (exr_const_context_t ctxt, int part_index, exr_storage_t* out);
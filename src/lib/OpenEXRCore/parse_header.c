@@ -2822,6 +2822,7 @@ internal_exr_parse_header (exr_context_t ctxt)
     }
 
     if (rv == EXR_ERR_SUCCESS) { rv = update_chunk_offsets (ctxt, &scratch); }
+    if (rv == EXR_ERR_SUCCESS) internal_exr_build_part_name_index (ctxt);
 
     priv_destroy_scratch (&scratch);
     return internal_exr_context_restore_handlers (ctxt, rv);
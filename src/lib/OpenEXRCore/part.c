@@ -36,6 +36,32 @@ exr_get_count (exr_const_context_t ctxt, int* count)
 
 /**************************************/
 
+exr_result_t
+exr_get_part_index (exr_const_context_t ctxt, const char* name, int* out)
+{
+    int idx;
+
+    if (!ctxt) return EXR_ERR_MISSING_CONTEXT_ARG;
+    if (!name || !out)
+        return ctxt->standard_error (ctxt, EXR_ERR_INVALID_ARGUMENT);
+
+    if (ctxt->mode == EXR_CONTEXT_WRITE)
+    {
+        internal_exr_lock (ctxt);
+        idx = internal_exr_find_part_by_name (ctxt, name);
+        internal_exr_unlock (ctxt);
+    }
+    else
+        idx = internal_exr_find_part_by_name (ctxt, name);
+
+    if (idx < 0) return EXR_ERR_NO_ATTR_BY_NAME;
+
+    *out = idx;
+    return EXR_ERR_SUCCESS;
+}
+
+/**************************************/
+
 exr_result_t
 exr_get_storage (exr_const_context_t ctxt, int part_index, exr_storage_t* out)
 {
@@ -489,7 +515,8 @@ exr_validate_chunk_table (exr_context_t ctxt, int part_index)
     for (int ci = 0; ci < part->chunk_count; ++ci)
     {
         uint64_t cchunk = ctable[ci];
-        if (cchunk < chunkmin || cchunk >= maxoff)
+        if ((cchunk < chunkmin || cchunk >= maxoff) &&
+            !(cchunk == 0 && internal_exr_constant_chunk (ctxt, part, ci)))
         {
             complete = 0;
             break;
@@ -138,7 +138,7 @@ exr_attr_declare_by_type (
     exr_result_t rv;
     EXR_LOCK_AND_DEFINE_PART (part_index);
 
-    if (ctxt->mode != EXR_CONTEXT_WRITE && ctxt->mode != EXR_CONTEXT_TEMPORARY)
+    if (!EXR_CAN_RESIZE_HEADER (ctxt))
         return EXR_UNLOCK_AND_RETURN (
             ctxt->standard_error (ctxt, EXR_ERR_NOT_OPEN_WRITE));
 
@@ -160,7 +160,7 @@ exr_attr_declare (
     exr_result_t rv;
     EXR_LOCK_AND_DEFINE_PART (part_index);
 
-    if (ctxt->mode != EXR_CONTEXT_WRITE && ctxt->mode != EXR_CONTEXT_TEMPORARY)
+    if (!EXR_CAN_RESIZE_HEADER (ctxt))
         return EXR_UNLOCK_AND_RETURN (
             ctxt->standard_error (ctxt, EXR_ERR_NOT_OPEN_WRITE));
 
@@ -596,11 +596,12 @@ exr_copy_unset_attributes (
     }                                                                          \
     return EXR_UNLOCK_WRITE_AND_RETURN (EXR_ERR_NO_ATTR_BY_NAME)
 
-#define REQ_ATTR_FIND_CREATE(name, t)                                          \
+#define REQ_ATTR_FIND_CREATE_IMPL(name, t, layout)                             \
     exr_attribute_t* attr = NULL;                                              \
     exr_result_t     rv   = EXR_ERR_SUCCESS;                                   \
     EXR_LOCK_AND_DEFINE_PART (part_index);                                     \
-    if (ctxt->mode == EXR_CONTEXT_READ)                                        \
+    if (ctxt->mode == EXR_CONTEXT_READ ||                                      \
+        ((layout) && ctxt->mode == EXR_CONTEXT_UPDATE_HEADER))                 \
         return EXR_UNLOCK_AND_RETURN (                                         \
             ctxt->standard_error (ctxt, EXR_ERR_NOT_OPEN_WRITE));              \
     if (ctxt->mode == EXR_CONTEXT_WRITING_DATA)                                \
@@ -620,6 +621,13 @@ exr_copy_unset_attributes (
             #name));                                                           \
     attr = part->name
 
+#define REQ_ATTR_FIND_CREATE(name, t) REQ_ATTR_FIND_CREATE_IMPL (name, t, 0)
+
+/* the attributes which determine the chunk layout, which can not
+ * change when updating the header of an existing file in place */
+#define REQ_LAYOUT_ATTR_FIND_CREATE(name, t)                                   \
+    REQ_ATTR_FIND_CREATE_IMPL (name, t, 1)
+
 /**************************************/
 
 exr_result_t
@@ -641,7 +649,7 @@ exr_add_channel (
     int32_t                    xsamp,
     int32_t                    ysamp)
 {
-    REQ_ATTR_FIND_CREATE (channels, EXR_ATTR_CHLIST);
+    REQ_LAYOUT_ATTR_FIND_CREATE (channels, EXR_ATTR_CHLIST);
     if (rv == EXR_ERR_SUCCESS)
     {
         rv = exr_attr_chlist_add (
@@ -663,7 +671,7 @@ exr_set_channels (
             "No channels provided for channel list");
 
     {
-        REQ_ATTR_FIND_CREATE (channels, EXR_ATTR_CHLIST);
+        REQ_LAYOUT_ATTR_FIND_CREATE (channels, EXR_ATTR_CHLIST);
         if (rv == EXR_ERR_SUCCESS)
         {
             exr_attr_chlist_t clist;
@@ -693,7 +701,7 @@ exr_result_t
 exr_set_compression (
     exr_context_t ctxt, int part_index, exr_compression_t ctype)
 {
-    REQ_ATTR_FIND_CREATE (compression, EXR_ATTR_COMPRESSION);
+    REQ_LAYOUT_ATTR_FIND_CREATE (compression, EXR_ATTR_COMPRESSION);
     if (rv == EXR_ERR_SUCCESS)
     {
         attr->uc        = (uint8_t) ctype;
@@ -726,7 +734,7 @@ exr_set_data_window (
             "Missing value for data window assignment");
 
     {
-        REQ_ATTR_FIND_CREATE (dataWindow, EXR_ATTR_BOX2I);
+        REQ_LAYOUT_ATTR_FIND_CREATE (dataWindow, EXR_ATTR_BOX2I);
 
         if (rv == EXR_ERR_SUCCESS)
         {
@@ -797,7 +805,7 @@ exr_set_lineorder (exr_context_t ctxt, int part_index, exr_lineorder_t lo)
             (int) EXR_LINEORDER_LAST_TYPE);
 
     {
-        REQ_ATTR_FIND_CREATE (lineOrder, EXR_ATTR_LINEORDER);
+        REQ_LAYOUT_ATTR_FIND_CREATE (lineOrder, EXR_ATTR_LINEORDER);
         if (rv == EXR_ERR_SUCCESS)
         {
             attr->uc        = (uint8_t) lo;
@@ -921,7 +929,8 @@ exr_set_tile_descriptor (
     exr_result_t     rv   = EXR_ERR_SUCCESS;
     exr_attribute_t* attr = NULL;
     EXR_LOCK_AND_DEFINE_PART (part_index);
-    if (ctxt->mode == EXR_CONTEXT_READ)
+    if (ctxt->mode == EXR_CONTEXT_READ ||
+        ctxt->mode == EXR_CONTEXT_UPDATE_HEADER)
         return EXR_UNLOCK_AND_RETURN (
             ctxt->standard_error (ctxt, EXR_ERR_NOT_OPEN_WRITE));
     if (ctxt->mode == EXR_CONTEXT_WRITING_DATA)
@@ -1054,7 +1063,7 @@ exr_set_name (exr_context_t ctxt, int part_index, const char* val)
             /* we own the string... */
             memcpy (EXR_CONST_CAST (void*, attr->string->str), val, bytes);
         }
-        else if (ctxt->mode != EXR_CONTEXT_WRITE && ctxt->mode != EXR_CONTEXT_TEMPORARY)
+        else if (!EXR_CAN_RESIZE_HEADER (ctxt))
         {
             return EXR_UNLOCK_AND_RETURN (ctxt->print_error (
                 ctxt,
@@ -1090,7 +1099,7 @@ exr_set_version (exr_context_t ctxt, int part_index, int32_t val)
     if (val <= 0 || val > 1) return EXR_ERR_ARGUMENT_OUT_OF_RANGE;
 
     {
-        REQ_ATTR_FIND_CREATE (version, EXR_ATTR_INT);
+        REQ_LAYOUT_ATTR_FIND_CREATE (version, EXR_ATTR_INT);
         if (rv == EXR_ERR_SUCCESS) { attr->i = val; }
         return EXR_UNLOCK_AND_RETURN (rv);
     }
@@ -1101,7 +1110,7 @@ exr_set_version (exr_context_t ctxt, int part_index, int32_t val)
 exr_result_t
 exr_set_chunk_count (exr_context_t ctxt, int part_index, int32_t val)
 {
-    REQ_ATTR_FIND_CREATE (chunkCount, EXR_ATTR_INT);
+    REQ_LAYOUT_ATTR_FIND_CREATE (chunkCount, EXR_ATTR_INT);
     if (rv == EXR_ERR_SUCCESS)
     {
         attr->i           = val;
@@ -1166,9 +1175,7 @@ exr_set_chunk_count (exr_context_t ctxt, int part_index, int32_t val)
         ctxt, (exr_attribute_list_t*) &(part->attributes), name, &attr);       \
     if (rv == EXR_ERR_NO_ATTR_BY_NAME)                                         \
     {                                                                          \
-        if (ctxt->mode != EXR_CONTEXT_WRITE &&                                 \
-            ctxt->mode != EXR_CONTEXT_TEMPORARY)                               \
-            return EXR_UNLOCK_AND_RETURN (rv);                                 \
+        if (!EXR_CAN_RESIZE_HEADER (ctxt)) return EXR_UNLOCK_AND_RETURN (rv); \
                                                                                \
         rv = exr_attr_list_add (                                               \
             ctxt, &(part->attributes), name, t, 0, NULL, &(attr));             \
@@ -1531,7 +1538,7 @@ exr_attr_set_float_vector (
 
     if (rv == EXR_ERR_NO_ATTR_BY_NAME)
     {
-        if (ctxt->mode != EXR_CONTEXT_WRITE && ctxt->mode != EXR_CONTEXT_TEMPORARY)
+        if (!EXR_CAN_RESIZE_HEADER (ctxt))
             return EXR_UNLOCK_AND_RETURN (rv);
 
         rv = exr_attr_list_add (
@@ -1560,7 +1567,7 @@ exr_attr_set_float_vector (
         {
             memcpy (EXR_CONST_CAST (void*, attr->floatvector->arr), val, bytes);
         }
-        else if (ctxt->mode != EXR_CONTEXT_WRITE && ctxt->mode != EXR_CONTEXT_TEMPORARY)
+        else if (!EXR_CAN_RESIZE_HEADER (ctxt))
         {
             return EXR_UNLOCK_AND_RETURN (ctxt->print_error (
                 ctxt,
@@ -1791,7 +1798,7 @@ exr_attr_set_preview (
 
     if (rv == EXR_ERR_NO_ATTR_BY_NAME)
     {
-        if (ctxt->mode != EXR_CONTEXT_WRITE && ctxt->mode != EXR_CONTEXT_TEMPORARY) return EXR_UNLOCK_AND_RETURN (rv);
+        if (!EXR_CAN_RESIZE_HEADER (ctxt)) return EXR_UNLOCK_AND_RETURN (rv);
 
         rv = exr_attr_list_add (
             ctxt,
@@ -1825,7 +1832,7 @@ exr_attr_set_preview (
                 val->rgba,
                 copybytes);
         }
-        else if (ctxt->mode != EXR_CONTEXT_WRITE && ctxt->mode != EXR_CONTEXT_TEMPORARY)
+        else if (!EXR_CAN_RESIZE_HEADER (ctxt))
         {
             return EXR_UNLOCK_AND_RETURN (ctxt->print_error (
                 ctxt,
@@ -1953,7 +1960,7 @@ exr_attr_set_string (
 
     if (rv == EXR_ERR_NO_ATTR_BY_NAME)
     {
-        if (ctxt->mode != EXR_CONTEXT_WRITE && ctxt->mode != EXR_CONTEXT_TEMPORARY)
+        if (!EXR_CAN_RESIZE_HEADER (ctxt))
             return EXR_UNLOCK_AND_RETURN (rv);
 
         rv = exr_attr_list_add (
@@ -1977,7 +1984,7 @@ exr_attr_set_string (
             if (val)
                 memcpy (EXR_CONST_CAST (void*, attr->string->str), val, bytes);
         }
-        else if (ctxt->mode != EXR_CONTEXT_WRITE && ctxt->mode != EXR_CONTEXT_TEMPORARY)
+        else if (!EXR_CAN_RESIZE_HEADER (ctxt))
         {
             return EXR_UNLOCK_AND_RETURN (ctxt->print_error (
                 ctxt,
@@ -2067,7 +2074,9 @@ exr_attr_set_string_vector (
 
     if (rv == EXR_ERR_NO_ATTR_BY_NAME)
     {
-        if (ctxt->mode != EXR_CONTEXT_WRITE) return EXR_UNLOCK_AND_RETURN (rv);
+        if (ctxt->mode != EXR_CONTEXT_WRITE &&
+            ctxt->mode != EXR_CONTEXT_UPDATE_HEADER)
+            return EXR_UNLOCK_AND_RETURN (rv);
 
         rv = exr_attr_list_add (
             ctxt,
@@ -2095,7 +2104,8 @@ exr_attr_set_string_vector (
         if (attr->stringvector->n_strings == size &&
             attr->stringvector->alloc_size > 0)
         {
-            if (ctxt->mode != EXR_CONTEXT_WRITE)
+            if (ctxt->mode != EXR_CONTEXT_WRITE &&
+                ctxt->mode != EXR_CONTEXT_UPDATE_HEADER)
             {
                 for (int32_t i = 0; rv == EXR_ERR_SUCCESS && i < size; ++i)
                 {
@@ -2130,7 +2140,9 @@ exr_attr_set_string_vector (
                         ctxt, attr->stringvector, i, val[i]);
             }
         }
-        else if (ctxt->mode != EXR_CONTEXT_WRITE)
+        else if (
+            ctxt->mode != EXR_CONTEXT_WRITE &&
+            ctxt->mode != EXR_CONTEXT_UPDATE_HEADER)
         {
             return EXR_UNLOCK_AND_RETURN (ctxt->print_error (
                 ctxt,
@@ -2400,7 +2412,9 @@ exr_attr_set_user (
         ctxt, (exr_attribute_list_t*) &(part->attributes), name, &attr);
     if (rv == EXR_ERR_NO_ATTR_BY_NAME)
     {
-        if (ctxt->mode != EXR_CONTEXT_WRITE) return EXR_UNLOCK_AND_RETURN (rv);
+        if (ctxt->mode != EXR_CONTEXT_WRITE &&
+            ctxt->mode != EXR_CONTEXT_UPDATE_HEADER)
+            return EXR_UNLOCK_AND_RETURN (rv);
         rv = exr_attr_list_add_by_type (
             ctxt, &(part->attributes), name, type, 0, NULL, &(attr));
     }
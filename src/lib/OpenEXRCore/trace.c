@@ -0,0 +1,229 @@
+/*
+** SPDX-License-Identifier: BSD-3-Clause
+** Copyright Contributors to the OpenEXR Project.
+*/
+
+#include "openexr_debug.h"
+
+#include "internal_coding.h"
+#include "internal_compress.h"
+#include "internal_memory.h"
+
+#ifdef _WIN32
+#    include <windows.h>
+#else
+#    include <time.h>
+#    ifdef ILMTHREAD_THREADING_ENABLED
+#        include <pthread.h>
+#    endif
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+/**************************************/
+
+uint64_t
+internal_exr_clock_ns (void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER        now;
+
+    if (freq.QuadPart == 0) QueryPerformanceFrequency (&freq);
+    QueryPerformanceCounter (&now);
+    return (uint64_t) ((double) now.QuadPart * 1e9 / (double) freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * (uint64_t) 1000000000 +
+           (uint64_t) ts.tv_nsec;
+#endif
+}
+
+/**************************************/
+
+static uint64_t
+trace_thread_id (void)
+{
+#ifdef _WIN32
+    return (uint64_t) GetCurrentThreadId ();
+#elif defined(ILMTHREAD_THREADING_ENABLED)
+    return (uint64_t) (uintptr_t) pthread_self ();
+#else
+    return 1;
+#endif
+}
+
+/**************************************/
+
+void
+internal_exr_emit_trace (
+    exr_const_context_t     ctxt,
+    int                     part_index,
+    const exr_chunk_info_t* cinfo,
+    exr_trace_stage_t       stage,
+    int                     is_end,
+    uint64_t                time_ns,
+    uint64_t                in_bytes,
+    uint64_t                out_bytes)
+{
+    exr_trace_event_t ev;
+
+    ev.stage       = stage;
+    ev.is_end      = is_end;
+    ev.part_index  = part_index;
+    ev.chunk_index = cinfo->idx;
+    ev.compression = (int32_t) ctxt->parts[part_index]->comp_type;
+    ev.time_ns     = time_ns;
+    ev.in_bytes    = in_bytes;
+    ev.out_bytes   = out_bytes;
+
+    ctxt->trace_fn (ctxt, ctxt->trace_user_data, &ev);
+}
+
+/**************************************/
+
+struct _exr_trace_writer
+{
+    FILE*    file;
+    uint64_t origin_ns;
+    int      first;
+
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#    else
+    pthread_mutex_t mutex;
+#    endif
+#endif
+};
+
+static const char* stage_names[] = {
+    "read", "decompress", "unpack", "pack", "compress", "write"};
+
+/**************************************/
+
+exr_result_t
+exr_trace_writer_create (exr_trace_writer_t* writer, const char* filename)
+{
+    exr_trace_writer_t ret;
+
+    if (!writer || !filename) return EXR_ERR_INVALID_ARGUMENT;
+    *writer = NULL;
+
+    ret = (exr_trace_writer_t) internal_exr_alloc (
+        sizeof (struct _exr_trace_writer));
+    if (!ret) return EXR_ERR_OUT_OF_MEMORY;
+
+    memset (ret, 0, sizeof (struct _exr_trace_writer));
+    ret->file = fopen (filename, "w");
+    if (!ret->file)
+    {
+        internal_exr_free (ret);
+        return EXR_ERR_FILE_ACCESS;
+    }
+    ret->origin_ns = internal_exr_clock_ns ();
+    ret->first     = 1;
+
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    InitializeCriticalSection (&(ret->mutex));
+#    else
+    if (pthread_mutex_init (&(ret->mutex), NULL) != 0)
+    {
+        fclose (ret->file);
+        internal_exr_free (ret);
+        return EXR_ERR_OUT_OF_MEMORY;
+    }
+#    endif
+#endif
+
+    fputs ("[\n", ret->file);
+    *writer = ret;
+    return EXR_ERR_SUCCESS;
+}
+
+/**************************************/
+
+void
+exr_trace_write_chrome_event (
+    exr_const_context_t ctxt, void* userdata, const exr_trace_event_t* event)
+{
+    exr_trace_writer_t writer = (exr_trace_writer_t) userdata;
+    const char*        stage  = "unknown";
+    const char*        comp   = "unknown";
+    const char*        name;
+    uint64_t           ts;
+
+    (void) ctxt;
+    if (!writer || !event) return;
+
+    if (event->stage >= 0 && event->stage < EXR_TRACE_STAGE_LAST_TYPE)
+        stage = stage_names[event->stage];
+    name = internal_exr_compression_name (
+        (exr_compression_t) event->compression);
+    if (name) comp = name;
+
+    /* events from before the writer was created clamp to its start */
+    ts = event->time_ns > writer->origin_ns
+             ? event->time_ns - writer->origin_ns
+             : 0;
+
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    EnterCriticalSection (&writer->mutex);
+#    else
+    pthread_mutex_lock (&writer->mutex);
+#    endif
+#endif
+
+    fprintf (
+        writer->file,
+        "%s{\"name\":\"%s\",\"cat\":\"exr\",\"ph\":\"%s\",\"ts\":%.3f,"
+        "\"pid\":1,\"tid\":%llu,\"args\":{\"part\":%d,\"chunk\":%d,"
+        "\"compression\":\"%s\",\"in_bytes\":%llu,\"out_bytes\":%llu}}",
+        writer->first ? "" : ",\n",
+        stage,
+        event->is_end ? "E" : "B",
+        (double) ts / 1000.0,
+        (unsigned long long) trace_thread_id (),
+        event->part_index,
+        event->chunk_index,
+        comp,
+        (unsigned long long) event->in_bytes,
+        (unsigned long long) event->out_bytes);
+    writer->first = 0;
+
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    LeaveCriticalSection (&writer->mutex);
+#    else
+    pthread_mutex_unlock (&writer->mutex);
+#    endif
+#endif
+}
+
+/**************************************/
+
+exr_result_t
+exr_trace_writer_finish (exr_trace_writer_t writer)
+{
+    exr_result_t rv = EXR_ERR_SUCCESS;
+
+    if (!writer) return EXR_ERR_INVALID_ARGUMENT;
+
+    fputs ("\n]\n", writer->file);
+    if (fclose (writer->file) != 0) rv = EXR_ERR_FILE_ACCESS;
+
+#ifdef ILMTHREAD_THREADING_ENABLED
+#    ifdef _WIN32
+    DeleteCriticalSection (&(writer->mutex));
+#    else
+    pthread_mutex_destroy (&(writer->mutex));
+#    endif
+#endif
+    internal_exr_free (writer);
+    return rv;
+}
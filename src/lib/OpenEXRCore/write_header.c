@@ -5,6 +5,8 @@
 
 #include "internal_file.h"
 
+#include "openexr_chunkio.h"
+
 #include "internal_attr.h"
 #include "internal_constants.h"
 #include "internal_structs.h"
@@ -598,6 +600,24 @@ save_attr (exr_context_t ctxt, const exr_attribute_t* a)
 
 /**************************************/
 
+static exr_result_t
+save_part_attr (
+    exr_context_t ctxt, exr_priv_part_t curp, const exr_attribute_t* a)
+{
+    exr_result_t rv = save_attr (ctxt, a);
+
+    /* the chunk statistics are filled in as chunks are written, keep
+     * track of where their value goes */
+    if (rv == EXR_ERR_SUCCESS && a->type == EXR_ATTR_OPAQUE &&
+        0 == strcmp (a->name, EXR_CHUNK_STATS_ATTR_NAME) &&
+        0 == strcmp (a->type_name, EXR_CHUNK_STATS_TYPE_NAME))
+    {
+        curp->chunk_stats_offset =
+            ctxt->output_file_offset - (uint64_t) a->opaque->size;
+    }
+    return rv;
+}
+
 exr_result_t internal_exr_calc_header_version_flags (exr_const_context_t ctxt, uint32_t *flags)
 {
     *flags = 2; // EXR_VERSION
@@ -699,7 +719,7 @@ internal_exr_write_header (exr_context_t ctxt)
                         continue;
                     }
                 }
-                rv = save_attr (ctxt, curattr);
+                rv = save_part_attr (ctxt, curp, curattr);
                 if (rv != EXR_ERR_SUCCESS) break;
             }
         }
@@ -707,7 +727,8 @@ internal_exr_write_header (exr_context_t ctxt)
         {
             for (int a = 0; a < curp->attributes.num_attributes; ++a)
             {
-                rv = save_attr (ctxt, curp->attributes.entries[a]);
+                rv = save_part_attr (
+                    ctxt, curp, curp->attributes.entries[a]);
                 if (rv != EXR_ERR_SUCCESS) break;
             }
         }
@@ -734,3 +755,148 @@ internal_exr_write_header (exr_context_t ctxt)
 
     return rv;
 }
+
+/**************************************/
+
+exr_result_t
+internal_exr_add_header_padding (exr_context_t ctxt)
+{
+    exr_result_t     rv;
+    exr_priv_part_t  lastp;
+    exr_attribute_t* attr = NULL;
+    void*            zeros;
+
+    if (ctxt->header_padding <= 0 || ctxt->num_parts < 1)
+        return EXR_ERR_SUCCESS;
+
+    lastp = ctxt->parts[ctxt->num_parts - 1];
+    rv    = exr_attr_list_find_by_name (
+        ctxt, &(lastp->attributes), EXR_HEADER_PADDING_ATTR_NAME, &attr);
+    if (rv == EXR_ERR_NO_ATTR_BY_NAME)
+        rv = exr_attr_list_add_by_type (
+            ctxt,
+            &(lastp->attributes),
+            EXR_HEADER_PADDING_ATTR_NAME,
+            EXR_HEADER_PADDING_TYPE_NAME,
+            0,
+            NULL,
+            &attr);
+    if (rv != EXR_ERR_SUCCESS) return rv;
+
+    if (attr->type != EXR_ATTR_OPAQUE)
+        return ctxt->print_error (
+            ctxt,
+            EXR_ERR_ATTR_TYPE_MISMATCH,
+            "Attribute '%s' is of type '%s', unable to use as header padding",
+            attr->name,
+            attr->type_name);
+
+    zeros = ctxt->alloc_fn ((size_t) ctxt->header_padding);
+    if (!zeros) return ctxt->standard_error (ctxt, EXR_ERR_OUT_OF_MEMORY);
+    memset (zeros, 0, (size_t) ctxt->header_padding);
+
+    rv = exr_attr_opaquedata_set_packed (
+        ctxt, attr->opaque, zeros, ctxt->header_padding);
+    ctxt->free_fn (zeros);
+    return rv;
+}
+
+/**************************************/
+
+static exr_result_t
+count_write (
+    exr_context_t ctxt, const void* buf, uint64_t sz, uint64_t* offsetp)
+{
+    (void) ctxt;
+    (void) buf;
+    *offsetp += sz;
+    return EXR_ERR_SUCCESS;
+}
+
+static exr_result_t
+compute_header_size (exr_context_t ctxt, uint64_t* size)
+{
+    exr_result_t rv;
+    exr_result_t (*do_write) (
+        exr_context_t, const void*, uint64_t, uint64_t*) = ctxt->do_write;
+
+    ctxt->do_write           = &count_write;
+    ctxt->output_file_offset = 0;
+    rv                       = internal_exr_write_header (ctxt);
+    ctxt->do_write           = do_write;
+
+    *size = ctxt->output_file_offset;
+    return rv;
+}
+
+exr_result_t
+internal_exr_update_header (exr_context_t ctxt)
+{
+    exr_result_t     rv;
+    exr_attribute_t* pad = NULL;
+    uint64_t         origsize, newsize;
+    int64_t          padsize;
+
+    if (ctxt->num_parts < 1) return EXR_ERR_SUCCESS;
+
+    /* the image data starts with the chunk table of the first part */
+    origsize = ctxt->parts[0]->chunk_table_offset;
+
+    for (int p = 0; p < ctxt->num_parts; ++p)
+    {
+        exr_attribute_t* attr = NULL;
+        if (EXR_ERR_SUCCESS == exr_attr_list_find_by_name (
+                                   ctxt,
+                                   &(ctxt->parts[p]->attributes),
+                                   EXR_HEADER_PADDING_ATTR_NAME,
+                                   &attr) &&
+            attr->type == EXR_ATTR_OPAQUE && attr->opaque->packed_data)
+            pad = attr;
+    }
+
+    rv = compute_header_size (ctxt, &newsize);
+    if (rv != EXR_ERR_SUCCESS) return rv;
+
+    if (newsize != origsize)
+    {
+        padsize = -1;
+        if (pad)
+            padsize = (int64_t) pad->opaque->size + (int64_t) origsize -
+                      (int64_t) newsize;
+
+        if (padsize < 0 || padsize > (int64_t) INT32_MAX)
+            return ctxt->print_error (
+                ctxt,
+                EXR_ERR_MODIFY_SIZE_CHANGE,
+                "Updated header needs %" PRIu64
+                " bytes, but the file only has space for %" PRIu64,
+                newsize - (pad ? (uint64_t) pad->opaque->size : 0),
+                origsize);
+
+        /* the padding is only ever zeros, so can shrink in place */
+        if (padsize <= (int64_t) pad->opaque->size)
+            pad->opaque->size = (int32_t) padsize;
+        else
+        {
+            void* zeros = ctxt->alloc_fn ((size_t) padsize);
+            if (!zeros)
+                return ctxt->standard_error (ctxt, EXR_ERR_OUT_OF_MEMORY);
+            memset (zeros, 0, (size_t) padsize);
+            rv = exr_attr_opaquedata_set_packed (
+                ctxt, pad->opaque, zeros, (int32_t) padsize);
+            ctxt->free_fn (zeros);
+            if (rv != EXR_ERR_SUCCESS) return rv;
+        }
+
+        rv = compute_header_size (ctxt, &newsize);
+        if (rv != EXR_ERR_SUCCESS) return rv;
+        if (newsize != origsize)
+            return ctxt->report_error (
+                ctxt,
+                EXR_ERR_MODIFY_SIZE_CHANGE,
+                "Unable to fit the updated header in the space of the original");
+    }
+
+    ctxt->output_file_offset = 0;
+    return internal_exr_write_header (ctxt);
+}
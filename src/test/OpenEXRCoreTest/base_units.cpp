@@ -16,8 +16,14 @@
 
 #include "test_value.h"
 
+#include <atomic>
+#include <chrono>
 #include <cstring>
 #include <iostream>
+#include <thread>
+#include <vector>
+
+#include <IlmThreadConfig.h>
 
 #include <ImfSystemSpecific.h>
 #include <ImfNamespace.h>
@@ -455,3 +461,943 @@ void testTempContext (const std::string& tempdir)
     printf ("ok.\n");
 }
 
+
+////////////////////////////////////////
+
+static int s_pool_allocs = 0;
+static int s_pool_frees  = 0;
+
+static void*
+counting_malloc (size_t bytes)
+{
+    ++s_pool_allocs;
+    return malloc (bytes);
+}
+
+static void
+counting_free (void* p)
+{
+    ++s_pool_frees;
+    free (p);
+}
+
+static const int kPoolW = 64;
+static const int kPoolH = 8;
+
+static void
+writePoolFile (
+    const std::string&               fn,
+    const exr_context_initializer_t& cinit,
+    exr_perf_counters_t*             counters = NULL)
+{
+    exr_context_t f;
+    int           partidx, allocsAfterFirst = 0;
+    uint16_t      line[kPoolW];
+
+    EXRCORE_TEST_RVAL (
+        exr_start_write (&f, fn.c_str (), EXR_WRITE_FILE_DIRECTLY, &cinit));
+    EXRCORE_TEST_RVAL (
+        exr_add_part (f, "pool", EXR_STORAGE_SCANLINE, &partidx));
+    EXRCORE_TEST_RVAL (exr_initialize_required_attr_simple (
+        f, partidx, kPoolW, kPoolH, EXR_COMPRESSION_RLE));
+    EXRCORE_TEST_RVAL (exr_add_channel (
+        f, partidx, "Y", EXR_PIXEL_HALF, EXR_PERCEPTUALLY_LOGARITHMIC, 1, 1));
+    EXRCORE_TEST_RVAL (exr_write_header (f));
+
+    for (int x = 0; x < kPoolW; ++x)
+        line[x] = 0x3c00;
+
+    for (int y = 0; y < kPoolH; ++y)
+    {
+        exr_chunk_info_t      cinfo;
+        exr_encode_pipeline_t encoder;
+
+        EXRCORE_TEST_RVAL (exr_write_scanline_chunk_info (f, 0, y, &cinfo));
+        EXRCORE_TEST_RVAL (exr_encoding_initialize (f, 0, &cinfo, &encoder));
+        encoder.channels[0].encode_from_ptr   = (const uint8_t*) line;
+        encoder.channels[0].user_pixel_stride = 2;
+        encoder.channels[0].user_line_stride  = 2 * kPoolW;
+        EXRCORE_TEST_RVAL (
+            exr_encoding_choose_default_routines (f, 0, &encoder));
+        EXRCORE_TEST_RVAL (exr_encoding_run (f, 0, &encoder));
+        EXRCORE_TEST_RVAL (exr_encoding_destroy (f, &encoder));
+
+        // every chunk after the first reuses the pooled buffers
+        if (y == 0) allocsAfterFirst = s_pool_allocs;
+        EXRCORE_TEST (s_pool_allocs == allocsAfterFirst);
+    }
+    if (counters) EXRCORE_TEST_RVAL (exr_get_perf_counters (f, counters));
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+}
+
+static void
+readPoolFile (
+    const std::string&               fn,
+    const exr_context_initializer_t& cinit,
+    bool                             reuse)
+{
+    exr_context_t f;
+    int           allocsAfterFirst = 0;
+    uint16_t      line[kPoolW];
+    bool          pooled =
+        cinit.buffer_pool ||
+        (cinit.flags & (EXR_CONTEXT_FLAG_PRIVATE_BUFFER_POOL |
+                        EXR_CONTEXT_FLAG_HUGE_PAGE_BUFFERS));
+
+    EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+    for (int y = 0; y < kPoolH; ++y)
+    {
+        exr_chunk_info_t      cinfo;
+        exr_decode_pipeline_t decoder;
+
+        memset (line, 0, sizeof (line));
+        EXRCORE_TEST_RVAL (exr_read_scanline_chunk_info (f, 0, y, &cinfo));
+        EXRCORE_TEST_RVAL (exr_decoding_initialize (f, 0, &cinfo, &decoder));
+        decoder.channels[0].decode_to_ptr     = (uint8_t*) line;
+        decoder.channels[0].user_pixel_stride = 2;
+        decoder.channels[0].user_line_stride  = 2 * kPoolW;
+        EXRCORE_TEST_RVAL (
+            exr_decoding_choose_default_routines (f, 0, &decoder));
+        EXRCORE_TEST_RVAL (exr_decoding_run (f, 0, &decoder));
+        // pooled buffers start on a cache line
+        if (pooled)
+            EXRCORE_TEST (((uintptr_t) decoder.packed_buffer & 63) == 0);
+        EXRCORE_TEST_RVAL (exr_decoding_destroy (f, &decoder));
+
+        for (int x = 0; x < kPoolW; ++x)
+            EXRCORE_TEST (line[x] == 0x3c00);
+
+        if (y == 0)
+            allocsAfterFirst = s_pool_allocs;
+        else
+            EXRCORE_TEST ((s_pool_allocs == allocsAfterFirst) == reuse);
+    }
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+}
+
+void
+testBufferPool (const std::string& tempdir)
+{
+    exr_buffer_pool_t         pool;
+    exr_context_t             c;
+    size_t                    cached;
+    std::string               fn    = tempdir + "core_buffer_pool.exr";
+    exr_context_initializer_t cinit = EXR_DEFAULT_CONTEXT_INITIALIZER;
+
+    printf ("Testing buffer pool API\n");
+
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_INVALID_ARGUMENT, exr_buffer_pool_create (NULL, 0, NULL, NULL));
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_INVALID_ARGUMENT,
+        exr_buffer_pool_get_cached_size (NULL, &cached));
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_INVALID_ARGUMENT, exr_buffer_pool_set_huge_pages (NULL, 1));
+    exr_buffer_pool_release (NULL);
+    exr_buffer_pool_trim (NULL);
+
+
+    s_pool_allocs = s_pool_frees = 0;
+    EXRCORE_TEST_RVAL (exr_buffer_pool_create (
+        &pool,
+        EXR_DEFAULT_BUFFER_POOL_CACHE_SIZE,
+        &counting_malloc,
+        &counting_free));
+    EXRCORE_TEST (s_pool_allocs == 1);
+    EXRCORE_TEST_RVAL (exr_buffer_pool_get_cached_size (pool, &cached));
+    EXRCORE_TEST (cached == 0);
+
+    // the compressed buffers are large enough for huge pages
+    EXRCORE_TEST_RVAL (exr_buffer_pool_set_huge_pages (pool, 1));
+
+    // the writing and reading contexts share the pool, reading
+    // reuses what writing left behind
+    cinit.buffer_pool = pool;
+    writePoolFile (fn, cinit);
+    EXRCORE_TEST_RVAL (exr_buffer_pool_get_cached_size (pool, &cached));
+    EXRCORE_TEST (cached > 0);
+    EXRCORE_TEST (s_pool_frees == 0);
+
+    readPoolFile (fn, cinit, true);
+    EXRCORE_TEST (s_pool_frees == 0);
+
+    exr_buffer_pool_trim (pool);
+    EXRCORE_TEST_RVAL (exr_buffer_pool_get_cached_size (pool, &cached));
+    EXRCORE_TEST (cached == 0);
+    EXRCORE_TEST (s_pool_frees == s_pool_allocs - 1);
+
+    // a context keeps the pool alive after the caller released it
+    EXRCORE_TEST_RVAL (exr_start_read (&c, fn.c_str (), &cinit));
+    exr_buffer_pool_release (pool);
+    EXRCORE_TEST (s_pool_frees == s_pool_allocs - 1);
+    exr_finish (&c);
+    EXRCORE_TEST (s_pool_frees == s_pool_allocs);
+
+    // by default a context has no pool, and allocates for every chunk
+    cinit.buffer_pool = NULL;
+    cinit.alloc_fn    = &counting_malloc;
+    cinit.free_fn     = &counting_free;
+    s_pool_allocs = s_pool_frees = 0;
+    readPoolFile (fn, cinit, false);
+    EXRCORE_TEST (s_pool_frees == s_pool_allocs);
+
+    // unless it asks for a private pool
+    s_pool_allocs = s_pool_frees = 0;
+    cinit.flags   = EXR_CONTEXT_FLAG_PRIVATE_BUFFER_POOL;
+    readPoolFile (fn, cinit, true);
+    EXRCORE_TEST (s_pool_frees == s_pool_allocs);
+
+    // a private pool with huge pages
+    s_pool_allocs = s_pool_frees = 0;
+    cinit.flags   = EXR_CONTEXT_FLAG_HUGE_PAGE_BUFFERS;
+    readPoolFile (fn, cinit, true);
+    cinit.flags    = 0;
+    cinit.alloc_fn = NULL;
+    cinit.free_fn  = NULL;
+
+    // nothing is kept beyond the cache limit
+    s_pool_allocs = s_pool_frees = 0;
+    EXRCORE_TEST_RVAL (
+        exr_buffer_pool_create (&pool, 0, &counting_malloc, &counting_free));
+    cinit.buffer_pool = pool;
+    readPoolFile (fn, cinit, false);
+    EXRCORE_TEST_RVAL (exr_buffer_pool_get_cached_size (pool, &cached));
+    EXRCORE_TEST (cached == 0);
+    EXRCORE_TEST (s_pool_frees == s_pool_allocs - 1);
+    exr_buffer_pool_release (pool);
+    EXRCORE_TEST (s_pool_frees == s_pool_allocs);
+
+    remove (fn.c_str ());
+    printf ("ok.\n");
+}
+
+////////////////////////////////////////
+
+static std::atomic<int> s_budget_active{0};
+static std::atomic<int> s_budget_max_active{0};
+
+static std::atomic<exr_result_t (*) (exr_decode_pipeline_t*)>
+    s_budget_unpack{nullptr};
+
+static exr_result_t
+counting_unpack (exr_decode_pipeline_t* decode)
+{
+    int active = ++s_budget_active;
+    int seen   = s_budget_max_active.load ();
+    while (active > seen &&
+           !s_budget_max_active.compare_exchange_weak (seen, active))
+        ;
+
+    std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    exr_result_t rv = s_budget_unpack (decode);
+    --s_budget_active;
+    return rv;
+}
+
+static void
+decodeBudgetChunks (exr_context_t f)
+{
+    uint16_t line[kPoolW];
+
+    for (int y = 0; y < kPoolH; ++y)
+    {
+        exr_chunk_info_t      cinfo;
+        exr_decode_pipeline_t decoder;
+
+        EXRCORE_TEST_RVAL (exr_read_scanline_chunk_info (f, 0, y, &cinfo));
+        EXRCORE_TEST_RVAL (exr_decoding_initialize (f, 0, &cinfo, &decoder));
+        decoder.channels[0].decode_to_ptr     = (uint8_t*) line;
+        decoder.channels[0].user_pixel_stride = 2;
+        decoder.channels[0].user_line_stride  = 2 * kPoolW;
+        EXRCORE_TEST_RVAL (
+            exr_decoding_choose_default_routines (f, 0, &decoder));
+        s_budget_unpack               = decoder.unpack_and_convert_fn;
+        decoder.unpack_and_convert_fn = &counting_unpack;
+        EXRCORE_TEST_RVAL (exr_decoding_run (f, 0, &decoder));
+        EXRCORE_TEST_RVAL (exr_decoding_destroy (f, &decoder));
+
+        EXRCORE_TEST (line[0] == 0x3c00);
+    }
+}
+
+void
+testMemoryBudget (const std::string& tempdir)
+{
+    exr_context_t             f;
+    exr_chunk_info_t          cinfo;
+    size_t                    budget, reserved;
+    std::string               fn    = tempdir + "core_memory_budget.exr";
+    exr_context_initializer_t cinit = EXR_DEFAULT_CONTEXT_INITIALIZER;
+
+    printf ("Testing context memory budget\n");
+
+    writePoolFile (fn, cinit);
+
+    EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_MISSING_CONTEXT_ARG,
+        exr_get_memory_budget (NULL, &budget, &reserved));
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_INVALID_ARGUMENT, exr_get_memory_budget (f, NULL, NULL));
+    EXRCORE_TEST_RVAL (exr_get_memory_budget (f, &budget, &reserved));
+    EXRCORE_TEST (budget == 0 && reserved == 0);
+    EXRCORE_TEST_RVAL (exr_read_scanline_chunk_info (f, 0, 0, &cinfo));
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+
+    // room for one chunk at a time: the decoders of all threads
+    // take turns, and a single thread is never blocked
+    cinit.memory_budget = cinfo.packed_size + cinfo.unpacked_size;
+    EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+    decodeBudgetChunks (f);
+    EXRCORE_TEST (s_budget_max_active == 1);
+
+#if ILMTHREAD_THREADING_ENABLED
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back (decodeBudgetChunks, f);
+    for (auto& t: threads)
+        t.join ();
+    EXRCORE_TEST (s_budget_max_active == 1);
+#endif
+
+    EXRCORE_TEST_RVAL (exr_get_memory_budget (f, &budget, &reserved));
+    EXRCORE_TEST (budget == cinit.memory_budget);
+    EXRCORE_TEST (reserved == 0);
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+
+    // a chunk larger than the whole budget still runs
+    cinit.memory_budget = 1;
+    EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+    decodeBudgetChunks (f);
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+
+    remove (fn.c_str ());
+    printf ("ok.\n");
+}
+
+////////////////////////////////////////
+
+static void
+collect_trace (
+    exr_const_context_t ctxt, void* userdata, const exr_trace_event_t* ev)
+{
+    static_cast<std::vector<exr_trace_event_t>*> (userdata)->push_back (*ev);
+}
+
+static void
+checkTrace (
+    const std::vector<exr_trace_event_t>& events,
+    const exr_trace_stage_t*              stages,
+    int                                   numStages)
+{
+    EXRCORE_TEST (events.size () == (size_t) (kPoolH * numStages * 2));
+    for (size_t i = 0; i < events.size (); i += 2)
+    {
+        const exr_trace_event_t& b = events[i];
+        const exr_trace_event_t& e = events[i + 1];
+        int                      s = (int) ((i / 2) % numStages);
+
+        EXRCORE_TEST (b.stage == stages[s] && e.stage == stages[s]);
+        EXRCORE_TEST (b.is_end == 0 && e.is_end == 1);
+        EXRCORE_TEST (b.chunk_index == (int) (i / (2 * numStages)));
+        EXRCORE_TEST (e.chunk_index == b.chunk_index);
+        EXRCORE_TEST (b.part_index == 0);
+        EXRCORE_TEST (b.compression == EXR_COMPRESSION_RLE);
+        EXRCORE_TEST (e.time_ns >= b.time_ns);
+        EXRCORE_TEST (e.in_bytes > 0 && e.out_bytes > 0);
+        if (i > 0) EXRCORE_TEST (b.time_ns >= events[i - 1].time_ns);
+    }
+}
+
+void
+testTrace (const std::string& tempdir)
+{
+    std::vector<exr_trace_event_t> events;
+    exr_trace_writer_t             writer;
+    std::string                    fn    = tempdir + "core_trace.exr";
+    std::string                    json  = tempdir + "core_trace.json";
+    exr_context_initializer_t      cinit = EXR_DEFAULT_CONTEXT_INITIALIZER;
+
+    static const exr_trace_stage_t encStages[] = {
+        EXR_TRACE_STAGE_PACK,
+        EXR_TRACE_STAGE_COMPRESS,
+        EXR_TRACE_STAGE_WRITE};
+    static const exr_trace_stage_t decStages[] = {
+        EXR_TRACE_STAGE_READ,
+        EXR_TRACE_STAGE_DECOMPRESS,
+        EXR_TRACE_STAGE_UNPACK};
+
+    printf ("Testing pipeline trace events\n");
+
+    cinit.trace_fn        = &collect_trace;
+    cinit.trace_user_data = &events;
+    writePoolFile (fn, cinit);
+    checkTrace (events, encStages, 3);
+
+    events.clear ();
+    readPoolFile (fn, cinit, true);
+    checkTrace (events, decStages, 3);
+
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_INVALID_ARGUMENT, exr_trace_writer_create (NULL, "x"));
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_INVALID_ARGUMENT, exr_trace_writer_finish (NULL));
+
+    EXRCORE_TEST_RVAL (exr_trace_writer_create (&writer, json.c_str ()));
+    cinit.trace_fn        = &exr_trace_write_chrome_event;
+    cinit.trace_user_data = writer;
+    readPoolFile (fn, cinit, true);
+    EXRCORE_TEST_RVAL (exr_trace_writer_finish (writer));
+
+    FILE* jf = fopen (json.c_str (), "r");
+    EXRCORE_TEST (jf != NULL);
+    std::string contents;
+    char        buf[4096];
+    size_t      n;
+    while ((n = fread (buf, 1, sizeof (buf), jf)) > 0)
+        contents.append (buf, n);
+    fclose (jf);
+
+    EXRCORE_TEST (contents.compare (0, 2, "[\n") == 0);
+    EXRCORE_TEST (contents.compare (contents.size () - 3, 3, "\n]\n") == 0);
+    EXRCORE_TEST (
+        contents.find ("\"name\":\"decompress\",\"cat\":\"exr\",\"ph\":\"B\"") !=
+        std::string::npos);
+    EXRCORE_TEST (
+        contents.find ("\"chunk\":7,\"compression\":\"rle\"") !=
+        std::string::npos);
+    EXRCORE_TEST (contents.find ("},\n{") != std::string::npos);
+
+    remove (json.c_str ());
+    remove (fn.c_str ());
+    printf ("ok.\n");
+}
+
+////////////////////////////////////////
+
+void
+testPerfCounters (const std::string& tempdir)
+{
+    exr_context_t             f;
+    exr_perf_counters_t       pc;
+    uint64_t                  packed = 0, stagens = 0;
+    uint16_t                  line[kPoolW];
+    std::string               fn    = tempdir + "core_perf_counters.exr";
+    exr_context_initializer_t cinit = EXR_DEFAULT_CONTEXT_INITIALIZER;
+
+    printf ("Testing context performance counters\n");
+
+    writePoolFile (fn, cinit, &pc);
+    EXRCORE_TEST (pc.chunks_encoded[EXR_COMPRESSION_RLE] == kPoolH);
+    EXRCORE_TEST (pc.chunks_encoded[EXR_COMPRESSION_NONE] == 0);
+    EXRCORE_TEST (pc.uncompressed_bytes_encoded == kPoolH * kPoolW * 2);
+    EXRCORE_TEST (pc.compressed_bytes_encoded > 0);
+    EXRCORE_TEST (pc.bytes_written > pc.compressed_bytes_encoded);
+    EXRCORE_TEST (pc.write_calls > kPoolH);
+    EXRCORE_TEST (pc.bytes_read == 0 && pc.read_calls == 0);
+    EXRCORE_TEST (pc.buffer_allocs > 0 && pc.peak_buffer_bytes > 0);
+
+    EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_MISSING_CONTEXT_ARG, exr_get_perf_counters (NULL, &pc));
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_INVALID_ARGUMENT, exr_get_perf_counters (f, NULL));
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_MISSING_CONTEXT_ARG, exr_reset_perf_counters (NULL));
+
+    // the header has been read
+    EXRCORE_TEST_RVAL (exr_get_perf_counters (f, &pc));
+    EXRCORE_TEST (pc.bytes_read > 0 && pc.read_calls > 0);
+    EXRCORE_TEST (pc.bytes_written == 0 && pc.write_calls == 0);
+    EXRCORE_TEST (pc.chunks_decoded[EXR_COMPRESSION_RLE] == 0);
+
+    EXRCORE_TEST_RVAL (exr_reset_perf_counters (f));
+    EXRCORE_TEST_RVAL (exr_get_perf_counters (f, &pc));
+    EXRCORE_TEST (pc.bytes_read == 0 && pc.read_calls == 0);
+
+    for (int y = 0; y < kPoolH; ++y)
+    {
+        exr_chunk_info_t      cinfo;
+        exr_decode_pipeline_t decoder;
+
+        EXRCORE_TEST_RVAL (exr_read_scanline_chunk_info (f, 0, y, &cinfo));
+        EXRCORE_TEST_RVAL (exr_decoding_initialize (f, 0, &cinfo, &decoder));
+        decoder.channels[0].decode_to_ptr     = (uint8_t*) line;
+        decoder.channels[0].user_pixel_stride = 2;
+        decoder.channels[0].user_line_stride  = 2 * kPoolW;
+        EXRCORE_TEST_RVAL (
+            exr_decoding_choose_default_routines (f, 0, &decoder));
+        EXRCORE_TEST_RVAL (exr_decoding_run (f, 0, &decoder));
+
+        // buffers still held by the decoder
+        if (y == 0)
+        {
+            EXRCORE_TEST_RVAL (exr_get_perf_counters (f, &pc));
+            EXRCORE_TEST (pc.buffer_bytes > 0);
+            EXRCORE_TEST (pc.peak_buffer_bytes >= pc.buffer_bytes);
+        }
+        EXRCORE_TEST_RVAL (exr_decoding_destroy (f, &decoder));
+        packed += cinfo.packed_size;
+    }
+
+    EXRCORE_TEST_RVAL (exr_get_perf_counters (f, &pc));
+    EXRCORE_TEST (pc.chunks_decoded[EXR_COMPRESSION_RLE] == kPoolH);
+    EXRCORE_TEST (pc.chunks_decoded[EXR_COMPRESSION_ZIP] == 0);
+    EXRCORE_TEST (pc.compressed_bytes_decoded == packed);
+    EXRCORE_TEST (pc.uncompressed_bytes_decoded == kPoolH * kPoolW * 2);
+    EXRCORE_TEST (pc.bytes_read >= packed);
+    EXRCORE_TEST (pc.chunks_encoded[EXR_COMPRESSION_RLE] == 0);
+    EXRCORE_TEST (pc.buffer_allocs > 0);
+    EXRCORE_TEST (pc.buffer_bytes == 0);
+    EXRCORE_TEST (pc.peak_buffer_bytes > 0);
+    for (int s = 0; s < EXR_TRACE_STAGE_LAST_TYPE; ++s)
+        stagens += pc.stage_ns[s];
+    EXRCORE_TEST (stagens > 0);
+    EXRCORE_TEST (pc.stage_ns[EXR_TRACE_STAGE_COMPRESS] == 0);
+
+    EXRCORE_TEST_RVAL (exr_reset_perf_counters (f));
+    EXRCORE_TEST_RVAL (exr_get_perf_counters (f, &pc));
+    EXRCORE_TEST (pc.chunks_decoded[EXR_COMPRESSION_RLE] == 0);
+    EXRCORE_TEST (pc.peak_buffer_bytes == 0 && pc.stage_ns[0] == 0);
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+
+    remove (fn.c_str ());
+    printf ("ok.\n");
+}
+
+////////////////////////////////////////
+
+static void
+decodeCachedFile (exr_context_t f, exr_perf_counters_t* pc)
+{
+    uint16_t line[kPoolW];
+
+    EXRCORE_TEST_RVAL (exr_reset_perf_counters (f));
+    for (int y = 0; y < kPoolH; ++y)
+    {
+        exr_chunk_info_t      cinfo;
+        exr_decode_pipeline_t decoder;
+
+        memset (line, 0, sizeof (line));
+        EXRCORE_TEST_RVAL (exr_read_scanline_chunk_info (f, 0, y, &cinfo));
+        EXRCORE_TEST_RVAL (exr_decoding_initialize (f, 0, &cinfo, &decoder));
+        decoder.channels[0].decode_to_ptr     = (uint8_t*) line;
+        decoder.channels[0].user_pixel_stride = 2;
+        decoder.channels[0].user_line_stride  = 2 * kPoolW;
+        EXRCORE_TEST_RVAL (
+            exr_decoding_choose_default_routines (f, 0, &decoder));
+        EXRCORE_TEST_RVAL (exr_decoding_run (f, 0, &decoder));
+        EXRCORE_TEST_RVAL (exr_decoding_destroy (f, &decoder));
+
+        for (int x = 0; x < kPoolW; ++x)
+            EXRCORE_TEST (line[x] == 0x3c00);
+    }
+    EXRCORE_TEST_RVAL (exr_get_perf_counters (f, pc));
+}
+
+void
+testChunkCache (const std::string& tempdir)
+{
+    exr_context_t             f1, f2, f3;
+    exr_perf_counters_t       pc, first;
+    size_t                    limit, used;
+    std::string               fn    = tempdir + "core_chunk_cache.exr";
+    exr_context_initializer_t cinit = EXR_DEFAULT_CONTEXT_INITIALIZER;
+
+    printf ("Testing shared chunk cache\n");
+
+    exr_get_chunk_cache_size (&limit, &used);
+    EXRCORE_TEST (limit == 0 && used == 0);
+
+    writePoolFile (fn, cinit);
+
+    // disabled by default
+    EXRCORE_TEST_RVAL (exr_start_read (&f1, fn.c_str (), &cinit));
+    decodeCachedFile (f1, &pc);
+    EXRCORE_TEST (pc.chunk_cache_hits == 0 && pc.chunk_cache_misses == 0);
+    EXRCORE_TEST_RVAL (exr_finish (&f1));
+
+    exr_set_chunk_cache_size (1 << 20);
+    EXRCORE_TEST_RVAL (exr_start_read (&f1, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL (exr_start_read (&f2, fn.c_str (), &cinit));
+
+    // both readers see the same file identity
+    {
+        int      has1, has2;
+        uint64_t id1[4], id2[4];
+        EXRCORE_TEST_RVAL (exr_get_file_identity (f1, &has1, id1));
+        EXRCORE_TEST_RVAL (exr_get_file_identity (f2, &has2, id2));
+        EXRCORE_TEST (has1 == 1 && has2 == 1);
+        EXRCORE_TEST (memcmp (id1, id2, sizeof (id1)) == 0);
+        EXRCORE_TEST (id1[3] > 0);
+    }
+
+    decodeCachedFile (f1, &first);
+    EXRCORE_TEST (first.chunk_cache_hits == 0);
+    EXRCORE_TEST (first.chunk_cache_misses == kPoolH);
+    EXRCORE_TEST (first.chunks_decoded[EXR_COMPRESSION_RLE] == kPoolH);
+    exr_get_chunk_cache_size (&limit, &used);
+    EXRCORE_TEST (limit == (1 << 20));
+    EXRCORE_TEST (used >= (size_t) (kPoolH * kPoolW * 2));
+
+    // a second reader of the same file only reads the chunk table
+    decodeCachedFile (f2, &pc);
+    EXRCORE_TEST (pc.chunk_cache_hits == kPoolH);
+    EXRCORE_TEST (pc.chunk_cache_misses == 0);
+    EXRCORE_TEST (
+        pc.bytes_read + first.compressed_bytes_decoded <= first.bytes_read);
+    EXRCORE_TEST (pc.stage_ns[EXR_TRACE_STAGE_DECOMPRESS] == 0);
+    EXRCORE_TEST (pc.chunks_decoded[EXR_COMPRESSION_RLE] == kPoolH);
+
+    // opting out of the cache per context
+    cinit.flags |= EXR_CONTEXT_FLAG_DISABLE_CHUNK_CACHE;
+    EXRCORE_TEST_RVAL (exr_start_read (&f3, fn.c_str (), &cinit));
+    decodeCachedFile (f3, &pc);
+    EXRCORE_TEST (pc.chunk_cache_hits == 0 && pc.chunk_cache_misses == 0);
+    EXRCORE_TEST (pc.bytes_read > 0);
+    EXRCORE_TEST_RVAL (exr_finish (&f3));
+
+    exr_clear_chunk_cache ();
+    exr_get_chunk_cache_size (&limit, &used);
+    EXRCORE_TEST (limit == (1 << 20) && used == 0);
+    decodeCachedFile (f2, &pc);
+    EXRCORE_TEST (pc.chunk_cache_misses == kPoolH);
+
+    // too small for a single chunk
+    exr_set_chunk_cache_size (16);
+    exr_get_chunk_cache_size (&limit, &used);
+    EXRCORE_TEST (used == 0);
+    decodeCachedFile (f1, &pc);
+    EXRCORE_TEST (pc.chunk_cache_hits == 0);
+    exr_get_chunk_cache_size (&limit, &used);
+    EXRCORE_TEST (used == 0);
+
+    EXRCORE_TEST_RVAL (exr_finish (&f1));
+    EXRCORE_TEST_RVAL (exr_finish (&f2));
+    exr_set_chunk_cache_size (0);
+
+    remove (fn.c_str ());
+    printf ("ok.\n");
+}
+
+static void
+writeConstantChunkFile (
+    const std::string&               fn,
+    const exr_context_initializer_t& cinit,
+    exr_compression_t                comp,
+    bool                             tiled)
+{
+    exr_context_t f;
+    int           partidx;
+    uint16_t      line[kPoolW];
+    uint8_t       attr[8 + 1 + kPoolH * 2];
+
+    // chunks 2 and 5 are constant, with half values 0.5 and 2.0
+    memset (attr, 0, sizeof (attr));
+    attr[0]             = kPoolH;
+    attr[4]             = 2;
+    attr[8]             = (1 << 2) | (1 << 5);
+    attr[9 + 2 * 2 + 1] = 0x38;
+    attr[9 + 5 * 2 + 1] = 0x40;
+
+    EXRCORE_TEST_RVAL (
+        exr_start_write (&f, fn.c_str (), EXR_WRITE_FILE_DIRECTLY, &cinit));
+    EXRCORE_TEST_RVAL (exr_add_part (
+        f,
+        "const",
+        tiled ? EXR_STORAGE_TILED : EXR_STORAGE_SCANLINE,
+        &partidx));
+    EXRCORE_TEST_RVAL (exr_initialize_required_attr_simple (
+        f, partidx, kPoolW, kPoolH, comp));
+    // one tile per scan line, so the chunks match the scan line file
+    if (tiled)
+    {
+        EXRCORE_TEST_RVAL (exr_set_tile_descriptor (
+            f, partidx, kPoolW, 1, EXR_TILE_ONE_LEVEL, EXR_TILE_ROUND_DOWN));
+    }
+    EXRCORE_TEST_RVAL (exr_add_channel (
+        f, partidx, "Y", EXR_PIXEL_HALF, EXR_PERCEPTUALLY_LOGARITHMIC, 1, 1));
+    EXRCORE_TEST_RVAL (exr_attr_set_user (
+        f,
+        partidx,
+        EXR_CONSTANT_CHUNKS_ATTR_NAME,
+        EXR_CONSTANT_CHUNKS_TYPE_NAME,
+        (int32_t) sizeof (attr),
+        attr));
+    EXRCORE_TEST_RVAL (exr_write_header (f));
+
+    for (int x = 0; x < kPoolW; ++x)
+        line[x] = 0x3c00;
+
+    // the Core writer stores every chunk, the table entries of the
+    // constant ones are cleared afterwards
+    for (int y = 0; y < kPoolH; ++y)
+    {
+        exr_chunk_info_t      cinfo;
+        exr_encode_pipeline_t encoder;
+
+        if (tiled)
+        {
+            EXRCORE_TEST_RVAL (
+                exr_write_tile_chunk_info (f, 0, 0, y, 0, 0, &cinfo));
+        }
+        else
+        {
+            EXRCORE_TEST_RVAL (
+                exr_write_scanline_chunk_info (f, 0, y, &cinfo));
+        }
+        EXRCORE_TEST_RVAL (exr_encoding_initialize (f, 0, &cinfo, &encoder));
+        encoder.channels[0].encode_from_ptr   = (const uint8_t*) line;
+        encoder.channels[0].user_pixel_stride = 2;
+        encoder.channels[0].user_line_stride  = 2 * kPoolW;
+        EXRCORE_TEST_RVAL (
+            exr_encoding_choose_default_routines (f, 0, &encoder));
+        EXRCORE_TEST_RVAL (exr_encoding_run (f, 0, &encoder));
+        EXRCORE_TEST_RVAL (exr_encoding_destroy (f, &encoder));
+    }
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+
+    uint64_t tableoff;
+    EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL (exr_get_chunk_table_offset (f, 0, &tableoff));
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+
+    FILE*    fp      = fopen (fn.c_str (), "r+b");
+    uint64_t zero    = 0;
+    int      cidx[2] = {2, 5};
+    EXRCORE_TEST (fp != NULL);
+    for (int c = 0; c < 2; ++c)
+    {
+        EXRCORE_TEST (
+            0 == fseek (fp, (long) (tableoff + cidx[c] * 8), SEEK_SET));
+        EXRCORE_TEST (1 == fwrite (&zero, 8, 1, fp));
+    }
+    fclose (fp);
+}
+
+void
+testConstantChunks (const std::string& tempdir)
+{
+    std::string               fn    = tempdir + "core_constant_chunks.exr";
+    exr_context_initializer_t cinit = EXR_DEFAULT_CONTEXT_INITIALIZER;
+    exr_compression_t comps[2] = {EXR_COMPRESSION_NONE, EXR_COMPRESSION_RLE};
+
+    printf ("Testing constant chunks\n");
+
+    for (int t = 0; t < 4; ++t)
+    {
+        exr_context_t f;
+        uint16_t      line[kPoolW];
+        bool          tiled = t >= 2;
+
+        writeConstantChunkFile (fn, cinit, comps[t % 2], tiled);
+
+        EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+        EXRCORE_TEST_RVAL (exr_validate_chunk_table (f, 0));
+        for (int y = 0; y < kPoolH; ++y)
+        {
+            exr_chunk_info_t      cinfo;
+            exr_decode_pipeline_t decoder;
+            uint16_t              expect = 0x3c00;
+
+            if (y == 2) expect = 0x3800;
+            if (y == 5) expect = 0x4000;
+
+            memset (line, 0, sizeof (line));
+            if (tiled)
+            {
+                EXRCORE_TEST_RVAL (
+                    exr_read_tile_chunk_info (f, 0, 0, y, 0, 0, &cinfo));
+            }
+            else
+            {
+                EXRCORE_TEST_RVAL (
+                    exr_read_scanline_chunk_info (f, 0, y, &cinfo));
+            }
+            // constant chunks are filled without reading anything
+            EXRCORE_TEST ((cinfo.data_offset == 0) == (expect != 0x3c00));
+            EXRCORE_TEST ((cinfo.packed_size == 0) == (expect != 0x3c00));
+            EXRCORE_TEST (cinfo.unpacked_size == 2 * kPoolW);
+            EXRCORE_TEST_RVAL (
+                exr_decoding_initialize (f, 0, &cinfo, &decoder));
+            decoder.channels[0].decode_to_ptr     = (uint8_t*) line;
+            decoder.channels[0].user_pixel_stride = 2;
+            decoder.channels[0].user_line_stride  = 2 * kPoolW;
+            EXRCORE_TEST_RVAL (
+                exr_decoding_choose_default_routines (f, 0, &decoder));
+            EXRCORE_TEST_RVAL (exr_decoding_run (f, 0, &decoder));
+            EXRCORE_TEST_RVAL (exr_decoding_destroy (f, &decoder));
+
+            for (int x = 0; x < kPoolW; ++x)
+                EXRCORE_TEST (line[x] == expect);
+        }
+        EXRCORE_TEST_RVAL (exr_finish (&f));
+    }
+
+    remove (fn.c_str ());
+    printf ("ok.\n");
+}
+
+void
+testChunkStats (const std::string& tempdir)
+{
+    std::string               fn    = tempdir + "core_chunk_stats.exr";
+    exr_context_initializer_t cinit = EXR_DEFAULT_CONTEXT_INITIALIZER;
+    const int                 w = 16, h = 32;
+    uint16_t                  alpha[w * h];
+    float                     depth[w * h];
+    uint32_t                  ids[w * h];
+
+    printf ("Testing chunk statistics\n");
+
+    // alpha is 0 in the top half only
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            alpha[y * w + x] = (y < h / 2) ? 0 : 0x3c00;
+            depth[y * w + x] = (float) (x + y * w) - 100.f;
+            ids[y * w + x]   = (uint32_t) (x * 7 + y);
+        }
+    }
+
+    for (int t = 0; t < 2; ++t)
+    {
+        exr_context_t f;
+        int           partidx;
+        bool          tiled = t == 1;
+        int32_t       count;
+        double        mn, mx;
+
+        EXRCORE_TEST_RVAL (
+            exr_start_write (&f, fn.c_str (), EXR_WRITE_FILE_DIRECTLY, &cinit));
+        EXRCORE_TEST_RVAL (exr_add_part (
+            f,
+            "stats",
+            tiled ? EXR_STORAGE_TILED : EXR_STORAGE_SCANLINE,
+            &partidx));
+        EXRCORE_TEST_RVAL (exr_initialize_required_attr_simple (
+            f, partidx, w, h, EXR_COMPRESSION_ZIP));
+        if (tiled)
+        {
+            EXRCORE_TEST_RVAL (exr_set_tile_descriptor (
+                f, partidx, 8, 8, EXR_TILE_ONE_LEVEL, EXR_TILE_ROUND_DOWN));
+        }
+        EXRCORE_TEST_RVAL (exr_add_channel (
+            f,
+            partidx,
+            "A",
+            EXR_PIXEL_HALF,
+            EXR_PERCEPTUALLY_LOGARITHMIC,
+            1,
+            1));
+        EXRCORE_TEST_RVAL (exr_add_channel (
+            f, partidx, "ID", EXR_PIXEL_UINT, EXR_PERCEPTUALLY_LINEAR, 1, 1));
+        EXRCORE_TEST_RVAL (exr_add_channel (
+            f, partidx, "Z", EXR_PIXEL_FLOAT, EXR_PERCEPTUALLY_LINEAR, 1, 1));
+        EXRCORE_TEST_RVAL (exr_add_chunk_stats (f, partidx));
+        EXRCORE_TEST_RVAL (exr_write_header (f));
+        EXRCORE_TEST_RVAL (exr_get_chunk_count (f, partidx, &count));
+        EXRCORE_TEST (count == (tiled ? 8 : 2));
+
+        for (int c = 0; c < count; ++c)
+        {
+            exr_chunk_info_t      cinfo;
+            exr_encode_pipeline_t encoder;
+            size_t                off;
+
+            if (tiled)
+            {
+                EXRCORE_TEST_RVAL (exr_write_tile_chunk_info (
+                    f, partidx, c % 2, c / 2, 0, 0, &cinfo));
+                off = (size_t) (cinfo.start_y * 8 * w + cinfo.start_x * 8);
+            }
+            else
+            {
+                EXRCORE_TEST_RVAL (exr_write_scanline_chunk_info (
+                    f, partidx, c * 16, &cinfo));
+                off = (size_t) (cinfo.start_y * w);
+            }
+            EXRCORE_TEST_RVAL (
+                exr_encoding_initialize (f, partidx, &cinfo, &encoder));
+            encoder.channels[0].encode_from_ptr   = (uint8_t*) (alpha + off);
+            encoder.channels[0].user_pixel_stride = 2;
+            encoder.channels[0].user_line_stride  = 2 * w;
+            encoder.channels[1].encode_from_ptr   = (uint8_t*) (ids + off);
+            encoder.channels[1].user_pixel_stride = 4;
+            encoder.channels[1].user_line_stride  = 4 * w;
+            encoder.channels[2].encode_from_ptr   = (uint8_t*) (depth + off);
+            encoder.channels[2].user_pixel_stride = 4;
+            encoder.channels[2].user_line_stride  = 4 * w;
+            EXRCORE_TEST_RVAL (
+                exr_encoding_choose_default_routines (f, partidx, &encoder));
+            EXRCORE_TEST_RVAL (exr_encoding_run (f, partidx, &encoder));
+            EXRCORE_TEST_RVAL (exr_encoding_destroy (f, &encoder));
+        }
+        EXRCORE_TEST_RVAL (exr_finish (&f));
+
+        EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+        for (int c = 0; c < count; ++c)
+        {
+            exr_chunk_info_t cinfo;
+            int              x0, y0, cw, ch;
+
+            if (tiled)
+            {
+                EXRCORE_TEST_RVAL (exr_read_tile_chunk_info (
+                    f, 0, c % 2, c / 2, 0, 0, &cinfo));
+                x0 = cinfo.start_x * 8;
+                y0 = cinfo.start_y * 8;
+            }
+            else
+            {
+                EXRCORE_TEST_RVAL (
+                    exr_read_scanline_chunk_info (f, 0, c * 16, &cinfo));
+                x0 = 0;
+                y0 = cinfo.start_y;
+            }
+            cw = cinfo.width;
+            ch = cinfo.height;
+
+            // a reader can skip the chunks where alpha is 0 everywhere
+            EXRCORE_TEST_RVAL (
+                exr_get_chunk_stats (f, 0, cinfo.idx, 0, &mn, &mx));
+            EXRCORE_TEST (mn == mx);
+            EXRCORE_TEST (mn == ((y0 < h / 2) ? 0.0 : 1.0));
+
+            EXRCORE_TEST_RVAL (
+                exr_get_chunk_stats (f, 0, cinfo.idx, 1, &mn, &mx));
+            EXRCORE_TEST (mn == (double) (x0 * 7 + y0));
+            EXRCORE_TEST (mx == (double) ((x0 + cw - 1) * 7 + y0 + ch - 1));
+
+            EXRCORE_TEST_RVAL (
+                exr_get_chunk_stats (f, 0, cinfo.idx, 2, &mn, &mx));
+            EXRCORE_TEST (mn == (double) (x0 + y0 * w) - 100.0);
+            EXRCORE_TEST (
+                mx == (double) (x0 + cw - 1 + (y0 + ch - 1) * w) - 100.0);
+        }
+        EXRCORE_TEST (
+            EXR_ERR_ARGUMENT_OUT_OF_RANGE ==
+            exr_get_chunk_stats (f, 0, count, 0, &mn, &mx));
+        EXRCORE_TEST (
+            EXR_ERR_ARGUMENT_OUT_OF_RANGE ==
+            exr_get_chunk_stats (f, 0, 0, 3, &mn, &mx));
+        EXRCORE_TEST_RVAL (exr_finish (&f));
+    }
+
+    // files written without statistics have none to query
+    {
+        exr_context_t f;
+        double        mn, mx;
+
+        writeConstantChunkFile (fn, cinit, EXR_COMPRESSION_NONE, false);
+        EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+        EXRCORE_TEST (
+            EXR_ERR_NO_ATTR_BY_NAME ==
+            exr_get_chunk_stats (f, 0, 0, 0, &mn, &mx));
+        EXRCORE_TEST_RVAL (exr_finish (&f));
+    }
+
+    remove (fn.c_str ());
+    printf ("ok.\n");
+}
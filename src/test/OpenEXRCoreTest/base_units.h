@@ -13,5 +13,12 @@ void testBaseDebug (const std::string& tempdir);
 void testCPUIdent (const std::string& tempdir);
 void testHalf (const std::string& tempdir);
 void testTempContext (const std::string& tempdir);
+void testBufferPool (const std::string& tempdir);
+void testMemoryBudget (const std::string& tempdir);
+void testTrace (const std::string& tempdir);
+void testPerfCounters (const std::string& tempdir);
+void testChunkCache (const std::string& tempdir);
+void testConstantChunks (const std::string& tempdir);
+void testChunkStats (const std::string& tempdir);
 
 #endif // OPENEXR_CORE_TEST_BASE_H
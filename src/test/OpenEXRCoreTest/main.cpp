@@ -154,6 +154,13 @@ main (int argc, char* argv[])
     TEST (testXDR, "core");
     TEST (testBufferCompression, "core");
     TEST (testTempContext, "core");
+    TEST (testBufferPool, "core");
+    TEST (testMemoryBudget, "core");
+    TEST (testTrace, "core");
+    TEST (testPerfCounters, "core");
+    TEST (testChunkCache, "core");
+    TEST (testConstantChunks, "core");
+    TEST (testChunkStats, "core");
 
     TEST (testAttrSizes, "gen_attr");
     TEST (testAttrStrings, "gen_attr");
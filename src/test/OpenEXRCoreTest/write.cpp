@@ -23,9 +23,11 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 static void
 err_cb (exr_const_context_t f, exr_result_t code, const char* msg)
@@ -1280,9 +1282,177 @@ testWriteAttrs (const std::string& tempdir)
     remove (outfn.c_str ());
 }
 
+static void
+writeUpdateFile (
+    const std::string&               fn,
+    const exr_context_initializer_t& cinit,
+    int32_t                          padding)
+{
+    exr_context_t f;
+    int           partidx;
+    uint16_t      pixels[8 * 8];
+
+    for (int i = 0; i < 8 * 8; ++i)
+        pixels[i] = (uint16_t) (0x3c00 + i);
+
+    EXRCORE_TEST_RVAL (
+        exr_start_write (&f, fn.c_str (), EXR_WRITE_FILE_DIRECTLY, &cinit));
+    EXRCORE_TEST_RVAL (exr_add_part (f, "meta", EXR_STORAGE_SCANLINE, &partidx));
+    EXRCORE_TEST_RVAL (exr_initialize_required_attr_simple (
+        f, partidx, 8, 8, EXR_COMPRESSION_NONE));
+    EXRCORE_TEST_RVAL (exr_add_channel (
+        f, partidx, "Y", EXR_PIXEL_HALF, EXR_PERCEPTUALLY_LOGARITHMIC, 1, 1));
+    EXRCORE_TEST_RVAL (exr_attr_set_string (f, partidx, "owner", "render"));
+    if (padding > 0)
+    {
+        EXRCORE_TEST_RVAL (exr_set_header_padding (f, padding));
+    }
+    EXRCORE_TEST_RVAL (exr_write_header (f));
+
+    for (int y = 0; y < 8; ++y)
+    {
+        exr_chunk_info_t      cinfo;
+        exr_encode_pipeline_t encoder;
+
+        EXRCORE_TEST_RVAL (exr_write_scanline_chunk_info (f, 0, y, &cinfo));
+        EXRCORE_TEST_RVAL (exr_encoding_initialize (f, 0, &cinfo, &encoder));
+        encoder.channels[0].encode_from_ptr   = (uint8_t*) (pixels + y * 8);
+        encoder.channels[0].user_pixel_stride = 2;
+        encoder.channels[0].user_line_stride  = 2 * 8;
+        EXRCORE_TEST_RVAL (exr_encoding_choose_default_routines (f, 0, &encoder));
+        EXRCORE_TEST_RVAL (exr_encoding_run (f, 0, &encoder));
+        EXRCORE_TEST_RVAL (exr_encoding_destroy (f, &encoder));
+    }
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+}
+
+static std::vector<uint8_t>
+readFileBytes (const std::string& fn)
+{
+    std::vector<uint8_t> bytes;
+    FILE*                fp = fopen (fn.c_str (), "rb");
+    EXRCORE_TEST (fp != NULL);
+    fseek (fp, 0, SEEK_END);
+    bytes.resize ((size_t) ftell (fp));
+    fseek (fp, 0, SEEK_SET);
+    EXRCORE_TEST (bytes.size () == fread (bytes.data (), 1, bytes.size (), fp));
+    fclose (fp);
+    return bytes;
+}
+
 void
 testUpdateMeta (const std::string& tempdir)
-{}
+{
+    exr_context_t             f;
+    std::string               fn    = tempdir + "core_update_meta.exr";
+    exr_context_initializer_t cinit = EXR_DEFAULT_CONTEXT_INITIALIZER;
+    uint64_t                  tableoff, newtableoff;
+    const char*               str;
+    int32_t                   len;
+    const exr_attribute_t*    attr;
+    std::string               note (100, 'n');
+    std::string               toolong (400, 'x');
+
+    cinit.error_handler_fn = &err_cb;
+
+    writeUpdateFile (fn, cinit, 256);
+    std::vector<uint8_t> orig = readFileBytes (fn);
+
+    EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL (exr_get_chunk_table_offset (f, 0, &tableoff));
+    EXRCORE_TEST_RVAL (
+        exr_get_attribute_by_name (f, 0, EXR_HEADER_PADDING_ATTR_NAME, &attr));
+    EXRCORE_TEST (attr->type == EXR_ATTR_OPAQUE);
+    EXRCORE_TEST (attr->opaque->size == 256);
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+
+    // rewriting an unchanged header leaves the file as it was
+    EXRCORE_TEST_RVAL (
+        exr_start_inplace_header_update (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+    EXRCORE_TEST (readFileBytes (fn) == orig);
+
+    // new metadata comes out of the padding, the image data stays put
+    EXRCORE_TEST_RVAL (
+        exr_start_inplace_header_update (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL (exr_attr_set_string (f, 0, "comments", note.c_str ()));
+    EXRCORE_TEST_RVAL (exr_attr_set_string (f, 0, "owner", "compositing"));
+    EXRCORE_TEST (
+        EXR_ERR_NOT_OPEN_WRITE ==
+        exr_add_channel (
+            f, 0, "Z", EXR_PIXEL_FLOAT, EXR_PERCEPTUALLY_LINEAR, 1, 1));
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+
+    std::vector<uint8_t> updated = readFileBytes (fn);
+    EXRCORE_TEST (updated.size () == orig.size ());
+    EXRCORE_TEST (std::equal (
+        orig.begin () + (ptrdiff_t) tableoff,
+        orig.end (),
+        updated.begin () + (ptrdiff_t) tableoff));
+
+    EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL (exr_get_chunk_table_offset (f, 0, &newtableoff));
+    EXRCORE_TEST (newtableoff == tableoff);
+    EXRCORE_TEST_RVAL (exr_validate_chunk_table (f, 0));
+    EXRCORE_TEST_RVAL (exr_attr_get_string (f, 0, "comments", &len, &str));
+    EXRCORE_TEST (note == str);
+    EXRCORE_TEST_RVAL (exr_attr_get_string (f, 0, "owner", &len, &str));
+    EXRCORE_TEST (std::string ("compositing") == str);
+    EXRCORE_TEST_RVAL (
+        exr_get_attribute_by_name (f, 0, EXR_HEADER_PADDING_ATTR_NAME, &attr));
+    // the new attribute has a name, type, size and value to store
+    EXRCORE_TEST (
+        attr->opaque->size ==
+        256 - (int32_t) (sizeof ("comments") + sizeof ("string") + 4 + 100) -
+            (int32_t) (strlen ("compositing") - strlen ("render")));
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+
+    // more than the remaining padding fails and leaves the file alone
+    EXRCORE_TEST_RVAL (
+        exr_start_inplace_header_update (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL (exr_attr_set_string (f, 0, "notes", toolong.c_str ()));
+    EXRCORE_TEST (EXR_ERR_MODIFY_SIZE_CHANGE == exr_finish (&f));
+    EXRCORE_TEST (readFileBytes (fn) == updated);
+
+    // string vectors can be added when updating, though still not in
+    // a temporary context
+    const char* views[] = {"left", "right"};
+    EXRCORE_TEST_RVAL (
+        exr_start_inplace_header_update (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL (exr_attr_set_string_vector (f, 0, "views", 2, views));
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+    EXRCORE_TEST_RVAL (exr_start_read (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL (exr_get_attribute_by_name (f, 0, "views", &attr));
+    EXRCORE_TEST (attr->type == EXR_ATTR_STRING_VECTOR);
+    EXRCORE_TEST (attr->stringvector->n_strings == 2);
+    EXRCORE_TEST (std::string ("right") == attr->stringvector->strings[1].str);
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+
+    EXRCORE_TEST_RVAL (exr_start_temporary_context (&f, "temp", &cinit));
+    EXRCORE_TEST (
+        EXR_ERR_NO_ATTR_BY_NAME ==
+        exr_attr_set_string_vector (f, 0, "views", 2, views));
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+
+    // without padding, only changes of the same size fit
+    writeUpdateFile (fn, cinit, 0);
+    orig = readFileBytes (fn);
+    EXRCORE_TEST_RVAL (
+        exr_start_inplace_header_update (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL (exr_attr_set_string (f, 0, "owner", "lookdv"));
+    EXRCORE_TEST_RVAL (exr_finish (&f));
+    updated = readFileBytes (fn);
+    EXRCORE_TEST (updated.size () == orig.size ());
+    EXRCORE_TEST (updated != orig);
+
+    EXRCORE_TEST_RVAL (
+        exr_start_inplace_header_update (&f, fn.c_str (), &cinit));
+    EXRCORE_TEST_RVAL (exr_attr_set_string (f, 0, "comments", "x"));
+    EXRCORE_TEST (EXR_ERR_MODIFY_SIZE_CHANGE == exr_finish (&f));
+    EXRCORE_TEST (readFileBytes (fn) == updated);
+
+    remove (fn.c_str ());
+}
 
 void
 testWriteScans (const std::string& tempdir)
@@ -1404,6 +1574,20 @@ testWriteMultiPart (const std::string& tempdir)
     EXRCORE_TEST_RVAL (exr_get_storage (outf, 1, &storage));
     EXRCORE_TEST (storage == EXR_STORAGE_TILED);
 
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_MISSING_CONTEXT_ARG,
+        exr_get_part_index (NULL, "debug", &partidx));
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_INVALID_ARGUMENT, exr_get_part_index (outf, NULL, &partidx));
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_INVALID_ARGUMENT, exr_get_part_index (outf, "debug", NULL));
+    EXRCORE_TEST_RVAL (exr_get_part_index (outf, "debug", &partidx));
+    EXRCORE_TEST (partidx == 1);
+    EXRCORE_TEST_RVAL (exr_get_part_index (outf, "beauty", &partidx));
+    EXRCORE_TEST (partidx == 0);
+    EXRCORE_TEST_RVAL_FAIL (
+        EXR_ERR_NO_ATTR_BY_NAME, exr_get_part_index (outf, "depth", &partidx));
+
     uint32_t verflags;
     EXRCORE_TEST_RVAL (
         exr_get_file_version_and_flags (outf, &verflags));
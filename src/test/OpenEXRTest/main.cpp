@@ -17,6 +17,7 @@
 #include "testCompositeDeepScanLine.h"
 #include "testCompression.h"
 #include "testCompressionApi.h"
+#include "testConstantChunks.h"
 #include "testConversion.h"
 #include "testCopyDeepScanLine.h"
 #include "testCopyDeepTiled.h"
@@ -51,19 +52,26 @@
 #include "testOptimizedInterleavePatterns.h"
 #include "testPartHelper.h"
 #include "testPreviewImage.h"
+#include "testReadParts.h"
+#include "testReadRanges.h"
+#include "testReadRegion.h"
 #include "testRgba.h"
 #include "testCRgba.h"
 #include "testRgbaThreading.h"
 #include "testRle.h"
 #include "testSampleImages.h"
 #include "testScanLineApi.h"
+#include "testSequenceReader.h"
 #include "testSharedFrameBuffer.h"
 #include "testStandardAttributes.h"
+#include "testTileCache.h"
 #include "testTiledCompression.h"
 #include "testTiledCopyPixels.h"
+#include "testTiledLevels.h"
 #include "testTiledLineOrder.h"
 #include "testTiledRgba.h"
 #include "testTiledYa.h"
+#include "testTranscode.h"
 #include "testWav.h"
 #include "testXdr.h"
 #include "testYca.h"
@@ -192,6 +200,7 @@ main (int argc, char* argv[])
     TEST (testCompressionApi, "basic");
     TEST (testCompression, "basic");
     TEST (testCopyPixels, "basic");
+    TEST (testConstantChunks, "basic");
     TEST (testLut, "basic");
     TEST (testSampleImages, "basic");
     TEST (testPreviewImage, "basic");
@@ -200,6 +209,13 @@ main (int argc, char* argv[])
     TEST (testTiledCopyPixels, "basic");
     TEST (testTiledCompression, "basic");
     TEST (testTiledLineOrder, "basic");
+    TEST (testTileCache, "basic");
+    TEST (testReadRegion, "basic");
+    TEST (testTiledLevels, "basic");
+    TEST (testSequenceReader, "basic");
+    TEST (testReadRanges, "basic");
+    TEST (testReadParts, "basic");
+    TEST (testTranscode, "basic");
     TEST (testScanLineApi, "basic");
     TEST (testExistingStreams, "core");
     TEST (testExistingStreamsUTF8, "core");
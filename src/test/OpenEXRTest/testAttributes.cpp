@@ -32,6 +32,7 @@
 #include <ImfVecAttribute.h>
 
 #include <stdio.h>
+#include <type_traits>
 #ifdef NDEBUG
 #    undef NDEBUG
 #endif
@@ -558,6 +559,149 @@ longNames (
     cout << endl;
 }
 
+void
+copyOnWrite ()
+{
+    cout << "copy on write" << endl;
+
+    Header hdr;
+    hdr.insert ("s", StringAttribute ("a"));
+    hdr.insert ("i", IntAttribute (1));
+
+    const Header& chdr = hdr;
+
+    //
+    // Modifying a copy of a header must not change the original,
+    // and vice versa.
+    //
+
+    {
+        Header copy (chdr);
+        assert (copy.typedAttribute<StringAttribute> ("s").value () == "a");
+
+        copy.insert ("s", StringAttribute ("b"));
+        copy.erase ("i");
+        copy.insert ("f", FloatAttribute (2));
+
+        assert (chdr.typedAttribute<StringAttribute> ("s").value () == "a");
+        assert (chdr.findTypedAttribute<IntAttribute> ("i") != 0);
+        assert (chdr.findTypedAttribute<FloatAttribute> ("f") == 0);
+        assert (copy.typedAttribute<StringAttribute> ("s").value () == "b");
+    }
+
+    {
+        Header copy;
+        copy = chdr;
+        hdr.typedAttribute<IntAttribute> ("i").value () = 3;
+        assert (copy.typedAttribute<IntAttribute> ("i").value () == 1);
+    }
+
+    //
+    // A reference to an attribute that was obtained before the header
+    // was copied must not change the copy.
+    //
+
+    {
+        IntAttribute& i = hdr.typedAttribute<IntAttribute> ("i");
+        Header        copy (chdr);
+
+        i.value () = 4;
+        assert (chdr.typedAttribute<IntAttribute> ("i").value () == 4);
+        assert (copy.typedAttribute<IntAttribute> ("i").value () == 3);
+
+        Header copy2 (copy);
+        copy.dataWindow () = Box2i (V2i (0, 0), V2i (9, 9));
+        assert (copy2.dataWindow () == chdr.dataWindow ());
+    }
+
+    {
+        Header moved (std::move (hdr));
+        assert (moved.typedAttribute<IntAttribute> ("i").value () == 4);
+        assert (hdr.find ("i") == hdr.end ());
+        hdr = moved;
+        assert (hdr.typedAttribute<IntAttribute> ("i").value () == 4);
+    }
+
+    static_assert (
+        std::is_nothrow_move_constructible<Header>::value &&
+            std::is_nothrow_move_assignable<Header>::value,
+        "moving a header must not throw");
+
+    //
+    // A const reference to an attribute stays valid while other
+    // attributes are modified, even after the header it was obtained
+    // from is gone.
+    //
+
+    {
+        Header*                copy = new Header (chdr);
+        const StringAttribute& s = chdr.typedAttribute<StringAttribute> ("s");
+
+        copy->insert ("f", FloatAttribute (2));
+        hdr.insert ("f", FloatAttribute (3));
+        hdr.erase ("f");
+        delete copy;
+
+        assert (s.value () == "a");
+        assert (&s == &chdr.typedAttribute<StringAttribute> ("s"));
+    }
+
+    //
+    // Modifying one attribute does not copy the others, and the
+    // others stay shared with copies made afterwards.
+    //
+
+    {
+        Header        copy (chdr);
+        const Header& ccopy = copy;
+
+        hdr.channels ().insert ("R", Channel (FLOAT));
+
+        assert (ccopy.channels ().findChannel ("R") == 0);
+        assert (&ccopy["s"] == &chdr["s"]);
+        assert (&ccopy["channels"] != &chdr["channels"]);
+
+        Header copy2 (chdr);
+        const Header& ccopy2 = copy2;
+
+        assert (&ccopy2["s"] == &chdr["s"]);
+        assert (&ccopy2["channels"] != &chdr["channels"]);
+        assert (ccopy2.channels ().findChannel ("R") != 0);
+
+        hdr.channels ().insert ("G", Channel (FLOAT));
+        assert (ccopy2.channels ().findChannel ("G") == 0);
+
+        assert (hdr.findTypedAttribute<StringAttribute> ("s") != 0);
+
+        Header        copy3 (chdr);
+        const Header& ccopy3 = copy3;
+
+        assert (&ccopy3["s"] != &chdr["s"]);
+        assert (&ccopy3["screenWindowWidth"] == &chdr["screenWindowWidth"]);
+    }
+
+    //
+    // Compression levels are copied with the header.
+    //
+
+    {
+        hdr.zipCompressionLevel () = 9;
+        hdr.dwaCompressionLevel () = 100.f;
+
+        Header copy (chdr);
+        assert (copy.zipCompressionLevel () == 9);
+        assert (copy.dwaCompressionLevel () == 100.f);
+
+        copy.resetDefaultCompressionLevels ();
+        assert (copy.zipCompressionLevel () != 9);
+        assert (chdr.zipCompressionLevel () == 9);
+
+        Header moved (std::move (copy));
+        assert (moved.zipCompressionLevel () != 9);
+        hdr.resetDefaultCompressionLevels ();
+    }
+}
+
 } // namespace
 
 template <class T>
@@ -586,6 +730,7 @@ testAttributes (const std::string& tempDir)
         writeReadAttr (pf, filename.c_str (), W, H);
         channelList ();
         longNames (pf, filename.c_str (), W, H);
+        copyOnWrite ();
 
         print_type (OPENEXR_IMF_NAMESPACE::TypedAttribute<int> ());
 
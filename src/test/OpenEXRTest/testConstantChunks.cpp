@@ -0,0 +1,445 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifdef NDEBUG
+#    undef NDEBUG
+#endif
+
+#include <ImfArray.h>
+#include <ImfChannelList.h>
+#include <ImfConstantChunks.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfInputFile.h>
+#include <ImfInputPart.h>
+#include <ImfMultiPartInputFile.h>
+#include <ImfMultiPartOutputFile.h>
+#include <ImfOutputFile.h>
+#include <ImfOutputPart.h>
+#include <ImfPartType.h>
+#include <ImfThreading.h>
+#include <ImfTiledInputFile.h>
+#include <ImfTiledInputPart.h>
+#include <ImfTiledOutputFile.h>
+#include <ImfTiledOutputPart.h>
+#include <half.h>
+
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <vector>
+
+using namespace OPENEXR_IMF_NAMESPACE;
+using namespace std;
+using namespace IMATH_NAMESPACE;
+
+namespace
+{
+
+const int W = 100;
+const int H = 70;
+
+//
+// A mostly empty image: a gradient in the top left corner, a block
+// with the constant value 3 that covers one 16x16 tile, and zeroes
+// everywhere else.
+//
+
+float
+pixelValue (int x, int y, int level)
+{
+    if (x < 20 && y < 20) return 1 + x * 0.25f + y + level;
+    if (x >= 48 && x < 64 && y >= 16 && y < 32) return 3;
+    return 0;
+}
+
+struct Pixels
+{
+    Pixels (int w, int h, int level) : a (h, w), z (h, w), id (h, w)
+    {
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+            {
+                float v  = pixelValue (x, y, level);
+                a[y][x]  = v;
+                z[y][x]  = v * 2;
+                id[y][x] = (unsigned int) (v * 4);
+            }
+
+        insert (fb, w);
+    }
+
+    void insert (FrameBuffer& frameBuffer, int w)
+    {
+        frameBuffer.insert (
+            "A",
+            Slice (HALF, (char*) &a[0][0], sizeof (half), sizeof (half) * w));
+        frameBuffer.insert (
+            "Z",
+            Slice (
+                FLOAT,
+                (char*) &z[0][0],
+                sizeof (float),
+                sizeof (float) * w));
+        frameBuffer.insert (
+            "ID",
+            Slice (
+                UINT,
+                (char*) &id[0][0],
+                sizeof (unsigned int),
+                sizeof (unsigned int) * w));
+    }
+
+    void clear (int w, int h)
+    {
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+            {
+                a[y][x]  = -1;
+                z[y][x]  = -1;
+                id[y][x] = 12345;
+            }
+    }
+
+    void check (int w, int h, int level) const
+    {
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+            {
+                float v = pixelValue (x, y, level);
+                assert (a[y][x] == half (v));
+                assert (z[y][x] == v * 2);
+                assert (id[y][x] == (unsigned int) (v * 4));
+            }
+    }
+
+    Array2D<half>         a;
+    Array2D<float>        z;
+    Array2D<unsigned int> id;
+    FrameBuffer           fb;
+};
+
+Header
+makeHeader (Compression comp, LineOrder order, bool constant)
+{
+    Header hdr (W, H);
+    hdr.compression () = comp;
+    hdr.lineOrder ()   = order;
+    hdr.channels ().insert ("A", Channel (HALF));
+    hdr.channels ().insert ("Z", Channel (FLOAT));
+    hdr.channels ().insert ("ID", Channel (UINT));
+
+    if (constant) addConstantChunks (hdr);
+
+    return hdr;
+}
+
+uint64_t
+fileSize (const std::string& fileName)
+{
+    ifstream f (fileName.c_str (), ios::binary | ios::ate);
+    return f.tellg ();
+}
+
+template <class TiledOut>
+void
+writeTiles (TiledOut& out, bool reverse)
+{
+    for (int ly = 0; ly < out.numYLevels (); ++ly)
+        for (int lx = 0; lx < out.numXLevels (); ++lx)
+        {
+            if (!out.isValidLevel (lx, ly)) continue;
+
+            int    w = out.levelWidth (lx);
+            int    h = out.levelHeight (ly);
+            Pixels pixels (w, h, lx + ly);
+
+            out.setFrameBuffer (pixels.fb);
+
+            if (!reverse)
+            {
+                out.writeTiles (
+                    0,
+                    out.numXTiles (lx) - 1,
+                    0,
+                    out.numYTiles (ly) - 1,
+                    lx,
+                    ly);
+                continue;
+            }
+
+            //
+            // Out of order: constant tiles are recorded while the
+            // tiles before them are still buffered.
+            //
+
+            for (int dy = out.numYTiles (ly) - 1; dy >= 0; --dy)
+                for (int dx = out.numXTiles (lx) - 1; dx >= 0; --dx)
+                    out.writeTile (dx, dy, lx, ly);
+        }
+}
+
+template <class TiledIn>
+void
+checkTiles (TiledIn& in)
+{
+    for (int ly = 0; ly < in.numYLevels (); ++ly)
+        for (int lx = 0; lx < in.numXLevels (); ++lx)
+        {
+            if (!in.isValidLevel (lx, ly)) continue;
+
+            int    w = in.levelWidth (lx);
+            int    h = in.levelHeight (ly);
+            Pixels pixels (w, h, lx + ly);
+
+            pixels.clear (w, h);
+            in.setFrameBuffer (pixels.fb);
+            in.readTiles (
+                0, in.numXTiles (lx) - 1, 0, in.numYTiles (ly) - 1, lx, ly);
+            pixels.check (w, h, lx + ly);
+        }
+}
+
+void
+writeReadTiled (
+    const std::string& fileName,
+    Compression        comp,
+    LevelMode          mode,
+    LineOrder          order,
+    bool               reverse)
+{
+    cout << " tiled, compression " << comp << ", level mode " << mode
+         << ", line order " << order << (reverse ? ", reversed" : "")
+         << endl;
+
+    uint64_t sizes[2];
+
+    for (int constant = 0; constant < 2; ++constant)
+    {
+        Header hdr = makeHeader (comp, order, constant);
+        hdr.setTileDescription (TileDescription (16, 16, mode));
+
+        remove (fileName.c_str ());
+        {
+            TiledOutputFile out (fileName.c_str (), hdr);
+            writeTiles (out, reverse);
+        }
+
+        sizes[constant] = fileSize (fileName);
+
+        TiledInputFile in (fileName.c_str ());
+        assert (hasConstantChunks (in.header ()) == bool (constant));
+        assert (in.isComplete ());
+        checkTiles (in);
+
+        remove (fileName.c_str ());
+    }
+
+    assert (sizes[1] < sizes[0]);
+}
+
+void
+writeReadScanLines (const std::string& fileName, Compression comp)
+{
+    cout << " scan lines, compression " << comp << endl;
+
+    uint64_t sizes[2];
+
+    for (int constant = 0; constant < 2; ++constant)
+    {
+        //
+        // Add a subsampled channel, which must be filled along
+        // with the others.
+        //
+
+        Header hdr = makeHeader (comp, INCREASING_Y, constant);
+        hdr.channels ().insert ("C", Channel (HALF, 2, 2));
+
+        Array2D<half> c (H / 2, W / 2);
+        for (int y = 0; y < H / 2; ++y)
+            for (int x = 0; x < W / 2; ++x)
+                c[y][x] = pixelValue (x * 2, y * 2, 5);
+
+        remove (fileName.c_str ());
+        {
+            Pixels pixels (W, H, 0);
+            pixels.fb.insert (
+                "C",
+                Slice (
+                    HALF,
+                    (char*) &c[0][0],
+                    sizeof (half),
+                    sizeof (half) * (W / 2),
+                    2,
+                    2));
+
+            OutputFile out (fileName.c_str (), hdr);
+            out.setFrameBuffer (pixels.fb);
+            out.writePixels (H);
+        }
+
+        sizes[constant] = fileSize (fileName);
+
+        InputFile in (fileName.c_str ());
+        assert (hasConstantChunks (in.header ()) == bool (constant));
+        assert (in.isComplete ());
+
+        Pixels pixels (W, H, 0);
+        pixels.clear (W, H);
+        for (int y = 0; y < H / 2; ++y)
+            for (int x = 0; x < W / 2; ++x)
+                c[y][x] = -1;
+        pixels.fb.insert (
+            "C",
+            Slice (
+                HALF,
+                (char*) &c[0][0],
+                sizeof (half),
+                sizeof (half) * (W / 2),
+                2,
+                2));
+
+        in.setFrameBuffer (pixels.fb);
+        in.readPixels (0, H - 1);
+        pixels.check (W, H, 0);
+
+        for (int y = 0; y < H / 2; ++y)
+            for (int x = 0; x < W / 2; ++x)
+                assert (c[y][x] == half (pixelValue (x * 2, y * 2, 5)));
+
+        remove (fileName.c_str ());
+    }
+
+    assert (sizes[1] < sizes[0]);
+}
+
+void
+writeReadMultiPart (const std::string& fileName)
+{
+    cout << " multi-part" << endl;
+
+    vector<Header> headers;
+
+    headers.push_back (makeHeader (ZIP_COMPRESSION, INCREASING_Y, true));
+    headers.back ().setTileDescription (TileDescription (16, 16, ONE_LEVEL));
+    headers.back ().setType (TILEDIMAGE);
+    headers.back ().setName ("tiled");
+
+    headers.push_back (makeHeader (RLE_COMPRESSION, INCREASING_Y, true));
+    headers.back ().setType (SCANLINEIMAGE);
+    headers.back ().setName ("scanlines");
+
+    remove (fileName.c_str ());
+    {
+        MultiPartOutputFile out (
+            fileName.c_str (), &headers[0], int (headers.size ()));
+
+        TiledOutputPart tiled (out, 0);
+        writeTiles (tiled, false);
+
+        Pixels     pixels (W, H, 0);
+        OutputPart scanLines (out, 1);
+        scanLines.setFrameBuffer (pixels.fb);
+        scanLines.writePixels (H);
+    }
+
+    MultiPartInputFile in (fileName.c_str ());
+    assert (hasConstantChunks (in.header (0)));
+    assert (hasConstantChunks (in.header (1)));
+
+    TiledInputPart tiled (in, 0);
+    checkTiles (tiled);
+
+    Pixels pixels (W, H, 0);
+    pixels.clear (W, H);
+    InputPart scanLines (in, 1);
+    scanLines.setFrameBuffer (pixels.fb);
+    scanLines.readPixels (0, H - 1);
+    pixels.check (W, H, 0);
+
+    remove (fileName.c_str ());
+}
+
+void
+testCopyPixelsRejected (const std::string& fileName)
+{
+    std::string copyName = fileName + ".copy.exr";
+
+    Header hdr = makeHeader (ZIP_COMPRESSION, INCREASING_Y, true);
+    hdr.setTileDescription (TileDescription (16, 16, ONE_LEVEL));
+
+    remove (fileName.c_str ());
+    {
+        TiledOutputFile out (fileName.c_str (), hdr);
+        writeTiles (out, false);
+    }
+
+    bool caught = false;
+    {
+        TiledInputFile  in (fileName.c_str ());
+        TiledOutputFile out (copyName.c_str (), in.header ());
+
+        try
+        {
+            out.copyPixels (in);
+        }
+        catch (const IEX_NAMESPACE::ArgExc&)
+        {
+            caught = true;
+        }
+    }
+    assert (caught);
+
+    remove (copyName.c_str ());
+    remove (fileName.c_str ());
+}
+
+} // namespace
+
+void
+testConstantChunks (const std::string& tempDir)
+{
+    try
+    {
+        cout << "Testing constant chunks" << endl;
+
+        std::string fn = tempDir + "imf_test_constant_chunks.exr";
+
+        int numThreads = globalThreadCount ();
+        for (int t: {0, 3})
+        {
+            setGlobalThreadCount (t);
+            cout << "threads " << t << endl;
+
+            writeReadTiled (
+                fn, ZIP_COMPRESSION, ONE_LEVEL, INCREASING_Y, false);
+            writeReadTiled (
+                fn, NO_COMPRESSION, ONE_LEVEL, INCREASING_Y, true);
+            writeReadTiled (
+                fn, PIZ_COMPRESSION, MIPMAP_LEVELS, DECREASING_Y, true);
+            writeReadTiled (
+                fn, RLE_COMPRESSION, RIPMAP_LEVELS, RANDOM_Y, true);
+            writeReadTiled (
+                fn, ZIP_COMPRESSION, RIPMAP_LEVELS, INCREASING_Y, true);
+
+            writeReadScanLines (fn, NO_COMPRESSION);
+            writeReadScanLines (fn, ZIP_COMPRESSION);
+            writeReadScanLines (fn, PIZ_COMPRESSION);
+
+            writeReadMultiPart (fn);
+        }
+        setGlobalThreadCount (numThreads);
+
+        testCopyPixelsRejected (fn);
+
+        cout << "ok\n" << endl;
+    }
+    catch (const std::exception& e)
+    {
+        cerr << "ERROR -- caught exception: " << e.what () << endl;
+        assert (false);
+    }
+}
@@ -482,6 +482,16 @@ readWholeFiles (const std::string& fn)
     Array2D<float>        fData;
     Array2D<half>         hData;
 
+    {
+        //
+        // Look the parts up by name before any header is used.
+        //
+        MultiPartInputFile byName (fn.c_str ());
+        for (int i = byName.parts () - 1; i >= 0; --i)
+            assert (byName.partNumber (headers[i].name ()) == i);
+        assert (byName.partNumber ("no such part") == -1);
+    }
+
     MultiPartInputFile file (fn.c_str ());
     for (size_t i = 0; i < static_cast<size_t> (file.parts ()); i++)
     {
@@ -0,0 +1,329 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifdef NDEBUG
+#    undef NDEBUG
+#endif
+
+#include <ImfArray.h>
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfMultiPartInputFile.h>
+#include <ImfMultiPartOutputFile.h>
+#include <ImfOutputPart.h>
+#include <ImfPartType.h>
+#include <ImfThreading.h>
+#include <ImfTiledOutputPart.h>
+#include <half.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <vector>
+
+using namespace OPENEXR_IMF_NAMESPACE;
+using namespace std;
+using namespace IMATH_NAMESPACE;
+
+namespace
+{
+
+const int W  = 67;
+const int H  = 93;
+const int X0 = -3;
+const int Y0 = 11;
+
+//
+// Parts 0-4 are scan line parts with different compression and
+// channels, part 5 is tiled.
+//
+
+const int         numParts               = 6;
+const Compression compressions[numParts] = {
+    NO_COMPRESSION,
+    ZIP_COMPRESSION,
+    PIZ_COMPRESSION,
+    RLE_COMPRESSION,
+    ZIPS_COMPRESSION,
+    ZIP_COMPRESSION};
+
+float
+pixelValue (int part, int x, int y)
+{
+    return part * 100.f + x * 0.5f + y * 0.25f;
+}
+
+void
+writeFile (const std::string& fileName)
+{
+    Box2i          dw (V2i (X0, Y0), V2i (X0 + W - 1, Y0 + H - 1));
+    vector<Header> headers;
+
+    for (int p = 0; p < numParts; ++p)
+    {
+        Header hdr (dw, dw);
+        hdr.compression () = compressions[p];
+        hdr.channels ().insert ("H", Channel (HALF));
+        if (p % 2) hdr.channels ().insert ("F", Channel (FLOAT));
+
+        ostringstream name;
+        name << "part" << p;
+        hdr.setName (name.str ());
+
+        if (p == numParts - 1)
+        {
+            hdr.setType (TILEDIMAGE);
+            hdr.setTileDescription (TileDescription (16, 12, ONE_LEVEL));
+        }
+        else
+            hdr.setType (SCANLINEIMAGE);
+
+        headers.push_back (hdr);
+    }
+
+    remove (fileName.c_str ());
+    MultiPartOutputFile out (
+        fileName.c_str (), &headers[0], static_cast<int> (headers.size ()));
+
+    for (int p = 0; p < numParts; ++p)
+    {
+        Array2D<half>  ph (H, W);
+        Array2D<float> pf (H, W);
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x)
+            {
+                ph[y][x] = pixelValue (p, x + X0, y + Y0);
+                pf[y][x] = pixelValue (p, x + X0, y + Y0);
+            }
+
+        FrameBuffer fb;
+        fb.insert (
+            "H",
+            Slice::Make (
+                HALF, &ph[0][0], V2i (X0, Y0), W, H, sizeof (half)));
+        fb.insert (
+            "F",
+            Slice::Make (
+                FLOAT, &pf[0][0], V2i (X0, Y0), W, H, sizeof (float)));
+
+        if (p == numParts - 1)
+        {
+            TiledOutputPart part (out, p);
+            part.setFrameBuffer (fb);
+            part.writeTiles (
+                0, part.numXTiles () - 1, 0, part.numYTiles () - 1);
+        }
+        else
+        {
+            OutputPart part (out, p);
+            part.setFrameBuffer (fb);
+            part.writePixels (H);
+        }
+    }
+}
+
+//
+// A whole-image frame buffer per part; reading must only overwrite
+// rows y1 through y2.  Channel "F" is missing from the even parts and
+// must be filled with the slice's fill value.
+//
+
+struct PartBuffer
+{
+    PartBuffer () : ph (H, W), pf (H, W)
+    {
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x)
+            {
+                ph[y][x] = -1.f;
+                pf[y][x] = -1.f;
+            }
+
+        fb.insert (
+            "H",
+            Slice::Make (
+                HALF, &ph[0][0], V2i (X0, Y0), W, H, sizeof (half)));
+        fb.insert (
+            "F",
+            Slice (
+                FLOAT,
+                (char*) (&pf[0][0] - X0 - Y0 * W),
+                sizeof (float),
+                sizeof (float) * W,
+                1,
+                1,
+                7.0));
+    }
+
+    void check (int part, int y1, int y2) const
+    {
+        if (y2 < y1) swap (y1, y2);
+
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x)
+            {
+                if (y + Y0 >= y1 && y + Y0 <= y2)
+                {
+                    float v = pixelValue (part, x + X0, y + Y0);
+                    assert (ph[y][x] == half (v));
+                    assert (pf[y][x] == ((part % 2) ? v : 7.f));
+                }
+                else
+                {
+                    assert (ph[y][x] == -1.f);
+                    assert (pf[y][x] == -1.f);
+                }
+            }
+    }
+
+    Array2D<half>  ph;
+    Array2D<float> pf;
+    FrameBuffer    fb;
+};
+
+void
+readParts (const std::string& fileName, int y1, int y2)
+{
+    MultiPartInputFile                   in (fileName.c_str ());
+    vector<PartBuffer>                   buffers (numParts);
+    vector<MultiPartInputFile::PartRead> reads;
+
+    //
+    // request the parts in reverse order, the result must not depend
+    // on the order in which they are decoded
+    //
+
+    for (int p = numParts - 1; p >= 0; --p)
+        reads.push_back (
+            MultiPartInputFile::PartRead (p, buffers[p].fb, y1, y2));
+
+    in.readPixels (reads);
+
+    for (int p = 0; p < numParts; ++p)
+        buffers[p].check (p, y1, y2);
+}
+
+//
+// The same part twice, into frame buffers of different types
+//
+
+void
+readPartTwice (const std::string& fileName, int part)
+{
+    MultiPartInputFile in (fileName.c_str ());
+    PartBuffer         buffer;
+    Array2D<float>     hf (H, W);
+    Array2D<half>      fh (H, W);
+    FrameBuffer        fb;
+
+    fb.insert (
+        "H",
+        Slice::Make (FLOAT, &hf[0][0], V2i (X0, Y0), W, H, sizeof (float)));
+    fb.insert (
+        "F",
+        Slice::Make (HALF, &fh[0][0], V2i (X0, Y0), W, H, sizeof (half)));
+
+    vector<MultiPartInputFile::PartRead> reads;
+    reads.push_back (
+        MultiPartInputFile::PartRead (part, buffer.fb, Y0, Y0 + H - 1));
+    reads.push_back (MultiPartInputFile::PartRead (part, fb, Y0, Y0 + H - 1));
+
+    in.readPixels (reads);
+
+    buffer.check (part, Y0, Y0 + H - 1);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x)
+        {
+            float v = pixelValue (part, x + X0, y + Y0);
+            assert (hf[y][x] == float (half (v)));
+            assert (fh[y][x] == half (v));
+        }
+}
+
+void
+testFile (const std::string& fileName)
+{
+    writeFile (fileName);
+
+    readParts (fileName, Y0, Y0 + H - 1);
+    readParts (fileName, Y0 + 17, Y0 + 40);
+    readParts (fileName, Y0 + 40, Y0 + 17);
+    readParts (fileName, Y0 + H - 1, Y0 + H - 1);
+    readPartTwice (fileName, 1);
+    readPartTwice (fileName, 3);
+    readPartTwice (fileName, numParts - 1);
+
+    {
+        MultiPartInputFile                   in (fileName.c_str ());
+        PartBuffer                           buffer;
+        vector<MultiPartInputFile::PartRead> reads;
+        reads.push_back (
+            MultiPartInputFile::PartRead (numParts, buffer.fb, Y0, Y0));
+
+        bool caught = false;
+        try
+        {
+            in.readPixels (reads);
+        }
+        catch (const IEX_NAMESPACE::ArgExc&)
+        {
+            caught = true;
+        }
+        assert (caught);
+    }
+
+    {
+        MultiPartInputFile                   in (fileName.c_str ());
+        PartBuffer                           buffer;
+        vector<MultiPartInputFile::PartRead> reads;
+        reads.push_back (MultiPartInputFile::PartRead (
+            numParts - 1, buffer.fb, Y0 - 1, Y0 + 3));
+
+        bool caught = false;
+        try
+        {
+            in.readPixels (reads);
+        }
+        catch (const IEX_NAMESPACE::ArgExc&)
+        {
+            caught = true;
+        }
+        assert (caught);
+    }
+
+    remove (fileName.c_str ());
+}
+
+} // namespace
+
+void
+testReadParts (const std::string& tempDir)
+{
+    try
+    {
+        cout << "Testing reading several parts in one pass" << endl;
+
+        std::string fn = tempDir + "imf_test_read_parts.exr";
+
+        int numThreads = globalThreadCount ();
+        for (int t: {0, 3})
+        {
+            setGlobalThreadCount (t);
+            cout << " threads " << t << endl;
+            testFile (fn);
+        }
+        setGlobalThreadCount (numThreads);
+
+        cout << "ok\n" << endl;
+    }
+    catch (const std::exception& e)
+    {
+        cerr << "ERROR -- caught exception: " << e.what () << endl;
+        assert (false);
+    }
+}
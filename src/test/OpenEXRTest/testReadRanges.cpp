@@ -0,0 +1,267 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifdef NDEBUG
+#    undef NDEBUG
+#endif
+
+#include <ImfArray.h>
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfInputFile.h>
+#include <ImfInputPart.h>
+#include <ImfMultiPartInputFile.h>
+#include <ImfOutputFile.h>
+#include <ImfThreading.h>
+#include <ImfTiledOutputFile.h>
+#include <half.h>
+
+#include <assert.h>
+#include <iostream>
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+using namespace OPENEXR_IMF_NAMESPACE;
+using namespace std;
+using namespace IMATH_NAMESPACE;
+
+namespace
+{
+
+const int W  = 53;
+const int H  = 141;
+const int X0 = 4;
+const int Y0 = -20;
+
+typedef vector<pair<int, int>> Ranges;
+
+float
+pixelValue (int x, int y)
+{
+    return x * 0.25f + y * 2.f;
+}
+
+void
+writeFile (const std::string& fileName, Compression comp, bool tiled)
+{
+    Box2i  dw (V2i (X0, Y0), V2i (X0 + W - 1, Y0 + H - 1));
+    Header hdr (dw, dw);
+    hdr.compression () = comp;
+    hdr.channels ().insert ("H", Channel (HALF));
+    hdr.channels ().insert ("F", Channel (FLOAT));
+
+    Array2D<half>  ph (H, W);
+    Array2D<float> pf (H, W);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x)
+        {
+            ph[y][x] = pixelValue (x + X0, y + Y0);
+            pf[y][x] = pixelValue (x + X0, y + Y0);
+        }
+
+    FrameBuffer fb;
+    fb.insert (
+        "H",
+        Slice::Make (HALF, &ph[0][0], V2i (X0, Y0), W, H, sizeof (half)));
+    fb.insert (
+        "F",
+        Slice::Make (FLOAT, &pf[0][0], V2i (X0, Y0), W, H, sizeof (float)));
+
+    remove (fileName.c_str ());
+    if (tiled)
+    {
+        hdr.setTileDescription (TileDescription (16, 12, ONE_LEVEL));
+        TiledOutputFile out (fileName.c_str (), hdr);
+        out.setFrameBuffer (fb);
+        out.writeTiles (0, out.numXTiles () - 1, 0, out.numYTiles () - 1);
+    }
+    else
+    {
+        OutputFile out (fileName.c_str (), hdr);
+        out.setFrameBuffer (fb);
+        out.writePixels (H);
+    }
+}
+
+//
+// A whole-image frame buffer, initialized to a value that reading
+// must only overwrite in the requested rows.
+//
+
+struct ImageBuffer
+{
+    ImageBuffer () : ph (H, W), pf (H, W)
+    {
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x)
+            {
+                ph[y][x] = -1.f;
+                pf[y][x] = -1.f;
+            }
+
+        fb.insert (
+            "H",
+            Slice::Make (
+                HALF, &ph[0][0], V2i (X0, Y0), W, H, sizeof (half)));
+        fb.insert (
+            "F",
+            Slice::Make (
+                FLOAT, &pf[0][0], V2i (X0, Y0), W, H, sizeof (float)));
+    }
+
+    void check (const Ranges& ranges) const
+    {
+        for (int y = 0; y < H; ++y)
+        {
+            bool inside = false;
+            for (const pair<int, int>& r: ranges)
+            {
+                int y1 = min (r.first, r.second) - Y0;
+                int y2 = max (r.first, r.second) - Y0;
+                inside = inside || (y >= y1 && y <= y2);
+            }
+
+            for (int x = 0; x < W; ++x)
+            {
+                if (inside)
+                {
+                    float v = pixelValue (x + X0, y + Y0);
+                    assert (ph[y][x] == half (v));
+                    assert (pf[y][x] == v);
+                }
+                else
+                {
+                    assert (ph[y][x] == -1.f);
+                    assert (pf[y][x] == -1.f);
+                }
+            }
+        }
+    }
+
+    Array2D<half>  ph;
+    Array2D<float> pf;
+    FrameBuffer    fb;
+};
+
+vector<Ranges>
+testRanges ()
+{
+    vector<Ranges> all;
+
+    // the whole image, as a single range
+
+    all.push_back (Ranges (1, make_pair (Y0, Y0 + H - 1)));
+
+    // sparse bands, every eighth group of three lines
+
+    Ranges sparse;
+    for (int y = Y0; y < Y0 + H; y += 8)
+        sparse.push_back (make_pair (y, min (y + 2, Y0 + H - 1)));
+    all.push_back (sparse);
+
+    // unordered, overlapping, touching and reversed ranges
+
+    Ranges mixed;
+    mixed.push_back (make_pair (Y0 + 100, Y0 + 90));
+    mixed.push_back (make_pair (Y0 + 3, Y0 + 3));
+    mixed.push_back (make_pair (Y0 + 40, Y0 + 60));
+    mixed.push_back (make_pair (Y0 + 55, Y0 + 70));
+    mixed.push_back (make_pair (Y0 + 71, Y0 + 72));
+    mixed.push_back (make_pair (Y0 + 5, Y0 + 6));
+    mixed.push_back (make_pair (Y0 + H - 1, Y0 + H - 1));
+    all.push_back (mixed);
+
+    // nothing at all
+
+    all.push_back (Ranges ());
+
+    return all;
+}
+
+void
+testFile (const std::string& fileName, Compression comp, bool tiled)
+{
+    writeFile (fileName, comp, tiled);
+
+    for (const Ranges& ranges: testRanges ())
+    {
+        {
+            InputFile   in (fileName.c_str ());
+            ImageBuffer ib;
+            in.setFrameBuffer (ib.fb);
+            in.readPixels (ranges);
+            ib.check (ranges);
+        }
+
+        {
+            InputFile   in (fileName.c_str ());
+            ImageBuffer ib;
+            in.readPixels (ib.fb, ranges);
+            ib.check (ranges);
+        }
+
+        {
+            MultiPartInputFile mpf (fileName.c_str ());
+            InputPart          in (mpf, 0);
+            ImageBuffer        ib;
+            in.setFrameBuffer (ib.fb);
+            in.readPixels (ranges);
+            ib.check (ranges);
+        }
+    }
+
+    {
+        InputFile in (fileName.c_str ());
+        bool      caught = false;
+        try
+        {
+            in.readPixels (Ranges (1, make_pair (Y0 - 1, Y0 + 3)));
+        }
+        catch (const IEX_NAMESPACE::ArgExc&)
+        {
+            caught = true;
+        }
+        assert (caught);
+    }
+
+    remove (fileName.c_str ());
+}
+
+} // namespace
+
+void
+testReadRanges (const std::string& tempDir)
+{
+    try
+    {
+        cout << "Testing reading batched scan line ranges" << endl;
+
+        std::string fn = tempDir + "imf_test_read_ranges.exr";
+
+        int numThreads = globalThreadCount ();
+        for (int t: {0, 3})
+        {
+            setGlobalThreadCount (t);
+            cout << " threads " << t << ": uncompressed" << flush;
+            testFile (fn, NO_COMPRESSION, false);
+            cout << " zip" << flush;
+            testFile (fn, ZIP_COMPRESSION, false);
+            cout << " piz" << flush;
+            testFile (fn, PIZ_COMPRESSION, false);
+            cout << " tiled" << endl;
+            testFile (fn, ZIP_COMPRESSION, true);
+        }
+        setGlobalThreadCount (numThreads);
+
+        cout << "ok\n" << endl;
+    }
+    catch (const std::exception& e)
+    {
+        cerr << "ERROR -- caught exception: " << e.what () << endl;
+        assert (false);
+    }
+}
@@ -0,0 +1,323 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifdef NDEBUG
+#    undef NDEBUG
+#endif
+
+#include <ImfArray.h>
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfInputFile.h>
+#include <ImfOutputFile.h>
+#include <ImfThreading.h>
+#include <ImfTileCache.h>
+#include <ImfTiledInputFile.h>
+#include <ImfTiledOutputFile.h>
+#include <half.h>
+
+#include <assert.h>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+using namespace OPENEXR_IMF_NAMESPACE;
+using namespace std;
+using namespace IMATH_NAMESPACE;
+
+namespace
+{
+
+const int W  = 131;
+const int H  = 77;
+const int X0 = -9;
+const int Y0 = 14;
+
+float
+pixelValue (int x, int y)
+{
+    return x * 0.5f + y * 3.f;
+}
+
+void
+writeFile (const std::string& fileName, bool tiled)
+{
+    Box2i  dw (V2i (X0, Y0), V2i (X0 + W - 1, Y0 + H - 1));
+    Header hdr (dw, dw);
+    hdr.compression () = ZIP_COMPRESSION;
+    hdr.channels ().insert ("H", Channel (HALF));
+    hdr.channels ().insert ("F", Channel (FLOAT));
+
+    Array2D<half>  ph (H, W);
+    Array2D<float> pf (H, W);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x)
+        {
+            ph[y][x] = pixelValue (x + X0, y + Y0);
+            pf[y][x] = pixelValue (x + X0, y + Y0);
+        }
+
+    FrameBuffer fb;
+    fb.insert (
+        "H",
+        Slice::Make (
+            HALF, &ph[0][0], V2i (X0, Y0), W, H, sizeof (half)));
+    fb.insert (
+        "F",
+        Slice::Make (
+            FLOAT, &pf[0][0], V2i (X0, Y0), W, H, sizeof (float)));
+
+    remove (fileName.c_str ());
+    if (tiled)
+    {
+        hdr.setTileDescription (TileDescription (16, 12, ONE_LEVEL));
+        TiledOutputFile out (fileName.c_str (), hdr);
+        out.setFrameBuffer (fb);
+        out.writeTiles (0, out.numXTiles () - 1, 0, out.numYTiles () - 1);
+    }
+    else
+    {
+        OutputFile out (fileName.c_str (), hdr);
+        out.setFrameBuffer (fb);
+        out.writePixels (H);
+    }
+}
+
+//
+// Build a frame buffer that only covers box, surrounded by a
+// guard band that readRegion() must not touch.
+//
+
+struct RegionBuffer
+{
+    RegionBuffer (const Box2i& box)
+        : box (box)
+        , w (box.max.x - box.min.x + 1)
+        , h (box.max.y - box.min.y + 1)
+        , ph (h + 2, w + 2)
+        , pf (h + 2, w + 2)
+        , pfill (h + 2, w + 2)
+    {
+        for (int y = 0; y < h + 2; ++y)
+            for (int x = 0; x < w + 2; ++x)
+            {
+                ph[y][x]    = -1.f;
+                pf[y][x]    = -1.f;
+                pfill[y][x] = -1.f;
+            }
+
+        V2i origin (box.min.x - 1, box.min.y - 1);
+        fb.insert (
+            "H",
+            Slice::Make (
+                HALF, &ph[0][0], origin, w + 2, h + 2, sizeof (half)));
+        fb.insert (
+            "F",
+            Slice::Make (
+                FLOAT, &pf[0][0], origin, w + 2, h + 2, sizeof (float)));
+        fb.insert (
+            "missing",
+            Slice (
+                FLOAT,
+                (char*) (&pfill[0][0] - origin.x - origin.y * (w + 2)),
+                sizeof (float),
+                sizeof (float) * (w + 2),
+                1,
+                1,
+                7.0));
+    }
+
+    void check () const
+    {
+        for (int y = 0; y < h + 2; ++y)
+            for (int x = 0; x < w + 2; ++x)
+            {
+                bool inside = x > 0 && y > 0 && x <= w && y <= h;
+                float v     = pixelValue (box.min.x + x - 1, box.min.y + y - 1);
+
+                if (inside)
+                {
+                    assert (ph[y][x] == half (v));
+                    assert (pf[y][x] == v);
+                    assert (pfill[y][x] == 7.f);
+                }
+                else
+                {
+                    assert (ph[y][x] == -1.f);
+                    assert (pf[y][x] == -1.f);
+                    assert (pfill[y][x] == -1.f);
+                }
+            }
+    }
+
+    Box2i          box;
+    int            w, h;
+    Array2D<half>  ph;
+    Array2D<float> pf;
+    Array2D<float> pfill;
+    FrameBuffer    fb;
+};
+
+const Box2i regions[] = {
+    Box2i (V2i (X0, Y0), V2i (X0 + W - 1, Y0 + H - 1)),
+    Box2i (V2i (X0 + 5, Y0 + 3), V2i (X0 + 5, Y0 + 3)),
+    Box2i (V2i (X0 + 15, Y0 + 11), V2i (X0 + 16, Y0 + 12)),
+    Box2i (V2i (X0 + 20, Y0 + 30), V2i (X0 + 97, Y0 + 41)),
+    Box2i (V2i (X0 + 7, Y0 + 5), V2i (X0 + 70, Y0 + 50)),
+    Box2i (V2i (X0 + 100, Y0 + 60), V2i (X0 + W - 1, Y0 + H - 1)),
+};
+
+//
+// Read several regions, some of them sharing tiles, in one call into
+// a whole-image frame buffer, and check that exactly the pixels inside
+// the regions were written.
+//
+
+void
+testBoxes (const std::string& fileName, bool useCache)
+{
+    vector<Box2i> boxes;
+    boxes.push_back (regions[3]);
+    boxes.push_back (regions[2]);
+    boxes.push_back (regions[5]);
+    boxes.push_back (Box2i (V2i (X0 + 17, Y0 + 10), V2i (X0 + 30, Y0 + 13)));
+    boxes.push_back (regions[1]);
+
+    Array2D<half>  ph (H, W);
+    Array2D<float> pf (H, W);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x)
+        {
+            ph[y][x] = -1.f;
+            pf[y][x] = -1.f;
+        }
+
+    FrameBuffer fb;
+    fb.insert (
+        "H",
+        Slice::Make (HALF, &ph[0][0], V2i (X0, Y0), W, H, sizeof (half)));
+    fb.insert (
+        "F",
+        Slice::Make (FLOAT, &pf[0][0], V2i (X0, Y0), W, H, sizeof (float)));
+
+    if (useCache)
+    {
+        TiledInputFile in (fileName.c_str ());
+        in.setTileCache (std::make_shared<TileCache> (16 * 1024 * 1024));
+        in.setFrameBuffer (fb);
+        in.readRegion (boxes);
+    }
+    else
+    {
+        InputFile in (fileName.c_str ());
+        in.setFrameBuffer (fb);
+        in.readRegion (boxes);
+    }
+
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x)
+        {
+            bool inside = false;
+            for (const Box2i& box: boxes)
+                inside = inside || box.intersects (V2i (x + X0, y + Y0));
+
+            if (inside)
+            {
+                float v = pixelValue (x + X0, y + Y0);
+                assert (ph[y][x] == half (v));
+                assert (pf[y][x] == v);
+            }
+            else
+            {
+                assert (ph[y][x] == -1.f);
+                assert (pf[y][x] == -1.f);
+            }
+        }
+}
+
+void
+testFile (const std::string& fileName, bool tiled)
+{
+    writeFile (fileName, tiled);
+
+    testBoxes (fileName, false);
+    if (tiled) testBoxes (fileName, true);
+
+    for (const Box2i& box: regions)
+    {
+        {
+            InputFile    in (fileName.c_str ());
+            RegionBuffer rb (box);
+            in.setFrameBuffer (rb.fb);
+            in.readRegion (box);
+            rb.check ();
+        }
+
+        if (tiled)
+        {
+            std::shared_ptr<TileCache> cache =
+                std::make_shared<TileCache> (16 * 1024 * 1024);
+
+            TiledInputFile in (fileName.c_str ());
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                RegionBuffer rb (box);
+                in.setFrameBuffer (rb.fb);
+                in.readRegion (box);
+                rb.check ();
+                in.setTileCache (cache);
+            }
+        }
+    }
+
+    {
+        InputFile in (fileName.c_str ());
+        bool      caught = false;
+        try
+        {
+            in.readRegion (Box2i (V2i (X0 - 1, Y0), V2i (X0 + 3, Y0 + 3)));
+        }
+        catch (const IEX_NAMESPACE::ArgExc&)
+        {
+            caught = true;
+        }
+        assert (caught);
+    }
+
+    remove (fileName.c_str ());
+}
+
+} // namespace
+
+void
+testReadRegion (const std::string& tempDir)
+{
+    try
+    {
+        cout << "Testing reading rectangular regions" << endl;
+
+        std::string fn = tempDir + "imf_test_read_region.exr";
+
+        int numThreads = globalThreadCount ();
+        for (int t: {0, 4})
+        {
+            setGlobalThreadCount (t);
+            cout << " threads " << t << ": tiled" << flush;
+            testFile (fn, true);
+            cout << " scan line" << endl;
+            testFile (fn, false);
+        }
+        setGlobalThreadCount (numThreads);
+
+        cout << "ok\n" << endl;
+    }
+    catch (const std::exception& e)
+    {
+        cerr << "ERROR -- caught exception: " << e.what () << endl;
+        assert (false);
+    }
+}
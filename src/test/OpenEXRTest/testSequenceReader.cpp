@@ -0,0 +1,384 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifdef NDEBUG
+#    undef NDEBUG
+#endif
+
+#include <ImfArray.h>
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfMultiPartOutputFile.h>
+#include <ImfOutputFile.h>
+#include <ImfOutputPart.h>
+#include <ImfPartType.h>
+#include <ImfSequenceReader.h>
+#include <ImfThreading.h>
+#include <ImfTiledOutputPart.h>
+#include <half.h>
+
+#include "Iex.h"
+
+#include <assert.h>
+#include <iostream>
+#include <stdio.h>
+#include <vector>
+
+using namespace OPENEXR_IMF_NAMESPACE;
+using namespace std;
+using namespace IMATH_NAMESPACE;
+
+namespace
+{
+
+const int W         = 40;
+const int H         = 23;
+const int numFrames = 7;
+
+float
+pixelValue (int frame, int x, int y)
+{
+    return frame * 100.f + x + y * 0.5f;
+}
+
+void
+writeFrames (const std::vector<std::string>& names)
+{
+    for (int f = 0; f < numFrames; ++f)
+    {
+        Header hdr (W, H);
+        hdr.channels ().insert ("R", Channel (FLOAT));
+        hdr.channels ().insert ("G", Channel (HALF));
+
+        Array2D<float> pr (H, W);
+        Array2D<half>  pg (H, W);
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x)
+            {
+                pr[y][x] = pixelValue (f, x, y);
+                pg[y][x] = float (f);
+            }
+
+        FrameBuffer fb;
+        fb.insert (
+            "R",
+            Slice (FLOAT, (char*) &pr[0][0], sizeof (float), sizeof (float) * W));
+        fb.insert (
+            "G",
+            Slice (HALF, (char*) &pg[0][0], sizeof (half), sizeof (half) * W));
+
+        remove (names[f].c_str ());
+        OutputFile out (names[f].c_str (), hdr);
+        out.setFrameBuffer (fb);
+        out.writePixels (H);
+    }
+}
+
+void
+checkFrame (
+    const std::shared_ptr<const SequenceReader::Frame>& frame,
+    int                                                 index,
+    const Box2i&                                        region,
+    bool                                                withG)
+{
+    assert (frame);
+    assert (frame->index () == index);
+    assert (frame->region () == region);
+
+    const FrameBuffer& fb = frame->frameBuffer ();
+    const Slice*       r  = fb.findSlice ("R");
+    const Slice*       g  = fb.findSlice ("G");
+
+    assert (r);
+    assert ((g != nullptr) == withG);
+
+    for (int y = region.min.y; y <= region.max.y; ++y)
+    {
+        for (int x = region.min.x; x <= region.max.x; ++x)
+        {
+            float rv = *(const float*) (r->base + y * r->yStride +
+                                        x * r->xStride);
+            assert (rv == pixelValue (index, x, y));
+
+            if (withG)
+            {
+                half gv = *(const half*) (g->base + y * g->yStride +
+                                          x * g->xStride);
+                assert (gv == float (index));
+            }
+        }
+    }
+}
+
+void
+testPlayback (const std::vector<std::string>& names)
+{
+    Box2i full (V2i (0, 0), V2i (W - 1, H - 1));
+
+    {
+        cout << " forward" << flush;
+        SequenceReader seq (names, SequenceReader::ReadSpec (), 3);
+        assert (seq.numFrames () == numFrames);
+
+        for (int f = 0; f < numFrames; ++f)
+            checkFrame (seq.frame (f), f, full, true);
+
+        cout << " backward" << flush;
+        for (int f = numFrames - 1; f >= 0; --f)
+            checkFrame (seq.frame (f), f, full, true);
+        assert (seq.direction () == -1);
+
+        // the frame just returned is retained
+        assert (seq.isReady (0));
+    }
+
+    {
+        cout << " bounded" << flush;
+
+        //
+        // With no budget, frames are still released once playback
+        // has moved past them
+        //
+
+        SequenceReader seq (names, SequenceReader::ReadSpec (), 1);
+        for (int f = 0; f < numFrames; ++f)
+        {
+            checkFrame (seq.frame (f), f, full, true);
+
+            int ready = 0;
+            for (int i = 0; i < numFrames; ++i)
+            {
+                if (seq.isReady (i))
+                {
+                    assert (i >= f);
+                    ++ready;
+                }
+            }
+            assert (ready <= 2);
+        }
+    }
+
+    {
+        cout << " region" << flush;
+        SequenceReader::ReadSpec spec;
+        spec.channels.push_back ("R");
+        spec.region = Box2i (V2i (5, 3), V2i (17, 20));
+
+        SequenceReader seq (names, spec, 2, W * H * 4);
+        seq.seek (4);
+        for (int f = 4; f < numFrames; ++f)
+            checkFrame (seq.frame (f), f, spec.region, false);
+
+        seq.setDirection (-1);
+        for (int f = numFrames - 1; f >= 0; f -= 2)
+            checkFrame (seq.frame (f), f, spec.region, false);
+    }
+
+    {
+        cout << " missing frame" << flush;
+        std::vector<std::string> bad = names;
+        bad[2] += ".missing";
+
+        SequenceReader seq (bad);
+        checkFrame (seq.frame (1), 1, full, true);
+
+        bool caught = false;
+        try
+        {
+            seq.frame (2);
+        }
+        catch (const IEX_NAMESPACE::InputExc&)
+        {
+            caught = true;
+        }
+        assert (caught);
+
+        checkFrame (seq.frame (3), 3, full, true);
+    }
+
+    {
+        // destroying the reader while frames are in flight
+        SequenceReader seq (names, SequenceReader::ReadSpec (), numFrames);
+        seq.seek (0);
+    }
+
+    cout << endl;
+}
+
+//
+// Frames with a scan line part 0 and a tiled part 1, whose values are
+// offset by 1000 from those of part 0
+//
+
+void
+writePartFrames (const std::vector<std::string>& names)
+{
+    for (size_t f = 0; f < names.size (); ++f)
+    {
+        vector<Header> headers (2, Header (W, H));
+        for (int p = 0; p < 2; ++p)
+        {
+            headers[p].channels ().insert ("R", Channel (FLOAT));
+            headers[p].setName (p ? "tiled" : "scanline");
+            headers[p].setType (p ? TILEDIMAGE : SCANLINEIMAGE);
+        }
+        headers[1].setTileDescription (TileDescription (16, 8, ONE_LEVEL));
+
+        remove (names[f].c_str ());
+        MultiPartOutputFile out (names[f].c_str (), &headers[0], 2);
+
+        for (int p = 0; p < 2; ++p)
+        {
+            Array2D<float> pr (H, W);
+            for (int y = 0; y < H; ++y)
+                for (int x = 0; x < W; ++x)
+                    pr[y][x] = pixelValue (int (f), x, y) + p * 1000.f;
+
+            FrameBuffer fb;
+            fb.insert (
+                "R",
+                Slice (
+                    FLOAT,
+                    (char*) &pr[0][0],
+                    sizeof (float),
+                    sizeof (float) * W));
+
+            if (p)
+            {
+                TiledOutputPart part (out, p);
+                part.setFrameBuffer (fb);
+                part.writeTiles (
+                    0, part.numXTiles () - 1, 0, part.numYTiles () - 1);
+            }
+            else
+            {
+                OutputPart part (out, p);
+                part.setFrameBuffer (fb);
+                part.writePixels (H);
+            }
+        }
+    }
+}
+
+void
+checkParts (
+    const std::shared_ptr<const SequenceReader::Frame>& frame,
+    int                                                 index,
+    const Box2i&                                        region)
+{
+    assert (frame);
+    assert (frame->numParts () == 2);
+    assert (frame->partNumber (0) == 1 && frame->partNumber (1) == 0);
+    assert (&frame->header () == &frame->header (0));
+    assert (isTiled (frame->header (0).type ()));
+
+    for (int i = 0; i < 2; ++i)
+    {
+        assert (frame->region (i) == region);
+
+        const Slice* r = frame->frameBuffer (i).findSlice ("R");
+        assert (r);
+
+        float offset = frame->partNumber (i) * 1000.f;
+
+        for (int y = region.min.y; y <= region.max.y; ++y)
+            for (int x = region.min.x; x <= region.max.x; ++x)
+            {
+                float rv = *(const float*) (r->base + y * r->yStride +
+                                            x * r->xStride);
+                assert (rv == pixelValue (index, x, y) + offset);
+            }
+    }
+
+    bool caught = false;
+    try
+    {
+        frame->header (2);
+    }
+    catch (const IEX_NAMESPACE::ArgExc&)
+    {
+        caught = true;
+    }
+    assert (caught);
+}
+
+void
+testParts (const std::vector<std::string>& names)
+{
+    cout << " parts" << flush;
+
+    SequenceReader::ReadSpec spec;
+    spec.parts.push_back (1);
+    spec.parts.push_back (0);
+
+    {
+        SequenceReader seq (names, spec, 2);
+        for (int f = 0; f < int (names.size ()); ++f)
+            checkParts (
+                seq.frame (f), f, Box2i (V2i (0, 0), V2i (W - 1, H - 1)));
+    }
+
+    spec.region = Box2i (V2i (3, 5), V2i (30, 19));
+
+    {
+        SequenceReader seq (names, spec, 2);
+        for (int f = 0; f < int (names.size ()); ++f)
+            checkParts (seq.frame (f), f, spec.region);
+    }
+
+    cout << endl;
+}
+
+} // namespace
+
+void
+testSequenceReader (const std::string& tempDir)
+{
+    try
+    {
+        cout << "Testing image sequence reader" << endl;
+
+        std::vector<std::string> names = SequenceReader::expandPattern (
+            tempDir + "imf_test_sequence.%03d.exr", 1, numFrames);
+
+        assert (names.size () == size_t (numFrames));
+        assert (names[0] == tempDir + "imf_test_sequence.001.exr");
+        assert (
+            SequenceReader::expandPattern ("a.####.exr", 12, 10)[2] ==
+            "a.0010.exr");
+        assert (SequenceReader::expandPattern ("a.%d.exr", 9, 9)[0] == "a.9.exr");
+
+        writeFrames (names);
+
+        std::vector<std::string> partNames = SequenceReader::expandPattern (
+            tempDir + "imf_test_sequence_parts.#.exr", 1, 3);
+
+        writePartFrames (partNames);
+
+        int numThreads = globalThreadCount ();
+        for (int t: {0, 4})
+        {
+            cout << " threads " << t << ":" << flush;
+            setGlobalThreadCount (t);
+            testPlayback (names);
+            testParts (partNames);
+        }
+        setGlobalThreadCount (numThreads);
+
+        for (const std::string& n: names)
+            remove (n.c_str ());
+
+        for (const std::string& n: partNames)
+            remove (n.c_str ());
+
+        cout << "ok\n" << endl;
+    }
+    catch (const std::exception& e)
+    {
+        cerr << "ERROR -- caught exception: " << e.what () << endl;
+        assert (false);
+    }
+}
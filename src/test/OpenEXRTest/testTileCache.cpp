@@ -0,0 +1,295 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifdef NDEBUG
+#    undef NDEBUG
+#endif
+
+#include <ImfArray.h>
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfMultiPartInputFile.h>
+#include <ImfStdIO.h>
+#include <ImfStringAttribute.h>
+#include <ImfThreading.h>
+#include <ImfTileCache.h>
+#include <ImfTiledInputFile.h>
+#include <ImfTiledInputPart.h>
+#include <ImfTiledOutputFile.h>
+#include <half.h>
+
+#include <assert.h>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+
+using namespace OPENEXR_IMF_NAMESPACE;
+using namespace std;
+using namespace IMATH_NAMESPACE;
+
+namespace
+{
+
+const int W = 117;
+const int H = 93;
+
+void
+fillPixels (Array2D<half>& ph, Array2D<float>& pf, float offset = 0.f)
+{
+    for (int y = 0; y < H; ++y)
+    {
+        for (int x = 0; x < W; ++x)
+        {
+            ph[y][x] = sin (double (x)) + sin (y * 0.5) + offset;
+            pf[y][x] = x * 0.25f + y + offset;
+        }
+    }
+}
+
+void
+writeFile (
+    const std::string& fileName,
+    Array2D<half>&     ph,
+    Array2D<float>&    pf,
+    const char*        comment = nullptr)
+{
+    Header hdr (W, H);
+    if (comment) hdr.insert ("comment", StringAttribute (comment));
+    hdr.compression () = ZIP_COMPRESSION;
+    hdr.channels ().insert ("H", Channel (HALF));
+    hdr.channels ().insert ("F", Channel (FLOAT));
+    hdr.setTileDescription (TileDescription (16, 16, MIPMAP_LEVELS));
+
+    FrameBuffer fb;
+    fb.insert ("H", Slice (HALF, (char*) &ph[0][0], sizeof (half), sizeof (half) * W));
+    fb.insert ("F", Slice (FLOAT, (char*) &pf[0][0], sizeof (float), sizeof (float) * W));
+
+    remove (fileName.c_str ());
+    TiledOutputFile out (fileName.c_str (), hdr);
+    out.setFrameBuffer (fb);
+    out.writeTiles (0, out.numXTiles (0) - 1, 0, out.numYTiles (0) - 1, 0);
+
+    // the lower levels are not checked, just fill them with zeros
+    for (int l = 1; l < out.numLevels (); ++l)
+    {
+        Array2D<half>  zh (H, W);
+        Array2D<float> zf (H, W);
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x)
+            {
+                zh[y][x] = 0.f;
+                zf[y][x] = 0.f;
+            }
+        FrameBuffer zfb;
+        zfb.insert ("H", Slice (HALF, (char*) &zh[0][0], sizeof (half), sizeof (half) * W));
+        zfb.insert ("F", Slice (FLOAT, (char*) &zf[0][0], sizeof (float), sizeof (float) * W));
+        out.setFrameBuffer (zfb);
+        out.writeTiles (0, out.numXTiles (l) - 1, 0, out.numYTiles (l) - 1, l);
+    }
+}
+
+template <class In>
+void
+readAndCompare (
+    In&                   in,
+    const Array2D<half>&  ph,
+    const Array2D<float>& pf,
+    bool                  halfOnly)
+{
+    Array2D<half>  rh (H, W);
+    Array2D<float> rf (H, W);
+    Array2D<float> rfill (H, W);
+
+    FrameBuffer fb;
+    fb.insert ("H", Slice (HALF, (char*) &rh[0][0], sizeof (half), sizeof (half) * W));
+    if (!halfOnly)
+        fb.insert ("F", Slice (FLOAT, (char*) &rf[0][0], sizeof (float), sizeof (float) * W));
+    fb.insert (
+        "missing",
+        Slice (FLOAT, (char*) &rfill[0][0], sizeof (float), sizeof (float) * W, 1, 1, 3.f));
+    in.setFrameBuffer (fb);
+
+    in.readTiles (0, in.numXTiles (0) - 1, 0, in.numYTiles (0) - 1, 0);
+
+    for (int y = 0; y < H; ++y)
+    {
+        for (int x = 0; x < W; ++x)
+        {
+            assert (rh[y][x].bits () == ph[y][x].bits ());
+            if (!halfOnly) assert (rf[y][x] == pf[y][x]);
+            assert (rfill[y][x] == 3.f);
+        }
+    }
+}
+
+void
+testCache (const std::string& fileName)
+{
+    Array2D<half>  ph (H, W);
+    Array2D<float> pf (H, W);
+    fillPixels (ph, pf);
+    writeFile (fileName, ph, pf);
+
+    std::shared_ptr<TileCache> cache = std::make_shared<TileCache> (64 * 1024 * 1024);
+
+    int numTiles = 0;
+    {
+        TiledInputFile in (fileName.c_str ());
+        numTiles = in.numXTiles (0) * in.numYTiles (0);
+        in.setTileCache (cache);
+        assert (in.tileCache () == cache);
+
+        cout << " first read" << flush;
+        readAndCompare (in, ph, pf, false);
+
+        TileCache::Statistics st = cache->statistics ();
+        assert (st.hits == 0);
+        assert (st.misses == uint64_t (numTiles));
+        assert (st.insertions == uint64_t (numTiles));
+        assert (st.numTiles == size_t (numTiles));
+        assert (st.bytesUsed == size_t (W * H * (2 + 4)));
+
+        cout << " cached read" << flush;
+        readAndCompare (in, ph, pf, false);
+
+        st = cache->statistics ();
+        assert (st.hits == uint64_t (numTiles));
+        assert (st.misses == uint64_t (numTiles));
+
+        // a different channel set does not reuse the tiles
+        cout << " channel subset" << flush;
+        readAndCompare (in, ph, pf, true);
+        st = cache->statistics ();
+        assert (st.misses == uint64_t (2 * numTiles));
+        assert (st.numTiles == size_t (2 * numTiles));
+    }
+
+    {
+        // a second reader of the same file, as a file or as a part,
+        // reuses the tiles of the first
+        cout << " second reader" << flush;
+        TiledInputFile in (fileName.c_str ());
+        in.setTileCache (cache);
+        readAndCompare (in, ph, pf, false);
+
+        TileCache::Statistics st = cache->statistics ();
+        assert (st.hits == uint64_t (2 * numTiles));
+        assert (st.misses == uint64_t (2 * numTiles));
+
+        MultiPartInputFile mpf (fileName.c_str ());
+        TiledInputPart     part (mpf, 0);
+        part.setTileCache (cache);
+        readAndCompare (part, ph, pf, false);
+
+        st = cache->statistics ();
+        assert (st.hits == uint64_t (3 * numTiles));
+        assert (st.misses == uint64_t (2 * numTiles));
+    }
+
+    {
+        // a reader of an IStream has no file identity, so it only
+        // reuses its own tiles
+        cout << " stream reader" << flush;
+        StdIFStream    is (fileName.c_str ());
+        TiledInputFile in (is);
+        in.setTileCache (cache);
+        readAndCompare (in, ph, pf, false);
+        readAndCompare (in, ph, pf, false);
+
+        TileCache::Statistics st = cache->statistics ();
+        assert (st.hits == uint64_t (4 * numTiles));
+        assert (st.misses == uint64_t (3 * numTiles));
+    }
+
+    {
+        // the file is rewritten under the same name (with a
+        // different size, as the modification time may not have
+        // changed), a new file object must not see the old tiles
+        cout << " rewritten file" << flush;
+        Array2D<half>  nh (H, W);
+        Array2D<float> nf (H, W);
+        fillPixels (nh, nf, 1.f);
+        writeFile (fileName, nh, nf, "rewritten");
+
+        TiledInputFile in (fileName.c_str ());
+        in.setTileCache (cache);
+        readAndCompare (in, nh, nf, false);
+
+        TileCache::Statistics st = cache->statistics ();
+        assert (st.hits == uint64_t (4 * numTiles));
+        assert (st.misses == uint64_t (4 * numTiles));
+
+        writeFile (fileName, ph, pf);
+    }
+
+    cout << " eviction" << flush;
+    cache->resetStatistics ();
+    cache->setMaxBytes (16 * 16 * 6 * 4);
+    TileCache::Statistics st = cache->statistics ();
+    assert (st.bytesUsed <= cache->maxBytes ());
+    assert (st.evictions > 0);
+
+    cache->clear (fileName);
+    st = cache->statistics ();
+    assert (st.numTiles == 0);
+    assert (st.bytesUsed == 0);
+
+    {
+        // reading still works with a budget that is too small for
+        // most tiles to be retained
+        TiledInputFile in (fileName.c_str ());
+        in.setTileCache (cache);
+        readAndCompare (in, ph, pf, false);
+        readAndCompare (in, ph, pf, false);
+        st = cache->statistics ();
+        assert (st.bytesUsed <= cache->maxBytes ());
+    }
+
+    {
+        // tiles larger than a shard's share of the budget are
+        // still cached, as long as they fit the whole budget
+        cout << " large tiles" << flush;
+        cache->clear ();
+        cache->setMaxBytes (16 * 16 * 6 * 2);
+
+        TiledInputFile in (fileName.c_str ());
+        in.setTileCache (cache);
+        readAndCompare (in, ph, pf, false);
+        st = cache->statistics ();
+        assert (st.numTiles > 0);
+        assert (st.bytesUsed <= cache->maxBytes ());
+    }
+
+    cout << endl;
+    remove (fileName.c_str ());
+}
+
+} // namespace
+
+void
+testTileCache (const std::string& tempDir)
+{
+    try
+    {
+        cout << "Testing decoded tile cache" << endl;
+
+        std::string fn = tempDir + "imf_test_tile_cache.exr";
+
+        int numThreads = globalThreadCount ();
+        setGlobalThreadCount (0);
+        testCache (fn);
+        setGlobalThreadCount (4);
+        testCache (fn);
+        setGlobalThreadCount (numThreads);
+
+        cout << "ok\n" << endl;
+    }
+    catch (const std::exception& e)
+    {
+        cerr << "ERROR -- caught exception: " << e.what () << endl;
+        assert (false);
+    }
+}
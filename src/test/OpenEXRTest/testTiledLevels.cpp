@@ -0,0 +1,732 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifdef NDEBUG
+#    undef NDEBUG
+#endif
+
+#include <ImfArray.h>
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfThreading.h>
+#include <ImfTiledInputFile.h>
+#include <ImfTiledLevels.h>
+#include <ImfTiledOutputFile.h>
+#include <ImathFun.h>
+#include <half.h>
+
+#include <assert.h>
+#include <iostream>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace OPENEXR_IMF_NAMESPACE;
+using namespace std;
+using namespace IMATH_NAMESPACE;
+
+namespace
+{
+
+//
+// Write a file whose channels are
+//
+//   C: a constant, which every filter and wrap mode except
+//      WRAP_BLACK must preserve on every level
+//   G: a horizontal ramp, half
+//   I: unsigned int ids, point sampled
+//
+
+void
+writeFile (
+    const std::string&            fileName,
+    int                           w,
+    int                           h,
+    LevelMode                     mode,
+    const LevelGenerationOptions& options)
+{
+    Header hdr (w, h);
+    hdr.compression () = ZIP_COMPRESSION;
+    hdr.channels ().insert ("C", Channel (FLOAT));
+    hdr.channels ().insert ("G", Channel (HALF));
+    hdr.channels ().insert ("I", Channel (UINT));
+    hdr.setTileDescription (TileDescription (8, 8, mode, ROUND_DOWN));
+
+    Array2D<float>        pc (h, w);
+    Array2D<half>         pg (h, w);
+    Array2D<unsigned int> pi (h, w);
+
+    LevelGenerationOptions o = options;
+    o.pointSampledChannels.insert ("I");
+
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+        {
+            pc[y][x] = 0.75f;
+            pg[y][x] = float (x);
+            pi[y][x] = 7;
+        }
+
+    FrameBuffer fb;
+    fb.insert (
+        "C",
+        Slice (FLOAT, (char*) &pc[0][0], sizeof (float), sizeof (float) * w));
+    fb.insert (
+        "G", Slice (HALF, (char*) &pg[0][0], sizeof (half), sizeof (half) * w));
+    fb.insert (
+        "I",
+        Slice (
+            UINT,
+            (char*) &pi[0][0],
+            sizeof (unsigned int),
+            sizeof (unsigned int) * w));
+
+    remove (fileName.c_str ());
+    TiledOutputFile out (fileName.c_str (), hdr);
+    writeLevels (out, fb, o);
+    assert (out.frameBuffer ()["C"].base == fb["C"].base);
+}
+
+void
+checkLevel (
+    TiledInputFile& in, int lx, int ly, const LevelGenerationOptions& options)
+{
+    Box2i dw = in.dataWindowForLevel (lx, ly);
+    int   w  = dw.max.x - dw.min.x + 1;
+    int   h  = dw.max.y - dw.min.y + 1;
+
+    Array2D<float>        pc (h, w);
+    Array2D<float>        pg (h, w);
+    Array2D<unsigned int> pi (h, w);
+
+    FrameBuffer fb;
+    fb.insert ("C", Slice::Make (FLOAT, &pc[0][0], dw));
+    fb.insert ("G", Slice::Make (FLOAT, &pg[0][0], dw));
+    fb.insert ("I", Slice::Make (UINT, &pi[0][0], dw));
+    in.setFrameBuffer (fb);
+    in.readTiles (0, in.numXTiles (lx) - 1, 0, in.numYTiles (ly) - 1, lx, ly);
+
+    int w0 = in.levelWidth (0);
+
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            assert (fabs (pc[y][x] - 0.75f) < 1e-5f);
+            assert (pi[y][x] == 7);
+
+            //
+            // With power of two sizes, the box filter averages
+            // pixel pairs exactly, and the ramp stays a ramp.
+            //
+
+            if (options.filter == BOX_FILTER && lx > 0)
+            {
+                float s = float (1 << lx);
+                assert (fabs (pg[y][x] - (x * s + (s - 1) * 0.5f)) < 1e-2f);
+            }
+            else if (lx == 0)
+            {
+                assert (pg[y][x] == float (x));
+            }
+            else
+            {
+                assert (pg[y][x] >= 0.f && pg[y][x] <= float (w0 - 1));
+            }
+        }
+    }
+}
+
+void
+testLevels (
+    const std::string&            fileName,
+    int                           w,
+    int                           h,
+    LevelMode                     mode,
+    const LevelGenerationOptions& options)
+{
+    writeFile (fileName, w, h, mode, options);
+
+    TiledInputFile in (fileName.c_str ());
+    assert (in.isComplete ());
+
+    for (int ly = 0; ly < in.numYLevels (); ++ly)
+    {
+        for (int lx = 0; lx < in.numXLevels (); ++lx)
+        {
+            if (!in.isValidLevel (lx, ly)) continue;
+            checkLevel (in, lx, ly, options);
+        }
+    }
+
+    remove (fileName.c_str ());
+}
+
+//
+// Read one channel of one level, in the pixel type of the file
+//
+
+template <class T>
+struct LevelPixels
+{
+    int            w = 0;
+    int            h = 0;
+    std::vector<T> p;
+
+    LevelPixels () {}
+    LevelPixels (int width, int height)
+        : w (width), h (height), p (size_t (width) * size_t (height))
+    {}
+
+    T&       operator() (int x, int y) { return p[size_t (y) * w + x]; }
+    const T& operator() (int x, int y) const { return p[size_t (y) * w + x]; }
+};
+
+template <class T>
+LevelPixels<T>
+readLevel (
+    TiledInputFile& in, const char* name, PixelType type, int lx, int ly)
+{
+    Box2i          dw = in.dataWindowForLevel (lx, ly);
+    LevelPixels<T> l (dw.max.x - dw.min.x + 1, dw.max.y - dw.min.y + 1);
+
+    FrameBuffer fb;
+    fb.insert (name, Slice::Make (type, l.p.data (), dw));
+    in.setFrameBuffer (fb);
+    in.readTiles (0, in.numXTiles (lx) - 1, 0, in.numYTiles (ly) - 1, lx, ly);
+    return l;
+}
+
+//
+// Point sampling must pick the same pixels as exrmaketiled always
+// did: an 11 pixel wide level 0 shrinks to 5, 2 and 1 pixels, and
+// the skipped pixel alternates between the last and the first.
+// Mipmap reductions use the parity of the level they produce,
+// ripmap reductions the parity of the level they start from.
+//
+
+void
+testPointPositions (const std::string& fileName, LevelMode mode, bool listed)
+{
+    const int n = 11;
+
+    static const int mipmap[4][11] = {
+        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10},
+        {2, 4, 6, 8, 10},
+        {2, 6},
+        {6}};
+
+    static const int ripmap[4][11] = {
+        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10},
+        {0, 2, 4, 6, 8},
+        {4, 8},
+        {4}};
+
+    const int (*expected)[11] = (mode == MIPMAP_LEVELS) ? mipmap : ripmap;
+
+    Header hdr (n, n);
+    hdr.channels ().insert ("X", Channel (FLOAT));
+    hdr.channels ().insert ("Y", Channel (FLOAT));
+    hdr.setTileDescription (TileDescription (4, 4, mode, ROUND_DOWN));
+
+    Array2D<float> px (n, n);
+    Array2D<float> py (n, n);
+    for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x)
+        {
+            px[y][x] = float (x);
+            py[y][x] = float (y);
+        }
+
+    FrameBuffer fb;
+    fb.insert ("X", Slice::Make (FLOAT, &px[0][0], hdr.dataWindow ()));
+    fb.insert ("Y", Slice::Make (FLOAT, &py[0][0], hdr.dataWindow ()));
+
+    //
+    // Channels listed in pointSampledChannels are point sampled
+    // like all channels are with POINT_FILTER.
+    //
+
+    LevelGenerationOptions options;
+    if (listed)
+    {
+        options.pointSampledChannels.insert ("X");
+        options.pointSampledChannels.insert ("Y");
+    }
+    else
+    {
+        options.filter = POINT_FILTER;
+    }
+
+    std::vector<std::pair<int, int>> order;
+    options.progress = [&order] (int lx, int ly) {
+        order.push_back (std::make_pair (lx, ly));
+    };
+
+    {
+        remove (fileName.c_str ());
+        TiledOutputFile out (fileName.c_str (), hdr);
+        writeLevels (out, fb, options);
+    }
+
+    TiledInputFile in (fileName.c_str ());
+    assert (in.numXLevels () == 4 && in.numYLevels () == 4);
+
+    size_t numLevels = 0;
+    for (int ly = 0; ly < in.numYLevels (); ++ly)
+    {
+        for (int lx = 0; lx < in.numXLevels (); ++lx)
+        {
+            if (!in.isValidLevel (lx, ly)) continue;
+
+            //
+            // the levels are reported in the order exrmaketiled
+            // printed them
+            //
+
+            assert (order[numLevels] == std::make_pair (lx, ly));
+            ++numLevels;
+
+            LevelPixels<float> lpx = readLevel<float> (in, "X", FLOAT, lx, ly);
+            LevelPixels<float> lpy = readLevel<float> (in, "Y", FLOAT, lx, ly);
+
+            for (int y = 0; y < lpx.h; ++y)
+                for (int x = 0; x < lpx.w; ++x)
+                {
+                    assert (lpx (x, y) == float (expected[lx][x]));
+                    assert (lpy (x, y) == float (expected[ly][y]));
+                }
+        }
+    }
+
+    assert (order.size () == numLevels);
+    remove (fileName.c_str ());
+}
+
+//
+// With WRAP_BLACK the pixels outside the image are zero, so the
+// edge pixels of a constant image darken.  For a 64 pixel wide
+// level 0 the filter positions of level 1 fall on whole pixels,
+// one tap of the edge pixels falls outside, and the results are
+// exact: 7/8 on the edges, 49/64 in the corners.
+//
+
+void
+testBlackEdges (const std::string& fileName, LevelWrap wrap)
+{
+    const int n = 64;
+
+    Header hdr (n, n);
+    hdr.channels ().insert ("C", Channel (FLOAT));
+    hdr.setTileDescription (TileDescription (16, 16, MIPMAP_LEVELS));
+
+    Array2D<float> pc (n, n);
+    for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x)
+            pc[y][x] = 1.f;
+
+    FrameBuffer fb;
+    fb.insert ("C", Slice::Make (FLOAT, &pc[0][0], hdr.dataWindow ()));
+
+    LevelGenerationOptions options;
+    options.wrapX = wrap;
+    options.wrapY = wrap;
+
+    {
+        remove (fileName.c_str ());
+        TiledOutputFile out (fileName.c_str (), hdr);
+        writeLevels (out, fb, options);
+    }
+
+    TiledInputFile     in (fileName.c_str ());
+    LevelPixels<float> l = readLevel<float> (in, "C", FLOAT, 1, 1);
+    assert (l.w == n / 2 && l.h == n / 2);
+
+    for (int y = 0; y < l.h; ++y)
+    {
+        for (int x = 0; x < l.w; ++x)
+        {
+            float ex = 1.f;
+            float ey = 1.f;
+
+            if (wrap == WRAP_BLACK)
+            {
+                if (x == 0 || x == l.w - 1) ex = 0.875f;
+                if (y == 0 || y == l.h - 1) ey = 0.875f;
+            }
+
+            assert (l (x, y) == ex * ey);
+        }
+    }
+
+    remove (fileName.c_str ());
+}
+
+//
+// The level reduction exrmaketiled used before it called
+// writeLevels(), copied from the old makeTiled.cpp.  Files written
+// by writeLevels() must match it bit for bit.
+//
+
+int
+refMirror (int x, int w)
+{
+    int d = divp (x, w);
+    int m = modp (x, w);
+    return (d & 1) ? w - 1 - m : m;
+}
+
+template <class T>
+double
+refSample (
+    const LevelPixels<T>& c,
+    int                   n,
+    double                x,
+    int                   y,
+    LevelWrap             ext,
+    bool                  xAxis)
+{
+    int    xs = IMATH_NAMESPACE::floor (x);
+    int    xt = xs + 1;
+    double s  = xt - x;
+    double t  = 1 - s;
+    double vs = 0.0;
+    double vt = 0.0;
+
+    auto at = [&] (int i) { return xAxis ? c (i, y) : c (y, i); };
+
+    switch (ext)
+    {
+        case WRAP_BLACK:
+
+            vs = (xs >= 0 && xs < n) ? double (at (xs)) : 0.0;
+            vt = (xt >= 0 && xt < n) ? double (at (xt)) : 0.0;
+            break;
+
+        case WRAP_CLAMP:
+
+            xs = IMATH_NAMESPACE::clamp (xs, 0, n - 1);
+            xt = IMATH_NAMESPACE::clamp (xt, 0, n - 1);
+            vs = at (xs);
+            vt = at (xt);
+            break;
+
+        case WRAP_PERIODIC:
+
+            xs = modp (xs, n);
+            xt = modp (xt, n);
+            vs = at (xs);
+            vt = at (xt);
+            break;
+
+        default:
+
+            xs = refMirror (xs, n);
+            xt = refMirror (xt, n);
+            vs = at (xs);
+            vt = at (xt);
+            break;
+    }
+
+    return s * vs + t * vt;
+}
+
+template <class T>
+T
+refFilter (
+    const LevelPixels<T>& c,
+    int                   n,
+    double                x,
+    int                   y,
+    LevelWrap             ext,
+    bool                  xAxis)
+{
+    return T (
+        0.125 * refSample (c, n, x - 1, y, ext, xAxis) +
+        0.375 * refSample (c, n, x, y, ext, xAxis) +
+        0.375 * refSample (c, n, x + 1, y, ext, xAxis) +
+        0.125 * refSample (c, n, x + 2, y, ext, xAxis));
+}
+
+template <class T>
+void
+refReduceX (
+    const LevelPixels<T>& c0,
+    LevelPixels<T>&       c1,
+    bool                  filter,
+    LevelWrap             ext,
+    bool                  odd)
+{
+    int w0 = c0.w;
+    int w1 = c1.w;
+
+    if (filter)
+    {
+        double f = (w1 > 1) ? double (w0 - 2) / (w1 - 1) : 1;
+
+        for (int y = 0; y < c1.h; ++y)
+            for (int x = 0; x < w1; ++x)
+                c1 (x, y) = refFilter (c0, w0, x * f, y, ext, true);
+    }
+    else
+    {
+        int offset = odd ? ((w0 - 1) - 2 * (w1 - 1)) : 0;
+
+        for (int y = 0; y < c1.h; ++y)
+            for (int x = 0; x < w1; ++x)
+                c1 (x, y) = c0 (2 * x + offset, y);
+    }
+}
+
+template <class T>
+void
+refReduceY (
+    const LevelPixels<T>& c0,
+    LevelPixels<T>&       c1,
+    bool                  filter,
+    LevelWrap             ext,
+    bool                  odd)
+{
+    int h0 = c0.h;
+    int h1 = c1.h;
+
+    if (filter)
+    {
+        double f = (h1 > 1) ? double (h0 - 2) / (h1 - 1) : 1;
+
+        for (int y = 0; y < h1; ++y)
+            for (int x = 0; x < c1.w; ++x)
+                c1 (x, y) = refFilter (c0, h0, y * f, x, ext, false);
+    }
+    else
+    {
+        int offset = odd ? ((h0 - 1) - 2 * (h1 - 1)) : 0;
+
+        for (int y = 0; y < h1; ++y)
+            for (int x = 0; x < c1.w; ++x)
+                c1 (x, y) = c0 (x, 2 * y + offset);
+    }
+}
+
+template <class T>
+std::map<std::pair<int, int>, LevelPixels<T>>
+refLevels (
+    TiledInputFile&       in,
+    const LevelPixels<T>& c0,
+    bool                  filter,
+    LevelWrap             extX,
+    LevelWrap             extY)
+{
+    std::map<std::pair<int, int>, LevelPixels<T>> levels;
+
+    if (in.levelMode () == MIPMAP_LEVELS)
+    {
+        LevelPixels<T> cur = c0;
+        levels[std::make_pair (0, 0)] = cur;
+
+        for (int l = 1; l < in.numLevels (); ++l)
+        {
+            LevelPixels<T> tmp (in.levelWidth (l), cur.h);
+            refReduceX (cur, tmp, filter, extX, l & 1);
+            LevelPixels<T> next (tmp.w, in.levelHeight (l));
+            refReduceY (tmp, next, filter, extY, l & 1);
+            levels[std::make_pair (l, l)] = next;
+            cur = next;
+        }
+    }
+    else
+    {
+        LevelPixels<T> column = c0;
+
+        for (int ly = 0; ly < in.numYLevels (); ++ly)
+        {
+            LevelPixels<T> cur = column;
+
+            for (int lx = 0; lx < in.numXLevels (); ++lx)
+            {
+                levels[std::make_pair (lx, ly)] = cur;
+
+                if (lx < in.numXLevels () - 1)
+                {
+                    LevelPixels<T> next (in.levelWidth (lx + 1), cur.h);
+                    refReduceX (cur, next, filter, extX, lx & 1);
+                    cur = next;
+                }
+            }
+
+            if (ly < in.numYLevels () - 1)
+            {
+                LevelPixels<T> next (column.w, in.levelHeight (ly + 1));
+                refReduceY (column, next, filter, extY, ly & 1);
+                column = next;
+            }
+        }
+    }
+
+    return levels;
+}
+
+template <class T>
+void
+compareChannel (
+    TiledInputFile&       in,
+    const char*           name,
+    PixelType             type,
+    const LevelPixels<T>& c0,
+    bool                  filter,
+    LevelWrap             extX,
+    LevelWrap             extY)
+{
+    std::map<std::pair<int, int>, LevelPixels<T>> ref =
+        refLevels (in, c0, filter, extX, extY);
+
+    for (auto& r: ref)
+    {
+        LevelPixels<T> l =
+            readLevel<T> (in, name, type, r.first.first, r.first.second);
+
+        assert (l.w == r.second.w && l.h == r.second.h);
+        assert (
+            memcmp (
+                l.p.data (), r.second.p.data (), l.p.size () * sizeof (T)) ==
+            0);
+    }
+}
+
+void
+testReference (
+    const std::string& fileName,
+    int                w,
+    int                h,
+    LevelMode          mode,
+    LevelRoundingMode  rmode,
+    LevelWrap          extX,
+    LevelWrap          extY)
+{
+    Header hdr (w, h);
+    hdr.compression () = ZIP_COMPRESSION;
+    hdr.channels ().insert ("H", Channel (HALF));
+    hdr.channels ().insert ("F", Channel (FLOAT));
+    hdr.channels ().insert ("U", Channel (UINT));
+    hdr.channels ().insert ("P", Channel (HALF));
+    hdr.setTileDescription (TileDescription (8, 8, mode, rmode));
+
+    LevelPixels<half>         ph (w, h);
+    LevelPixels<float>        pf (w, h);
+    LevelPixels<unsigned int> pu (w, h);
+    LevelPixels<half>         pp (w, h);
+
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            ph (x, y) = float (sin (x * 0.7) * cos (y * 0.3) * 4);
+            pf (x, y) = float (x * 0.37 - y * 1.3 + (x * y % 7));
+            pu (x, y) = (x * 7919u + y * 104729u) % 65536u;
+            pp (x, y) = float (x + y * 0.5);
+        }
+    }
+
+    Box2i       dw = hdr.dataWindow ();
+    FrameBuffer fb;
+    fb.insert ("H", Slice::Make (HALF, ph.p.data (), dw));
+    fb.insert ("F", Slice::Make (FLOAT, pf.p.data (), dw));
+    fb.insert ("U", Slice::Make (UINT, pu.p.data (), dw));
+    fb.insert ("P", Slice::Make (HALF, pp.p.data (), dw));
+
+    LevelGenerationOptions options;
+    options.filter = BSPLINE_FILTER;
+    options.wrapX  = extX;
+    options.wrapY  = extY;
+    options.pointSampledChannels.insert ("P");
+
+    {
+        remove (fileName.c_str ());
+        TiledOutputFile out (fileName.c_str (), hdr);
+        writeLevels (out, fb, options);
+    }
+
+    TiledInputFile in (fileName.c_str ());
+    compareChannel (in, "H", HALF, ph, true, extX, extY);
+    compareChannel (in, "F", FLOAT, pf, true, extX, extY);
+    compareChannel (in, "U", UINT, pu, true, extX, extY);
+    compareChannel (in, "P", HALF, pp, false, extX, extY);
+
+    remove (fileName.c_str ());
+}
+
+} // namespace
+
+void
+testTiledLevels (const std::string& tempDir)
+{
+    try
+    {
+        cout << "Testing tiled level generation" << endl;
+
+        std::string fn = tempDir + "imf_test_tiled_levels.exr";
+
+        int numThreads = globalThreadCount ();
+
+        for (int t: {0, 3})
+        {
+            setGlobalThreadCount (t);
+
+            for (int f = 0; f < NUM_LEVEL_FILTERS; ++f)
+            {
+                LevelGenerationOptions options;
+                options.filter = LevelFilter (f);
+                options.wrapX  = WRAP_MIRROR;
+                options.wrapY  = WRAP_PERIODIC;
+
+                cout << " threads " << t << " filter " << f << endl;
+
+                testLevels (fn, 64, 32, MIPMAP_LEVELS, options);
+                testLevels (fn, 64, 32, RIPMAP_LEVELS, options);
+                testLevels (fn, 64, 32, ONE_LEVEL, options);
+
+                if (options.filter != BOX_FILTER)
+                {
+                    testLevels (fn, 37, 19, MIPMAP_LEVELS, options);
+                    testLevels (fn, 37, 19, RIPMAP_LEVELS, options);
+                }
+            }
+
+            cout << " threads " << t << " point positions" << endl;
+            testPointPositions (fn, MIPMAP_LEVELS, false);
+            testPointPositions (fn, RIPMAP_LEVELS, false);
+            testPointPositions (fn, MIPMAP_LEVELS, true);
+            testPointPositions (fn, RIPMAP_LEVELS, true);
+
+            cout << " threads " << t << " black edges" << endl;
+            testBlackEdges (fn, WRAP_BLACK);
+            testBlackEdges (fn, WRAP_CLAMP);
+
+            cout << " threads " << t << " exrmaketiled reference" << endl;
+            for (LevelMode mode: {MIPMAP_LEVELS, RIPMAP_LEVELS})
+            {
+                for (LevelRoundingMode rmode: {ROUND_DOWN, ROUND_UP})
+                {
+                    testReference (
+                        fn, 37, 19, mode, rmode, WRAP_BLACK, WRAP_CLAMP);
+                    testReference (
+                        fn, 64, 33, mode, rmode, WRAP_PERIODIC, WRAP_MIRROR);
+                }
+            }
+        }
+
+        setGlobalThreadCount (numThreads);
+
+        cout << "ok\n" << endl;
+    }
+    catch (const std::exception& e)
+    {
+        cerr << "ERROR -- caught exception: " << e.what () << endl;
+        assert (false);
+    }
+}
@@ -19,7 +19,9 @@
 #include <ImfTiledOutputFile.h>
 #include <half.h>
 
+#include <algorithm>
 #include <assert.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <vector>
 
@@ -678,6 +680,137 @@ writeCopyRead (const std::string& tempDir, int w, int h, int xs, int ys)
     }
 }
 
+void
+writeReadSpiral (
+    const char  fileName[],
+    int         width,
+    int         height,
+    LineOrder   lorder,
+    Compression comp,
+    size_t      maxBuffered)
+{
+    cout << "LineOrder " << lorder << ", spiral tile order, "
+         << "compression " << comp << ", buffer limit " << maxBuffered
+         << endl;
+
+    Header hdr (width, height);
+    hdr.compression () = comp;
+    hdr.lineOrder ()   = lorder;
+    hdr.channels ().insert ("H", Channel (HALF, 1, 1));
+    hdr.setTileDescription (TileDescription (16, 16, ONE_LEVEL));
+
+    Array2D<half> ph1 (height, width);
+    fillPixels (ph1, width, height);
+
+    {
+        cout << " writing" << flush;
+
+        remove (fileName);
+        TiledOutputFile out (fileName, hdr);
+        out.setMaxBufferedTileBytes (maxBuffered);
+        assert (out.maxBufferedTileBytes () == maxBuffered);
+
+        FrameBuffer fb;
+        fb.insert (
+            "H",
+            Slice (
+                HALF,
+                (char*) &ph1[0][0],
+                sizeof (ph1[0][0]),
+                sizeof (ph1[0][0]) * width));
+        out.setFrameBuffer (fb);
+
+        //
+        // Emulate a bucket renderer working outwards from the center
+        // of the image, which holds back almost every tile.
+        //
+
+        int nx = out.numXTiles ();
+        int ny = out.numYTiles ();
+        int cx = nx / 2;
+        int cy = ny / 2;
+
+        std::vector<std::pair<int, int>> tiles;
+        for (int dy = 0; dy < ny; ++dy)
+            for (int dx = 0; dx < nx; ++dx)
+                tiles.push_back (std::make_pair (dx, dy));
+
+        std::stable_sort (
+            tiles.begin (),
+            tiles.end (),
+            [cx, cy] (
+                const std::pair<int, int>& a, const std::pair<int, int>& b) {
+                return max (abs (a.first - cx), abs (a.second - cy)) <
+                       max (abs (b.first - cx), abs (b.second - cy));
+            });
+
+        for (size_t i = 0; i < tiles.size (); ++i)
+        {
+            out.writeTile (tiles[i].first, tiles[i].second);
+
+            if (maxBuffered > 0)
+                assert (out.bufferedTileBytes () <= maxBuffered);
+        }
+
+        assert (out.bufferedTileBytes () == 0);
+    }
+
+    {
+        cout << " reading" << flush;
+
+        TiledInputFile in (fileName);
+        assert (in.isComplete ());
+        assert (in.header ().lineOrder () == lorder);
+
+        Array2D<half> ph2 (height, width);
+        FrameBuffer   fb;
+        fb.insert (
+            "H",
+            Slice (
+                HALF,
+                (char*) &ph2[0][0],
+                sizeof (ph2[0][0]),
+                sizeof (ph2[0][0]) * width));
+        in.setFrameBuffer (fb);
+        in.readTiles (0, in.numXTiles () - 1, 0, in.numYTiles () - 1);
+
+        cout << " comparing" << flush;
+
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                assert (ph1[y][x] == ph2[y][x]);
+    }
+
+    remove (fileName);
+    cout << endl;
+}
+
+void
+writeReadSpiral (const std::string& tempDir)
+{
+    std::string filename = tempDir + "imf_test_spiral.exr";
+
+    const int W = 203;
+    const int H = 171;
+
+    for (int lorder = 0; lorder < RANDOM_Y; ++lorder)
+    {
+        // no limit, a limit of a few tiles, and a limit too small
+        // for any tile so every held back tile is spilled
+        writeReadSpiral (
+            filename.c_str (), W, H, LineOrder (lorder), ZIP_COMPRESSION, 0);
+        writeReadSpiral (
+            filename.c_str (),
+            W,
+            H,
+            LineOrder (lorder),
+            ZIP_COMPRESSION,
+            4 * 16 * 16 * sizeof (half));
+        writeReadSpiral (
+            filename.c_str (), W, H, LineOrder (lorder), NO_COMPRESSION, 1);
+    }
+}
+
 } // namespace
 
 void
@@ -705,6 +838,7 @@ testTiledLineOrder (const std::string& tempDir)
             }
 
             writeCopyRead (tempDir, W, H, XS, YS);
+            writeReadSpiral (tempDir);
         }
 
         cout << "ok\n" << endl;
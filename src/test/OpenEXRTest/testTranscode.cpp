@@ -0,0 +1,311 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) Contributors to the OpenEXR Project.
+//
+
+#ifdef NDEBUG
+#    undef NDEBUG
+#endif
+
+#include <ImfArray.h>
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfInputPart.h>
+#include <ImfMultiPartInputFile.h>
+#include <ImfMultiPartOutputFile.h>
+#include <ImfOutputPart.h>
+#include <ImfPartType.h>
+#include <ImfThreading.h>
+#include <ImfTiledInputPart.h>
+#include <ImfTiledOutputPart.h>
+#include <ImfTranscode.h>
+#include <half.h>
+
+#include <assert.h>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <vector>
+
+using namespace OPENEXR_IMF_NAMESPACE;
+using namespace std;
+using namespace IMATH_NAMESPACE;
+
+namespace
+{
+
+const int W  = 66;
+const int H  = 94;
+const int X0 = -4;
+const int Y0 = 10;
+
+//
+// Part 0 is a scan line part with a subsampled channel, part 1 a
+// single channel scan line part, part 2 a mipmapped tiled part.
+//
+
+const int numParts = 3;
+
+float
+pixelValue (int part, int level, int x, int y)
+{
+    return part * 100.f + level * 10.f + x * 0.5f + y * 0.25f;
+}
+
+//
+// Frame buffer for the pixels of one part or level: channels H and F
+// at full resolution, and C sampled every other pixel and line.
+//
+
+struct Pixels
+{
+    Pixels (const Box2i& dw, bool subsampled)
+        : box (dw)
+        , w (dw.max.x - dw.min.x + 1)
+        , h (dw.max.y - dw.min.y + 1)
+        , ph (h, w)
+        , pf (h, w)
+        , pc (h / 2, w / 2)
+        , hasC (subsampled)
+    {
+        fb.insert (
+            "H",
+            Slice (
+                HALF,
+                (char*) (&ph[0][0] - dw.min.x - dw.min.y * w),
+                sizeof (half),
+                sizeof (half) * w));
+        fb.insert (
+            "F",
+            Slice (
+                FLOAT,
+                (char*) (&pf[0][0] - dw.min.x - dw.min.y * w),
+                sizeof (float),
+                sizeof (float) * w));
+
+        if (hasC)
+        {
+            fb.insert (
+                "C",
+                Slice (
+                    HALF,
+                    (char*) (&pc[0][0] - dw.min.x / 2 -
+                             (dw.min.y / 2) * (w / 2)),
+                    sizeof (half),
+                    sizeof (half) * (w / 2),
+                    2,
+                    2));
+        }
+    }
+
+    void fill (int part, int level)
+    {
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+            {
+                float v =
+                    pixelValue (part, level, x + box.min.x, y + box.min.y);
+                ph[y][x] = v;
+                pf[y][x] = v;
+            }
+
+        for (int y = 0; y < h / 2; ++y)
+            for (int x = 0; x < w / 2; ++x)
+                pc[y][x] = -pixelValue (part, level, x, y);
+    }
+
+    void check (int part, int level) const
+    {
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+            {
+                float v =
+                    pixelValue (part, level, x + box.min.x, y + box.min.y);
+                assert (ph[y][x] == half (v));
+                assert (pf[y][x] == v);
+            }
+
+        if (hasC)
+        {
+            for (int y = 0; y < h / 2; ++y)
+                for (int x = 0; x < w / 2; ++x)
+                    assert (
+                        pc[y][x] == half (-pixelValue (part, level, x, y)));
+        }
+    }
+
+    Box2i          box;
+    int            w;
+    int            h;
+    Array2D<half>  ph;
+    Array2D<float> pf;
+    Array2D<half>  pc;
+    bool           hasC;
+    FrameBuffer    fb;
+};
+
+void
+writeFile (const std::string& fileName)
+{
+    Box2i          dw (V2i (X0, Y0), V2i (X0 + W - 1, Y0 + H - 1));
+    vector<Header> headers;
+
+    for (int p = 0; p < numParts; ++p)
+    {
+        Header hdr (dw, dw);
+        hdr.compression () = p == 1 ? NO_COMPRESSION : PIZ_COMPRESSION;
+        hdr.channels ().insert ("H", Channel (HALF));
+        hdr.channels ().insert ("F", Channel (FLOAT));
+        if (p == 0) hdr.channels ().insert ("C", Channel (HALF, 2, 2));
+
+        ostringstream name;
+        name << "part" << p;
+        hdr.setName (name.str ());
+
+        if (p == 2)
+        {
+            hdr.setType (TILEDIMAGE);
+            hdr.setTileDescription (TileDescription (16, 12, MIPMAP_LEVELS));
+        }
+        else
+            hdr.setType (SCANLINEIMAGE);
+
+        headers.push_back (hdr);
+    }
+
+    remove (fileName.c_str ());
+    MultiPartOutputFile out (
+        fileName.c_str (), &headers[0], static_cast<int> (headers.size ()));
+
+    for (int p = 0; p < 2; ++p)
+    {
+        Pixels pixels (dw, p == 0);
+        pixels.fill (p, 0);
+
+        OutputPart part (out, p);
+        part.setFrameBuffer (pixels.fb);
+        part.writePixels (H);
+    }
+
+    TiledOutputPart part (out, 2);
+    for (int l = 0; l < part.numLevels (); ++l)
+    {
+        Pixels pixels (part.dataWindowForLevel (l), false);
+        pixels.fill (2, l);
+
+        part.setFrameBuffer (pixels.fb);
+        part.writeTiles (
+            0, part.numXTiles (l) - 1, 0, part.numYTiles (l) - 1, l);
+    }
+}
+
+void
+checkFile (const std::string& fileName, Compression compression)
+{
+    MultiPartInputFile in (fileName.c_str ());
+    assert (in.parts () == numParts);
+
+    Box2i dw (V2i (X0, Y0), V2i (X0 + W - 1, Y0 + H - 1));
+
+    for (int p = 0; p < numParts; ++p)
+    {
+        ostringstream name;
+        name << "part" << p;
+        assert (in.header (p).name () == name.str ());
+        assert (in.header (p).compression () == compression);
+        assert (
+            (in.header (p).channels ().findChannel ("C") != nullptr) ==
+            (p == 0));
+    }
+
+    for (int p = 0; p < 2; ++p)
+    {
+        Pixels pixels (dw, p == 0);
+
+        InputPart part (in, p);
+        part.setFrameBuffer (pixels.fb);
+        part.readPixels (Y0, Y0 + H - 1);
+        pixels.check (p, 0);
+    }
+
+    TiledInputPart part (in, 2);
+    assert (part.levelMode () == MIPMAP_LEVELS);
+    for (int l = 0; l < part.numLevels (); ++l)
+    {
+        Pixels pixels (part.dataWindowForLevel (l), false);
+
+        part.setFrameBuffer (pixels.fb);
+        part.readTiles (
+            0, part.numXTiles (l) - 1, 0, part.numYTiles (l) - 1, l);
+        pixels.check (2, l);
+    }
+}
+
+void
+testTranscodes (const std::string& inFile, const std::string& outFile)
+{
+    const Compression compressions[] = {
+        NO_COMPRESSION,
+        RLE_COMPRESSION,
+        ZIPS_COMPRESSION,
+        ZIP_COMPRESSION,
+        PIZ_COMPRESSION};
+
+    for (Compression c: compressions)
+    {
+        TranscodeSettings settings;
+        settings.compression = c;
+
+        transcodeFile (inFile.c_str (), outFile.c_str (), settings);
+        checkFile (outFile, c);
+    }
+
+    //
+    // the smallest window still writes the chunks in order
+    //
+
+    TranscodeSettings settings;
+    settings.compression         = ZIP_COMPRESSION;
+    settings.zipCompressionLevel = 9;
+    settings.window              = 1;
+
+    transcodeFile (inFile.c_str (), outFile.c_str (), settings);
+    checkFile (outFile, ZIP_COMPRESSION);
+
+    remove (outFile.c_str ());
+}
+
+} // namespace
+
+void
+testTranscode (const std::string& tempDir)
+{
+    try
+    {
+        cout << "Testing transcoding between compressions" << endl;
+
+        std::string inFile  = tempDir + "imf_test_transcode_in.exr";
+        std::string outFile = tempDir + "imf_test_transcode_out.exr";
+
+        writeFile (inFile);
+
+        int numThreads = globalThreadCount ();
+        for (int t: {0, 3})
+        {
+            setGlobalThreadCount (t);
+            cout << " threads " << t << endl;
+            testTranscodes (inFile, outFile);
+        }
+        setGlobalThreadCount (numThreads);
+
+        remove (inFile.c_str ());
+
+        cout << "ok\n" << endl;
+    }
+    catch (const std::exception& e)
+    {
+        cerr << "ERROR -- caught exception: " << e.what () << endl;
+        assert (false);
+    }
+}
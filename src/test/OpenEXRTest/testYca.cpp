@@ -178,6 +178,105 @@ writeReadYca (
     remove (fileName);
 }
 
+void
+readYca (
+    const char     fileName[],
+    const Box2i&   dw,
+    bool           oneCall,
+    Array2D<Rgba>& pixels)
+{
+    RgbaInputFile in (fileName);
+
+    int w = dw.max.x - dw.min.x + 1;
+    in.setFrameBuffer (&pixels[-dw.min.y][-dw.min.x], 1, w);
+
+    if (oneCall)
+        in.readPixels (dw.min.y, dw.max.y);
+    else
+        for (int y = dw.min.y; y <= dw.max.y; ++y)
+            in.readPixels (y);
+}
+
+bool
+sameBits (
+    const Array2D<Rgba>& pixels1, const Array2D<Rgba>& pixels2, int w, int h)
+{
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            const Rgba& p1 = pixels1[y][x];
+            const Rgba& p2 = pixels2[y][x];
+
+            if (p1.r.bits () != p2.r.bits () || p1.g.bits () != p2.g.bits () ||
+                p1.b.bits () != p2.b.bits () || p1.a.bits () != p2.a.bits ())
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void
+writeReadBands (
+    const char   fileName[],
+    const Box2i& dw,
+    RgbaChannels channels,
+    LineOrder    writeOrder,
+    void (*fillPixels) (Array2D<Rgba>& pixels, int w, int h))
+{
+    //
+    // Writing or reading many scan lines in one call converts
+    // between RGB and luminance/chroma in parallel bands; verify
+    // that the results are identical to those of converting one
+    // scan line at a time.
+    //
+
+    int           w = dw.max.x - dw.min.x + 1;
+    int           h = dw.max.y - dw.min.y + 1;
+    Array2D<Rgba> pixels (h, w);
+    Array2D<Rgba> pixels1 (h, w);
+    Array2D<Rgba> pixels2 (h, w);
+    Array2D<Rgba> pixels3 (h, w);
+
+    cout << w << " by " << h << " pixels, channels " << channels
+         << ", write order " << writeOrder << ", banded" << endl;
+
+    fillPixels (pixels, w, h);
+
+    for (int oneCall = 0; oneCall < 2; ++oneCall)
+    {
+        {
+            RgbaOutputFile out (
+                fileName,
+                dw,
+                dw, // display window, data window
+                channels,
+                1,          // pixelAspectRatio
+                V2f (0, 0), // screenWindowCenter
+                1,          // screenWindowWidth
+                writeOrder);
+
+            out.setFrameBuffer (&pixels[-dw.min.y][-dw.min.x], 1, w);
+
+            if (oneCall)
+                out.writePixels (h);
+            else
+                for (int y = 0; y < h; ++y)
+                    out.writePixels (1);
+        }
+
+        readYca (fileName, dw, false, oneCall ? pixels2 : pixels1);
+    }
+
+    assert (sameBits (pixels1, pixels2, w, h));
+
+    readYca (fileName, dw, true, pixels3);
+    assert (sameBits (pixels2, pixels3, w, h));
+
+    remove (fileName);
+}
+
 } // namespace
 
 void
@@ -197,6 +296,13 @@ testYca (const std::string& tempDir)
         dataWindow[4] = Box2i (V2i (0, 0), V2i (1, 1));
         dataWindow[5] = Box2i (V2i (-18, -28), V2i (247, 255));
 
+        //
+        // Taller than two conversion bands, so that the chroma filter
+        // window is carried across band boundaries.
+        //
+
+        Box2i tallWindow = Box2i (V2i (-8, -30), V2i (55, 1085));
+
         int maxThreads = ILMTHREAD_NAMESPACE::supportsThreads () ? 3 : 0;
 
         for (int n = 0; n <= maxThreads; ++n)
@@ -249,6 +355,38 @@ testYca (const std::string& tempDir)
                     }
                 }
             }
+
+            for (int writeOrder = INCREASING_Y; writeOrder <= DECREASING_Y;
+                 ++writeOrder)
+            {
+                writeReadBands (
+                    fileName.c_str (),
+                    dataWindow[5],
+                    WRITE_YCA,
+                    LineOrder (writeOrder),
+                    fillPixelsColor);
+
+                writeReadBands (
+                    fileName.c_str (),
+                    dataWindow[5],
+                    WRITE_YA,
+                    LineOrder (writeOrder),
+                    fillPixelsGray);
+
+                writeReadBands (
+                    fileName.c_str (),
+                    tallWindow,
+                    WRITE_YCA,
+                    LineOrder (writeOrder),
+                    fillPixelsColor);
+
+                writeReadBands (
+                    fileName.c_str (),
+                    tallWindow,
+                    WRITE_YA,
+                    LineOrder (writeOrder),
+                    fillPixelsGray);
+            }
         }
 
         cout << "ok\n" << endl;
@@ -61,4 +61,10 @@ print(" ".join(result.args))
 assert(result.returncode == 0), "\n"+result.stderr
 assert('tiled image has levels: x 1 y 1' in result.stdout), "\n"+result.stdout
 
+# -v reports every level as it is written
+result = run ([exrmaketiled, "-m", "-v", image, outimage], stdout=PIPE, stderr=PIPE, universal_newlines=True)
+print(" ".join(result.args))
+assert(result.returncode == 0), "\n"+result.stderr
+assert(f"writing file {outimage}\nlevel (0, 0)\nlevel (1, 1)\n" in result.stdout), "\n"+result.stdout
+
 print("success")
@@ -48,7 +48,7 @@ assert(version in result.stdout), "\n"+result.stdout
 
 # test missing arguments, using just the -option but no value
 
-for a in ["-p","-l","-16","-z","-t","-i","--passes","-o","--pixelmode","--time"]:
+for a in ["-p","-l","-16","-z","-t","-i","--passes","-o","--pixelmode","--time","--threads"]:
     result = run ([exrmetrics, a], stdout=PIPE, stderr=PIPE, universal_newlines=True)
     print(" ".join(result.args))
     print(result.stderr)
@@ -77,4 +77,43 @@ for image in [f"{image_dir}/TestImages/GrayRampsHorizontal.exr",f"{image_dir}/Be
                   for x in ['file','pixels','compression','part type','total raw size']:
                      assert(x in data[0]),"\n Missing field "+x
 
+# --threads sweeps thread counts, reporting the count and the read stages
+image = f"{image_dir}/TestImages/GrayRampsHorizontal.exr"
+command = [exrmetrics, "-i", image, "--threads", "1,2", "--time", "read,reread", "-o", outimage]
+result = run (command, stdout=PIPE, stderr=PIPE, universal_newlines=True)
+print(" ".join(result.args))
+assert(result.returncode == 0), "\n"+result.stderr
+data = json.loads(result.stdout)
+runs = data[0]["metrics"]
+assert([r["threads"] for r in runs] == [1,2]), "\n"+result.stdout
+for r in runs:
+    for x in ["read stages","re-read stages","process peak memory"]:
+        assert(x in r), "\n Missing field "+x
+    for x in ["io time","decompress time","unpack time","bytes read","peak buffer size"]:
+        assert(x in r["read stages"]), "\n Missing read stage field "+x
+    assert(r["read stages"]["bytes read"] > 0), "\n"+result.stdout
+    assert(r["process peak memory"] > 0), "\n"+result.stdout
+
+result = run (command + ["--csv"], stdout=PIPE, stderr=PIPE, universal_newlines=True)
+print(" ".join(result.args))
+assert(result.returncode == 0), "\n"+result.stderr
+lines = [l for l in result.stdout.split("\n") if l]
+columns = lines[0].split(",")
+for x in ["threads","read io time","read decompress time","read unpack time",
+          "read peak buffer size","reread time p90","reread io time",
+          "reread peak buffer size","process peak memory"]:
+    assert(x in columns), "\n Missing CSV column "+x
+assert(len(lines) == 3), "\n"+result.stdout
+rows = [l.split(",") for l in lines[1:]]
+for row in rows:
+    assert(len(row) == len(columns)), "\n"+result.stdout
+assert([row[columns.index("threads")] for row in rows] == ["1","2"]), "\n"+result.stdout
+
+# -t and -m select a single count, and can not be combined with --threads
+for a in [["-t","2"],["-m"]]:
+    result = run ([exrmetrics, "-i", image, "--threads", "1,2", "-o", outimage] + a, stdout=PIPE, stderr=PIPE, universal_newlines=True)
+    print(" ".join(result.args))
+    assert(result.returncode != 0), "\n"+result.stderr
+    assert("--threads" in result.stderr), "\n"+result.stderr
+
 print("success")
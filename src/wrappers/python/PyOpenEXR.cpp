@@ -30,6 +30,8 @@
 #include <ImfDeepFrameBuffer.h>
 #include <ImfPartType.h>
 #include <ImfArray.h>
+#include <ImfThreading.h>
+#include <IlmThreadPool.h>
 
 #include <ImfBoxAttribute.h>
 #include <ImfChannelListAttribute.h>
@@ -51,6 +53,8 @@
 #include <ImfTimeCodeAttribute.h>
 #include <ImfVecAttribute.h>
 
+#include <functional>
+#include <mutex>
 #include <typeinfo>
 #include <sys/types.h>
 
@@ -140,10 +144,12 @@ PyFile::PyFile(const py::dict& header, const py::dict& channels)
 // e.g. "left.R", "left.G", etc, the channel key is the prefix.
 //
 
-PyFile::PyFile(const std::string& filename, bool separate_channels, bool header_only)
+PyFile::PyFile(const std::string& filename, bool separate_channels, bool header_only,
+               bool lazy)
     : filename(filename), header_only(header_only)
 {
-    MultiPartInputFile infile(filename.c_str());
+    auto input = std::make_shared<PyInputFile>(filename);
+    MultiPartInputFile& infile = input->file();
 
     for (int part_index = 0; part_index < infile.parts(); part_index++)
     {
@@ -195,13 +201,14 @@ PyFile::PyFile(const std::string& filename, bool separate_channels, bool header_
         std::vector<size_t> shape ({height, width});
 
         //
-        // Read the channel data, different for image vs. deep
+        // Read the channel data, different for image vs. deep. Deep
+        // data is always read up front.
         //
         
         auto type = header.type();
         if (type == SCANLINEIMAGE || type == TILEDIMAGE)
         {
-            P.readPixels(infile, header.channels(), shape, rgbaChannels, dw, separate_channels);
+            P.readPixels(input, header.channels(), shape, rgbaChannels, dw, separate_channels, lazy);
         }
         else if (type == DEEPSCANLINE || type == DEEPTILE)
         {
@@ -209,12 +216,140 @@ PyFile::PyFile(const std::string& filename, bool separate_channels, bool header_
         }
         parts.append(py::cast<PyPart>(PyPart(P)));
     } // for parts
+
+    //
+    // Lazy channels keep the file open until they're read; keep it for
+    // read() as well.
+    //
+    
+    if (lazy)
+        _input = input;
+}
+
+PyInputFile::PyInputFile(const std::string& filename)
+{
+    //
+    // Opening the file reads the headers and offset tables, which
+    // needs no Python objects, so let other Python threads run.
+    //
+    
+    py::gil_scoped_release release;
+    _file.reset (new MultiPartInputFile (filename.c_str()));
 }
 
 void
-PyPart::readPixels(MultiPartInputFile& infile, const ChannelList& channel_list,
+PyInputFile::readPixels(int part_index, const FrameBuffer& frameBuffer,
+                        int scanLine1, int scanLine2)
+{
+    //
+    // The numpy arrays in the framebuffer must be kept alive by the
+    // caller, who holds the GIL for them.
+    //
+    
+    py::gil_scoped_release release;
+    std::lock_guard<std::mutex> lock (_mutex);
+
+    InputPart part (*_file, part_index);
+
+    part.setFrameBuffer (frameBuffer);
+    part.readPixels (scanLine1, scanLine2);
+}
+
+void
+PyInputFile::readRegion(int part_index, const FrameBuffer& frameBuffer,
+                        const Box2i& box)
+{
+    py::gil_scoped_release release;
+    std::lock_guard<std::mutex> lock (_mutex);
+
+    InputPart part (*_file, part_index);
+
+    part.setFrameBuffer (frameBuffer);
+    part.readRegion (box);
+}
+
+//
+// Add a slice for the given file channel to the framebuffer, reading
+// into or writing from the given (height,width) array or, for gathered
+// R, G, B and A channels, the given offset of a (height,width,nrgba)
+// array. The first row of the array is the first scanline of the
+// window. The slice takes the array's strides, so the pixels are read
+// or written in place, whatever the array's layout. Subsampled channels
+// keep their legacy layout, a contiguous full-resolution array, so they
+// must be contiguous.
+//
+
+static void
+insertSlice(FrameBuffer& frameBuffer, const std::string& name, PixelType type,
+            const py::array& pixels, int nrgba, int offset,
+            const Box2i& window, int xSampling, int ySampling)
+{
+    for (py::ssize_t d = 0; d < pixels.ndim(); d++)
+        if (pixels.strides(d) < 0)
+            throw std::invalid_argument("pixel arrays with negative strides are not supported");
+
+    if ((xSampling != 1 || ySampling != 1) &&
+        !(pixels.flags() & py::array::c_style))
+        throw std::invalid_argument("pixel arrays of subsampled channels must be contiguous");
+    
+    auto basePtr = static_cast<uint8_t*>(const_cast<void*>(pixels.data()));
+    if (nrgba > 0 && pixels.ndim() == 3)
+        basePtr += offset * pixels.strides(2);
+
+    size_t xStride = pixels.strides(1);
+    size_t yStride = pixels.strides(0) / xSampling;
+
+    frameBuffer.insert (name,
+                        Slice::Make (type,
+                                     (void*) basePtr,
+                                     window, xStride, yStride,
+                                     xSampling,
+                                     ySampling));
+}
+
+//
+// Return the offset of a gathered channel in the last dimension of its
+// array: R, G, B, A.
+//
+
+static int
+rgbaOffset(char channel_name)
+{
+    switch (channel_name)
+    {
+      case 'G':
+          return 1;
+      case 'B':
+          return 2;
+      case 'A':
+          return 3;
+      default:
+          return 0;
+    }
+}
+
+static py::array
+newPixelArray(PixelType type, const std::vector<size_t>& shape)
+{
+    const auto style = py::array::c_style | py::array::forcecast;
+
+    switch (type)
+    {
+      case UINT:
+          return py::array_t<uint32_t,style>(shape);
+      case HALF:
+          return py::array_t<half,style>(shape);
+      case FLOAT:
+          return py::array_t<float,style>(shape);
+      default:
+          throw std::runtime_error("invalid pixel type");
+    }
+}
+
+void
+PyPart::readPixels(const std::shared_ptr<PyInputFile>& input, const ChannelList& channel_list,
                    const std::vector<size_t>& shape, const std::set<std::string>& rgbaChannels,
-                   const Box2i& dw, bool separate_channels)
+                   const Box2i& dw, bool separate_channels, bool lazy)
 {
     FrameBuffer frameBuffer;
 
@@ -241,8 +376,6 @@ PyPart::readPixels(MultiPartInputFile& infile, const ChannelList& channel_list,
             C.ySampling = c.channel().ySampling;
             C.pLinear = c.channel().pLinear;
                 
-            const auto style = py::array::c_style | py::array::forcecast;
-
             std::vector<size_t> c_shape = shape;
 
             //
@@ -254,80 +387,126 @@ PyPart::readPixels(MultiPartInputFile& infile, const ChannelList& channel_list,
             if (rgbaChannels.find(c.name()) != rgbaChannels.end())
                 c_shape.push_back(nrgba);
 
-            switch (c.channel().type)
+            if (lazy)
             {
-              case UINT:
-                  C.pixels = py::array_t<uint32_t,style>(c_shape);
-                  break;
-              case HALF:
-                  C.pixels = py::array_t<half,style>(c_shape);
-                  break;
-              case FLOAT:
-                  C.pixels = py::array_t<float,style>(c_shape);
-                  break;
-              default:
-                  throw std::runtime_error("invalid pixel type");
-            } // switch c->type
+                //
+                // Record where to read the pixels from; the file
+                // channels are added below.
+                //
+                
+                C._lazy = std::make_shared<PyLazyChannel>();
+                C._lazy->input = input;
+                C._lazy->part_index = part_index;
+                C._lazy->dw = dw;
+                C._lazy->type = c.channel().type;
+                C._lazy->xSampling = C.xSampling;
+                C._lazy->ySampling = C.ySampling;
+                C._lazy->nrgba = nrgba;
+            }
+            else
+                C.pixels = newPixelArray(c.channel().type, c_shape);
 
             channels[py_channel_name.c_str()] = C;
         }
 
+        auto v = channels[py_channel_name.c_str()];
+        auto& C = v.cast<PyChannel&>();
+
+        int offset = nrgba > 0 ? rgbaOffset(channel_name) : 0;
+        
+        if (lazy)
+        {
+            C._lazy->file_channels.push_back (std::make_pair (std::string (c.name()), offset));
+            continue;
+        }
+        
         //
         // Add a slice to the framebuffer
         //
         
-        auto v = channels[py_channel_name.c_str()];
-        auto C = v.cast<PyChannel&>();
+        insertSlice (frameBuffer, c.name(), c.channel().type, C.pixels,
+                         nrgba, offset, dw, C.xSampling, C.ySampling);
+    } // for header.channels()
+
+    if (lazy)
+        return;
+
+    //
+    // Read the pixels. The numpy arrays are owned by this part's
+    // channels dict, which no other thread can see yet, so the
+    // decode runs without the GIL.
+    //
+    
+    input->readPixels (part_index, frameBuffer, dw.min.y, dw.max.y);
+}
+
+py::array
+PyLazyChannel::read()
+{
+    if (_pixels)
+        return _pixels.cast<py::array>();
+    
+    size_t width  = dw.max.x - dw.min.x + 1;
+    size_t height = dw.max.y - dw.min.y + 1;
+
+    std::vector<size_t> shape ({height, width});
+    if (nrgba > 0)
+        shape.push_back (nrgba);
 
-        py::buffer_info buf = C.pixels.request();
-        auto basePtr = static_cast<uint8_t*>(buf.ptr);
+    py::array pixels = newPixelArray (type, shape);
 
+    FrameBuffer frameBuffer;
+    for (auto& fc : file_channels)
+        insertSlice (frameBuffer, fc.first, type, pixels, nrgba, fc.second,
+                         dw, xSampling, ySampling);
+
+    input->readPixels (part_index, frameBuffer, dw.min.y, dw.max.y);
+
+    _pixels = pixels;
+    return pixels;
+}
+
+//
+// Return the pixel array, reading it first if the channel is lazy.
+//
+
+const py::array&
+PyChannel::array() const
+{
+    if (_lazy)
+    {
         //
-        // Offset the pointer for the channel
+        // read() releases the GIL, so another thread may load this
+        // channel and drop _lazy meanwhile: hold on to it, and keep
+        // whichever array was stored first.
         //
         
-        py::dtype dt = C.pixels.dtype();
-        size_t xStride = dt.itemsize();
-        if (nrgba > 0)
+        std::shared_ptr<PyLazyChannel> lazy = _lazy;
+        py::array p = lazy->read();
+        if (_lazy == lazy)
         {
-            xStride *= nrgba;
-            switch (channel_name)
-            {
-              case 'R':
-                  break;
-              case 'G':
-                  basePtr += dt.itemsize();
-                  break;
-              case 'B':
-                  basePtr += 2 * dt.itemsize();
-                  break;
-              case 'A':
-                  basePtr += 3 * dt.itemsize();
-                  break;
-              default:
-                  break;
-            }
+            pixels = p;
+            _lazy.reset();
         }
+    }
+    return pixels;
+}
 
-        size_t yStride = xStride * shape[1] / C.xSampling;
-
-        frameBuffer.insert (c.name(),
-                            Slice::Make (c.channel().type,
-                                         (void*) basePtr,
-                                         dw, xStride, yStride,
-                                         C.xSampling,
-                                         C.ySampling));
-    } // for header.channels()
+//
+// Return the (height,width) of the pixel array, without reading it.
+//
 
+V2i
+PyChannel::arrayShape() const
+{
+    if (_lazy)
+        return V2i(_lazy->dw.max.y - _lazy->dw.min.y + 1,
+                   _lazy->dw.max.x - _lazy->dw.min.x + 1);
 
-    //
-    // Read the pixels
-    //
-    
-    InputPart part (infile, part_index);
+    if (pixels.ndim() < 2 ||  pixels.ndim() > 3)
+        throw std::invalid_argument("error: channel must have a 2D or 3D array");
 
-    part.setFrameBuffer (frameBuffer);
-    part.readPixels (dw.min.y, dw.max.y);
+    return V2i(pixels.shape(0), pixels.shape(1));
 }
 
 void
@@ -566,14 +745,23 @@ PyPart::readDeepPixels(MultiPartInputFile& infile, const std::string& type, cons
                                        c.channel().ySampling));
     } // for header.channels()
 
+    //
+    // The sample counts and samples are read without the GIL;
+    // allocating the per-pixel numpy arrays in between needs it.
+    //
+    
     if (type == DEEPSCANLINE)
     {
         DeepScanLineInputPart part (infile, part_index);
         part.setFrameBuffer (frameBuffer);
-        part.readPixelSampleCounts (dw.min.y, dw.max.y);
+        {
+            py::gil_scoped_release release;
+            part.readPixelSampleCounts (dw.min.y, dw.max.y);
+        }
 
         setDeepSliceData(channel_list, height, width, sliceDataMap, rgbaChannelMap, sampleCount);
 
+        py::gil_scoped_release release;
         part.readPixels (dw.min.y, dw.max.y);
     }
     else if (type == DEEPTILE)
@@ -584,10 +772,14 @@ PyPart::readDeepPixels(MultiPartInputFile& infile, const std::string& type, cons
         int numXTiles = part.numXTiles (0);
         int numYTiles = part.numYTiles (0);
 
-        part.readPixelSampleCounts (0, numXTiles - 1, 0, numYTiles - 1);
+        {
+            py::gil_scoped_release release;
+            part.readPixelSampleCounts (0, numXTiles - 1, 0, numYTiles - 1);
+        }
 
         setDeepSliceData(channel_list, height, width, sliceDataMap, rgbaChannelMap, sampleCount);
 
+        py::gil_scoped_release release;
         part.readTiles (0, numXTiles - 1, 0, numYTiles - 1);
     }
 }
@@ -596,11 +788,21 @@ void
 PyPart::writePixels(MultiPartOutputFile& outfile, const Box2i& dw) const
 {
     FrameBuffer frameBuffer;
-        
+
+    //
+    // Hold a reference to every pixel array in the framebuffer, so
+    // none is freed by another Python thread while the GIL is
+    // released below.
+    //
+    
+    std::vector<py::array> pixels;
+    
     for (auto c : channels)
     {
         auto C = c.second.cast<const PyChannel&>();
 
+        pixels.push_back (C.array());
+
         auto pixelType = C.pixelType();
             
         if (C.pixels.ndim() == 3)
@@ -616,64 +818,35 @@ PyPart::writePixels(MultiPartOutputFile& outfile, const Box2i& dw) const
             else
                 name_prefix = C.name + ".";
                 
-            py::buffer_info buf = C.pixels.request();
-            auto basePtr = static_cast<uint8_t*>(buf.ptr);
-            py::dtype dt = C.pixels.dtype();
             int nrgba = C.pixels.shape(2);
-            size_t xStride = dt.itemsize() * nrgba;
-            size_t yStride = xStride * width() / C.xSampling;
                     
-            auto rPtr = basePtr;
-            frameBuffer.insert (name_prefix + "R",
-                                Slice::Make (pixelType,
-                                             static_cast<void*>(rPtr),
-                                             dw, xStride, yStride,
-                                             C.xSampling,
-                                             C.ySampling));
-
-            auto gPtr = &basePtr[dt.itemsize()];
-            frameBuffer.insert (name_prefix + "G",
-                                Slice::Make (pixelType,
-                                             static_cast<void*>(gPtr),
-                                             dw, xStride, yStride,
-                                             C.xSampling,
-                                             C.ySampling));
-
-            auto bPtr = &basePtr[2*dt.itemsize()];
-            frameBuffer.insert (name_prefix + "B",
-                                Slice::Make (pixelType,
-                                             static_cast<void*>(bPtr),
-                                             dw, xStride, yStride,
-                                             C.xSampling,
-                                             C.ySampling));
-
+            insertSlice (frameBuffer, name_prefix + "R", pixelType, C.pixels,
+                         nrgba, 0, dw, C.xSampling, C.ySampling);
+            insertSlice (frameBuffer, name_prefix + "G", pixelType, C.pixels,
+                         nrgba, 1, dw, C.xSampling, C.ySampling);
+            insertSlice (frameBuffer, name_prefix + "B", pixelType, C.pixels,
+                         nrgba, 2, dw, C.xSampling, C.ySampling);
             if (nrgba == 4)
-            {
-                auto aPtr = &basePtr[3*dt.itemsize()];
-                frameBuffer.insert (name_prefix + "A",
-                                    Slice::Make (pixelType,
-                                                 static_cast<void*>(aPtr),
-                                                 dw, xStride, yStride,
-                                                 C.xSampling,
-                                                 C.ySampling));
-            }
+                insertSlice (frameBuffer, name_prefix + "A", pixelType, C.pixels,
+                             nrgba, 3, dw, C.xSampling, C.ySampling);
         }
         else
         {
-            frameBuffer.insert (C.name,
-                                Slice::Make (pixelType,
-                                             static_cast<void*>(C.pixels.request().ptr),
-                                             dw, 0, 0,
-                                             C.xSampling,
-                                             C.ySampling));
+            insertSlice (frameBuffer, C.name, pixelType, C.pixels,
+                         0, 0, dw, C.xSampling, C.ySampling);
         }
     }
                 
-    if (type() == EXR_STORAGE_SCANLINE)
+    auto h = height();
+    auto storage = type();
+
+    py::gil_scoped_release release;
+
+    if (storage == EXR_STORAGE_SCANLINE)
     {
         OutputPart part(outfile, part_index);
         part.setFrameBuffer (frameBuffer);
-        part.writePixels (height());
+        part.writePixels (h);
     }
     else
     {
@@ -838,10 +1011,19 @@ PyPart::writeDeepPixels(MultiPartOutputFile& outfile, const Box2i& dw) const
 
     std::vector<std::shared_ptr<Array2DVoidPtr>> sliceDatas;
 
+    //
+    // Hold a reference to every pixel array, since the framebuffer
+    // points into their samples while the GIL is released below.
+    //
+    
+    std::vector<py::array> pixels;
+
     for (auto c : channels)
     {
         const PyChannel& C = c.second.cast<const PyChannel&>();
 
+        pixels.push_back (C.pixels);
+
         if (C.pixels.dtype().kind() != 'O')
             throw std::runtime_error("Expected deep pixel array with dtype 'O'");
 
@@ -864,7 +1046,11 @@ PyPart::writeDeepPixels(MultiPartOutputFile& outfile, const Box2i& dw) const
         }
     }
 
-    if (type() == EXR_STORAGE_DEEP_SCANLINE)
+    auto storage = type();
+
+    py::gil_scoped_release release;
+
+    if (storage == EXR_STORAGE_DEEP_SCANLINE)
     {
         DeepScanLineOutputPart part(outfile, part_index);
         part.setFrameBuffer (frameBuffer);
@@ -971,6 +1157,7 @@ PyFile::__exit__(py::args args)
         P.channels.clear();
     }
     parts = py::list();
+    _input.reset();
 }
 
 void
@@ -1010,6 +1197,387 @@ PyFile::channels(int part_index)
     return parts[part_index].cast<PyPart&>().channels;
 }
 
+//
+// The file to read pixels from: the open file of a lazily read File,
+// otherwise the file is opened again.
+//
+
+std::shared_ptr<PyInputFile>
+PyFile::inputFile()
+{
+    if (_input)
+        return _input;
+
+    if (filename.empty())
+        throw std::runtime_error("File has no filename to read from");
+
+    return std::make_shared<PyInputFile>(filename);
+}
+
+bool objectToBox2i(const py::object& object, Box2i& b);
+
+static bool
+numpyVersionAtLeast(int major, int minor)
+{
+    std::string version = py::str(py::module_::import("numpy").attr("__version__"));
+    std::istringstream in(version);
+    int M = 0, m = 0;
+    char dot = 0;
+    if (!(in >> M >> dot >> m) || dot != '.')
+        return false;
+    return M > major || (M == major && m >= minor);
+}
+
+//
+// Return a numpy array sharing the memory of the given object: a numpy
+// array, an object supporting the buffer protocol, or any object
+// supporting DLPack, e.g. a CPU torch tensor. Unlike casting to
+// py::array, this never copies. Before NumPy 2.1, and for producers
+// without versioned DLPack, DLPack arrays are read-only.
+//
+
+static py::array
+sharedArray(const py::object& object)
+{
+    if (py::isinstance<py::array>(object))
+        return object.cast<py::array>();
+
+    py::module_ numpy = py::module_::import("numpy");
+
+    if (py::isinstance<py::buffer>(object))
+        return numpy.attr("asarray")(object).cast<py::array>();
+
+    if (py::hasattr(object, "__dlpack__"))
+    {
+        if (numpyVersionAtLeast(2, 1))
+            return numpy.attr("from_dlpack")(object, py::arg("copy") = false).cast<py::array>();
+        return numpy.attr("from_dlpack")(object).cast<py::array>();
+    }
+
+    throw std::invalid_argument("expected a numpy array or an object supporting DLPack");
+}
+
+//
+// Read the given channels of a part, or all of them, for the given
+// window of the data window, or all of it, into a dict of
+// (height,width) arrays by channel name. Arrays in "out" are read into
+// in place, whatever their strides, e.g. the channels of one
+// interleaved (height,width,4) array; other arrays are allocated.
+//
+
+py::dict
+PyFile::read(int part_index, const py::object& channels,
+             const py::object& window, const py::dict& out)
+{
+    auto input = inputFile();
+    MultiPartInputFile& infile = input->file();
+
+    validate_part_index(part_index, infile.parts());
+
+    const Header& header = infile.header(part_index);
+    if (header.type() != SCANLINEIMAGE && header.type() != TILEDIMAGE)
+        throw std::invalid_argument("read() does not support deep parts");
+
+    const Box2i& dw = header.dataWindow();
+    Box2i roi = dw;
+    if (!window.is_none())
+    {
+        if (!objectToBox2i(window, roi))
+            throw std::invalid_argument("window must be a tuple ((xmin,ymin),(xmax,ymax))");
+
+        if (roi.isEmpty() || !dw.intersects(roi.min) || !dw.intersects(roi.max))
+        {
+            std::stringstream err;
+            err << "window " << roi.min << " - " << roi.max
+                << " is not within the data window " << dw.min << " - " << dw.max;
+            throw std::invalid_argument(err.str());
+        }
+    }
+
+    std::vector<std::string> names;
+    if (channels.is_none())
+    {
+        for (auto c = header.channels().begin(); c != header.channels().end(); c++)
+            names.push_back(c.name());
+    }
+    else
+    {
+        for (auto c : channels)
+        {
+            std::string name = py::str(c);
+            if (!header.channels().findChannel(name))
+                throw std::invalid_argument("no channel '" + name + "' in part");
+            names.push_back(name);
+        }
+    }
+
+    size_t width  = roi.max.x - roi.min.x + 1;
+    size_t height = roi.max.y - roi.min.y + 1;
+
+    py::dict result;
+    FrameBuffer frameBuffer;
+
+    for (auto& name : names)
+    {
+        const Channel& channel = *header.channels().findChannel(name);
+
+        if (roi != dw && (channel.xSampling != 1 || channel.ySampling != 1))
+            throw std::invalid_argument("cannot read a window of subsampled channel '" + name + "'");
+
+        py::array pixels;
+        if (out.contains(name))
+        {
+            pixels = sharedArray(out[py::str(name)]);
+
+            PyChannel C(name.c_str(), pixels);
+            if (C.pixelType() != channel.type ||
+                pixels.ndim() != 2 ||
+                static_cast<size_t>(pixels.shape(0)) != height ||
+                static_cast<size_t>(pixels.shape(1)) != width ||
+                !pixels.writeable())
+            {
+                std::stringstream err;
+                err << "out array for channel '" << name << "' must be a writeable "
+                    << height << "x" << width << " array of the channel's pixel type";
+                if (!pixels.writeable() && py::hasattr(out[py::str(name)], "__dlpack__"))
+                    err << " (DLPack arrays are read-only before NumPy 2.1, or if the "
+                        << "producer lacks versioned DLPack)";
+                throw std::invalid_argument(err.str());
+            }
+        }
+        else
+            pixels = newPixelArray(channel.type, {height, width});
+
+        result[py::str(name)] = pixels;
+
+        insertSlice (frameBuffer, name, channel.type, pixels, 0, 0, roi,
+                     channel.xSampling, channel.ySampling);
+    }
+
+    //
+    // A window narrower than the data window only decodes the tiles
+    // (or scanlines) that overlap it, straight into the arrays.
+    //
+
+    if (roi.min.x == dw.min.x && roi.max.x == dw.max.x)
+        input->readPixels (part_index, frameBuffer, roi.min.y, roi.max.y);
+    else
+        input->readRegion (part_index, frameBuffer, roi);
+
+    return result;
+}
+
+//
+// Batch reading: a task on the global thread pool runs a function for
+// one file of the batch, keeping the message of any exception it
+// throws to raise in Python once the batch is done.
+//
+
+class PyBatchTask : public ILMTHREAD_NAMESPACE::Task
+{
+public:
+    PyBatchTask(ILMTHREAD_NAMESPACE::TaskGroup* group,
+                const std::function<void(size_t)>& fn, size_t index, std::string& error)
+        : Task(group), _fn(fn), _index(index), _error(error) {}
+
+    void execute() override
+    {
+        try
+        {
+            _fn(_index);
+        }
+        catch (std::exception& e)
+        {
+            _error = e.what();
+        }
+        catch (...)
+        {
+            _error = "unknown error";
+        }
+    }
+
+private:
+    const std::function<void(size_t)>& _fn;
+    size_t                             _index;
+    std::string&                       _error;
+};
+
+//
+// Run fn(i) for every file of the batch on the global thread pool, with
+// the GIL released, and raise the first error.
+//
+
+static void
+runBatch(const std::vector<std::string>& filenames, const std::function<void(size_t)>& fn)
+{
+    std::vector<std::string> errors (filenames.size());
+
+    {
+        py::gil_scoped_release release;
+
+        // The TaskGroup destructor waits for the tasks to finish
+        ILMTHREAD_NAMESPACE::TaskGroup group;
+        for (size_t i = 0; i < filenames.size(); i++)
+            ILMTHREAD_NAMESPACE::ThreadPool::addGlobalTask (
+                new PyBatchTask (&group, fn, i, errors[i]));
+    }
+
+    for (size_t i = 0; i < filenames.size(); i++)
+        if (!errors[i].empty())
+            throw std::runtime_error(filenames[i] + ": " + errors[i]);
+}
+
+static PixelType
+dtypeToPixelType(const py::object& object)
+{
+    auto dt = py::dtype::from_args(object);
+    if (dt.kind() == 'f' && dt.itemsize() == 2)
+        return HALF;
+    if (dt.kind() == 'f' && dt.itemsize() == 4)
+        return FLOAT;
+    if (dt.kind() == 'u' && dt.itemsize() == 4)
+        return UINT;
+    throw std::invalid_argument("dtype must be float16, float32 or uint32");
+}
+
+//
+// Read the same channels of the same part of a list of files into
+// stacked (nfiles,height,width) arrays, one per channel. The files are
+// opened and decoded in parallel on the global thread pool, a file per
+// task, each file reading its chunks in that task.
+//
+
+static py::dict
+readBatch(const std::vector<std::string>& filenames, int part_index,
+          const py::object& channels, const py::object& window, const py::object& dtype)
+{
+    size_t nfiles = filenames.size();
+    if (nfiles == 0)
+        throw std::invalid_argument("no files to read");
+
+    std::vector<std::unique_ptr<MultiPartInputFile>> files (nfiles);
+
+    runBatch (filenames, [&](size_t i)
+    {
+        files[i].reset (new MultiPartInputFile (filenames[i].c_str(), 0));
+    });
+
+    //
+    // The first file gives the channels and pixel types, every file
+    // must have the channels and a window of the same size.
+    //
+    
+    Box2i userWindow;
+    if (!window.is_none() && !objectToBox2i(window, userWindow))
+        throw std::invalid_argument("window must be a tuple ((xmin,ymin),(xmax,ymax))");
+
+    std::vector<std::string> names;
+    std::vector<PixelType>   types;
+    std::vector<Box2i>       dws (nfiles);
+    std::vector<Box2i>       rois (nfiles);
+
+    for (size_t i = 0; i < nfiles; i++)
+    {
+        validate_part_index(part_index, files[i]->parts());
+
+        const Header& header = files[i]->header(part_index);
+        if (header.type() != SCANLINEIMAGE && header.type() != TILEDIMAGE)
+            throw std::invalid_argument(filenames[i] + ": deep parts are not supported");
+
+        if (i == 0)
+        {
+            if (channels.is_none())
+            {
+                for (auto c = header.channels().begin(); c != header.channels().end(); c++)
+                    names.push_back(c.name());
+            }
+            else
+            {
+                for (auto c : channels)
+                    names.push_back(py::str(c));
+            }
+
+            for (auto& name : names)
+            {
+                const Channel* channel = header.channels().findChannel(name);
+                if (!channel)
+                    throw std::invalid_argument(filenames[i] + ": no channel '" + name + "' in part");
+                types.push_back(dtype.is_none() ? channel->type : dtypeToPixelType(dtype));
+            }
+        }
+
+        for (auto& name : names)
+        {
+            const Channel* channel = header.channels().findChannel(name);
+            if (!channel)
+                throw std::invalid_argument(filenames[i] + ": no channel '" + name + "' in part");
+            if (channel->xSampling != 1 || channel->ySampling != 1)
+                throw std::invalid_argument(filenames[i] + ": subsampled channel '" + name + "' is not supported");
+        }
+
+        dws[i] = header.dataWindow();
+        rois[i] = window.is_none() ? dws[i] : userWindow;
+
+        if (rois[i].isEmpty() || !dws[i].intersects(rois[i].min) || !dws[i].intersects(rois[i].max))
+        {
+            std::stringstream err;
+            err << filenames[i] << ": window " << rois[i].min << " - " << rois[i].max
+                << " is not within the data window " << dws[i].min << " - " << dws[i].max;
+            throw std::invalid_argument(err.str());
+        }
+        
+        if (rois[i].size() != rois[0].size())
+            throw std::invalid_argument(filenames[i] + ": image size differs from " + filenames[0]);
+    }
+
+    size_t width  = rois[0].max.x - rois[0].min.x + 1;
+    size_t height = rois[0].max.y - rois[0].min.y + 1;
+
+    py::dict result;
+    std::vector<uint8_t*> data;
+    std::vector<size_t> itemsizes;
+    for (size_t c = 0; c < names.size(); c++)
+    {
+        py::array pixels = newPixelArray(types[c], {nfiles, height, width});
+        result[py::str(names[c])] = pixels;
+        data.push_back(static_cast<uint8_t*>(pixels.mutable_data()));
+        itemsizes.push_back(pixels.dtype().itemsize());
+    }
+
+    runBatch (filenames, [&](size_t i)
+    {
+        const Box2i& dw = dws[i];
+        const Box2i& roi = rois[i];
+
+        FrameBuffer frameBuffer;
+        for (size_t c = 0; c < names.size(); c++)
+        {
+            size_t itemsize = itemsizes[c];
+            uint8_t* dst = data[c] + i * height * width * itemsize;
+            frameBuffer.insert (names[c],
+                                Slice::Make (types[c], dst, roi,
+                                             itemsize, width * itemsize));
+        }
+
+        //
+        // A window narrower than the data window only decodes the
+        // tiles (or scanlines) that overlap it, straight into this
+        // file's slice of the stacked arrays.
+        //
+
+        InputPart part (*files[i], part_index);
+        part.setFrameBuffer (frameBuffer);
+        if (roi.min.x == dw.min.x && roi.max.x == dw.max.x)
+            part.readPixels (roi.min.y, roi.max.y);
+        else
+            part.readRegion (roi);
+
+        files[i].reset();
+    });
+
+    return result;
+}
+
 //
 // Write the PyFile to the given filename
 //
@@ -1089,13 +1657,15 @@ PyFile::write(const char* outfilename)
             auto C = py::cast<PyChannel&>(c.second);
             auto pixelType = C.pixelType();
 
+            const py::array& pixels = C.array();
+            
             int nrgba;
-            if (C.pixels.dtype().kind() == 'O')
-                nrgba = get_deep_nrgba(C.pixels);
-            else if (C.pixels.ndim() == 2)
+            if (pixels.dtype().kind() == 'O')
+                nrgba = get_deep_nrgba(pixels);
+            else if (pixels.ndim() == 2)
                 nrgba = 0;
             else
-                nrgba = C.pixels.shape(2);
+                nrgba = pixels.shape(2);
 
             if (nrgba > 0)
             {
@@ -1124,7 +1694,12 @@ PyFile::write(const char* outfilename)
         headers.push_back (header);
     }
 
-    MultiPartOutputFile outfile(outfilename, headers.data(), headers.size());
+    std::unique_ptr<MultiPartOutputFile> outfile_ptr;
+    {
+        py::gil_scoped_release release;
+        outfile_ptr.reset (new MultiPartOutputFile (outfilename, headers.data(), headers.size()));
+    }
+    MultiPartOutputFile& outfile = *outfile_ptr;
 
     //
     // Write the channel data: add slices to the framebuffer and write.
@@ -1151,6 +1726,15 @@ PyFile::write(const char* outfilename)
             throw std::runtime_error("invalid type");
     }
 
+    //
+    // Closing the file writes the offset tables
+    //
+    
+    {
+        py::gil_scoped_release release;
+        outfile_ptr.reset();
+    }
+
     filename = outfilename;
 }
 
@@ -1999,15 +2583,16 @@ PyPart::PyPart(const py::dict& header, const py::dict& channels, const std::stri
         // Accept a py::array as the py::dict value, but replace it with a PyChannel object.
         //
         
-        if (py::isinstance<py::array>(c.second))
+        if (py::isinstance<PyChannel>(c.second))
         {
-            std::string channel_name = py::str(c.first);
-            py::array a = c.second.cast<py::array>();
-            channels[channel_name.c_str()] = PyChannel(channel_name.c_str(), a);
+            c.second.cast<PyChannel&>().name = py::str(c.first);
         }
-        else if (py::isinstance<PyChannel>(c.second))
+        else if (py::isinstance<py::array>(c.second) || py::isinstance<py::buffer>(c.second) ||
+                 py::hasattr(c.second, "__dlpack__"))
         {
-            c.second.cast<PyChannel&>().name = py::str(c.first);
+            std::string channel_name = py::str(c.first);
+            py::array a = sharedArray(py::reinterpret_borrow<py::object>(c.second));
+            channels[channel_name.c_str()] = PyChannel(channel_name.c_str(), a);
         }
         else
             throw std::invalid_argument("Channel value must be a Channel() object or a numpy pixel array");
@@ -2085,10 +2670,7 @@ PyPart::shape() const
     {
         auto C = py::cast<PyChannel&>(c.second);
 
-        if (C.pixels.ndim() < 2 ||  C.pixels.ndim() > 3)
-            throw std::invalid_argument("error: channel must have a 2D or 3D array");
-
-        V2i c_S(C.pixels.shape(0), C.pixels.shape(1));
+        V2i c_S = C.arrayShape();
             
         if (S == V2i(0, 0))
         {
@@ -2168,6 +2750,9 @@ PyPart::typeString() const
 PixelType
 PyChannel::pixelType() const
 {
+    if (_lazy)
+        return _lazy->type;
+    
     auto buf = py::array::ensure(pixels);
     if (buf)
     {
@@ -2230,6 +2815,84 @@ PYBIND11_MODULE(OpenEXR, m)
     
     init_OpenEXR_old(m.ptr());
 
+    //
+    // Threading: pixel data is read and written without the GIL, so
+    // Python threads overlap their I/O, and each file decodes or
+    // encodes its chunks on the global IlmThread pool.
+    //
+
+    m.def("setGlobalThreadCount",
+          [](int count)
+          {
+              if (count < 0)
+                  throw std::invalid_argument("thread count must be non-negative");
+              
+              // Resizing the pool waits for its running tasks
+              py::gil_scoped_release release;
+              setGlobalThreadCount (count);
+          },
+          py::arg("count"),
+          R"pbdoc(
+          Set the number of worker threads in the global thread pool
+          used to compress and decompress image data.
+
+          Parameters
+          ----------
+          count : int
+              The number of threads. 0 (the default) decodes and encodes
+              in the calling thread.
+
+          Example
+          -------
+          >>> OpenEXR.setGlobalThreadCount(8)
+          )pbdoc");
+
+    m.def("read_batch", &readBatch,
+          py::arg("filenames"),
+          py::arg("part_index") = 0,
+          py::arg("channels") = py::none(),
+          py::arg("window") = py::none(),
+          py::arg("dtype") = py::none(),
+          R"pbdoc(
+          Read the same channels of a list of files into stacked arrays.
+
+          The files are opened and decoded in parallel on the global thread
+          pool (see setGlobalThreadCount), one file per task, with the GIL
+          released.
+
+          Parameters
+          ----------
+          filenames : list
+              The paths of the image files.
+          part_index : int
+              The index of the part to read in each file. Defaults to 0.
+          channels : list
+              The names of the channels to read, e.g. "R" or "depth.Z".
+              Defaults to the channels of the first file.
+          window : tuple
+              The ((xmin,ymin),(xmax,ymax)) region to read from each file,
+              inclusive. Defaults to each file's data window, which must all
+              be the same size.
+          dtype : numpy.dtype
+              The type to convert the pixels to: float16, float32 or uint32.
+              Defaults to each channel's type in the first file.
+
+          Returns
+          -------
+          dict : The (len(filenames),height,width) arrays, by channel name.
+
+          Example
+          -------
+          >>> OpenEXR.setGlobalThreadCount(8)
+          >>> batch = OpenEXR.read_batch(paths, channels=["R", "G", "B"], dtype="float32")
+          >>> images = np.stack([batch["R"], batch["G"], batch["B"]], axis=-1)
+          )pbdoc");
+
+    m.def("globalThreadCount", &globalThreadCount,
+          R"pbdoc(
+          Return the number of worker threads in the global thread pool.
+          )pbdoc");
+
     //
     // Enums
     //
@@ -2513,9 +3176,16 @@ PYBIND11_MODULE(OpenEXR, m)
              R"pbdoc(
              bool : The pLinear value, used for DWA compression.
              )pbdoc")
-        .def_readwrite("pixels", &PyChannel::pixels,
+        .def_property("pixels",
+             [](const PyChannel& c) { return c.array(); },
+             [](PyChannel& c, const py::array& pixels)
+             {
+                 c.pixels = pixels;
+                 c._lazy.reset();
+             },
              R"pbdoc(
-             np.array : The channel pixel array.
+             np.array : The channel pixel array. For a File read with lazy=True,
+             the pixels are read on first access.
              )pbdoc")
         .def_readonly("channel_index", &PyChannel::channel_index,
              R"pbdoc(
@@ -2619,10 +3289,11 @@ PYBIND11_MODULE(OpenEXR, m)
          >>> f.write("out.exr")
     )pbdoc")
         .def(py::init<>())
-        .def(py::init<std::string,bool,bool>(),
+        .def(py::init<std::string,bool,bool,bool>(),
              py::arg("filename"),
              py::arg("separate_channels")=false,
              py::arg("header_only")=false,
+             py::arg("lazy")=false,
              R"pbdoc(
              Initialize a File by reading the image from the given filename.
 
@@ -2635,10 +3306,16 @@ PYBIND11_MODULE(OpenEXR, m)
                  if False (default), read pixel data into a single "RGB" or "RGBA" numpy array of dimension (height,width,3) or (height,width,4);
              header_only : bool
                  If True, read only the header metadata, not the image pixel data.
+             lazy : bool
+                 If True, read a channel's pixel data when its `pixels` are first
+                 accessed, keeping the file open until then. Deep parts are always
+                 read up front.
 
              Example
              -------  
              >>> f = OpenEXR.File("image.exr", separate_channels=False, header_only=False)
+             >>> f = OpenEXR.File("aovs.exr", separate_channels=True, lazy=True)
+             >>> Z = f.channels()["Z"].pixels
              )pbdoc")
         .def(py::init<py::dict,py::dict>(),
              py::arg("header"),
@@ -2734,6 +3411,41 @@ PYBIND11_MODULE(OpenEXR, m)
              >>> f.channels(0)
              {'A': Channel("A", xSampling=1, ySampling=1), 'B': Channel("B", xSampling=1, ySampling=1), 'G': Channel("G", xSampling=1, ySampling=1), 'R': Channel("R", xSampling=1, ySampling=1)}
              )pbdoc")
+        .def("read", &PyFile::read,
+             py::arg("part_index") = 0,
+             py::arg("channels") = py::none(),
+             py::arg("window") = py::none(),
+             py::arg("out") = py::dict(),
+             R"pbdoc(
+             Read the pixels of selected channels of a part, optionally for
+             a window of the data window, from the file the File was read from.
+
+             Parameters
+             ----------
+             part_index : int
+                 The index of the part. Defaults to 0.
+             channels : list
+                 The names of the channels in the file to read, e.g. "R" or
+                 "depth.Z". Defaults to all channels.
+             window : tuple
+                 The ((xmin,ymin),(xmax,ymax)) region to read, inclusive, in
+                 the coordinates of the data window. Defaults to the data window.
+             out : dict
+                 Arrays to read into, by channel name. Each must be a writeable
+                 (height,width) array of the channel's pixel type, of any strides:
+                 a numpy array, a buffer, or a DLPack object such as a CPU torch
+                 tensor (writeable with NumPy 2.1 or later and versioned DLPack).
+                 Arrays are allocated for the other channels.
+
+             Returns
+             -------
+             dict : The (height,width) pixel arrays, by channel name.
+
+             Example
+             -------
+             >>> f = OpenEXR.File("aovs.exr", header_only=True)
+             >>> Z = f.read(channels=["Z"], window=((0,0),(63,63)))["Z"]
+             )pbdoc")
         .def("write", &PyFile::write,
              R"pbdoc(
              Write the File to the give file name.
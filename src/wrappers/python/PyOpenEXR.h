@@ -14,11 +14,35 @@ typedef std::map<std::string,std::unique_ptr<Array2DVoidPtr>> SliceDataMap;
 class PyPart;
 class PyChannel;
 
+//
+// PyInputFile is an open input file, shared by a File and the channels
+// it reads lazily. Pixels are read without the GIL; the mutex keeps
+// setting a part's framebuffer and reading into it together.
+//
+
+class PyInputFile
+{
+public:
+    PyInputFile(const std::string& filename);
+
+    MultiPartInputFile& file() { return *_file; }
+
+    void         readPixels(int part_index, const FrameBuffer& frameBuffer,
+                            int scanLine1, int scanLine2);
+    void         readRegion(int part_index, const FrameBuffer& frameBuffer,
+                            const Box2i& box);
+
+private:
+    std::mutex                          _mutex;
+    std::unique_ptr<MultiPartInputFile> _file;
+};
+
 class PyFile 
 {
 public:
     PyFile() {}
-    PyFile(const std::string& filename, bool separate_channels = false, bool header_only = false);
+    PyFile(const std::string& filename, bool separate_channels = false, bool header_only = false,
+           bool lazy = false);
     PyFile(const py::dict& header, const py::dict& channels);
     PyFile(const py::list& parts);
 
@@ -28,6 +52,9 @@ public:
     py::dict&    header(int part_index = 0);
     py::dict&    channels(int part_index = 0);
 
+    py::dict     read(int part_index, const py::object& channels,
+                      const py::object& window, const py::dict& out);
+
     void         write(const char* filename);
     
     std::string  filename;
@@ -36,6 +63,10 @@ public:
 protected:
     
     bool         header_only;
+
+    std::shared_ptr<PyInputFile> _input;
+
+    std::shared_ptr<PyInputFile> inputFile();
     
     py::object   getAttributeObject(const std::string& name, const Attribute* a);
     
@@ -78,9 +109,9 @@ class PyPart
                                     std::map<std::string,PyChannel*>& rgbaChannelMap,
                                     const Array2D<unsigned int>& sampleCount);
 
-    void           readPixels(MultiPartInputFile& infile, const ChannelList& channel_list,
+    void           readPixels(const std::shared_ptr<PyInputFile>& input, const ChannelList& channel_list,
                               const std::vector<size_t>& shape, const std::set<std::string>& rgbaChannels,
-                              const Box2i& dw, bool separate_channels);
+                              const Box2i& dw, bool separate_channels, bool lazy);
     void           readDeepPixels(MultiPartInputFile& infile, const std::string& type, const ChannelList& channel_list,
                                   const std::vector<size_t>& shape, const std::set<std::string>& rgbaChannels,
                                   const Box2i& dw, bool separate_channels);
@@ -89,6 +120,31 @@ class PyPart
     
 };
 
+//
+// PyLazyChannel holds what is needed to read a channel's pixels on
+// first access: the file, the part, and the file channels that make up
+// the channel with their offset in the last dimension of the array, for
+// R, G, B and A channels gathered into one (height,width,nrgba) array.
+//
+
+class PyLazyChannel
+{
+public:
+    std::shared_ptr<PyInputFile>             input;
+    int                                      part_index;
+    Box2i                                    dw;
+    PixelType                                type;
+    int                                      xSampling;
+    int                                      ySampling;
+    int                                      nrgba;
+    std::vector<std::pair<std::string,int>>  file_channels;
+
+    py::array                                read();
+
+private:
+    py::object                               _pixels;
+};
+
 //
 // PyChannel holds information for a channel of a PyPart: name, type, x/y
 // sampling, and the array of pixel data.
@@ -127,16 +183,21 @@ public:
 
     PixelType             pixelType() const;
 
+    const py::array&      array() const;
+    V2i                   arrayShape() const;
+
     std::string           name;
     int                   xSampling;
     int                   ySampling;
     int                   pLinear;
-    py::array             pixels;
+    mutable py::array     pixels;
     size_t                channel_index;
 
     mutable PixelType      _type;
     mutable int            _nrgba;
 
+    mutable std::shared_ptr<PyLazyChannel> _lazy;
+
     void                   validatePixelArray();
     template<class T> void setSliceDataPtr(Array2DVoidPtr& slice_data,const py::array& a,
                                            size_t y, size_t x,
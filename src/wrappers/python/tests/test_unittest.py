@@ -564,5 +564,301 @@ class TestUnittest(unittest.TestCase):
             with OpenEXR.File(outfilename, separate_channels=True) as i:
                 compare_files (i, outfile2)
 
+    def test_lazy_read(self):
+
+        #
+        # Read channels on first access, and read selected channels and
+        # windows on request.
+        #
+
+        width = 10
+        height = 20
+        size = width * height
+        R = np.array([i for i in range(0,size)], dtype='f').reshape((height, width))
+        G = np.array([i*10 for i in range(0,size)], dtype='f').reshape((height, width))
+        Z = np.array([i for i in range(0,size)], dtype='e').reshape((height, width))
+        channels = {
+            "R" : OpenEXR.Channel("R", R, 1, 1),
+            "G" : OpenEXR.Channel("G", G, 1, 1),
+            "Z" : OpenEXR.Channel("Z", Z, 1, 1)
+        }
+        header = {}
+
+        with OpenEXR.File(header, channels) as outfile:
+            outfilename = mktemp_outfilename()
+            outfile.write(outfilename)
+
+            with OpenEXR.File(outfilename, separate_channels=True, lazy=True) as infile:
+                self.assertEqual(infile.parts[0].width(), width)
+                self.assertEqual(infile.channels()["Z"].type(), OpenEXR.HALF)
+                self.assertTrue(np.array_equal(infile.channels()["Z"].pixels, Z))
+                compare_files(infile, outfile)
+
+            #
+            # Threads loading the same lazy channel all get the same array
+            #
+
+            import threading
+            with OpenEXR.File(outfilename, separate_channels=True, lazy=True) as infile:
+                channel = infile.channels()["R"]
+                results = [None] * 8
+                def load(i):
+                    results[i] = channel.pixels
+                threads = [threading.Thread(target=load, args=(i,)) for i in range(len(results))]
+                for t in threads:
+                    t.start()
+                for t in threads:
+                    t.join()
+                for p in results:
+                    self.assertTrue(p is channel.pixels)
+                self.assertTrue(np.array_equal(channel.pixels, R))
+
+            with OpenEXR.File(outfilename, header_only=True) as infile:
+
+                pixels = infile.read(channels=["G"])
+                self.assertEqual(list(pixels.keys()), ["G"])
+                self.assertTrue(np.array_equal(pixels["G"], G))
+
+                window = ((2,3),(6,9))
+                pixels = infile.read(channels=["R", "Z"], window=window)
+                self.assertTrue(np.array_equal(pixels["R"], R[3:10,2:7]))
+                self.assertTrue(np.array_equal(pixels["Z"], Z[3:10,2:7]))
+
+                out = np.zeros((7,5), dtype='f')
+                pixels = infile.read(channels=["R"], window=window, out={"R" : out})
+                self.assertTrue(pixels["R"] is out)
+                self.assertTrue(np.array_equal(out, R[3:10,2:7]))
+
+                with self.assertRaises(Exception):
+                    infile.read(channels=["R"], out={"R" : np.zeros((2,2), dtype='f')})
+                with self.assertRaises(Exception):
+                    infile.read(channels=["nope"])
+                with self.assertRaises(Exception):
+                    infile.read(window=((0,0),(width,height)))
+
+    def test_tiled_window(self):
+
+        #
+        # A window of a tiled part decodes only the tiles that overlap
+        # it, straight into the output arrays
+        #
+
+        width = 37
+        height = 29
+        size = width * height
+        R = np.array([i for i in range(0,size)], dtype='f').reshape((height, width))
+        Z = np.array([i % 2048 for i in range(0,size)], dtype='e').reshape((height, width))
+        channels = {
+            "R" : OpenEXR.Channel("R", R, 1, 1),
+            "Z" : OpenEXR.Channel("Z", Z, 1, 1)
+        }
+        tiles = OpenEXR.TileDescription()
+        tiles.xSize = 8
+        tiles.ySize = 8
+        header = { "type" : OpenEXR.tiledimage, "tiles" : tiles }
+
+        filenames = []
+        for n in range(2):
+            with OpenEXR.File(header, channels) as outfile:
+                outfilename = mktemp_outfilename()
+                outfile.write(outfilename)
+                filenames.append(outfilename)
+
+        for window in [((3,2),(30,25)), ((8,8),(15,15)), ((0,5),(36,6)), ((36,28),(36,28))]:
+            (x0,y0),(x1,y1) = window
+            with OpenEXR.File(filenames[0], header_only=True) as infile:
+                pixels = infile.read(window=window)
+                self.assertTrue(np.array_equal(pixels["R"], R[y0:y1+1,x0:x1+1]))
+                self.assertTrue(np.array_equal(pixels["Z"], Z[y0:y1+1,x0:x1+1]))
+
+                out = np.zeros((y1-y0+1,x1-x0+1,2), dtype='f')
+                infile.read(channels=["R"], window=window, out={"R" : out[:,:,1]})
+                self.assertTrue(np.array_equal(out[:,:,1], R[y0:y1+1,x0:x1+1]))
+                self.assertFalse(out[:,:,0].any())
+
+            batch = OpenEXR.read_batch(filenames, window=window)
+            for n in range(2):
+                self.assertTrue(np.array_equal(batch["R"][n], R[y0:y1+1,x0:x1+1]))
+                self.assertTrue(np.array_equal(batch["Z"][n], Z[y0:y1+1,x0:x1+1]))
+
+    def test_strided_arrays(self):
+
+        #
+        # Write from and read into strided views of interleaved
+        # buffers, which are used in place.
+        #
+
+        width = 10
+        height = 20
+        size = width * height
+        RGBA = np.array([i for i in range(0,size*4)], dtype='e').reshape((height, width, 4))
+        channels = {
+            "R" : OpenEXR.Channel("R", RGBA[:,:,0], 1, 1),
+            "G" : OpenEXR.Channel("G", RGBA[:,:,1], 1, 1),
+            "B" : OpenEXR.Channel("B", RGBA[:,:,2], 1, 1),
+            "A" : OpenEXR.Channel("A", RGBA[:,:,3], 1, 1)
+        }
+        header = {}
+
+        with OpenEXR.File(header, channels) as outfile:
+            outfilename = mktemp_outfilename()
+            outfile.write(outfilename)
+
+            with OpenEXR.File(outfilename) as infile:
+                self.assertTrue(np.array_equal(infile.channels()["RGBA"].pixels, RGBA))
+
+                buf = np.zeros((height, width, 4), dtype='e')
+                out = { "R" : buf[:,:,0], "G" : buf[:,:,1], "B" : buf[:,:,2], "A" : buf[:,:,3] }
+                infile.read(out=out)
+                self.assertTrue(np.array_equal(buf, RGBA))
+
+                window = ((2,3),(6,9))
+                buf = np.zeros((7, 5, 4), dtype='e')
+                out = { "R" : buf[:,:,0], "G" : buf[:,:,1], "B" : buf[:,:,2], "A" : buf[:,:,3] }
+                infile.read(window=window, out=out)
+                self.assertTrue(np.array_equal(buf, RGBA[3:10,2:7,:]))
+
+        # A channel from a larger interleaved buffer, written in place
+
+        big = np.array([i for i in range(0,size*8)], dtype='f').reshape((height, width*2, 4))
+        RGB = big[:,::2,:3]
+        with OpenEXR.File(header, { "RGB" : RGB }) as outfile:
+            outfilename = mktemp_outfilename()
+            outfile.write(outfilename)
+
+            with OpenEXR.File(outfilename) as infile:
+                self.assertTrue(np.array_equal(infile.channels()["RGB"].pixels, RGB))
+
+            # Any writeable buffer can be read into
+
+            with OpenEXR.File(outfilename, header_only=True) as infile:
+                buf = memoryview(bytearray(size * 4)).cast('f', (height, width))
+                infile.read(channels=["RGB.R"], out={ "RGB.R" : buf })
+                self.assertTrue(np.array_equal(np.asarray(buf), RGB[:,:,0]))
+
+        # Subsampled channels keep their contiguous layout
+
+        Z = np.zeros((height, width*2), dtype='f')[:,::2]
+        with OpenEXR.File(header, { "Z" : OpenEXR.Channel("Z", Z, 2, 2) }) as outfile:
+            with self.assertRaises(Exception):
+                outfile.write(mktemp_outfilename())
+
+    def test_dlpack(self):
+
+        #
+        # Write from and read into DLPack tensors
+        #
+
+        try:
+            import torch
+        except ImportError:
+            self.skipTest("torch is not installed")
+
+        width = 10
+        height = 20
+        size = width * height
+        R = torch.arange(size, dtype=torch.float32).reshape((height, width))
+        header = {}
+
+        with OpenEXR.File(header, { "R" : R }) as outfile:
+            outfilename = mktemp_outfilename()
+            outfile.write(outfilename)
+
+        with OpenEXR.File(outfilename, header_only=True) as infile:
+            out = torch.zeros((height, width), dtype=torch.float32)
+            if (np.lib.NumpyVersion(np.__version__) >= "2.1.0" and
+                np.from_dlpack(out, copy=False).flags.writeable):
+                infile.read(out={ "R" : out })
+                self.assertTrue(torch.equal(out, R))
+            else:
+                # read-only DLPack arrays are rejected, not copied
+                with self.assertRaises(Exception):
+                    infile.read(out={ "R" : out })
+
+    def test_read_batch(self):
+
+        #
+        # Read the same channels of several files into stacked arrays
+        #
+
+        width = 10
+        height = 20
+        size = width * height
+        filenames = []
+        images = []
+        for n in range(3):
+            R = np.array([i+n for i in range(0,size)], dtype='f').reshape((height, width))
+            Z = np.array([i*n for i in range(0,size)], dtype='e').reshape((height, width))
+            with OpenEXR.File({}, { "R" : R, "Z" : Z }) as outfile:
+                outfilename = mktemp_outfilename()
+                outfile.write(outfilename)
+            filenames.append(outfilename)
+            images.append((R, Z))
+
+        batch = OpenEXR.read_batch(filenames)
+        self.assertEqual(batch["R"].shape, (3, height, width))
+        self.assertEqual(batch["Z"].dtype, np.float16)
+        for n in range(3):
+            self.assertTrue(np.array_equal(batch["R"][n], images[n][0]))
+            self.assertTrue(np.array_equal(batch["Z"][n], images[n][1]))
+
+        batch = OpenEXR.read_batch(filenames, channels=["Z"], window=((2,3),(6,9)), dtype="float32")
+        self.assertEqual(list(batch.keys()), ["Z"])
+        self.assertEqual(batch["Z"].dtype, np.float32)
+        for n in range(3):
+            self.assertTrue(np.array_equal(batch["Z"][n], images[n][1][3:10,2:7].astype('f')))
+
+        with self.assertRaises(Exception):
+            OpenEXR.read_batch(filenames + ["/nonexistent.exr"])
+        with self.assertRaises(Exception):
+            OpenEXR.read_batch(filenames, channels=["nope"])
+
+    def test_threads(self):
+
+        #
+        # Read and write from several Python threads at once, with the
+        # global thread pool enabled, and verify every result.
+        #
+
+        import threading
+
+        default_count = OpenEXR.globalThreadCount()
+        OpenEXR.setGlobalThreadCount(4)
+        self.assertEqual(OpenEXR.globalThreadCount(), 4)
+
+        with self.assertRaises(Exception):
+            OpenEXR.setGlobalThreadCount(-1)
+
+        width = 64
+        height = 128
+        size = width * height
+        R = np.array([i for i in range(0,size)], dtype='f').reshape((height, width))
+        channels = { "R" : OpenEXR.Channel("R", R, 1, 1) }
+        header = { "compression" : OpenEXR.ZIP_COMPRESSION }
+
+        with OpenEXR.File(header, channels) as outfile:
+            outfilename = mktemp_outfilename()
+            outfile.write(outfilename)
+
+        errors = []
+        def worker():
+            try:
+                for i in range(4):
+                    with OpenEXR.File(outfilename, separate_channels=True) as infile:
+                        compare_files(infile, outfile)
+                        copyname = mktemp_outfilename()
+                        infile.write(copyname)
+            except Exception as e:
+                errors.append(e)
+
+        threads = [threading.Thread(target=worker) for i in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+        OpenEXR.setGlobalThreadCount(default_count)
+        self.assertEqual(errors, [])
+
 if __name__ == '__main__':
     unittest.main()